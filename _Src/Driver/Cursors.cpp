@@ -3,6 +3,8 @@
 #include "Interface.h"
 #include "Implementation.h"
 #include "NativeCursors.h"
+#include "NativeWorkers.h"
+#include "NativePrefixCounts.h"
 
 using namespace SimpleBdb::Driver::Implementation;
 
@@ -18,6 +20,10 @@ using SimpleBdb::Driver::ICursor;
 using SimpleBdb::Driver::FetchOptions;
 using SimpleBdb::Utils::BytesTable;
 using SimpleBdb::Utils::SegmentPosition;
+using SimpleBdb::Utils::KeySchema;
+using SimpleBdb::Utils::KeyField;
+using SimpleBdb::Utils::BytesSegment;
+using System::Diagnostics::Stopwatch;
 
 #define INVOKE_NATIVE(f, retriesCount) \
 	array<Byte>^ keyBytes = keyAccessor_->buffer_->DangerousBytes; \
@@ -30,6 +36,7 @@ using SimpleBdb::Utils::SegmentPosition;
 			f; \
 		} \
 		catch(const NativeBufferSmallException& e) { \
+			bufferSmallRetries_++; \
 			keyAccessor_->EnsureChunkCapacity(e.KeySize()); \
 			valueAccessor_->EnsureChunkCapacity(e.ValueSize()); \
 			keyBytes = keyAccessor_->buffer_->DangerousBytes; \
@@ -49,7 +56,7 @@ template <typename TReader>
 AbstractCursor<TReader>::AbstractCursor(Database^ db, TReader* reader, unsigned int readRetriesCount, unsigned int chunksCount)
 	:db_(db), reader_(reader),
 	keyAccessor_(gcnew BufferAllocator(db->keysState_, chunksCount)),
-	valueAccessor_(gcnew BufferAllocator(db->valuesState_, chunksCount)), readRetriesCount_(readRetriesCount),
+	valueAccessor_(gcnew BufferAllocator(db->valuesState_, chunksCount)), readRetriesCount_(readRetriesCount), bufferSmallRetries_(0),
 	BdbComponent(db_->logger_, "cursor for " + db_->description_) {
 }
 
@@ -66,8 +73,25 @@ void AbstractCursor<TReader>::Close() {
 	reader_ = nullptr;
 }
 
+template <typename TReader>
+ReadCounters AbstractCursor<TReader>::Counters() {
+	NativeReadCounters counters = reader_->Counters();
+	ReadCounters result;
+	result.Seeks = counters.seeks;
+	result.Steps = counters.steps;
+	result.BytesCopied = counters.bytesCopied;
+	result.BufferSmallRetries = bufferSmallRetries_;
+	return result;
+}
+
 template <typename TReader>
 BytesTable^ AbstractCursor<TReader>::Fetch(FetchOptions options, unsigned int take) {
+	return Fetch(options, take, gcnew BytesTable());
+}
+
+//arrays of fresh target are allocated exactly, reused target keeps bigger ones, so steady paging doesn't allocate
+template <typename TReader>
+BytesTable^ AbstractCursor<TReader>::Fetch(FetchOptions options, unsigned int take, BytesTable^ target) {
 	CheckOpen();
 	bool needKeys = options == FetchOptions::Keys || options == FetchOptions::KeysAndValues;
 	bool needValues = options == FetchOptions::Values || options == FetchOptions::KeysAndValues;
@@ -76,11 +100,10 @@ BytesTable^ AbstractCursor<TReader>::Fetch(FetchOptions options, unsigned int ta
 		columnsCount++;
 	if (needValues)
 		columnsCount++;
-	array<Byte>^ store = nullptr;
-	array<SegmentPosition>^ positions = gcnew array<SegmentPosition>(columnsCount * take);
-	unsigned int rowsCount = 0;
+	array<SegmentPosition>^ positions = target->ReservePositions(columnsCount * take);
+	target->SetShape(0, columnsCount);
 	if (take == 0)
-		return gcnew BytesTable(store, positions, rowsCount, columnsCount);
+		return target;
 	NativeReaderFetcher<TReader> fetcher(*reader_, needKeys, needValues, take);
 	INVOKE_NATIVE({
 		unsigned int storeSize = 0;
@@ -89,17 +112,16 @@ BytesTable^ AbstractCursor<TReader>::Fetch(FetchOptions options, unsigned int ta
 		if (needValues)
 			storeSize += valueAccessor_->chunkSize_;
 		storeSize *= take;
-		array<Byte>^ newStore = gcnew array<Byte>(storeSize);
-		if (store != nullptr) {
-			pin_ptr<Byte> oldStorePtr = &store[0];
-			pin_ptr<Byte> newStorePtr = &newStore[0];
-			memcpy(newStorePtr, oldStorePtr, fetcher.FilledStoreSize());
-		}
-		store = newStore;
-		pin_ptr<Byte> storePtr = &newStore[0];
+		array<Byte>^ store = target->ReserveStore(storeSize, fetcher.FilledStoreSize());
+		pin_ptr<Byte> storePtr = &store[0];
 		pin_ptr<SegmentPosition> positionsPtr = &positions[0];
-		rowsCount = fetcher.FetchInto(storePtr, (unsigned int *)positionsPtr);
-		return gcnew BytesTable(store, positions, rowsCount, columnsCount);
+		unsigned int rowsCount = fetcher.FetchInto(storePtr, (unsigned int *)positionsPtr);
+		target->SetShape(rowsCount, columnsCount);
+		if (needKeys)
+			db_->keysState_->Observe(positions, 0, rowsCount);
+		if (needValues)
+			db_->valuesState_->Observe(positions, needKeys ? rowsCount : 0, rowsCount);
+		return target;
 	}, (take + 1) * readRetriesCount_ * 10);
 }
 
@@ -126,18 +148,71 @@ static NativeRangeCursorReader* CreateNativeRangeCursorReader(Database^ db, Rang
 	return new NativeRangeCursorReader(db->db_, leftPtr, leftLength, leftInclusive, rightPtr, rightLength, rightInclusive, direction, skip, take);
 }
 
+//false when prefix counts are disabled or range boundaries split counted prefixes
+static bool TryGetCountedTotal(Database^ db, Range^ range, unsigned int% result) {
+	if (db->prefixCounts_ == nullptr)
+		return false;
+	DECLARE_NATIVE_BOUNDARY(left, range->Left);
+	DECLARE_NATIVE_BOUNDARY(right, range->Right);
+	unsigned int count;
+	if (!db->prefixCounts_->TryCount(leftPtr, leftLength, leftInclusive, rightPtr, rightLength, rightInclusive, count))
+		return false;
+	result = count;
+	return true;
+}
+
 SimpleCursor::SimpleCursor(Database^ db, Range^ range, int direction, unsigned int skip, int take)
-	:skip_(skip), take_(take), AbstractCursor(db, CreateNativeRangeCursorReader(db, range, direction, skip, take), 5, 1) {
+	:skip_(skip), take_(take), range_(range), direction_(direction), slowLog_(db->slowLog_), readTicks_(0), limited_(false), traceStarted_(0),
+	AbstractCursor(db, CreateNativeRangeCursorReader(db, range, direction, skip, take), 5, 1) {
 	content_ = gcnew BytesRecord(keyAccessor_->buffer_, valueAccessor_->buffer_);
+	if (slowLog_ != nullptr)
+		slowLogStart_ = slowLog_->Begin();
+}
+
+void SimpleCursor::Trace(TraceRecorder^ trace) {
+	if (trace == nullptr)
+		return;
+	trace_ = trace;
+	traceStarted_ = trace->Now();
+}
+
+//leaked cursor is neither reported nor traced, logger and trace may be already finalized
+void SimpleCursor::Close() {
+	CheckOpen();
+	try {
+		if (!finalizing_) {
+			if (slowLog_ != nullptr)
+				slowLog_->Query(slowLogStart_, readTicks_, range_, direction_, skip_, take_, reader_->readRecordsCount_, Counters());
+			if (trace_ != nullptr)
+				trace_->Query(traceStarted_, readTicks_, range_, direction_, skip_, take_, reader_->readRecordsCount_);
+		}
+	}
+	finally {
+		AbstractCursor::Close();
+	}
 }
 
 bool SimpleCursor::Read(BytesRecord^% result) {
+	if (slowLog_ == nullptr && trace_ == nullptr)
+		return DoRead(result);
+	long long started = Stopwatch::GetTimestamp();
+	try {
+		return DoRead(result);
+	}
+	finally {
+		readTicks_ += Stopwatch::GetTimestamp() - started;
+	}
+}
+
+bool SimpleCursor::DoRead(BytesRecord^% result) {
 	CheckOpen();
 	unsigned int keyLength, valueLength;
 	INVOKE_NATIVE(
 		if (reader_->Read(keyLength, valueLength)) {
 		keyAccessor_->buffer_->Length = keyLength;
 		valueAccessor_->buffer_->Length = valueLength;
+		db_->keysState_->Observe(keyLength);
+		db_->valuesState_->Observe(valueLength);
 		result = content_;
 		return true;
 		}
@@ -148,41 +223,352 @@ bool SimpleCursor::Read(BytesRecord^% result) {
 }
 
 BytesTable^ SimpleCursor::Fetch(FetchOptions options) {
-	int recordsCount = take_ >= 0 && take_ < System::Int32::MaxValue
-		? take_ - reader_->readRecordsCount_
-		: GetTotalCount() - skip_ - reader_->readRecordsCount_;
-	return AbstractCursor::Fetch(options, recordsCount);
+	return Fetch(options, gcnew BytesTable());
+}
+
+BytesTable^ SimpleCursor::Fetch(FetchOptions options, BytesTable^ target) {
+	long long started = Stopwatch::GetTimestamp();
+	try {
+		int recordsCount = take_ >= 0 && take_ < System::Int32::MaxValue
+			? take_ - reader_->readRecordsCount_
+			: GetTotalCount() - skip_ - reader_->readRecordsCount_;
+		return AbstractCursor::Fetch(options, recordsCount, target);
+	}
+	finally {
+		readTicks_ += Stopwatch::GetTimestamp() - started;
+	}
 }
 
 unsigned int SimpleCursor::GetTotalCount() {
 	CheckOpen();
+	unsigned int result;
+	if (!limited_ && TryGetCountedTotal(db_, range_, result))
+		return result;
 	db_->CheckRecordNumbersEnabled();
 	INVOKE_NATIVE(return reader_->GetTotalCount(); , 7)
 }
 
-static NativeSuffixMergingRangeCursorReader* CreateNativeSuffixMergingRangeCursorReader(Database^ db, array<Range^>^ ranges, int direction, unsigned int keySuffixOffset, FetchOptions options) {
-	NativeRangeCursorReader** readers = new NativeRangeCursorReader*[ranges->Length];
-	for (int i = 0; i < ranges->Length; i++)
-		readers[i] = CreateNativeRangeCursorReader(db, ranges[i], direction, 0, -1);
+void SimpleCursor::LimitTo(const std::vector<Byte>& from, const std::vector<Byte>& to) {
+	limited_ = true;
+	reader_->LimitTo(from, to);
+}
+
+static NativeSuffixMergingRangeCursorReader* CreateNativeSuffixMergingRangeCursorReader(NativeRangeCursorReader** readers, unsigned int readersCount, int direction, unsigned int keySuffixOffset, const NativeKeySchema& keySchema, bool byValue, FetchOptions options) {
 	bool needKeys = options == FetchOptions::Keys || options == FetchOptions::KeysAndValues;
 	bool needValues = options == FetchOptions::Values || options == FetchOptions::KeysAndValues;
-	return new NativeSuffixMergingRangeCursorReader(keySuffixOffset, needKeys, needValues, readers, ranges->Length, direction);
+	return new NativeSuffixMergingRangeCursorReader(keySuffixOffset, keySchema, byValue, needKeys, needValues, readers, readersCount, direction);
+}
+
+//each partition holds a key ordered part of every range, so the merge sees them as separate ranges
+static NativeSuffixMergingRangeCursorReader* CreateNativeSuffixMergingRangeCursorReader(array<Database^>^ partitions, array<Range^>^ ranges, int direction, unsigned int keySuffixOffset, const NativeKeySchema& keySchema, FetchOptions options) {
+	unsigned int readersCount = ranges->Length * partitions->Length;
+	NativeRangeCursorReader** readers = new NativeRangeCursorReader*[readersCount];
+	for (int i = 0; i < ranges->Length; i++)
+		for (int j = 0; j < partitions->Length; j++)
+			readers[i * partitions->Length + j] = CreateNativeRangeCursorReader(partitions[j], ranges[i], direction, 0, -1);
+	return CreateNativeSuffixMergingRangeCursorReader(readers, readersCount, direction, keySuffixOffset, keySchema, false, options);
+}
+
+static NativeSuffixMergingRangeCursorReader* CreateNativeSuffixMergingRangeCursorReader(Database^ db, array<Range^>^ ranges, int direction, unsigned int keySuffixOffset, const NativeKeySchema& keySchema, FetchOptions options) {
+	return CreateNativeSuffixMergingRangeCursorReader(gcnew array<Database^>{ db }, ranges, direction, keySuffixOffset, keySchema, options);
+}
+
+static NativeSuffixMergingRangeCursorReader* CreateNativeSuffixMergingRangeCursorReader(Database^ db, array<BytesSegment>^ keys, int direction, FetchOptions options) {
+	NativeRangeCursorReader** readers = new NativeRangeCursorReader*[keys->Length];
+	for (int i = 0; i < keys->Length; i++) {
+		DBT_FOR_BYTES_SEGMENT(key, keys[i]);
+		readers[i] = new NativeRangeCursorReader(db->db_, keyPtr, keyLen, direction);
+	}
+	return CreateNativeSuffixMergingRangeCursorReader(readers, keys->Length, direction, 0, NativeKeySchema(), true, options);
+}
+
+static NativeKeySchema CreateNativeKeySchema(KeySchema^ keySchema, int keySuffixField) {
+	NativeKeySchema result;
+	for (int i = 0; i < keySuffixField; i++) {
+		KeyField^ field = keySchema->Fields[i];
+		result.AddField(field->FixedLength, field->Descending);
+	}
+	return result;
+}
+
+static NativeSuffixMergingRangeCursorReader* CreateNativeSuffixMergingRangeCursorReader(array<Database^>^ partitions, array<Range^>^ ranges, int direction, KeySchema^ keySchema, int keySuffixField, FetchOptions options) {
+	return CreateNativeSuffixMergingRangeCursorReader(partitions, ranges, direction, 0, CreateNativeKeySchema(keySchema, keySuffixField), options);
+}
+
+static NativeSuffixMergingRangeCursorReader* CreateNativeSuffixMergingRangeCursorReader(Database^ db, array<Range^>^ ranges, int direction, KeySchema^ keySchema, int keySuffixField, FetchOptions options) {
+	return CreateNativeSuffixMergingRangeCursorReader(gcnew array<Database^>{ db }, ranges, direction, keySchema, keySuffixField, options);
 }
 
 SuffixMergingFetcher::SuffixMergingFetcher(Database^ db, array<Range^>^ ranges, int direction, unsigned int keySuffixOffset, FetchOptions options)
-	:AbstractCursor(db, CreateNativeSuffixMergingRangeCursorReader(db, ranges, direction, keySuffixOffset, options),
+	:partitions_(gcnew array<Database^>{ db }), ranges_(ranges), AbstractCursor(db, CreateNativeSuffixMergingRangeCursorReader(db, ranges, direction, keySuffixOffset, NativeKeySchema(), options),
 	5 * ranges->Length, ranges->Length + 1) {
 }
 
+SuffixMergingFetcher::SuffixMergingFetcher(Database^ db, array<Range^>^ ranges, int direction, KeySchema^ keySchema, int keySuffixField, FetchOptions options)
+	:partitions_(gcnew array<Database^>{ db }), ranges_(ranges), AbstractCursor(db, CreateNativeSuffixMergingRangeCursorReader(db, ranges, direction, keySchema, keySuffixField, options),
+	5 * ranges->Length, ranges->Length + 1) {
+}
+
+SuffixMergingFetcher::SuffixMergingFetcher(Database^ db, array<BytesSegment>^ keys, int direction, FetchOptions options)
+	:AbstractCursor(db, CreateNativeSuffixMergingRangeCursorReader(db, keys, direction, options),
+	5 * keys->Length, keys->Length + 1) {
+}
+
+SuffixMergingFetcher::SuffixMergingFetcher(array<Database^>^ partitions, array<Range^>^ ranges, int direction, unsigned int keySuffixOffset, FetchOptions options)
+	:partitions_(partitions), ranges_(ranges), AbstractCursor(partitions[0], CreateNativeSuffixMergingRangeCursorReader(partitions, ranges, direction, keySuffixOffset, NativeKeySchema(), options),
+	5 * ranges->Length * partitions->Length, ranges->Length * partitions->Length + 1) {
+}
+
+SuffixMergingFetcher::SuffixMergingFetcher(array<Database^>^ partitions, array<Range^>^ ranges, int direction, KeySchema^ keySchema, int keySuffixField, FetchOptions options)
+	:partitions_(partitions), ranges_(ranges), AbstractCursor(partitions[0], CreateNativeSuffixMergingRangeCursorReader(partitions, ranges, direction, keySchema, keySuffixField, options),
+	5 * ranges->Length * partitions->Length, ranges->Length * partitions->Length + 1) {
+}
+
 //todo pre release hacks, make it right
 
 BytesTable^ SuffixMergingFetcher::Fetch(FetchOptions options, int take) {
-	int recordsCount = take < 0 || take == System::Int32::MaxValue ? GetTotalCount() : take;
-	return AbstractCursor::Fetch(options, recordsCount);
+	return Fetch(options, take, gcnew BytesTable());
+}
+
+BytesTable^ SuffixMergingFetcher::Fetch(FetchOptions options, int take, BytesTable^ target) {
+	int recordsCount = take;
+	if (take < 0 || take == System::Int32::MaxValue) {
+		unsigned int totalCount = GetTotalCount();
+		recordsCount = totalCount > skip_ ? totalCount - skip_ : 0;
+	}
+	return AbstractCursor::Fetch(options, recordsCount, target);
+}
+
+void SuffixMergingFetcher::Skip(unsigned int skip) {
+	db_->CheckRecordNumbersEnabled();
+	skip_ = skip;
+	reader_->Skip(skip);
 }
 
+//total is the sum of range totals, as merging reader counts records of every range
 unsigned int SuffixMergingFetcher::GetTotalCount() {
 	CheckOpen();
+	if (ranges_ != nullptr) {
+		unsigned int result = 0;
+		bool counted = true;
+		for (int i = 0; i < ranges_->Length && counted; i++)
+			for (int j = 0; j < partitions_->Length && counted; j++) {
+				unsigned int count = 0;
+				counted = TryGetCountedTotal(partitions_[j], ranges_[i], count);
+				result += count;
+			}
+		if (counted)
+			return result;
+	}
 	db_->CheckRecordNumbersEnabled();
 	INVOKE_NATIVE(return reader_->GetTotalCount(); , readRetriesCount_ * 10)
+}
+
+static NativeDuplicatesCursorReader* CreateNativeDuplicatesCursorReader(Database^ db, BytesSegment key, int take, unsigned int bulkBufferSize) {
+	DBT_FOR_BYTES_SEGMENT(key, key);
+	return new NativeDuplicatesCursorReader(db->db_, keyPtr, keyLen, take, bulkBufferSize);
+}
+
+DuplicatesCursor::DuplicatesCursor(Database^ db, BytesSegment key, int take, unsigned int bulkBufferSize)
+	:take_(take), AbstractCursor(db, CreateNativeDuplicatesCursorReader(db, key, take, bulkBufferSize), 5, 1) {
+	content_ = gcnew BytesRecord(keyAccessor_->buffer_, valueAccessor_->buffer_);
+}
+
+bool DuplicatesCursor::Read(BytesRecord^% result) {
+	CheckOpen();
+	unsigned int keyLength, valueLength;
+	INVOKE_NATIVE(
+		if (reader_->Read(keyLength, valueLength)) {
+		keyAccessor_->buffer_->Length = keyLength;
+		valueAccessor_->buffer_->Length = valueLength;
+		db_->keysState_->Observe(keyLength);
+		db_->valuesState_->Observe(valueLength);
+		result = content_;
+		return true;
+		}
+		else {
+			result = nullptr;
+			return false;
+		}, readRetriesCount_);
+}
+
+BytesTable^ DuplicatesCursor::Fetch(FetchOptions options) {
+	return Fetch(options, gcnew BytesTable());
+}
+
+BytesTable^ DuplicatesCursor::Fetch(FetchOptions options, BytesTable^ target) {
+	int recordsCount = take_ >= 0 && take_ < System::Int32::MaxValue
+		? take_ - reader_->readRecordsCount_
+		: GetTotalCount() - reader_->readRecordsCount_;
+	return AbstractCursor::Fetch(options, recordsCount, target);
+}
+
+unsigned int DuplicatesCursor::GetTotalCount() {
+	CheckOpen();
+	INVOKE_NATIVE(return reader_->GetTotalCount(); , readRetriesCount_)
+}
+
+static NativeSecondaryCursorReader* CreateNativeSecondaryCursorReader(DB* secondary, Range^ range, int direction, int take) {
+	DECLARE_NATIVE_BOUNDARY(left, range->Left);
+	DECLARE_NATIVE_BOUNDARY(right, range->Right);
+	return new NativeSecondaryCursorReader(secondary, leftPtr, leftLength, leftInclusive, rightPtr, rightLength, rightInclusive, direction, take);
+}
+
+SecondaryCursor::SecondaryCursor(Database^ db, DB* secondary, Range^ range, int direction, int take)
+	:take_(take), AbstractCursor(db, CreateNativeSecondaryCursorReader(secondary, range, direction, take), 5, 1) {
+	content_ = gcnew BytesRecord(keyAccessor_->buffer_, valueAccessor_->buffer_);
+}
+
+bool SecondaryCursor::Read(BytesRecord^% result) {
+	CheckOpen();
+	unsigned int keyLength, valueLength;
+	INVOKE_NATIVE(
+		if (reader_->Read(keyLength, valueLength)) {
+		keyAccessor_->buffer_->Length = keyLength;
+		valueAccessor_->buffer_->Length = valueLength;
+		db_->keysState_->Observe(keyLength);
+		db_->valuesState_->Observe(valueLength);
+		result = content_;
+		return true;
+		}
+		else {
+			result = nullptr;
+			return false;
+		}, readRetriesCount_);
+}
+
+BytesTable^ SecondaryCursor::Fetch(FetchOptions options) {
+	return Fetch(options, gcnew BytesTable());
+}
+
+BytesTable^ SecondaryCursor::Fetch(FetchOptions options, BytesTable^ target) {
+	if (take_ < 0 || take_ == System::Int32::MaxValue)
+		throw gcnew BdbException("secondary index cursor fetch requires bounded take, " + description_);
+	return AbstractCursor::Fetch(options, take_ - reader_->readRecordsCount_, target);
+}
+
+unsigned int SecondaryCursor::GetTotalCount() {
+	throw gcnew BdbException("total count is not supported by secondary index cursor, " + description_);
+}
+
+template <typename TReader>
+static NativeWorkItem* CreateNativeFetchWorkItem(Database^ db, NativeReaderFactory<TReader>* factory, unsigned int readRetriesCount, unsigned int chunksCount, FetchOptions options, int take, unsigned int skip) {
+	bool needKeys = options == FetchOptions::Keys || options == FetchOptions::KeysAndValues;
+	bool needValues = options == FetchOptions::Values || options == FetchOptions::KeysAndValues;
+	return new NativeFetchWorkItem<TReader>(factory, chunksCount, db->keysState_->GetLengthInBytes(), db->valuesState_->GetLengthInBytes(),
+		needKeys, needValues, take, skip, readRetriesCount, db->asyncStopped_);
+}
+
+PartitionsCursor::PartitionsCursor(array<ICursor^>^ cursors, int take, unsigned int skippedCount)
+	:cursors_(cursors), current_(0), take_(take), readRecordsCount_(0), skippedCount_(skippedCount) {
+}
+
+PartitionsCursor::~PartitionsCursor() {
+	for each (ICursor^ cursor in cursors_)
+		delete cursor;
+}
+
+bool PartitionsCursor::Read(BytesRecord^% result) {
+	for (; current_ < cursors_->Length; current_++) {
+		if (take_ >= 0 && readRecordsCount_ >= take_)
+			break;
+		if (cursors_[current_]->Read(result)) {
+			readRecordsCount_++;
+			return true;
+		}
+	}
+	result = nullptr;
+	return false;
+}
+
+unsigned int PartitionsCursor::GetTotalCount() {
+	unsigned int result = skippedCount_;
+	for each (ICursor^ cursor in cursors_)
+		result += cursor->GetTotalCount();
+	return result;
+}
+
+BytesTable^ PartitionsCursor::Fetch(FetchOptions options) {
+	return Fetch(options, gcnew BytesTable());
+}
+
+//partition cursors are created with the whole take, so the tail of the last fetched partition is dropped
+BytesTable^ PartitionsCursor::Fetch(FetchOptions options, BytesTable^ target) {
+	unsigned int columnsCount = options == FetchOptions::KeysAndValues ? 2 : 1;
+	unsigned int maxRowsCount = take_ >= 0 ? take_ - readRecordsCount_ : System::UInt32::MaxValue;
+	System::Collections::Generic::List<BytesTable^>^ tables = gcnew System::Collections::Generic::List<BytesTable^>();
+	unsigned int rowsCount = 0;
+	for (; current_ < cursors_->Length && rowsCount < maxRowsCount; current_++) {
+		BytesTable^ table = cursors_[current_]->Fetch(options);
+		tables->Add(table);
+		rowsCount += table->RowsCount;
+	}
+	BytesTable^ result = BytesTable::Concat(tables, columnsCount, maxRowsCount, target);
+	readRecordsCount_ += result->RowsCount;
+	return result;
+}
+
+template <typename TReader>
+AsyncFetcher<TReader>::AsyncFetcher(Database^ db, NativeReaderFactory<TReader>* factory, unsigned int readRetriesCount, unsigned int chunksCount, FetchOptions options, int take, unsigned int skip)
+	:columnsCount_(options == FetchOptions::KeysAndValues ? 2 : 1),
+	AsyncOperation(db, CreateNativeFetchWorkItem(db, factory, readRetriesCount, chunksCount, options, take, skip)) {
+}
+
+template <typename TReader>
+BytesTable^ AsyncFetcher<TReader>::CopyResult(NativeWorkItem& item) {
+	NativeFetchWorkItem<TReader>& fetchItem = static_cast<NativeFetchWorkItem<TReader>&>(item);
+	db_->keysState_->UpdateLength(fetchItem.KeyChunkSize());
+	db_->valuesState_->UpdateLength(fetchItem.ValueChunkSize());
+	//the same layout as AbstractCursor::Fetch result, including unfilled tail
+	array<Byte>^ store = gcnew array<Byte>(fetchItem.Store().size());
+	array<SegmentPosition>^ positions = gcnew array<SegmentPosition>(fetchItem.Positions().size() / 2);
+	if (store->Length > 0) {
+		pin_ptr<Byte> storePtr = &store[0];
+		memcpy(storePtr, &fetchItem.Store()[0], store->Length);
+	}
+	if (positions->Length > 0) {
+		pin_ptr<SegmentPosition> positionsPtr = &positions[0];
+		memcpy(positionsPtr, &fetchItem.Positions()[0], positions->Length * sizeof(SegmentPosition));
+	}
+	return gcnew BytesTable(store, positions, fetchItem.RowsCount(), columnsCount_);
+}
+
+static NativeRangeReaderFactory* CreateNativeRangeReaderFactory(Database^ db, Range^ range, int direction, unsigned int skip, int take) {
+	DECLARE_NATIVE_BOUNDARY(left, range->Left);
+	DECLARE_NATIVE_BOUNDARY(right, range->Right);
+	return new NativeRangeReaderFactory(db->db_, leftPtr, leftLength, leftInclusive, rightPtr, rightLength, rightInclusive, direction, skip, take);
+}
+
+static NativeMergingReaderFactory* CreateNativeMergingReaderFactory(Database^ db, array<Range^>^ ranges, int direction, unsigned int keySuffixOffset, const NativeKeySchema& keySchema, FetchOptions options) {
+	bool needKeys = options == FetchOptions::Keys || options == FetchOptions::KeysAndValues;
+	bool needValues = options == FetchOptions::Values || options == FetchOptions::KeysAndValues;
+	NativeMergingReaderFactory* result = new NativeMergingReaderFactory(keySuffixOffset, keySchema, needKeys, needValues, direction);
+	try {
+		for (int i = 0; i < ranges->Length; i++)
+			result->AddRange(CreateNativeRangeReaderFactory(db, ranges[i], direction, 0, -1));
+	}
+	catch (...) {
+		delete result;
+		throw;
+	}
+	return result;
+}
+
+//readers are created by work items on worker threads, see NativeReaderFactory
+AsyncOperation<BytesTable^>^ AsyncFetchers::Read(Database^ db, Range^ range, int direction, unsigned int skip, int take, FetchOptions options) {
+	NativeRangeReaderFactory* factory = CreateNativeRangeReaderFactory(db, range, direction, skip, take);
+	int recordsCount = take >= 0 && take < System::Int32::MaxValue ? take : -1;
+	return gcnew AsyncFetcher<NativeRangeCursorReader>(db, factory, 5, 1, options, recordsCount, skip);
+}
+
+AsyncOperation<BytesTable^>^ AsyncFetchers::Merge(Database^ db, array<Range^>^ ranges, int direction, int take, unsigned int keySuffixOffset, FetchOptions options) {
+	NativeMergingReaderFactory* factory = CreateNativeMergingReaderFactory(db, ranges, direction, keySuffixOffset, NativeKeySchema(), options);
+	int recordsCount = take < 0 || take == System::Int32::MaxValue ? -1 : take;
+	return gcnew AsyncFetcher<NativeSuffixMergingRangeCursorReader>(db, factory, 5 * ranges->Length, ranges->Length + 1, options, recordsCount, 0);
+}
+
+AsyncOperation<BytesTable^>^ AsyncFetchers::Merge(Database^ db, array<Range^>^ ranges, int direction, int take, KeySchema^ keySchema, int keySuffixField, FetchOptions options) {
+	NativeMergingReaderFactory* factory = CreateNativeMergingReaderFactory(db, ranges, direction, 0, CreateNativeKeySchema(keySchema, keySuffixField), options);
+	int recordsCount = take < 0 || take == System::Int32::MaxValue ? -1 : take;
+	return gcnew AsyncFetcher<NativeSuffixMergingRangeCursorReader>(db, factory, 5 * ranges->Length, ranges->Length + 1, options, recordsCount, 0);
 }
\ No newline at end of file
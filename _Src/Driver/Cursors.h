@@ -1,10 +1,15 @@
 #pragma once
 
 #include "Shared.h"
+#include "Implementation.h"
+#include <vector>
 
 class NativeRangeCursorReader;
 class NativeSuffixMergingRangeCursorReader;
+class NativeDuplicatesCursorReader;
+class NativeSecondaryCursorReader;
 template <typename TReader> class NativeReaderFetcher;
+template <typename TReader> class NativeReaderFactory;
 
 namespace SimpleBdb {
 	namespace Driver {
@@ -21,6 +26,8 @@ namespace SimpleBdb {
 			public:
 				AbstractCursor(Database^ db, TReader* reader, unsigned int readRetriesCount, unsigned int chunkCount);
 				SimpleBdb::Utils::BytesTable^ Fetch(FetchOptions options, unsigned int take);
+				SimpleBdb::Utils::BytesTable^ Fetch(FetchOptions options, unsigned int take, SimpleBdb::Utils::BytesTable^ target);
+				ReadCounters Counters();
 			internal:
 				Database^ db_;
 				virtual void CheckOpen() override;
@@ -29,6 +36,7 @@ namespace SimpleBdb {
 				BufferAllocator^ keyAccessor_;
 				BufferAllocator^ valueAccessor_;
 				unsigned int readRetriesCount_;
+				unsigned int bufferSmallRetries_;
 				virtual void Close() override;
 			};
 
@@ -36,20 +44,113 @@ namespace SimpleBdb {
 			public:
 				SimpleCursor(Database^ db, SimpleBdb::Utils::Range^ range, int direction, unsigned int skip, int take);
 				virtual SimpleBdb::Utils::BytesTable^ Fetch(FetchOptions options);
+				virtual SimpleBdb::Utils::BytesTable^ Fetch(FetchOptions options, SimpleBdb::Utils::BytesTable^ target);
 				virtual bool Read(SimpleBdb::Utils::BytesRecord^% result);
 				virtual unsigned int GetTotalCount();
+				//see NativeRangeCursorReader::LimitTo
+				void LimitTo(const std::vector<Byte>& from, const std::vector<Byte>& to);
+				//cursor is written to trace on dispose with rows read, null trace is ignored
+				void Trace(TraceRecorder^ trace);
+			protected:
+				//reports slow query to slow operation log and trace
+				virtual void Close() override;
 			private:
+				bool DoRead(SimpleBdb::Utils::BytesRecord^% result);
 				SimpleBdb::Utils::BytesRecord^ content_;
 				unsigned int skip_;
 				int take_;
+				SimpleBdb::Utils::Range^ range_;
+				int direction_;
+				SlowOperationLog^ slowLog_;
+				SlowOperationLog::Start slowLogStart_;
+				long long readTicks_;
+				//limited cursor reads a part of range_, so its total count can't be taken from prefix counts
+				bool limited_;
+				TraceRecorder^ trace_;
+				long long traceStarted_;
 			};
 
 			private ref class SuffixMergingFetcher : AbstractCursor<NativeSuffixMergingRangeCursorReader> {
 			public:
 				SuffixMergingFetcher(Database^ db, array<SimpleBdb::Utils::Range^>^ ranges, int direction, unsigned int keySuffixOffset, FetchOptions options);
+				SuffixMergingFetcher(Database^ db, array<SimpleBdb::Utils::Range^>^ ranges, int direction, SimpleBdb::Utils::KeySchema^ keySchema, int keySuffixField, FetchOptions options);
+				//merges duplicate sets of keys by value
+				SuffixMergingFetcher(Database^ db, array<SimpleBdb::Utils::BytesSegment>^ keys, int direction, FetchOptions options);
+				//merges ranges across partitions of PartitionedDatabase, partitions share config, so the first one provides buffers
+				SuffixMergingFetcher(array<Database^>^ partitions, array<SimpleBdb::Utils::Range^>^ ranges, int direction, unsigned int keySuffixOffset, FetchOptions options);
+				SuffixMergingFetcher(array<Database^>^ partitions, array<SimpleBdb::Utils::Range^>^ ranges, int direction, SimpleBdb::Utils::KeySchema^ keySchema, int keySuffixField, FetchOptions options);
 				SimpleBdb::Utils::BytesTable^ Fetch(FetchOptions options, int take);
+				SimpleBdb::Utils::BytesTable^ Fetch(FetchOptions options, int take, SimpleBdb::Utils::BytesTable^ target);
+				//see NativeSuffixMergingRangeCursorReader::Skip
+				void Skip(unsigned int skip);
 			private:
 				unsigned int GetTotalCount();
+				unsigned int skip_;
+				//null for merged duplicate sets, otherwise every range is read from every partition
+				array<Database^>^ partitions_;
+				array<SimpleBdb::Utils::Range^>^ ranges_;
+			};
+
+			//reads cursors of key ordered partitions one after another
+			private ref class PartitionsCursor : ICursor {
+			public:
+				//skippedCount is records count of partitions dropped entirely by skip
+				PartitionsCursor(array<ICursor^>^ cursors, int take, unsigned int skippedCount);
+				~PartitionsCursor();
+				virtual SimpleBdb::Utils::BytesTable^ Fetch(FetchOptions options);
+				virtual SimpleBdb::Utils::BytesTable^ Fetch(FetchOptions options, SimpleBdb::Utils::BytesTable^ target);
+				virtual bool Read(SimpleBdb::Utils::BytesRecord^% result);
+				virtual unsigned int GetTotalCount();
+			private:
+				array<ICursor^>^ cursors_;
+				int current_;
+				int take_;
+				int readRecordsCount_;
+				unsigned int skippedCount_;
+			};
+
+			template <typename TReader>
+			private ref class AsyncFetcher : AsyncOperation<SimpleBdb::Utils::BytesTable^> {
+			public:
+				//takes ownership of factory, take < 0 means all records after skip
+				AsyncFetcher(Database^ db, NativeReaderFactory<TReader>* factory, unsigned int readRetriesCount, unsigned int chunksCount, FetchOptions options, int take, unsigned int skip);
+			protected:
+				virtual SimpleBdb::Utils::BytesTable^ CopyResult(NativeWorkItem& item) override;
+			private:
+				unsigned int columnsCount_;
+			};
+
+			//async counterparts of SimpleCursor and SuffixMergingFetcher fetches
+			private ref class AsyncFetchers abstract sealed {
+			public:
+				static AsyncOperation<SimpleBdb::Utils::BytesTable^>^ Read(Database^ db, SimpleBdb::Utils::Range^ range, int direction, unsigned int skip, int take, FetchOptions options);
+				static AsyncOperation<SimpleBdb::Utils::BytesTable^>^ Merge(Database^ db, array<SimpleBdb::Utils::Range^>^ ranges, int direction, int take, unsigned int keySuffixOffset, FetchOptions options);
+				static AsyncOperation<SimpleBdb::Utils::BytesTable^>^ Merge(Database^ db, array<SimpleBdb::Utils::Range^>^ ranges, int direction, int take, SimpleBdb::Utils::KeySchema^ keySchema, int keySuffixField, FetchOptions options);
+			};
+
+			//reads primary records of secondary keys range, total count is not supported as secondaries don't keep record numbers
+			private ref class SecondaryCursor : AbstractCursor<NativeSecondaryCursorReader>, ICursor {
+			public:
+				SecondaryCursor(Database^ db, DB* secondary, SimpleBdb::Utils::Range^ range, int direction, int take);
+				virtual SimpleBdb::Utils::BytesTable^ Fetch(FetchOptions options);
+				virtual SimpleBdb::Utils::BytesTable^ Fetch(FetchOptions options, SimpleBdb::Utils::BytesTable^ target);
+				virtual bool Read(SimpleBdb::Utils::BytesRecord^% result);
+				virtual unsigned int GetTotalCount();
+			private:
+				SimpleBdb::Utils::BytesRecord^ content_;
+				int take_;
+			};
+
+			private ref class DuplicatesCursor : AbstractCursor<NativeDuplicatesCursorReader>, ICursor {
+			public:
+				DuplicatesCursor(Database^ db, SimpleBdb::Utils::BytesSegment key, int take, unsigned int bulkBufferSize);
+				virtual SimpleBdb::Utils::BytesTable^ Fetch(FetchOptions options);
+				virtual SimpleBdb::Utils::BytesTable^ Fetch(FetchOptions options, SimpleBdb::Utils::BytesTable^ target);
+				virtual bool Read(SimpleBdb::Utils::BytesRecord^% result);
+				virtual unsigned int GetTotalCount();
+			private:
+				SimpleBdb::Utils::BytesRecord^ content_;
+				int take_;
 			};
 		}
 	}
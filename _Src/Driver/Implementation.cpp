@@ -1,6 +1,7 @@
 #include "Stdafx.h"
 #include "Implementation.h"
 #include "Interface.h"
+#include "NativeWorkers.h"
 
 using namespace SimpleBdb::Driver::Implementation;
 
@@ -9,14 +10,38 @@ using System::ObjectDisposedException;
 using System::GC;
 using System::Exception;
 using System::Array;
+using System::Convert;
+using System::Collections::Generic::Dictionary;
+using System::Collections::Generic::List;
+using System::IO::BinaryReader;
+using System::IO::BinaryWriter;
+using System::IO::File;
+using System::Object;
+using System::Diagnostics::Stopwatch;
+using System::Threading::Interlocked;
+using System::Threading::Monitor;
+using System::Threading::ManualResetEventSlim;
+using System::Threading::Thread;
+using System::Threading::ThreadStart;
+using System::Threading::ThreadPool;
+using System::Threading::WaitCallback;
+using System::Threading::CancellationToken;
+using System::Threading::Tasks::Task;
+using System::Threading::Tasks::TaskCompletionSource;
 using SimpleBdb::Utils::ILogger;
 using SimpleBdb::Utils::Boundary;
 using SimpleBdb::Utils::BytesBuffer;
+using SimpleBdb::Utils::BytesSegment;
+using SimpleBdb::Utils::Range;
+using SimpleBdb::Utils::KeySchema;
 using SimpleBdb::Driver::BytesBufferConfig;
 using SimpleBdb::Driver::Direction;
 using SimpleBdb::Driver::Byte;
+using SimpleBdb::Driver::FindCacheStatistics;
+using SimpleBdb::Driver::BufferStatistics;
+using SimpleBdb::Utils::SegmentPosition;
 
-BdbComponent::BdbComponent(ILogger^ logger, String^ description) :logger_(logger), description_(description), disposed_(false), 
+BdbComponent::BdbComponent(ILogger^ logger, String^ description) :logger_(logger), description_(description), disposed_(false), finalizing_(false), 
 	logErrorDelegate_(gcnew LogErrorDelegate(this, &BdbComponent::LogError)) {
 }
 
@@ -69,6 +94,7 @@ BdbComponent::~BdbComponent() {
 BdbComponent::!BdbComponent() {
 	if (disposed_)
 		return;
+	finalizing_ = true;
 	try {
 		this->Close();
 		disposed_ = true;
@@ -79,16 +105,95 @@ BdbComponent::!BdbComponent() {
 	}
 }
 
+//lengths below 8 have own buckets, longer ones 4 buckets per power of two
+const int histogramBucketsCount = 8 + 29 * 4;
+const int adaptInterval = 1024;
+const double adaptPercentile = 0.99;
+
 BufferState::BufferState(String^ description, BytesBufferConfig^ config, ILogger^ logger)
-	:description_(description), config_(config), lengthInBytes_(config->Size), logger_(logger) {
+	:description_(description), config_(config), lengthInBytes_(config->Size), logger_(logger),
+	observedCount_(0), maxLength_(0), percentileLength_(0) {
 	if (config_->Fixed && config_->Size < sizeof(unsigned int))
 		throw gcnew BdbException(String::Format("fixed buffer size [{0}] can't be smaller than size of unsigned int [{1}], {2}",
 		config_->Size, sizeof(unsigned int), description_));
+	if (config_->IsAdaptive)
+		histogram_ = gcnew array<long long>(histogramBucketsCount);
+}
+
+int BufferState::BucketOf(unsigned int length) {
+	if (length < 8)
+		return length;
+	int shift = 0;
+	while ((length >> shift) >= 8)
+		shift++;
+	return 8 + (shift - 1) * 4 + (int)(length >> shift) - 4;
+}
+
+int BufferState::BucketUpperBound(int bucket) {
+	if (bucket < 8)
+		return bucket;
+	int shift = (bucket - 8) / 4 + 1;
+	long long top = (bucket - 8) % 4 + 4;
+	long long result = ((top + 1) << shift) - 1;
+	return result > System::Int32::MaxValue ? System::Int32::MaxValue : (int)result;
+}
+
+void BufferState::Observe(unsigned int length) {
+	if (histogram_ == nullptr)
+		return;
+	histogram_[BucketOf(length)]++;
+	if (length > maxLength_)
+		maxLength_ = length;
+	if (++observedCount_ % adaptInterval == 0)
+		Adapt();
+}
+
+void BufferState::Observe(array<SegmentPosition>^ positions, unsigned int offset, unsigned int count) {
+	if (histogram_ == nullptr)
+		return;
+	for (unsigned int i = offset; i < offset + count; i++)
+		Observe(positions[i].length);
+}
+
+void BufferState::Seed(const std::vector<unsigned int>& lengths) {
+	if (histogram_ == nullptr)
+		return;
+	for (auto it = lengths.begin(); it != lengths.end(); it++)
+		Observe(*it);
+	Adapt();
+}
+
+//new cursors start with the smallest length covering the percentile, longer records grow only the cursor that met them
+void BufferState::Adapt() {
+	long long totalCount = 0;
+	for (int i = 0; i < histogram_->Length; i++)
+		totalCount += histogram_[i];
+	if (totalCount == 0)
+		return;
+	long long coveredCount = (long long)System::Math::Ceiling(totalCount * adaptPercentile);
+	long long count = 0;
+	int bucket = 0;
+	for (; bucket < histogram_->Length - 1; bucket++) {
+		count += histogram_[bucket];
+		if (count >= coveredCount)
+			break;
+	}
+	percentileLength_ = BucketUpperBound(bucket);
+	lengthInBytes_ = max(percentileLength_, (int)sizeof(unsigned int));
+}
+
+BufferStatistics BufferState::GetStatistics() {
+	BufferStatistics result;
+	result.ObservedCount = observedCount_;
+	result.MaxLength = maxLength_;
+	result.PercentileLength = percentileLength_;
+	result.ChunkLength = lengthInBytes_;
+	return result;
 }
 
 void BufferState::UpdateLength(int newLengthInBytes) {
 	CheckLength(newLengthInBytes);
-	if (newLengthInBytes <= lengthInBytes_)
+	if (config_->IsAdaptive || newLengthInBytes <= lengthInBytes_)
 		return;
 	logger_->Warn(String::Format("reallocated from [{0}] to [{1}], {2}", lengthInBytes_, newLengthInBytes, description_));
 	lengthInBytes_ = newLengthInBytes;
@@ -115,7 +220,723 @@ void BufferAllocator::EnsureChunkCapacity(int capacity) {
 	state_->UpdateLength(capacity);
 }
 
+//chunks are moved to their new starts, so merging reader rebinds its readers without reloading their records
 void BufferAllocator::Allocate(int capacity) {
-	buffer_->DangerousBytes = gcnew array<Byte>(capacity * chunksCount_);
+	array<Byte>^ bytes = gcnew array<Byte>(capacity * chunksCount_);
+	array<Byte>^ previous = buffer_->DangerousBytes;
+	if (previous != nullptr && chunksCount_ > 1)
+		for (unsigned int i = 0; i < chunksCount_; i++)
+			Array::Copy(previous, i * chunkSize_, bytes, i * capacity, chunkSize_);
+	buffer_->DangerousBytes = bytes;
 	chunkSize_ = capacity;
+}
+
+//only every samplingRate-th touch is recorded to keep Find overhead negligible
+const int samplingRate = 16;
+
+WarmList::WarmList(String^ fileName, int capacity, ILogger^ logger)
+	:fileName_(fileName), capacity_(capacity), touchesCount_(0), logger_(logger),
+	entries_(gcnew Dictionary<String^, Entry^>()) {
+	Load();
+}
+
+String^ WarmList::GetEntryKey(String^ databaseName, array<Byte>^ key) {
+	return databaseName + "/" + Convert::ToBase64String(key);
+}
+
+void WarmList::Touch(String^ databaseName, BytesSegment key) {
+	if (Interlocked::Increment(touchesCount_) % samplingRate != 0)
+		return;
+	array<Byte>^ keyBytes = key.CopyToByteArray();
+	String^ entryKey = GetEntryKey(databaseName, keyBytes);
+	Monitor::Enter(entries_);
+	try {
+		Entry^ entry;
+		if (!entries_->TryGetValue(entryKey, entry)) {
+			entry = gcnew Entry();
+			entry->databaseName_ = databaseName;
+			entry->key_ = keyBytes;
+			entries_->Add(entryKey, entry);
+		}
+		entry->hits_++;
+		if (entries_->Count < capacity_ * 2)
+			return;
+		List<Entry^>^ hottest = GetHottest();
+		entries_->Clear();
+		for each (Entry^ e in hottest)
+			entries_->Add(GetEntryKey(e->databaseName_, e->key_), e);
+	}
+	finally {
+		Monitor::Exit(entries_);
+	}
+}
+
+List<array<Byte>^>^ WarmList::GetKeys(String^ databaseName) {
+	List<array<Byte>^>^ result = gcnew List<array<Byte>^>();
+	Monitor::Enter(entries_);
+	try {
+		for each (Entry^ entry in GetHottest())
+			if (entry->databaseName_ == databaseName)
+				result->Add(entry->key_);
+	}
+	finally {
+		Monitor::Exit(entries_);
+	}
+	return result;
+}
+
+List<WarmList::Entry^>^ WarmList::GetHottest() {
+	List<Entry^>^ result = gcnew List<Entry^>(entries_->Values);
+	array<long long>^ hits = gcnew array<long long>(result->Count);
+	for (int i = 0; i < hits->Length; i++)
+		hits[i] = -result[i]->hits_;
+	array<Entry^>^ sorted = result->ToArray();
+	Array::Sort(hits, sorted);
+	result = gcnew List<Entry^>(sorted);
+	if (result->Count > capacity_)
+		result->RemoveRange(capacity_, result->Count - capacity_);
+	return result;
+}
+
+void WarmList::Load() {
+	if (!File::Exists(fileName_))
+		return;
+	try {
+		BinaryReader^ reader = gcnew BinaryReader(File::OpenRead(fileName_));
+		try {
+			int count = reader->ReadInt32();
+			for (int i = 0; i < count; i++) {
+				Entry^ entry = gcnew Entry();
+				entry->databaseName_ = reader->ReadString();
+				entry->key_ = reader->ReadBytes(reader->ReadInt32());
+				//decayed, so keys that went cold eventually leave the list
+				entry->hits_ = reader->ReadInt64() / 2 + 1;
+				entries_[GetEntryKey(entry->databaseName_, entry->key_)] = entry;
+			}
+		}
+		finally {
+			reader->Close();
+		}
+	}
+	catch (Exception^ exception) {
+		entries_->Clear();
+		logger_->Warn("can't load warm list from [" + fileName_ + "], " + exception->Message);
+	}
+}
+
+void WarmList::Save() {
+	List<Entry^>^ hottest;
+	Monitor::Enter(entries_);
+	try {
+		hottest = GetHottest();
+	}
+	finally {
+		Monitor::Exit(entries_);
+	}
+	String^ temporaryFileName = fileName_ + ".tmp";
+	BinaryWriter^ writer = gcnew BinaryWriter(File::Create(temporaryFileName));
+	try {
+		writer->Write(hottest->Count);
+		for each (Entry^ entry in hottest) {
+			writer->Write(entry->databaseName_);
+			writer->Write(entry->key_->Length);
+			writer->Write(entry->key_);
+			writer->Write(entry->hits_);
+		}
+	}
+	finally {
+		writer->Close();
+	}
+	if (File::Exists(fileName_))
+		File::Delete(fileName_);
+	File::Move(temporaryFileName, fileName_);
+}
+
+const int findCacheShardsCount = 16;
+//dictionary and clock slots of an entry
+const int findCacheEntryOverhead = 64;
+
+FindCache::FindCache(long long capacityInBytes) :shards_(gcnew array<Shard^>(findCacheShardsCount)) {
+	for (int i = 0; i < shards_->Length; i++) {
+		Shard^ shard = gcnew Shard();
+		shard->entries_ = gcnew Dictionary<long long, Entry^>();
+		shard->clock_ = gcnew List<Entry^>();
+		shard->capacityInBytes_ = capacityInBytes / findCacheShardsCount;
+		shards_[i] = shard;
+	}
+}
+
+//fnv-1a, entries are found by 64-bit hash and the key is compared on hit, so lookup doesn't allocate
+long long FindCache::Hash(BytesSegment key) {
+	unsigned long long result = 14695981039346656037ull;
+	if (key.Length == 0)
+		return result;
+	array<Byte>^ bytes = key.DangerousGetBytes();
+	for (int i = key.Offset; i < key.Offset + key.Length; i++)
+		result = (result ^ bytes[i]) * 1099511628211ull;
+	return result;
+}
+
+bool FindCache::KeyEquals(array<Byte>^ key, BytesSegment other) {
+	if (key->Length != other.Length)
+		return false;
+	if (key->Length == 0)
+		return true;
+	array<Byte>^ otherBytes = other.DangerousGetBytes();
+	for (int i = 0; i < key->Length; i++)
+		if (key[i] != otherBytes[other.Offset + i])
+			return false;
+	return true;
+}
+
+FindCache::Shard^ FindCache::GetShard(long long hash) {
+	return shards_[static_cast<int>(static_cast<unsigned long long>(hash) >> 60) & (findCacheShardsCount - 1)];
+}
+
+bool FindCache::TryGet(BytesSegment key, BytesBuffer^% value, long long% version) {
+	long long hash = Hash(key);
+	Shard^ shard = GetShard(hash);
+	Monitor::Enter(shard);
+	try {
+		Entry^ entry;
+		if (shard->entries_->TryGetValue(hash, entry) && KeyEquals(entry->key_, key)) {
+			entry->referenced_ = true;
+			shard->hits_++;
+			value = entry->value_;
+			return true;
+		}
+		shard->misses_++;
+		version = shard->version_;
+		return false;
+	}
+	finally {
+		Monitor::Exit(shard);
+	}
+}
+
+void FindCache::Put(BytesSegment key, BytesBuffer^ value, long long version) {
+	long long hash = Hash(key);
+	Shard^ shard = GetShard(hash);
+	int size = key.Length + value->DangerousBytes->Length + findCacheEntryOverhead;
+	if (size > shard->capacityInBytes_)
+		return;
+	Monitor::Enter(shard);
+	try {
+		if (shard->version_ != version)
+			return;
+		Entry^ existing;
+		if (shard->entries_->TryGetValue(hash, existing))
+			RemoveEntry(shard, existing);
+		Entry^ entry = gcnew Entry();
+		entry->key_ = key.CopyToByteArray();
+		entry->value_ = value;
+		entry->hash_ = hash;
+		entry->size_ = size;
+		entry->index_ = shard->clock_->Count;
+		shard->entries_->Add(hash, entry);
+		shard->clock_->Add(entry);
+		shard->sizeInBytes_ += size;
+		//new entry is not referenced yet, so the hand passes it once before eviction, the same as any other
+		while (shard->sizeInBytes_ > shard->capacityInBytes_) {
+			if (shard->hand_ >= shard->clock_->Count)
+				shard->hand_ = 0;
+			Entry^ candidate = shard->clock_[shard->hand_];
+			if (candidate->referenced_) {
+				candidate->referenced_ = false;
+				shard->hand_++;
+				continue;
+			}
+			RemoveEntry(shard, candidate);
+			shard->evictions_++;
+		}
+	}
+	finally {
+		Monitor::Exit(shard);
+	}
+}
+
+//last entry takes the slot of removed one, so the hand doesn't skip anything but the moved entry
+void FindCache::RemoveEntry(Shard^ shard, Entry^ entry) {
+	shard->entries_->Remove(entry->hash_);
+	int lastIndex = shard->clock_->Count - 1;
+	Entry^ last = shard->clock_[lastIndex];
+	shard->clock_[entry->index_] = last;
+	last->index_ = entry->index_;
+	shard->clock_->RemoveAt(lastIndex);
+	shard->sizeInBytes_ -= entry->size_;
+}
+
+void FindCache::Invalidate(BytesSegment key) {
+	long long hash = Hash(key);
+	Shard^ shard = GetShard(hash);
+	Monitor::Enter(shard);
+	try {
+		shard->version_++;
+		Entry^ entry;
+		if (shard->entries_->TryGetValue(hash, entry)) {
+			RemoveEntry(shard, entry);
+			shard->invalidations_++;
+		}
+	}
+	finally {
+		Monitor::Exit(shard);
+	}
+}
+
+void FindCache::Clear() {
+	for each (Shard^ shard in shards_) {
+		Monitor::Enter(shard);
+		try {
+			shard->version_++;
+			shard->invalidations_ += shard->entries_->Count;
+			shard->entries_->Clear();
+			shard->clock_->Clear();
+			shard->hand_ = 0;
+			shard->sizeInBytes_ = 0;
+		}
+		finally {
+			Monitor::Exit(shard);
+		}
+	}
+}
+
+FindCacheStatistics FindCache::GetStatistics() {
+	FindCacheStatistics result = FindCacheStatistics();
+	for each (Shard^ shard in shards_) {
+		Monitor::Enter(shard);
+		try {
+			result.Hits += shard->hits_;
+			result.Misses += shard->misses_;
+			result.Evictions += shard->evictions_;
+			result.Invalidations += shard->invalidations_;
+			result.SizeInBytes += shard->sizeInBytes_;
+			result.EntriesCount += shard->entries_->Count;
+		}
+		finally {
+			Monitor::Exit(shard);
+		}
+	}
+	return result;
+}
+
+const int traceBufferSize = 64 * 1024;
+
+TraceRecorder::TraceRecorder(String^ fileName, bool withKeys)
+	:withKeys_(withKeys), startTimestamp_(Stopwatch::GetTimestamp()), recordsCount_(0), closed_(false) {
+	writer_ = gcnew BinaryWriter(gcnew System::IO::BufferedStream(File::Create(fileName), traceBufferSize));
+	writer_->Write(System::Text::Encoding::ASCII->GetBytes("SBDBTRC1"));
+	writer_->Write(withKeys_);
+}
+
+long long TraceRecorder::Now() {
+	return (Stopwatch::GetTimestamp() - startTimestamp_) * 1000000 / Stopwatch::Frequency;
+}
+
+//called under writer lock, finished is taken before it, so duration doesn't include waiting for the lock.
+//calls that picked the recorder up before StopTrace are dropped after Close
+bool TraceRecorder::Begin(Operation operation, long long started, long long finished, int result) {
+	if (closed_)
+		return false;
+	long long duration = finished - started;
+	writer_->Write(static_cast<Byte>(operation));
+	writer_->Write(started);
+	writer_->Write(static_cast<int>(duration > System::Int32::MaxValue ? System::Int32::MaxValue : duration));
+	writer_->Write(result);
+	recordsCount_++;
+	return true;
+}
+
+void TraceRecorder::Write(BytesSegment bytes) {
+	writer_->Write(bytes.Length);
+	if (withKeys_ && bytes.Length > 0)
+		writer_->Write(bytes.DangerousGetBytes(), bytes.Offset, bytes.Length);
+}
+
+void TraceRecorder::Write(Boundary^ boundary) {
+	if (boundary == nullptr) {
+		writer_->Write(static_cast<Byte>(0));
+		return;
+	}
+	writer_->Write(static_cast<Byte>(boundary->Inclusive ? 3 : 1));
+	Write(BytesSegment(boundary->Value));
+}
+
+void TraceRecorder::Write(Range^ range) {
+	Write(range->Left);
+	Write(range->Right);
+}
+
+void TraceRecorder::Add(long long started, BytesSegment key, int valueLength) {
+	long long finished = Now();
+	Monitor::Enter(writer_);
+	try {
+		if (!Begin(Operation::Add, started, finished, 0))
+			return;
+		Write(key);
+		writer_->Write(valueLength);
+	}
+	finally {
+		Monitor::Exit(writer_);
+	}
+}
+
+void TraceRecorder::Remove(long long started, BytesSegment key) {
+	long long finished = Now();
+	Monitor::Enter(writer_);
+	try {
+		if (!Begin(Operation::Remove, started, finished, 0))
+			return;
+		Write(key);
+	}
+	finally {
+		Monitor::Exit(writer_);
+	}
+}
+
+void TraceRecorder::Find(long long started, BytesSegment key, bool found) {
+	long long finished = Now();
+	Monitor::Enter(writer_);
+	try {
+		if (!Begin(Operation::Find, started, finished, found ? 1 : 0))
+			return;
+		Write(key);
+	}
+	finally {
+		Monitor::Exit(writer_);
+	}
+}
+
+void TraceRecorder::Query(long long started, long long elapsedTicks, Range^ range, int direction, int skip, int take, int rowsCount) {
+	long long finished = started + elapsedTicks * 1000000 / Stopwatch::Frequency;
+	Monitor::Enter(writer_);
+	try {
+		if (!Begin(Operation::Query, started, finished, rowsCount))
+			return;
+		Write(range);
+		writer_->Write(static_cast<System::SByte>(direction));
+		writer_->Write(skip);
+		writer_->Write(take);
+	}
+	finally {
+		Monitor::Exit(writer_);
+	}
+}
+
+void TraceRecorder::Fetch(long long started, array<Range^>^ ranges, int direction, int take, unsigned int keySuffixOffset,
+	KeySchema^ keySchema, int keySuffixField, int options, unsigned int rowsCount) {
+	long long finished = Now();
+	Monitor::Enter(writer_);
+	try {
+		if (!Begin(Operation::Fetch, started, finished, static_cast<int>(rowsCount)))
+			return;
+		writer_->Write(ranges->Length);
+		for each (Range^ range in ranges)
+			Write(range);
+		writer_->Write(static_cast<System::SByte>(direction));
+		writer_->Write(take);
+		writer_->Write(keySuffixOffset);
+		int fieldsCount = keySchema == nullptr ? 0 : keySuffixField;
+		writer_->Write(fieldsCount);
+		for (int i = 0; i < fieldsCount; i++) {
+			writer_->Write(keySchema->Fields[i]->FixedLength);
+			writer_->Write(keySchema->Fields[i]->Descending);
+		}
+		writer_->Write(static_cast<Byte>(options));
+	}
+	finally {
+		Monitor::Exit(writer_);
+	}
+}
+
+void TraceRecorder::Close() {
+	Monitor::Enter(writer_);
+	try {
+		if (closed_)
+			return;
+		closed_ = true;
+		writer_->Close();
+	}
+	finally {
+		Monitor::Exit(writer_);
+	}
+}
+
+SlowOperationLog::SlowOperationLog(DB_ENV* dbEnv, int thresholdInMilliseconds, ILogger^ logger, String^ description)
+	:dbEnv_(dbEnv), thresholdTicks_(thresholdInMilliseconds * Stopwatch::Frequency / 1000), logger_(logger), description_(description) {
+	reportedCacheMisses_ = CacheMisses();
+}
+
+SlowOperationLog::Start SlowOperationLog::Begin() {
+	Start result;
+	result.Timestamp = Stopwatch::GetTimestamp();
+	return result;
+}
+
+long long SlowOperationLog::Now() {
+	return Stopwatch::GetTimestamp();
+}
+
+//failed stat doesn't fail the measured call
+long long SlowOperationLog::CacheMisses() {
+	DB_MPOOL_STAT* pStat;
+	if (dbEnv_->memp_stat(dbEnv_, &pStat, nullptr, 0) != 0)
+		return 0;
+	long long result = static_cast<long long>(pStat->st_cache_miss);
+	free(pStat);
+	return result;
+}
+
+void SlowOperationLog::Add(Start start, BytesSegment key, int valueLength) {
+	long long elapsedTicks = Stopwatch::GetTimestamp() - start.Timestamp;
+	if (elapsedTicks < thresholdTicks_)
+		return;
+	Report("Add", elapsedTicks, start, String::Format("key length [{0}], value length [{1}]", key.Length, valueLength), ReadCounters());
+}
+
+void SlowOperationLog::Find(Start start, BytesSegment key, bool found, ReadCounters counters) {
+	long long elapsedTicks = Stopwatch::GetTimestamp() - start.Timestamp;
+	if (elapsedTicks < thresholdTicks_)
+		return;
+	Report("Find", elapsedTicks, start, String::Format("key length [{0}], found [{1}]", key.Length, found), counters);
+}
+
+void SlowOperationLog::Query(Start start, long long readTicks, Range^ range, int direction, int skip, int take, int rowsCount, ReadCounters counters) {
+	if (readTicks < thresholdTicks_)
+		return;
+	Report("Query", readTicks, start, String::Format("boundary lengths [{0}], direction [{1}], skip [{2}], take [{3}], rows [{4}]",
+		Lengths(range), direction, skip, take, rowsCount), counters);
+}
+
+void SlowOperationLog::Fetch(Start start, array<Range^>^ ranges, int direction, int skip, int take,
+	unsigned int keySuffixOffset, int keySuffixField, unsigned int rowsCount, ReadCounters counters) {
+	long long elapsedTicks = Stopwatch::GetTimestamp() - start.Timestamp;
+	if (elapsedTicks < thresholdTicks_)
+		return;
+	System::Text::StringBuilder^ lengths = gcnew System::Text::StringBuilder();
+	for (int i = 0; i < ranges->Length; i++) {
+		if (i > 0)
+			lengths->Append(", ");
+		lengths->Append(Lengths(ranges[i]));
+	}
+	String^ suffix = keySuffixField < 0
+		? String::Format("key suffix offset [{0}]", keySuffixOffset)
+		: String::Format("key suffix field [{0}]", keySuffixField);
+	Report("Fetch", elapsedTicks, start, String::Format("ranges [{0}], boundary lengths [{1}], direction [{2}], skip [{3}], take [{4}], {5}, rows [{6}]",
+		ranges->Length, lengths, direction, skip, take, suffix, rowsCount), counters);
+}
+
+void SlowOperationLog::Report(String^ operation, long long elapsedTicks, Start start, String^ parameters, ReadCounters counters) {
+	long long cacheMisses = CacheMisses();
+	long long reportedCacheMisses = Interlocked::Exchange(reportedCacheMisses_, cacheMisses);
+	cacheMisses = cacheMisses > reportedCacheMisses ? cacheMisses - reportedCacheMisses : 0;
+	logger_->Warn(String::Format("slow {0} took [{1}] millis, {2}, seeks [{3}], steps [{4}], buffer small retries [{5}], bytes copied [{6}], cache misses since previous report [{7}], {8}",
+		operation, elapsedTicks * 1000 / Stopwatch::Frequency, parameters, counters.Seeks, counters.Steps, counters.BufferSmallRetries,
+		counters.BytesCopied, cacheMisses, description_));
+}
+
+//left-right, null boundary is -
+String^ SlowOperationLog::Lengths(Range^ range) {
+	return String::Format("{0}-{1}",
+		range->Left != nullptr ? range->Left->Value->Length.ToString() : "-",
+		range->Right != nullptr ? range->Right->Value->Length.ToString() : "-");
+}
+
+const int checkpointIntervalInMilliseconds = 60 * 1000;
+
+GroupCommitter::GroupCommitter(DB_ENV* dbEnv, int intervalInMilliseconds, ILogger^ logger, String^ description)
+	:dbEnv_(dbEnv), intervalInMilliseconds_(intervalInMilliseconds), sync_(gcnew Object()),
+	pending_(gcnew TaskCompletionSource<bool>()), stopped_(gcnew ManualResetEventSlim(false)),
+	sinceCheckpoint_(Stopwatch::StartNew()), BdbComponent(logger, "group commit for " + description) {
+	thread_ = gcnew Thread(gcnew ThreadStart(this, &GroupCommitter::Run));
+	thread_->IsBackground = true;
+	thread_->Name = "bdb group commit";
+	thread_->Start();
+}
+
+Task^ GroupCommitter::GetTicket() {
+	CheckOpen();
+	Monitor::Enter(sync_);
+	try {
+		return pending_->Task;
+	}
+	finally {
+		Monitor::Exit(sync_);
+	}
+}
+
+void GroupCommitter::Run() {
+	while (!stopped_->Wait(intervalInMilliseconds_)) {
+		Flush();
+		if (sinceCheckpoint_->ElapsedMilliseconds >= checkpointIntervalInMilliseconds)
+			Checkpoint();
+	}
+	Flush();
+}
+
+void GroupCommitter::Flush() {
+	TaskCompletionSource<bool>^ flushed;
+	Monitor::Enter(sync_);
+	try {
+		flushed = pending_;
+		pending_ = gcnew TaskCompletionSource<bool>();
+	}
+	finally {
+		Monitor::Exit(sync_);
+	}
+	int resultCode = dbEnv_->log_flush(dbEnv_, nullptr);
+	if (resultCode == 0) {
+		flushed->SetResult(true);
+		return;
+	}
+	BdbApiException^ exception = gcnew BdbApiException(FormatApiMessage(resultCode, "env.log_flush"), resultCode);
+	logger_->Error("group commit failed", exception);
+	flushed->SetException(exception);
+}
+
+//bounds recovery time and lets bdb remove old log files
+void GroupCommitter::Checkpoint() {
+	int resultCode = dbEnv_->txn_checkpoint(dbEnv_, 0, 0, 0);
+	if (resultCode != 0)
+		logger_->Error("checkpoint failed", gcnew BdbApiException(FormatApiMessage(resultCode, "env.txn_checkpoint"), resultCode));
+	sinceCheckpoint_->Restart();
+}
+
+void GroupCommitter::Close() {
+	stopped_->Set();
+	thread_->Join();
+}
+
+template <typename TResult>
+class AsyncOperationCallback : public NativeWorkCallback {
+public:
+	AsyncOperationCallback(AsyncOperation<TResult>^ operation) :operation_(operation) {
+	}
+	virtual void Finish(NativeWorkItem& item) {
+		operation_->Finish(item);
+	}
+	virtual bool Enter(NativeWorkItem& item) {
+		return operation_->EnterReadLock(item);
+	}
+	virtual void Exit() {
+		operation_->ExitReadLock();
+	}
+private:
+	gcroot<AsyncOperation<TResult>^> operation_;
+};
+
+template <typename TResult>
+AsyncOperation<TResult>::AsyncOperation(Database^ db, NativeWorkItem* item)
+	:db_(db), item_(item), completion_(gcnew TaskCompletionSource<TResult>()), cancelled_(false) {
+}
+
+template <typename TResult>
+System::Threading::Tasks::Task<TResult>^ AsyncOperation<TResult>::Start(int priority, CancellationToken cancellationToken) {
+	NativeWorkerPool* pool = db_->env_->GetWorkerPool();
+	//pending operations keep database open until they are finished
+	if (!db_->asyncPending_->TryAddCount()) {
+		delete item_;
+		throw gcnew ObjectDisposedException(db_->description_);
+	}
+	item_->SetCallback(new AsyncOperationCallback<TResult>(this));
+	registration_ = cancellationToken.Register(gcnew System::Action(this, &AsyncOperation<TResult>::Cancel));
+	if (!pool->TryEnqueue(item_, priority)) {
+		registration_.Dispose();
+		delete item_;
+		db_->asyncPending_->Signal();
+		throw gcnew BdbException("async queue is full, " + db_->description_);
+	}
+	return completion_->Task;
+}
+
+template <typename TResult>
+void AsyncOperation<TResult>::Cancel() {
+	item_->Cancel();
+}
+
+const int asyncLockTimeoutInMilliseconds = 100;
+
+//client may hold write lock while closing the database, which cancels the item and waits for it
+template <typename TResult>
+bool AsyncOperation<TResult>::EnterReadLock(NativeWorkItem& item) {
+	while (!db_->env_->locker_->TryEnterReadLock(asyncLockTimeoutInMilliseconds))
+		if (item.IsCancelled())
+			return false;
+	return true;
+}
+
+template <typename TResult>
+void AsyncOperation<TResult>::ExitReadLock() {
+	db_->env_->locker_->ExitReadLock();
+}
+
+//runs on native worker, item is deleted right after
+template <typename TResult>
+void AsyncOperation<TResult>::Finish(NativeWorkItem& item) {
+	//waits for running Cancel, so item is not touched after deletion
+	registration_.Dispose();
+	try {
+		switch (item.GetStatus()) {
+		case NativeWorkItem::Completed:
+			result_ = CopyResult(item);
+			break;
+		case NativeWorkItem::Cancelled:
+			cancelled_ = true;
+			break;
+		case NativeWorkItem::ApiFailed:
+			exception_ = gcnew BdbApiException(db_->FormatApiMessage(item.ErrorNumber(), gcnew String(item.Api())), item.ErrorNumber());
+			break;
+		case NativeWorkItem::Failed:
+			exception_ = gcnew BdbException(gcnew String(item.Message().c_str()) + ", " + db_->description_);
+			break;
+		default:
+			exception_ = gcnew ObjectDisposedException(db_->description_);
+			break;
+		}
+	}
+	catch (Exception^ exception) {
+		exception_ = exception;
+	}
+	finally {
+		db_->asyncPending_->Signal();
+	}
+	ThreadPool::UnsafeQueueUserWorkItem(gcnew WaitCallback(this, &AsyncOperation<TResult>::Complete), nullptr);
+}
+
+template <typename TResult>
+void AsyncOperation<TResult>::Complete(Object^) {
+	if (exception_ != nullptr)
+		completion_->SetException(exception_);
+	else if (cancelled_)
+		completion_->SetCanceled();
+	else
+		completion_->SetResult(result_);
+}
+
+template ref class AsyncOperation<BytesBuffer^>;
+template ref class AsyncOperation<SimpleBdb::Utils::BytesTable^>;
+
+static NativeWorkItem* CreateNativeFindWorkItem(Database^ db, BytesSegment key) {
+	DBT_FOR_BYTES_SEGMENT(key, key);
+	return new NativeFindWorkItem(db->db_, keyPtr, keyLen, db->valuesState_->GetLengthInBytes(), db->asyncStopped_);
+}
+
+AsyncFind::AsyncFind(Database^ db, BytesSegment key, long long cacheVersion)
+	:key_(db->findCache_ != nullptr ? key.CopyToByteArray() : nullptr), cacheVersion_(cacheVersion), AsyncOperation(db, CreateNativeFindWorkItem(db, key)) {
+}
+
+BytesBuffer^ AsyncFind::CopyResult(NativeWorkItem& item) {
+	NativeFindWorkItem& findItem = static_cast<NativeFindWorkItem&>(item);
+	if (!findItem.Found())
+		return nullptr;
+	const std::vector<Byte>& value = findItem.Value();
+	BufferAllocator^ valueAccessor = gcnew BufferAllocator(db_->valuesState_, 1);
+	valueAccessor->EnsureChunkCapacity(value.size());
+	if (!value.empty()) {
+		pin_ptr<Byte> valuePtr = &valueAccessor->buffer_->DangerousBytes[0];
+		memcpy(valuePtr, &value[0], value.size());
+	}
+	valueAccessor->buffer_->Length = value.size();
+	if (key_ != nullptr)
+		db_->findCache_->Put(BytesSegment(key_), valueAccessor->buffer_, cacheVersion_);
+	return valueAccessor->buffer_;
 }
\ No newline at end of file
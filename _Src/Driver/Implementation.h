@@ -3,12 +3,18 @@
 #include "Shared.h"
 #include <exception>
 #include <stdexcept>
+#include <vector>
+
+class NativeWorkItem;
 
 namespace SimpleBdb {
 	namespace Driver {
 
 		enum class Direction;
 		ref class BytesBufferConfig;
+		ref class Database;
+		value struct FindCacheStatistics;
+		value struct BufferStatistics;
 
 		namespace Implementation {
 
@@ -32,11 +38,219 @@ namespace SimpleBdb {
 				void UpdateLength(int newLengthInBytes);
 				void CheckLength(int newLengthInBytes);
 				int GetLengthInBytes();
+				//record sizes are collected for adaptive config only, calls are no-op otherwise
+				void Observe(unsigned int length);
+				void Observe(array<SimpleBdb::Utils::SegmentPosition>^ positions, unsigned int offset, unsigned int count);
+				void Seed(const std::vector<unsigned int>& lengths);
+				BufferStatistics GetStatistics();
 				BytesBufferConfig^ config_;
 			private:
+				void Adapt();
+				static int BucketOf(unsigned int length);
+				static int BucketUpperBound(int bucket);
 				System::String^ description_;
 				int lengthInBytes_;
 				SimpleBdb::Utils::ILogger^ logger_;
+				//log-linear histogram, 4 buckets per power of two, so the chosen length overshoots by at most a quarter.
+				//counters are not interlocked, lost increments under concurrency only delay adaptation
+				array<long long>^ histogram_;
+				long long observedCount_;
+				unsigned int maxLength_;
+				int percentileLength_;
+			};
+
+			//sampled hot keys of environment databases, saved on close and preloaded on attach after restart
+			private ref class WarmList {
+			public:
+				WarmList(System::String^ fileName, int capacity, SimpleBdb::Utils::ILogger^ logger);
+				void Touch(System::String^ databaseName, SimpleBdb::Utils::BytesSegment key);
+				System::Collections::Generic::List<array<Byte>^>^ GetKeys(System::String^ databaseName);
+				void Save();
+			private:
+				ref class Entry {
+				public:
+					System::String^ databaseName_;
+					array<Byte>^ key_;
+					long long hits_;
+				};
+				void Load();
+				System::Collections::Generic::List<Entry^>^ GetHottest();
+				static System::String^ GetEntryKey(System::String^ databaseName, array<Byte>^ key);
+				System::String^ fileName_;
+				int capacity_;
+				int touchesCount_;
+				System::Collections::Generic::Dictionary<System::String^, Entry^>^ entries_;
+				SimpleBdb::Utils::ILogger^ logger_;
+			};
+
+			//commits are written to log without sync, background thread flushes log once per interval,
+			//so one fsync makes durable all writes done before the ticket was taken
+			private ref class GroupCommitter : BdbComponent {
+			public:
+				GroupCommitter(DB_ENV* dbEnv, int intervalInMilliseconds, SimpleBdb::Utils::ILogger^ logger, System::String^ description);
+				System::Threading::Tasks::Task^ GetTicket();
+			protected:
+				virtual void Close() override;
+			private:
+				void Run();
+				void Flush();
+				void Checkpoint();
+				DB_ENV* dbEnv_;
+				int intervalInMilliseconds_;
+				System::Object^ sync_;
+				System::Threading::Tasks::TaskCompletionSource<bool>^ pending_;
+				System::Threading::ManualResetEventSlim^ stopped_;
+				System::Threading::Thread^ thread_;
+				System::Diagnostics::Stopwatch^ sinceCheckpoint_;
+			};
+
+			//values of hot keys returned by Database::Find, bounded by bytes and split into independently locked shards,
+			//each shard evicts by CLOCK. Writes bump shard version, so value read before the write is not cached after it
+			private ref class FindCache {
+			public:
+				FindCache(long long capacityInBytes);
+				bool TryGet(SimpleBdb::Utils::BytesSegment key, SimpleBdb::Utils::BytesBuffer^% value, long long% version);
+				void Put(SimpleBdb::Utils::BytesSegment key, SimpleBdb::Utils::BytesBuffer^ value, long long version);
+				void Invalidate(SimpleBdb::Utils::BytesSegment key);
+				void Clear();
+				FindCacheStatistics GetStatistics();
+			private:
+				ref class Entry {
+				public:
+					array<Byte>^ key_;
+					SimpleBdb::Utils::BytesBuffer^ value_;
+					long long hash_;
+					int size_;
+					int index_;
+					bool referenced_;
+				};
+				ref class Shard {
+				public:
+					System::Collections::Generic::Dictionary<long long, Entry^>^ entries_;
+					System::Collections::Generic::List<Entry^>^ clock_;
+					int hand_;
+					long long capacityInBytes_;
+					long long sizeInBytes_;
+					long long version_;
+					long long hits_;
+					long long misses_;
+					long long evictions_;
+					long long invalidations_;
+				};
+				static long long Hash(SimpleBdb::Utils::BytesSegment key);
+				static bool KeyEquals(array<Byte>^ key, SimpleBdb::Utils::BytesSegment other);
+				Shard^ GetShard(long long hash);
+				static void RemoveEntry(Shard^ shard, Entry^ entry);
+				array<Shard^>^ shards_;
+			};
+
+			//appends binary trace of database calls, replayed by _Src/Native/Tools/TraceReplay.cpp. Layout, little endian:
+			//header "SBDBTRC1", byte withKeys; record: byte op, int64 start micros since trace start, int32 duration micros, int32 result, body.
+			//bytes are int32 length followed by content only when keys are traced, boundary is byte flags (1 present, 2 inclusive) and bytes.
+			//Add: key, int32 value length. Remove, Find: key, result 1 when found. Query: left, right, sbyte direction, int32 skip, int32 take,
+			//result is rows read, query is written when its cursor is disposed and its duration is the time spent in cursor reads.
+			//Fetch: int32 ranges count, ranges, sbyte direction, int32 take, uint32 key suffix offset,
+			//int32 count of fields before suffix field followed by (int32 fixed length, byte descending) of each, byte options, result is rows count
+			private ref class TraceRecorder {
+			public:
+				enum class Operation : Byte { Add = 1, Remove = 2, Find = 3, Query = 4, Fetch = 5 };
+				TraceRecorder(System::String^ fileName, bool withKeys);
+				long long Now();
+				void Add(long long started, SimpleBdb::Utils::BytesSegment key, int valueLength);
+				void Remove(long long started, SimpleBdb::Utils::BytesSegment key);
+				void Find(long long started, SimpleBdb::Utils::BytesSegment key, bool found);
+				//elapsedTicks are Stopwatch ticks
+				void Query(long long started, long long elapsedTicks, SimpleBdb::Utils::Range^ range, int direction, int skip, int take, int rowsCount);
+				void Fetch(long long started, array<SimpleBdb::Utils::Range^>^ ranges, int direction, int take, unsigned int keySuffixOffset,
+					SimpleBdb::Utils::KeySchema^ keySchema, int keySuffixField, int options, unsigned int rowsCount);
+				void Close();
+				long long RecordsCount() { return recordsCount_; }
+			private:
+				bool Begin(Operation operation, long long started, long long finished, int result);
+				void Write(SimpleBdb::Utils::BytesSegment bytes);
+				void Write(SimpleBdb::Utils::Boundary^ boundary);
+				void Write(SimpleBdb::Utils::Range^ range);
+				System::IO::BinaryWriter^ writer_;
+				bool withKeys_;
+				long long startTimestamp_;
+				long long recordsCount_;
+				bool closed_;
+			};
+
+			//read work of one call, copied from NativeReadCounters
+			private value struct ReadCounters {
+				unsigned int Seeks;
+				unsigned int Steps;
+				unsigned long long BytesCopied;
+				unsigned int BufferSmallRetries;
+			};
+
+			//reports Database calls slower than DatabaseConfig.SlowOperationThresholdInMilliseconds as logger warnings,
+			//fast calls only take timestamps, message and memp_stat are done only for slow ones. memp_stat locks every
+			//cache region, so cache misses are the environment wide difference since the previous report of this log
+			//and include misses of concurrent calls
+			private ref class SlowOperationLog {
+			public:
+				value struct Start {
+					long long Timestamp;
+				};
+				SlowOperationLog(DB_ENV* dbEnv, int thresholdInMilliseconds, SimpleBdb::Utils::ILogger^ logger, System::String^ description);
+				Start Begin();
+				long long Now();
+				void Add(Start start, SimpleBdb::Utils::BytesSegment key, int valueLength);
+				void Find(Start start, SimpleBdb::Utils::BytesSegment key, bool found, ReadCounters counters);
+				//query is measured by its cursor, readTicks is time spent in cursor reads since start
+				void Query(Start start, long long readTicks, SimpleBdb::Utils::Range^ range, int direction, int skip, int take, int rowsCount, ReadCounters counters);
+				//keySuffixField < 0 means suffix is located by keySuffixOffset
+				void Fetch(Start start, array<SimpleBdb::Utils::Range^>^ ranges, int direction, int skip, int take,
+					unsigned int keySuffixOffset, int keySuffixField, unsigned int rowsCount, ReadCounters counters);
+			private:
+				long long CacheMisses();
+				void Report(System::String^ operation, long long elapsedTicks, Start start, System::String^ parameters, ReadCounters counters);
+				static System::String^ Lengths(SimpleBdb::Utils::Range^ range);
+				DB_ENV* dbEnv_;
+				long long thresholdTicks_;
+				long long reportedCacheMisses_;
+				SimpleBdb::Utils::ILogger^ logger_;
+				System::String^ description_;
+			};
+
+			//native part of the call runs on environment worker pool under client read lock, results are copied on the worker,
+			//task is completed on managed thread pool, so continuations never run on native workers
+			template <typename TResult>
+			private ref class AsyncOperation abstract {
+			public:
+				System::Threading::Tasks::Task<TResult>^ Start(int priority, System::Threading::CancellationToken cancellationToken);
+				void Finish(NativeWorkItem& item);
+				//takes environment read lock on the worker, false when item is cancelled while waiting for a writer
+				bool EnterReadLock(NativeWorkItem& item);
+				void ExitReadLock();
+			protected:
+				//takes ownership of item
+				AsyncOperation(Database^ db, NativeWorkItem* item);
+				virtual TResult CopyResult(NativeWorkItem& item) abstract;
+				Database^ db_;
+			private:
+				void Cancel();
+				void Complete(System::Object^ state);
+				NativeWorkItem* item_;
+				System::Threading::Tasks::TaskCompletionSource<TResult>^ completion_;
+				System::Threading::CancellationTokenRegistration registration_;
+				TResult result_;
+				System::Exception^ exception_;
+				bool cancelled_;
+			};
+
+			private ref class AsyncFind : AsyncOperation<SimpleBdb::Utils::BytesBuffer^> {
+			public:
+				//found value is put into find cache with cacheVersion taken by the missed TryGet, as the sync Find does
+				AsyncFind(Database^ db, SimpleBdb::Utils::BytesSegment key, long long cacheVersion);
+			protected:
+				virtual SimpleBdb::Utils::BytesBuffer^ CopyResult(NativeWorkItem& item) override;
+			private:
+				//null when find cache is disabled
+				array<Byte>^ key_;
+				long long cacheVersion_;
 			};
 
 			private ref class TestingEnvironment abstract sealed {
@@ -66,6 +280,17 @@ namespace SimpleBdb {
 				name##Dbt.data = name##Ptr; \
 				name##Dbt.ulen = accessor->buffer_->DangerousBytes->Length; \
 				name##Dbt.flags = DB_DBT_USERMEM
+
+			#define INVOKE_NATIVE_OPERATION(f) \
+				try { \
+					f; \
+				} \
+				catch(const NativeBdbApiException& e) { \
+					throw gcnew BdbApiException(FormatApiMessage(e.ErrorNumber(), gcnew System::String(e.Api())), e.ErrorNumber()); \
+				} \
+				catch (const NativeBdbException& e) { \
+					throw gcnew BdbException(gcnew System::String(e.Message().c_str()) + ", " + description_); \
+				}
 		}
 	}
 }
\ No newline at end of file
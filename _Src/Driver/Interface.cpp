@@ -2,13 +2,29 @@
 #include "Interface.h"
 #include "Implementation.h"
 #include "Cursors.h"
+#include "NativeCompression.h"
+#include "NativePostings.h"
+#include "NativeWorkers.h"
+#include "NativeBloom.h"
+#include "NativeBulkLoad.h"
+#include "NativeSecondary.h"
+#include "NativePrefixCounts.h"
+#include "NativeMetadata.h"
 #include <exception>
 
 using namespace SimpleBdb::Driver;
 
 using System::String;
+using System::Object;
 using System::Collections::Generic::List;
+using System::Collections::Generic::IEnumerable;
+using System::Collections::Generic::KeyValuePair;
 using System::Threading::ReaderWriterLockSlim;
+using System::Threading::CancellationToken;
+using System::Threading::CountdownEvent;
+using System::Threading::Monitor;
+using System::Threading::Interlocked;
+using System::Threading::Tasks::Task;
 using SimpleBdb::Utils::IForwardReader;
 using SimpleBdb::Utils::Range;
 using SimpleBdb::Utils::ILogger;
@@ -17,23 +33,120 @@ using Implementation::BufferState;
 using Implementation::BufferAllocator;
 using Implementation::SimpleCursor;
 using Implementation::SuffixMergingFetcher;
+using Implementation::DuplicatesCursor;
+using Implementation::SecondaryCursor;
+using Implementation::PartitionsCursor;
+using Implementation::WarmList;
+using Implementation::GroupCommitter;
+using Implementation::AsyncFind;
+using Implementation::AsyncFetchers;
+using Implementation::FindCache;
+using Implementation::TraceRecorder;
+using Implementation::SlowOperationLog;
+using Implementation::ReadCounters;
 using SimpleBdb::Utils::BytesSegment;
 using SimpleBdb::Utils::BytesBuffer;
 using SimpleBdb::Utils::BytesTable;
+using SimpleBdb::Utils::KeySchema;
+using SimpleBdb::Utils::ByteHelpers;
 
 const long long gb = 1ll * 1024 * 1024 * 1024;
+const unsigned int postingsChunkSize = 1024;
+const unsigned int duplicatesBulkBufferSize = 64 * 1024;
+const int defaultWarmListCapacity = 10000;
+const int warmUpLockTimeoutInMilliseconds = 100;
+const int defaultGroupCommitIntervalInMilliseconds = 10;
+const int defaultAsyncQueueLength = 1024;
+//bulk reads at the start and split keys of the database seeding adaptive buffer sizes
+const unsigned int adaptiveSamplesCount = 8;
+
+void AppendField(std::vector<Byte>& target, array<Byte>^ bytes) {
+	if (bytes->Length == 0) {
+		NativeAppendField(target, nullptr, 0);
+		return;
+	}
+	pin_ptr<Byte> bytesPtr = &bytes[0];
+	NativeAppendField(target, bytesPtr, bytes->Length);
+}
 
 Environment::Environment(EnvironmentConfig^ config, ILogger^ logger)
 	:config_(config), databases_(gcnew List<Database^>()), locker_(gcnew ReaderWriterLockSlim()),
-	fileName_(System::IO::Path::GetFullPath(config_->FileName)),
+	fileName_(System::IO::Path::GetFullPath(config_->FileName)), workerPool_(nullptr), workerPoolSync_(gcnew Object()),
 	BdbComponent(logger, String::Format("environment (file name [{0}])", fileName_)) {
+	if (config_->EnableGroupCommit && !config_->IsPersistent)
+		throw gcnew BdbException("group commit requires persistent environment, " + description_);
+	//recovery on open would recreate regions under processes already attached to them
+	if (config_->EnableGroupCommit && config_->IsShared)
+		throw gcnew BdbException("group commit is not supported by shared environment, " + description_);
+	//long is 32 bit on windows, truncated key would attach to regions of another environment
+	if (static_cast<long>(config_->SharedMemoryKey) != config_->SharedMemoryKey)
+		throw gcnew BdbException(String::Format("shared memory key [{0}] doesn't fit into long, {1}", config_->SharedMemoryKey, description_));
+	Create();
+	Open();
+	if (config_->EnableGroupCommit)
+		groupCommitter_ = gcnew GroupCommitter(dbEnv_, config_->GroupCommitIntervalInMilliseconds > 0
+			? config_->GroupCommitIntervalInMilliseconds : defaultGroupCommitIntervalInMilliseconds, logger_, description_);
+	if (config_->WarmListFileName != nullptr)
+		warmList_ = gcnew WarmList(System::IO::Path::GetFullPath(config_->WarmListFileName),
+			config_->WarmListCapacity > 0 ? config_->WarmListCapacity : defaultWarmListCapacity, logger_);
+}
+
+void Environment::Create() {
 	DB_ENV* dbEnv;
 	CheckApiOk(db_env_create(&dbEnv, 0), "db_env_create");
 	dbEnv_ = dbEnv;
 	dbEnv_->set_errpfx(dbEnv_, "envpfx");
 	dbEnv_->set_errcall(dbEnv_, GetLogFunc());
-	CheckApiOk(dbEnv_->set_cachesize(dbEnv_, static_cast<u_int32_t>(config->CacheSizeInBytes / gb), static_cast<u_int32_t>(config->CacheSizeInBytes % gb), 1), "env.set_cachesize");
-	CheckApiOk(dbEnv_->open(dbEnv_, nullptr, DB_CREATE | DB_PRIVATE | DB_THREAD | DB_INIT_MPOOL, 0), "env.open");
+	int cacheRegionsCount = config_->CacheRegionsCount > 0 ? config_->CacheRegionsCount : 1;
+	CheckApiOk(dbEnv_->set_cachesize(dbEnv_, static_cast<u_int32_t>(config_->CacheSizeInBytes / gb), static_cast<u_int32_t>(config_->CacheSizeInBytes % gb), cacheRegionsCount), "env.set_cachesize");
+	if (config_->CacheHashBucketsCount > 0)
+		CheckApiOk(dbEnv_->set_mp_tablesize(dbEnv_, config_->CacheHashBucketsCount), "env.set_mp_tablesize");
+	if (config_->CacheHashMutexesCount > 0)
+		CheckApiOk(dbEnv_->set_mp_mtxcount(dbEnv_, config_->CacheHashMutexesCount), "env.set_mp_mtxcount");
+	if (config_->MemoryMapSizeInBytes > 0)
+		CheckApiOk(dbEnv_->set_mp_mmapsize(dbEnv_, static_cast<size_t>(config_->MemoryMapSizeInBytes)), "env.set_mp_mmapsize");
+	if (config_->MaxOpenFiles > 0)
+		CheckApiOk(dbEnv_->set_mp_max_openfd(dbEnv_, config_->MaxOpenFiles), "env.set_mp_max_openfd");
+	if (config_->MaxWritesCount > 0)
+		CheckApiOk(dbEnv_->set_mp_max_write(dbEnv_, config_->MaxWritesCount, config_->MaxWriteSleepInMicroseconds), "env.set_mp_max_write");
+	if (config_->MutexSpinsCount > 0)
+		CheckApiOk(dbEnv_->mutex_set_tas_spins(dbEnv_, config_->MutexSpinsCount), "env.mutex_set_tas_spins");
+	if (config_->IsShared && config_->SharedMemoryKey != 0)
+		CheckApiOk(dbEnv_->set_shm_key(dbEnv_, static_cast<long>(config_->SharedMemoryKey)), "env.set_shm_key");
+	if (config_->EnableGroupCommit) {
+		CheckApiOk(dbEnv_->set_flags(dbEnv_, DB_TXN_NOSYNC, 1), "env.set_flags");
+		CheckApiOk(dbEnv_->log_set_config(dbEnv_, DB_LOG_AUTO_REMOVE, 1), "env.log_set_config");
+	}
+}
+
+void Environment::Open() {
+	u_int32_t flags = DB_CREATE | DB_THREAD | DB_INIT_MPOOL;
+	if (config_->EnableGroupCommit)
+		flags |= DB_INIT_LOG | DB_INIT_TXN | DB_RECOVER;
+	if (!config_->IsShared && !config_->EnableGroupCommit) {
+		CheckApiOk(dbEnv_->open(dbEnv_, nullptr, flags | DB_PRIVATE, 0), "env.open");
+		return;
+	}
+	std::string stdHome(msclr::interop::marshal_as<std::string>(System::IO::Path::GetDirectoryName(fileName_)));
+	//group commit environment is never shared, so recovery runs under no other process
+	if (!config_->IsShared) {
+		CheckApiOk(dbEnv_->open(dbEnv_, stdHome.c_str(), flags | DB_PRIVATE, 0), "env.open");
+		return;
+	}
+	if (config_->SharedMemoryKey != 0)
+		flags |= DB_SYSTEM_MEM;
+	int resultCode = dbEnv_->open(dbEnv_, stdHome.c_str(), flags, 0);
+	if (resultCode != DB_RUNRECOVERY) {
+		CheckApiOk(resultCode, "env.open");
+		return;
+	}
+	//regions were left inconsistent by crashed process, cache is lost anyway
+	logger_->Warn("shared environment regions are corrupted, recreating, " + description_);
+	dbEnv_->close(dbEnv_, 0);
+	Create();
+	CheckApiOk(dbEnv_->remove(dbEnv_, stdHome.c_str(), DB_FORCE), "env.remove");
+	Create();
+	CheckApiOk(dbEnv_->open(dbEnv_, stdHome.c_str(), flags, 0), "env.open");
 }
 
 Database^ Environment::AttachDatabase(DatabaseConfig^ config) {
@@ -42,6 +155,8 @@ Database^ Environment::AttachDatabase(DatabaseConfig^ config) {
 	try {
 		result->Open();
 		TrackDatabase(result);
+		if (warmList_ != nullptr)
+			result->StartWarmUp(warmList_->GetKeys(config->Name));
 	}
 	catch (...) {
 		result->~Database();
@@ -50,10 +165,251 @@ Database^ Environment::AttachDatabase(DatabaseConfig^ config) {
 	return result;
 }
 
+PartitionedDatabase^ Environment::AttachPartitionedDatabase(DatabaseConfig^ config, array<array<Byte>^>^ boundaries) {
+	CheckOpen();
+	if (String::IsNullOrEmpty(config->Name))
+		throw gcnew BdbException("partitioned database requires name, " + description_);
+	for (int i = 1; i < boundaries->Length; i++)
+		if (ByteHelpers::Compare(boundaries[i - 1], boundaries[i]) >= 0)
+			throw gcnew BdbException(String::Format("partition boundaries must be sorted ascending, boundary index [{0}], database name [{1}], {2}",
+			i, config->Name, description_));
+	CheckPartitionBoundaries(config, boundaries);
+	array<Database^>^ partitions = gcnew array<Database^>(boundaries->Length + 1);
+	try {
+		for (int i = 0; i < partitions->Length; i++) {
+			DatabaseConfig^ partitionConfig = config->Clone();
+			partitionConfig->Name = String::Format("{0}.{1}", config->Name, i);
+			partitions[i] = AttachDatabase(partitionConfig);
+		}
+	}
+	catch (...) {
+		for each (Database^ partition in partitions)
+			if (partition != nullptr)
+				partition->~Database();
+		throw;
+	}
+	return gcnew PartitionedDatabase(this, config->Name, safe_cast<array<array<Byte>^>^>(boundaries->Clone()), partitions);
+}
+
+//boundaries are stored on the first attach, as keys routed by other boundaries would be looked up in wrong partitions
+void Environment::CheckPartitionBoundaries(DatabaseConfig^ config, array<array<Byte>^>^ boundaries) {
+	std::vector<Byte> value;
+	for each (array<Byte>^ boundary in boundaries)
+		AppendField(value, boundary);
+	std::string stdFileName(msclr::interop::marshal_as<std::string>(fileName_));
+	std::string stdName(msclr::interop::marshal_as<std::string>(config->Name + ".metadata"));
+	bool matched = false;
+	INVOKE_NATIVE_OPERATION(
+		NativeMetadata metadata(dbEnv_, stdFileName.c_str(), stdName.c_str(), DatabaseOpenFlags(config->IsReadonly));
+		matched = metadata.Match("boundaries", value);
+		metadata.Close());
+	if (!matched)
+		throw gcnew BdbException(String::Format("partition boundaries don't match boundaries of the first attach, database name [{0}], {1}",
+		config->Name, description_));
+}
+
+u_int32_t Environment::DatabaseOpenFlags(bool readonly) {
+	u_int32_t flags = readonly ? DB_RDONLY : DB_CREATE;
+	if (config_->EnableGroupCommit)
+		flags |= DB_AUTO_COMMIT;
+	return flags;
+}
+
+//created on first async call, so environments without async calls don't hold idle threads
+NativeWorkerPool* Environment::GetWorkerPool() {
+	CheckOpen();
+	Monitor::Enter(workerPoolSync_);
+	try {
+		if (workerPool_ == nullptr) {
+			int workersCount = config_->AsyncWorkersCount > 0 ? config_->AsyncWorkersCount : 2 * System::Environment::ProcessorCount;
+			int queueLength = config_->AsyncQueueLength > 0 ? config_->AsyncQueueLength : defaultAsyncQueueLength;
+			workerPool_ = new NativeWorkerPool(workersCount, queueLength);
+		}
+		return workerPool_;
+	}
+	finally {
+		Monitor::Exit(workerPoolSync_);
+	}
+}
+
+Task^ Environment::GetCommitTicket() {
+	CheckOpen();
+	if (groupCommitter_ == nullptr)
+		throw gcnew BdbException("group commit is not enabled, " + description_);
+	return groupCommitter_->GetTicket();
+}
+
+BulkLoadStatistics Environment::BulkLoad(DatabaseConfig^ config, IEnumerable<KeyValuePair<array<Byte>^, array<Byte>^>>^ records, BulkLoadConfig^ loadConfig) {
+	CheckOpen();
+	if (String::IsNullOrEmpty(config->Name))
+		throw gcnew BdbException("bulk load requires database name, " + description_);
+	for each(Database^ database in databases_)
+		if (database->config_->Name == config->Name)
+			throw gcnew BdbException(String::Format("database [{0}] is attached and can't be bulk loaded, {1}", config->Name, description_));
+	System::Diagnostics::Stopwatch^ stopwatch = System::Diagnostics::Stopwatch::StartNew();
+	DatabaseConfig^ loadDatabaseConfig = config->Clone();
+	loadDatabaseConfig->Name = config->Name + ".bulkload";
+	loadDatabaseConfig->IsReadonly = false;
+	loadDatabaseConfig->IsMemoryMapped = false;
+	loadDatabaseConfig->FindCacheSizeInBytes = 0;
+	loadDatabaseConfig->BloomFilterBitsPerKey = 0;
+	loadDatabaseConfig->SecondaryIndexes = nullptr;
+	loadDatabaseConfig->CountedPrefixLength = 0;
+	String^ tempDirectory = loadConfig->TempDirectory != nullptr ? loadConfig->TempDirectory : System::IO::Path::GetDirectoryName(fileName_);
+	std::string stdRunFilePrefix(msclr::interop::marshal_as<std::string>(System::IO::Path::Combine(tempDirectory,
+		String::Format("{0}.bulkload.{1}.", System::IO::Path::GetFileName(fileName_), System::Guid::NewGuid().ToString("N")))));
+	size_t sortMemory = loadConfig->SortMemoryInBytes > 0 ? static_cast<size_t>(loadConfig->SortMemoryInBytes) : 64 * 1024 * 1024;
+	unsigned int fillPercent = loadConfig->FillPercent > 0 ? loadConfig->FillPercent : 95;
+	BulkLoadStatistics result;
+	auto loadDatabase = gcnew Database(this, loadDatabaseConfig);
+	try {
+		//open, remove and rename change master database of the file, which other databases read on their open
+		bool locked = EnterWriteLock();
+		try {
+			//left by a failed load
+			RemoveDatabase(loadDatabaseConfig->Name);
+			loadDatabase->Open();
+		}
+		finally {
+			if (locked)
+				locker_->ExitWriteLock();
+		}
+		NativeBulkLoader* loader;
+		INVOKE_NATIVE_OPERATION(loader = new NativeBulkLoader(loadDatabase->db_, loadConfig->IsSorted, sortMemory, stdRunFilePrefix));
+		try {
+			for each(KeyValuePair<array<Byte>^, array<Byte>^> record in records) {
+				BytesSegment keySegment(record.Key);
+				BytesSegment valueSegment(record.Value);
+				DBT_FOR_BYTES_SEGMENT(key, keySegment);
+				DBT_FOR_BYTES_SEGMENT(value, valueSegment);
+				INVOKE_NATIVE_OPERATION(loader->Add(keyPtr, keyLen, valuePtr, valueLen));
+			}
+			INVOKE_NATIVE_OPERATION(result.RecordsCount = loader->Finish());
+			result.RunsCount = loader->RunsCount();
+		}
+		finally {
+			delete loader;
+		}
+		INVOKE_NATIVE_OPERATION(NativeCompact(loadDatabase->db_, fillPercent));
+		result.PagesCount = loadDatabase->GetStatistics(false).bt_pagecnt;
+		loadDatabase->~Database();
+		//secondaries and saved prefix counts of the replaced database don't index loaded records
+		List<String^>^ staleNames = gcnew List<String^>();
+		if (config->SecondaryIndexes != nullptr)
+			for each (SecondaryIndexConfig^ index in config->SecondaryIndexes)
+				staleNames->Add(config->Name + "." + index->Name);
+		staleNames->Add(config->Name + ".metadata");
+		locked = EnterWriteLock();
+		try {
+			RenameDatabase(loadDatabaseConfig->Name, config->Name, staleNames);
+		}
+		finally {
+			if (locked)
+				locker_->ExitWriteLock();
+		}
+	}
+	catch (...) {
+		try {
+			loadDatabase->~Database();
+			bool locked = EnterWriteLock();
+			try {
+				RemoveDatabase(loadDatabaseConfig->Name);
+			}
+			finally {
+				if (locked)
+					locker_->ExitWriteLock();
+			}
+		}
+		catch (BdbException^ exception) {
+			logger_->Error("can't remove bulk load database, " + description_, exception);
+		}
+		throw;
+	}
+	result.ElapsedMilliseconds = stopwatch->ElapsedMilliseconds;
+	result.RecordsPerSecond = result.RecordsCount * 1000.0 / System::Math::Max(result.ElapsedMilliseconds, 1LL);
+	return result;
+}
+
+//load is called with or without client write lock, which is not recursive
+bool Environment::EnterWriteLock() {
+	if (locker_->IsWriteLockHeld)
+		return false;
+	locker_->EnterWriteLock();
+	return true;
+}
+
+//stale databases and target are removed and replaced in one transaction when environment is transactional,
+//otherwise stale ones are removed first, so they never outlive the target they were built from
+void Environment::RenameDatabase(String^ sourceName, String^ targetName, List<String^>^ staleNames) {
+	std::string stdFileName(msclr::interop::marshal_as<std::string>(fileName_));
+	std::string stdSourceName(msclr::interop::marshal_as<std::string>(sourceName));
+	std::string stdTargetName(msclr::interop::marshal_as<std::string>(targetName));
+	DB_TXN* txn = nullptr;
+	if (config_->EnableGroupCommit)
+		CheckApiOk(dbEnv_->txn_begin(dbEnv_, nullptr, &txn, 0), "env.txn_begin");
+	int resultCode = 0;
+	String^ api = "env.dbremove";
+	for (int i = 0; i < staleNames->Count && resultCode == 0; i++) {
+		std::string stdStaleName(msclr::interop::marshal_as<std::string>(staleNames[i]));
+		resultCode = dbEnv_->dbremove(dbEnv_, txn, stdFileName.c_str(), stdStaleName.c_str(), 0);
+		if (resultCode == ENOENT)
+			resultCode = 0;
+	}
+	if (resultCode == 0) {
+		resultCode = dbEnv_->dbremove(dbEnv_, txn, stdFileName.c_str(), stdTargetName.c_str(), 0);
+		if (resultCode == ENOENT)
+			resultCode = 0;
+	}
+	if (resultCode == 0) {
+		resultCode = dbEnv_->dbrename(dbEnv_, txn, stdFileName.c_str(), stdSourceName.c_str(), stdTargetName.c_str(), 0);
+		api = "env.dbrename";
+	}
+	if (txn != nullptr) {
+		if (resultCode == 0) {
+			resultCode = txn->commit(txn, 0);
+			api = "txn.commit";
+		}
+		else
+			txn->abort(txn);
+	}
+	CheckApiOk(resultCode, api);
+}
+
+void Environment::RemoveDatabase(String^ name) {
+	std::string stdFileName(msclr::interop::marshal_as<std::string>(fileName_));
+	std::string stdName(msclr::interop::marshal_as<std::string>(name));
+	int resultCode = dbEnv_->dbremove(dbEnv_, nullptr, stdFileName.c_str(), stdName.c_str(), config_->EnableGroupCommit ? DB_AUTO_COMMIT : 0);
+	if (resultCode != ENOENT)
+		CheckApiOk(resultCode, "env.dbremove");
+}
+
 String^ Environment::DumpStats() {
 	return "not implemented";
 }
 
+CacheStatistics Environment::GetCacheStatistics() {
+	CheckOpen();
+	DB_MPOOL_STAT* pStat;
+	CheckApiOk(dbEnv_->memp_stat(dbEnv_, &pStat, nullptr, 0), "env.memp_stat");
+	CacheStatistics result;
+	result.st_ncache = pStat->st_ncache;
+	result.st_pages = pStat->st_pages;
+	result.st_map = pStat->st_map;
+	result.st_page_clean = pStat->st_page_clean;
+	result.st_page_dirty = pStat->st_page_dirty;
+	result.st_hash_buckets = pStat->st_hash_buckets;
+	result.st_cache_hit = pStat->st_cache_hit;
+	result.st_cache_miss = pStat->st_cache_miss;
+	result.st_page_in = pStat->st_page_in;
+	result.st_page_out = pStat->st_page_out;
+	result.st_ro_evict = pStat->st_ro_evict;
+	result.st_rw_evict = pStat->st_rw_evict;
+	result.st_hash_wait = pStat->st_hash_wait;
+	result.st_region_wait = pStat->st_region_wait;
+	free(pStat);
+	return result;
+}
+
 void Environment::LogErrorViaBdb(int error, String^ message) {
 	CheckOpen();
 	std::string stdMessage(msclr::interop::marshal_as<std::string>(message));
@@ -74,6 +430,20 @@ void Environment::Close() {
 	List<Database^>^ databasesToDispose = gcnew List<Database^>(databases_);
 	for each(Database^ database in databasesToDispose)
 		database->~Database();
+	if (workerPool_ != nullptr) {
+		delete workerPool_;
+		workerPool_ = nullptr;
+	}
+	if (groupCommitter_ != nullptr)
+		groupCommitter_->~GroupCommitter();
+	if (warmList_ != nullptr) {
+		try {
+			warmList_->Save();
+		}
+		catch (System::IO::IOException^ exception) {
+			logger_->Error("can't save warm list, " + description_, exception);
+		}
+	}
 	CheckApiOk(dbEnv_->close(dbEnv_, 0), "env.close");
 	dbEnv_ = nullptr;
 }
@@ -89,6 +459,12 @@ Database::Database(Environment^ env, DatabaseConfig^ config)
 
 	keysState_ = gcnew BufferState("keys, " + description_, config->KeyBufferConfig, logger_);
 	valuesState_ = gcnew BufferState("values, " + description_, config->ValueBufferConfig, logger_);
+	if (config->FindCacheSizeInBytes > 0)
+		findCache_ = gcnew FindCache(config->FindCacheSizeInBytes);
+	asyncPending_ = gcnew CountdownEvent(1);
+	asyncStopped_ = new bool(false);
+	if (config->SlowOperationThresholdInMilliseconds > 0)
+		slowLog_ = gcnew SlowOperationLog(env->dbEnv_, config->SlowOperationThresholdInMilliseconds, logger_, description_);
 }
 
 void Database::LogErrorViaBdb(int error, String^ message) {
@@ -100,30 +476,309 @@ void Database::LogErrorViaBdb(int error, String^ message) {
 void Database::Open() {
 	if (config_->EnableRecno)
 		CheckApiOk(db_->set_flags(db_, DB_RECNUM), "db.set_flags");
+	if (config_->EnableSortedDuplicates) {
+		if (config_->EnableRecno)
+			throw gcnew BdbException("sorted duplicates can't be used with record numbers, " + description_);
+		CheckApiOk(db_->set_flags(db_, DB_DUPSORT), "db.set_flags");
+	}
+	if (config_->CountedPrefixLength < 0)
+		throw gcnew BdbException(String::Format("invalid counted prefix length [{0}], {1}", config_->CountedPrefixLength, description_));
+	if (config_->CountedPrefixLength > 0 && config_->EnableSortedDuplicates)
+		throw gcnew BdbException("prefix counts can't be used with sorted duplicates, " + description_);
+	if (config_->PageSize > 0)
+		CheckApiOk(db_->set_pagesize(db_, config_->PageSize), "db.set_pagesize");
+	if (config_->BtreeMinKey > 0)
+		CheckApiOk(db_->set_bt_minkey(db_, config_->BtreeMinKey), "db.set_bt_minkey");
+	if (config_->Compression != BtreeCompression::None) {
+		if (config_->EnableRecno)
+			throw gcnew BdbException("btree compression can't be used with record numbers, " + description_);
+		if (config_->Compression == BtreeCompression::PrefixDelta)
+			CheckApiOk(db_->set_bt_compress(db_, &NativePrefixDeltaCompress, &NativePrefixDeltaDecompress), "db.set_bt_compress");
+		else
+			CheckApiOk(db_->set_bt_compress(db_, nullptr, nullptr), "db.set_bt_compress");
+	}
 	CheckApiOk(db_->set_priority(db_, static_cast<DB_CACHE_PRIORITY>(config_->CachePriority)), "db.set_priority");
 	String^ localFileName = env_->fileName_;
 	String^ localDatabaseName_ = config_->Name;
 	std::string stdFileName(msclr::interop::marshal_as<std::string>(localFileName));
 	std::string stdDatabaseName(msclr::interop::marshal_as<std::string>(localDatabaseName_));
-	CheckApiOk(db_->open(db_, nullptr, stdFileName.c_str(), stdDatabaseName.c_str(), DB_BTREE, config_->IsReadonly ? DB_RDONLY : DB_CREATE, 0), "db.open");
+	if (config_->IsMemoryMapped && !config_->IsReadonly)
+		throw gcnew BdbException("memory mapped database must be readonly, " + description_);
+	u_int32_t flags = env_->DatabaseOpenFlags(config_->IsReadonly);
+	CheckApiOk(db_->open(db_, nullptr, stdFileName.c_str(), stdDatabaseName.c_str(), DB_BTREE, flags, 0), "db.open");
+	if (config_->IsMemoryMapped)
+		CheckMemoryMapped();
+	if (config_->SecondaryIndexes != nullptr && config_->SecondaryIndexes->Length > 0)
+		OpenSecondaryIndexes(stdFileName.c_str(), flags);
+	if (config_->KeyBufferConfig->IsAdaptive || config_->ValueBufferConfig->IsAdaptive) {
+		std::vector<unsigned int> keyLengths;
+		std::vector<unsigned int> valueLengths;
+		INVOKE_NATIVE_OPERATION(NativeSampleRecordSizes(db_, adaptiveSamplesCount, keyLengths, valueLengths));
+		keysState_->Seed(keyLengths);
+		valuesState_->Seed(valueLengths);
+	}
+	if (config_->MaxIdleCursors >= 0)
+		cursorPool_ = new NativeCursorPool(db_, config_->MaxIdleCursors > 0 ? config_->MaxIdleCursors : 128);
+	if (config_->BloomFilterBitsPerKey > 0)
+		INVOKE_NATIVE_OPERATION(bloomFilter_ = NativeBloomFilter::Build(db_, config_->BloomFilterBitsPerKey));
+	if (config_->CountedPrefixLength > 0)
+		OpenPrefixCounts(stdFileName.c_str(), flags);
+}
+
+//saved counts are removed once loaded, so they are never read after writes which didn't save them
+void Database::OpenPrefixCounts(const char* fileName, u_int32_t flags) {
+	std::string stdName(msclr::interop::marshal_as<std::string>(config_->Name + ".metadata"));
+	unsigned int prefixLength = config_->CountedPrefixLength;
+	INVOKE_NATIVE_OPERATION(
+		NativeMetadata metadata(env_->dbEnv_, fileName, stdName.c_str(), flags);
+		std::vector<Byte> saved;
+		if (metadata.TryGet("prefixCounts", saved))
+			prefixCounts_ = NativePrefixCounts::Load(saved, prefixLength);
+		if (prefixCounts_ != nullptr)
+			metadata.Remove("prefixCounts");
+		metadata.Close();
+		if (prefixCounts_ == nullptr)
+			prefixCounts_ = NativePrefixCounts::Build(db_, prefixLength));
+}
+
+//failed save only costs a key scan on the next attach, so it doesn't fail the close
+void Database::SavePrefixCounts() {
+	std::string stdFileName(msclr::interop::marshal_as<std::string>(env_->fileName_));
+	std::string stdName(msclr::interop::marshal_as<std::string>(config_->Name + ".metadata"));
+	try {
+		INVOKE_NATIVE_OPERATION(
+			std::vector<Byte> saved;
+			prefixCounts_->Save(saved);
+			NativeMetadata metadata(env_->dbEnv_, stdFileName.c_str(), stdName.c_str(), env_->DatabaseOpenFlags(false));
+			metadata.Put("prefixCounts", saved);
+			metadata.Close());
+	}
+	catch (BdbException^ exception) {
+		logger_->Error("can't save prefix counts, " + description_, exception);
+	}
+}
+
+void Database::OpenSecondaryIndexes(const char* fileName, u_int32_t flags) {
+	if (config_->EnableSortedDuplicates)
+		throw gcnew BdbException("secondary indexes can't be used with sorted duplicates, " + description_);
+	for each (SecondaryIndexConfig^ index in config_->SecondaryIndexes)
+		if (String::IsNullOrEmpty(index->Name) || index->Name == "metadata" || index->ValueOffset < 0 || index->ValueLength < 0)
+			throw gcnew BdbException(String::Format("invalid secondary index [{0}], value offset [{1}], value length [{2}], {3}",
+			index->Name, index->ValueOffset, index->ValueLength, description_));
+	CheckSecondaryIndexes(fileName, flags);
+	secondaryIndexes_ = new NativeSecondaryIndexes(db_);
+	for each (SecondaryIndexConfig^ index in config_->SecondaryIndexes) {
+		NativeSecondaryKey key;
+		key.valueOffset = index->ValueOffset;
+		key.valueLength = index->ValueLength;
+		key.appendPrimaryKey = index->AppendPrimaryKey;
+		std::string stdName(msclr::interop::marshal_as<std::string>(config_->Name + "." + index->Name));
+		INVOKE_NATIVE_OPERATION(secondaryIndexes_->Open(fileName, stdName.c_str(), key, flags, !config_->IsReadonly));
+	}
+}
+
+//existing secondary is not rebuilt on attach, so keys extracted by other spec would be looked up in it
+void Database::CheckSecondaryIndexes(const char* fileName, u_int32_t flags) {
+	std::string stdName(msclr::interop::marshal_as<std::string>(config_->Name + ".metadata"));
+	String^ mismatchedName = nullptr;
+	INVOKE_NATIVE_OPERATION(
+		NativeMetadata metadata(env_->dbEnv_, fileName, stdName.c_str(), flags);
+		for each (SecondaryIndexConfig^ index in config_->SecondaryIndexes) {
+			std::vector<Byte> spec;
+			unsigned int offset = index->ValueOffset;
+			unsigned int length = index->ValueLength;
+			Byte appendPrimaryKey = index->AppendPrimaryKey ? 1 : 0;
+			NativeAppendField(spec, reinterpret_cast<Byte*>(&offset), sizeof(offset));
+			NativeAppendField(spec, reinterpret_cast<Byte*>(&length), sizeof(length));
+			NativeAppendField(spec, &appendPrimaryKey, sizeof(appendPrimaryKey));
+			std::string stdKey(msclr::interop::marshal_as<std::string>("index." + index->Name));
+			if (mismatchedName == nullptr && !metadata.Match(stdKey.c_str(), spec))
+				mismatchedName = index->Name;
+		}
+		metadata.Close());
+	if (mismatchedName != nullptr)
+		throw gcnew BdbException(String::Format("secondary index [{0}] doesn't match its first attach, remove it or bulk load the database, {1}",
+		mismatchedName, description_));
+}
+
+DB* Database::GetSecondary(String^ indexName) {
+	if (config_->SecondaryIndexes != nullptr)
+		for (int i = 0; i < config_->SecondaryIndexes->Length; i++)
+			if (config_->SecondaryIndexes[i]->Name == indexName)
+				return secondaryIndexes_->Secondary(i);
+	throw gcnew BdbException(String::Format("secondary index [{0}] is not configured, {1}", indexName, description_));
+}
+
+//bdb silently falls back to the cache when file can't be mapped
+void Database::CheckMemoryMapped() {
+	size_t mmapSize;
+	CheckApiOk(env_->dbEnv_->get_mp_mmapsize(env_->dbEnv_, &mmapSize), "env.get_mp_mmapsize");
+	long long fileSize = (gcnew System::IO::FileInfo(env_->fileName_))->Length;
+	if (fileSize > static_cast<long long>(mmapSize))
+		throw gcnew BdbException(String::Format("file size [{0}] exceeds memory map size [{1}], {2}",
+		fileSize, static_cast<unsigned long long>(mmapSize), description_));
 }
 
 void Database::Add(BytesSegment key, BytesSegment value) {
+	TraceRecorder^ trace = trace_;
+	SlowOperationLog^ slowLog = slowLog_;
+	if (trace == nullptr && slowLog == nullptr) {
+		AddUntraced(key, value);
+		return;
+	}
+	long long started = trace != nullptr ? trace->Now() : 0;
+	SlowOperationLog::Start start = slowLog != nullptr ? slowLog->Begin() : SlowOperationLog::Start();
+	AddUntraced(key, value);
+	if (trace != nullptr)
+		trace->Add(started, key, value.Length);
+	if (slowLog != nullptr)
+		slowLog->Add(start, key, value.Length);
+}
+
+void Database::AddUntraced(BytesSegment key, BytesSegment value) {
 	CheckOpen();
 	DBT_FOR_BYTES_SEGMENT(key, key);
 	DBT_FOR_BYTES_SEGMENT(value, value);
 	keysState_->CheckLength(keyLen);
 	valuesState_->CheckLength(valueLen);
-	CheckApiOk(db_->put(db_, nullptr, &keyDbt, &valueDbt, 0), "db.put");
+	keysState_->Observe(keyLen);
+	valuesState_->Observe(valueLen);
+	//bits are set before the put, so concurrent Find never misses a written key
+	if (bloomFilter_ != nullptr)
+		bloomFilter_->Add(keyPtr, keyLen);
+	int resultCode;
+	if (prefixCounts_ == nullptr)
+		resultCode = db_->put(db_, nullptr, &keyDbt, &valueDbt, 0);
+	else
+		resultCode = PutCounted(&keyDbt, &valueDbt);
+	if (findCache_ != nullptr)
+		findCache_->Invalidate(key);
+	if (resultCode == DB_KEYEXIST && config_->EnableSortedDuplicates)
+		return;
+	CheckApiOk(resultCode, "db.put");
+}
+
+//only new keys are counted, cursor writes are not auto committed, so transactional env needs explicit txn
+int Database::PutCounted(DBT* key, DBT* value) {
+	DB_TXN* txn = nullptr;
+	if (env_->config_->EnableGroupCommit)
+		CheckApiOk(env_->dbEnv_->txn_begin(env_->dbEnv_, nullptr, &txn, 0), "env.txn_begin");
+	bool inserted;
+	int resultCode = NativePrefixCounts::Put(db_, txn, key, value, inserted);
+	if (txn != nullptr) {
+		if (resultCode != 0) {
+			txn->abort(txn);
+			return resultCode;
+		}
+		CheckApiOk(txn->commit(txn, 0), "txn.commit");
+	}
+	if (resultCode == 0 && inserted)
+		prefixCounts_->Add(static_cast<Byte*>(key->data), key->size);
+	return resultCode;
 }
 
 void Database::Remove(BytesSegment key) {
+	TraceRecorder^ trace = trace_;
+	if (trace == nullptr) {
+		RemoveUntraced(key);
+		return;
+	}
+	long long started = trace->Now();
+	RemoveUntraced(key);
+	trace->Remove(started, key);
+}
+
+void Database::RemoveUntraced(BytesSegment key) {
 	CheckOpen();
 	DBT_FOR_BYTES_SEGMENT(key, key);
 	int resultCode = db_->del(db_, nullptr, &keyDbt, 0);
+	if (findCache_ != nullptr)
+		findCache_->Invalidate(key);
 	if (resultCode == DB_NOTFOUND)
 		return;
 	CheckApiOk(resultCode, "db.del");
+	if (prefixCounts_ != nullptr)
+		prefixCounts_->Remove(keyPtr, keyLen);
+	if (bloomFilter_ != nullptr)
+		Interlocked::Increment(bloomRemovedKeys_);
+}
+
+FindCacheStatistics Database::GetFindCacheStatistics() {
+	CheckOpen();
+	if (findCache_ == nullptr)
+		throw gcnew BdbException("find cache is not enabled, " + description_);
+	return findCache_->GetStatistics();
+}
+
+BufferStatistics Database::GetKeyBufferStatistics() {
+	CheckOpen();
+	return keysState_->GetStatistics();
+}
+
+BufferStatistics Database::GetValueBufferStatistics() {
+	CheckOpen();
+	return valuesState_->GetStatistics();
+}
+
+BloomFilterStatistics Database::GetBloomFilterStatistics() {
+	CheckOpen();
+	if (bloomFilter_ == nullptr)
+		throw gcnew BdbException("bloom filter is not enabled, " + description_);
+	BloomFilterStatistics result;
+	result.KeysCount = static_cast<long long>(bloomFilter_->KeysCount());
+	result.Capacity = static_cast<long long>(bloomFilter_->Capacity());
+	result.LayersCount = bloomFilter_->LayersCount();
+	result.MemoryInBytes = static_cast<long long>(bloomFilter_->MemoryInBytes());
+	result.RemovedKeysCount = Interlocked::Read(bloomRemovedKeys_);
+	result.Checks = Interlocked::Read(bloomChecks_);
+	result.Negatives = Interlocked::Read(bloomNegatives_);
+	result.FalsePositives = Interlocked::Read(bloomFalsePositives_);
+	result.EstimatedFalsePositiveRate = bloomFilter_->EstimatedFalsePositiveRate();
+	//only absent keys can be false positives
+	long long absentCount = result.Negatives + result.FalsePositives;
+	result.ObservedFalsePositiveRate = absentCount == 0 ? 0 : static_cast<double>(result.FalsePositives) / absentCount;
+	return result;
+}
+
+void Database::RebuildBloomFilter() {
+	CheckOpen();
+	if (bloomFilter_ == nullptr)
+		throw gcnew BdbException("bloom filter is not enabled, " + description_);
+	NativeBloomFilter* rebuilt = nullptr;
+	INVOKE_NATIVE_OPERATION(rebuilt = NativeBloomFilter::Build(db_, config_->BloomFilterBitsPerKey));
+	delete bloomFilter_;
+	bloomFilter_ = rebuilt;
+	bloomRemovedKeys_ = 0;
+}
+
+void Database::StartTrace(String^ fileName, bool withKeys) {
+	CheckOpen();
+	if (trace_ != nullptr)
+		throw gcnew BdbException("trace is already started, " + description_);
+	TraceRecorder^ trace = gcnew TraceRecorder(fileName, withKeys);
+	if (Interlocked::CompareExchange<TraceRecorder^>(trace_, trace, nullptr) != nullptr) {
+		trace->Close();
+		throw gcnew BdbException("trace is already started, " + description_);
+	}
+}
+
+long long Database::StopTrace() {
+	TraceRecorder^ trace = Interlocked::Exchange<TraceRecorder^>(trace_, nullptr);
+	if (trace == nullptr)
+		return 0;
+	trace->Close();
+	return trace->RecordsCount();
+}
+
+bool Database::BloomFilterMayContain(BytesSegment key) {
+	if (bloomFilter_ == nullptr)
+		return true;
+	Interlocked::Increment(bloomChecks_);
+	DBT_FOR_BYTES_SEGMENT(key, key);
+	if (bloomFilter_->MayContain(keyPtr, keyLen))
+		return true;
+	Interlocked::Increment(bloomNegatives_);
+	return false;
 }
 
 DatabaseStatistics Database::GetStatistics(bool fast) {
@@ -143,30 +798,414 @@ void Database::CheckRecordNumbersEnabled() {
 		throw gcnew BdbException("Bdb was not configured to support record numbers, " + description_);
 }
 
+void Database::CheckSortedDuplicatesEnabled() {
+	if (!config_->EnableSortedDuplicates)
+		throw gcnew BdbException("Bdb was not configured to support sorted duplicates, " + description_);
+}
+
+void Database::RemoveDuplicate(BytesSegment key, BytesSegment value) {
+	CheckOpen();
+	CheckSortedDuplicatesEnabled();
+	DBT_FOR_BYTES_SEGMENT(key, key);
+	DBT_FOR_BYTES_SEGMENT(value, value);
+	//cursor writes are not auto committed, so transactional env needs explicit txn
+	DB_TXN* txn = nullptr;
+	if (env_->config_->EnableGroupCommit)
+		CheckApiOk(env_->dbEnv_->txn_begin(env_->dbEnv_, nullptr, &txn, 0), "env.txn_begin");
+	bool committed = false;
+	try {
+		DBC* dbc;
+		CheckApiOk(db_->cursor(db_, txn, &dbc, 0), "db.cursor");
+		try {
+			int resultCode = dbc->get(dbc, &keyDbt, &valueDbt, DB_GET_BOTH);
+			if (resultCode != DB_NOTFOUND) {
+				CheckApiOk(resultCode, "cursor.get.DB_GET_BOTH");
+				CheckApiOk(dbc->del(dbc, 0), "cursor.del");
+			}
+		}
+		finally {
+			CheckApiOk(dbc->close(dbc), "cursor.close");
+		}
+		if (txn != nullptr)
+			CheckApiOk(txn->commit(txn, 0), "txn.commit");
+		committed = true;
+	}
+	finally {
+		if (txn != nullptr && !committed)
+			txn->abort(txn);
+		if (findCache_ != nullptr)
+			findCache_->Invalidate(key);
+	}
+}
+
+unsigned int Database::GetDuplicatesCount(BytesSegment key) {
+	CheckOpen();
+	CheckSortedDuplicatesEnabled();
+	DBT_FOR_BYTES_SEGMENT(key, key);
+	//DB_THREAD environment requires memory flag on returned DBT, even an empty one
+	Byte ignored;
+	DBT valueDbt;
+	memset(&valueDbt, 0, sizeof(DBT));
+	valueDbt.data = &ignored;
+	valueDbt.flags = DB_DBT_PARTIAL | DB_DBT_USERMEM;
+	DBC* dbc;
+	CheckApiOk(db_->cursor(db_, nullptr, &dbc, 0), "db.cursor");
+	try {
+		int resultCode = dbc->get(dbc, &keyDbt, &valueDbt, DB_SET);
+		if (resultCode == DB_NOTFOUND)
+			return 0;
+		CheckApiOk(resultCode, "cursor.get.DB_SET");
+		db_recno_t result;
+		CheckApiOk(dbc->count(dbc, &result, 0), "cursor.count");
+		return result;
+	}
+	finally {
+		CheckApiOk(dbc->close(dbc), "cursor.close");
+	}
+}
+
+ICursor^ Database::QueryDuplicates(BytesSegment key, int take, bool bulk) {
+	CheckOpen();
+	CheckSortedDuplicatesEnabled();
+	return gcnew DuplicatesCursor(this, key, take, bulk ? duplicatesBulkBufferSize : 0);
+}
+
+ICursor^ Database::QueryIndex(String^ indexName, Range^ range, Direction direction, int take) {
+	CheckOpen();
+	return gcnew SecondaryCursor(this, GetSecondary(indexName), range, direction == Direction::Ascending ? 1 : -1, take);
+}
+
+BytesTable^ Database::FetchIndex(String^ indexName, Range^ range, Direction direction, int take, FetchOptions options) {
+	CheckOpen();
+	if (take < 0 || take == System::Int32::MaxValue)
+		throw gcnew BdbException(String::Format("secondary index fetch requires bounded take, index [{0}], {1}", indexName, description_));
+	SecondaryCursor cursor(this, GetSecondary(indexName), range, direction == Direction::Ascending ? 1 : -1, take);
+	return cursor.Fetch(options);
+}
+
+BytesTable^ Database::FetchDuplicates(array<BytesSegment>^ keys, Direction direction, int take, FetchOptions options) {
+	CheckOpen();
+	CheckSortedDuplicatesEnabled();
+	if (take < 0 || take == System::Int32::MaxValue) {
+		take = 0;
+		for each (BytesSegment key in keys)
+			take += GetDuplicatesCount(key);
+	}
+	SuffixMergingFetcher fether(this, keys, direction == Direction::Ascending ? 1 : -1, options);
+	return fether.Fetch(options, take);
+}
+
+Task<BytesBuffer^>^ Database::FindAsync(BytesSegment key, CancellationToken cancellationToken) {
+	CheckOpen();
+	if (env_->warmList_ != nullptr)
+		env_->warmList_->Touch(config_->Name, key);
+	BytesBuffer^ cached;
+	long long cacheVersion = 0;
+	if (findCache_ != nullptr && findCache_->TryGet(key, cached, cacheVersion))
+		return Task::FromResult<BytesBuffer^>(cached);
+	if (!BloomFilterMayContain(key))
+		return Task::FromResult<BytesBuffer^>(nullptr);
+	return (gcnew AsyncFind(this, key, cacheVersion))->Start(config_->AsyncPriority, cancellationToken);
+}
+
+Task<BytesTable^>^ Database::ReadAsync(Range^ range, Direction direction, int skip, int take, FetchOptions options, CancellationToken cancellationToken) {
+	CheckOpen();
+	if (skip > 0 || take < 0 || take == System::Int32::MaxValue)
+		CheckRecordNumbersEnabled();
+	return AsyncFetchers::Read(this, range, direction == Direction::Ascending ? 1 : -1, skip, take, options)
+		->Start(config_->AsyncPriority, cancellationToken);
+}
+
+Task<BytesTable^>^ Database::FetchAsync(array<Range^>^ ranges, Direction direction, int take, unsigned int keySuffixOffset, FetchOptions options, CancellationToken cancellationToken) {
+	CheckOpen();
+	if (take < 0 || take == System::Int32::MaxValue)
+		CheckRecordNumbersEnabled();
+	return AsyncFetchers::Merge(this, ranges, direction == Direction::Ascending ? 1 : -1, take, keySuffixOffset, options)
+		->Start(config_->AsyncPriority, cancellationToken);
+}
+
+Task<BytesTable^>^ Database::FetchAsync(array<Range^>^ ranges, Direction direction, int take, KeySchema^ keySchema, int keySuffixField, FetchOptions options, CancellationToken cancellationToken) {
+	CheckOpen();
+	if (keySuffixField < 0 || keySuffixField > keySchema->Fields->Length)
+		throw gcnew BdbException(String::Format("invalid key suffix field [{0}], key fields count [{1}], {2}",
+		keySuffixField, keySchema->Fields->Length, description_));
+	int keySuffixOffset = keySchema->GetFixedOffset(keySuffixField);
+	if (keySuffixOffset >= 0)
+		return FetchAsync(ranges, direction, take, keySuffixOffset, options, cancellationToken);
+	if (take < 0 || take == System::Int32::MaxValue)
+		CheckRecordNumbersEnabled();
+	return AsyncFetchers::Merge(this, ranges, direction == Direction::Ascending ? 1 : -1, take, keySchema, keySuffixField, options)
+		->Start(config_->AsyncPriority, cancellationToken);
+}
+
+//cancels queued and running async calls and waits for them, so native handles are not used after close
+void Database::StopAsync() {
+	if (asyncStopped_ == nullptr)
+		return;
+	*asyncStopped_ = true;
+	asyncPending_->Signal();
+	asyncPending_->Wait();
+	delete asyncStopped_;
+	asyncStopped_ = nullptr;
+}
+
 ICursor^ Database::Query(Range^ range, Direction direction, int skip, int take) {
 	CheckOpen();
+	if (env_->warmList_ != nullptr && range->Left != nullptr)
+		env_->warmList_->Touch(config_->Name, BytesSegment(range->Left->Value));
 	if (skip > 0)
 		CheckRecordNumbersEnabled();
-	return gcnew SimpleCursor(this, range, direction == Direction::Ascending ? 1 : -1, skip, take);
+	SimpleCursor^ result = gcnew SimpleCursor(this, range, direction == Direction::Ascending ? 1 : -1, skip, take);
+	result->Trace(trace_);
+	return result;
+}
+
+static std::vector<Byte> NativeBytes(SimpleBdb::Utils::Boundary^ boundary) {
+	std::vector<Byte> result;
+	if (boundary != nullptr && boundary->Value->Length > 0) {
+		pin_ptr<Byte> pinned = &boundary->Value[0];
+		Byte* bytes = pinned;
+		result.assign(bytes, bytes + boundary->Value->Length);
+	}
+	return result;
+}
+
+static unsigned int PartitionStart(unsigned int totalCount, int index, int partitionsCount) {
+	return static_cast<unsigned int>(static_cast<unsigned long long>(totalCount) * index / partitionsCount);
+}
+
+array<ICursor^>^ Database::QueryPartitions(Range^ range, int partitionsCount) {
+	CheckOpen();
+	if (partitionsCount <= 0)
+		throw gcnew BdbException(String::Format("invalid partitions count [{0}], {1}", partitionsCount, description_));
+	if (config_->EnableRecno) {
+		unsigned int totalCount;
+		SimpleCursor^ counter = gcnew SimpleCursor(this, range, 1, 0, -1);
+		try {
+			totalCount = counter->GetTotalCount();
+		}
+		finally {
+			delete counter;
+		}
+		array<ICursor^>^ result = gcnew array<ICursor^>(partitionsCount);
+		for (int i = 0; i < partitionsCount; i++) {
+			unsigned int skip = PartitionStart(totalCount, i, partitionsCount);
+			result[i] = gcnew SimpleCursor(this, range, 1, skip, PartitionStart(totalCount, i + 1, partitionsCount) - skip);
+		}
+		return result;
+	}
+	std::vector<std::vector<Byte>> splits;
+	INVOKE_NATIVE_OPERATION(splits = NativeSplitRange(db_, NativeBytes(range->Left), NativeBytes(range->Right), partitionsCount));
+	array<ICursor^>^ result = gcnew array<ICursor^>(static_cast<int>(splits.size()) + 1);
+	for (int i = 0; i < result->Length; i++) {
+		SimpleCursor^ cursor = gcnew SimpleCursor(this, range, 1, 0, -1);
+		cursor->LimitTo(i == 0 ? std::vector<Byte>() : splits[i - 1], i == result->Length - 1 ? std::vector<Byte>() : splits[i]);
+		result[i] = cursor;
+	}
+	return result;
 }
 
 BytesTable^ Database::Fetch([NotNull] array<Range^>^ ranges, Direction direction, int take, unsigned int keySuffixOffset, FetchOptions options) {
+	return Fetch(ranges, direction, take, keySuffixOffset, options, gcnew BytesTable());
+}
+
+BytesTable^ Database::Fetch([NotNull] array<Range^>^ ranges, Direction direction, int take, KeySchema^ keySchema, int keySuffixField, FetchOptions options) {
+	return Fetch(ranges, direction, take, keySchema, keySuffixField, options, gcnew BytesTable());
+}
+
+BytesTable^ Database::Fetch([NotNull] array<Range^>^ ranges, Direction direction, int take, unsigned int keySuffixOffset, FetchOptions options, BytesTable^ target) {
 	CheckOpen();
+	TraceRecorder^ trace = trace_;
+	long long started = trace != nullptr ? trace->Now() : 0;
 	SuffixMergingFetcher fether(this, ranges, direction == Direction::Ascending ? 1 : -1, keySuffixOffset, options);
-	return fether.Fetch(options, take);
+	BytesTable^ result = DoFetch(fether, ranges, direction, 0, take, keySuffixOffset, -1, options, target);
+	if (trace != nullptr)
+		trace->Fetch(started, ranges, direction == Direction::Ascending ? 1 : -1, take, keySuffixOffset, nullptr, 0, static_cast<int>(options), result->RowsCount);
+	return result;
+}
+
+BytesTable^ Database::Fetch([NotNull] array<Range^>^ ranges, Direction direction, int take, KeySchema^ keySchema, int keySuffixField, FetchOptions options, BytesTable^ target) {
+	CheckOpen();
+	if (keySuffixField < 0 || keySuffixField > keySchema->Fields->Length)
+		throw gcnew BdbException(String::Format("invalid key suffix field [{0}], key fields count [{1}], {2}",
+		keySuffixField, keySchema->Fields->Length, description_));
+	int keySuffixOffset = keySchema->GetFixedOffset(keySuffixField);
+	if (keySuffixOffset >= 0)
+		return Fetch(ranges, direction, take, keySuffixOffset, options, target);
+	TraceRecorder^ trace = trace_;
+	long long started = trace != nullptr ? trace->Now() : 0;
+	SuffixMergingFetcher fether(this, ranges, direction == Direction::Ascending ? 1 : -1, keySchema, keySuffixField, options);
+	BytesTable^ result = DoFetch(fether, ranges, direction, 0, take, 0, keySuffixField, options, target);
+	if (trace != nullptr)
+		trace->Fetch(started, ranges, direction == Direction::Ascending ? 1 : -1, take, 0, keySchema, keySuffixField, static_cast<int>(options), result->RowsCount);
+	return result;
+}
+
+BytesTable^ Database::Fetch([NotNull] array<Range^>^ ranges, Direction direction, int skip, int take, unsigned int keySuffixOffset, FetchOptions options) {
+	CheckOpen();
+	SuffixMergingFetcher fether(this, ranges, direction == Direction::Ascending ? 1 : -1, keySuffixOffset, options);
+	if (skip > 0)
+		fether.Skip(skip);
+	return DoFetch(fether, ranges, direction, skip, take, keySuffixOffset, -1, options, gcnew BytesTable());
+}
+
+BytesTable^ Database::Fetch([NotNull] array<Range^>^ ranges, Direction direction, int skip, int take, KeySchema^ keySchema, int keySuffixField, FetchOptions options) {
+	CheckOpen();
+	if (keySuffixField < 0 || keySuffixField > keySchema->Fields->Length)
+		throw gcnew BdbException(String::Format("invalid key suffix field [{0}], key fields count [{1}], {2}",
+		keySuffixField, keySchema->Fields->Length, description_));
+	int keySuffixOffset = keySchema->GetFixedOffset(keySuffixField);
+	if (keySuffixOffset >= 0)
+		return Fetch(ranges, direction, skip, take, keySuffixOffset, options);
+	SuffixMergingFetcher fether(this, ranges, direction == Direction::Ascending ? 1 : -1, keySchema, keySuffixField, options);
+	if (skip > 0)
+		fether.Skip(skip);
+	return DoFetch(fether, ranges, direction, skip, take, 0, keySuffixField, options, gcnew BytesTable());
+}
+
+BytesTable^ Database::DoFetch(SuffixMergingFetcher% fetcher, array<Range^>^ ranges, Direction direction,
+	int skip, int take, unsigned int keySuffixOffset, int keySuffixField, FetchOptions options, BytesTable^ target) {
+	SlowOperationLog^ slowLog = slowLog_;
+	if (slowLog == nullptr)
+		return fetcher.Fetch(options, take, target);
+	SlowOperationLog::Start start = slowLog->Begin();
+	BytesTable^ result = fetcher.Fetch(options, take, target);
+	slowLog->Fetch(start, ranges, direction == Direction::Ascending ? 1 : -1, skip, take, keySuffixOffset, keySuffixField, result->RowsCount, fetcher.Counters());
+	return result;
+}
+
+void Database::AddPosting(BytesSegment term, unsigned int id) {
+	CheckOpen();
+	DBT_FOR_BYTES_SEGMENT(term, term);
+	keysState_->CheckLength(termLen);
+	//block delete and puts of a split are committed together
+	DB_TXN* txn = nullptr;
+	if (env_->config_->EnableGroupCommit)
+		CheckApiOk(env_->dbEnv_->txn_begin(env_->dbEnv_, nullptr, &txn, 0), "env.txn_begin");
+	bool committed = false;
+	try {
+		INVOKE_NATIVE_OPERATION({
+			NativePostingsWriter writer(db_, txn, termPtr, termLen, PostingListMaxBlockIds());
+			writer.Add(id);
+		});
+		if (txn != nullptr)
+			CheckApiOk(txn->commit(txn, 0), "txn.commit");
+		committed = true;
+	}
+	finally {
+		if (txn != nullptr && !committed)
+			txn->abort(txn);
+		//block keys are not known here
+		if (findCache_ != nullptr)
+			findCache_->Clear();
+	}
+}
+
+void Database::RemovePosting(BytesSegment term, unsigned int id) {
+	CheckOpen();
+	DBT_FOR_BYTES_SEGMENT(term, term);
+	DB_TXN* txn = nullptr;
+	if (env_->config_->EnableGroupCommit)
+		CheckApiOk(env_->dbEnv_->txn_begin(env_->dbEnv_, nullptr, &txn, 0), "env.txn_begin");
+	bool committed = false;
+	try {
+		INVOKE_NATIVE_OPERATION({
+			NativePostingsWriter writer(db_, txn, termPtr, termLen, PostingListMaxBlockIds());
+			writer.Remove(id);
+		});
+		if (txn != nullptr)
+			CheckApiOk(txn->commit(txn, 0), "txn.commit");
+		committed = true;
+	}
+	finally {
+		if (txn != nullptr && !committed)
+			txn->abort(txn);
+		if (findCache_ != nullptr)
+			findCache_->Clear();
+	}
+}
+
+array<unsigned int>^ Database::FetchPostings(array<BytesSegment>^ terms, PostingsOperation operation, int take) {
+	CheckOpen();
+	List<unsigned int>^ result = gcnew List<unsigned int>();
+	NativePostingsReader* reader = operation == PostingsOperation::Union
+		? static_cast<NativePostingsReader*>(new NativePostingsUnionReader())
+		: static_cast<NativePostingsReader*>(new NativePostingsIntersectionReader());
+	try {
+		INVOKE_NATIVE_OPERATION({
+			for (int i = 0; i < terms->Length; i++) {
+				DBT_FOR_BYTES_SEGMENT(term, terms[i]);
+				reader->AddTerm(db_, termPtr, termLen);
+			}
+			unsigned int chunk[postingsChunkSize];
+			unsigned int count;
+			do {
+				unsigned int chunkSize = take <= 0 ? postingsChunkSize : min(postingsChunkSize, (unsigned int)(take - result->Count));
+				count = reader->FetchInto(chunk, chunkSize);
+				for (unsigned int i = 0; i < count; i++)
+					result->Add(chunk[i]);
+			} while (count > 0 && (take <= 0 || result->Count < take));
+		});
+	}
+	finally {
+		delete reader;
+	}
+	return result->ToArray();
+}
+
+unsigned int Database::PostingListMaxBlockIds() {
+	return config_->PostingListMaxBlockIds > 0 ? config_->PostingListMaxBlockIds : 128;
 }
 
 BytesBuffer^ Database::Find(BytesSegment key) {
+	TraceRecorder^ trace = trace_;
+	SlowOperationLog^ slowLog = slowLog_;
+	ReadCounters counters;
+	if (trace == nullptr && slowLog == nullptr)
+		return FindUntraced(key, counters);
+	long long started = trace != nullptr ? trace->Now() : 0;
+	SlowOperationLog::Start start = slowLog != nullptr ? slowLog->Begin() : SlowOperationLog::Start();
+	BytesBuffer^ result = FindUntraced(key, counters);
+	if (trace != nullptr)
+		trace->Find(started, key, result != nullptr);
+	if (slowLog != nullptr)
+		slowLog->Find(start, key, result != nullptr, counters);
+	return result;
+}
+
+//find cache and bloom filter answers leave counters empty
+BytesBuffer^ Database::FindUntraced(BytesSegment key, ReadCounters% counters) {
 	CheckOpen();
+	if (env_->warmList_ != nullptr)
+		env_->warmList_->Touch(config_->Name, key);
+	BytesBuffer^ cached;
+	long long cacheVersion;
+	if (findCache_ != nullptr && findCache_->TryGet(key, cached, cacheVersion))
+		return cached;
+	if (!BloomFilterMayContain(key))
+		return nullptr;
 	BufferAllocator^ valueAccessor = gcnew BufferAllocator(valuesState_, 1);
 	int resultCode = DoFind(key, valueAccessor);
+	counters.Seeks++;
 	if (resultCode == DB_BUFFER_SMALL) {
 		valueAccessor->EnsureChunkCapacity(valueAccessor->buffer_->Length);
 		resultCode = DoFind(key, valueAccessor);
+		counters.Seeks++;
+		counters.BufferSmallRetries++;
 	}
-	if (resultCode == DB_NOTFOUND)
+	if (resultCode == 0)
+		counters.BytesCopied = valueAccessor->buffer_->Length;
+	if (resultCode == DB_NOTFOUND) {
+		if (bloomFilter_ != nullptr)
+			Interlocked::Increment(bloomFalsePositives_);
 		return nullptr;
+	}
 	CheckApiOk(resultCode, "db.get");
+	keysState_->Observe(key.Length);
+	valuesState_->Observe(valueAccessor->buffer_->Length);
+	//buffer is allocated per call, so it is cached as is
+	if (findCache_ != nullptr)
+		findCache_->Put(key, valueAccessor->buffer_, cacheVersion);
 	return valueAccessor->buffer_;
 }
 
@@ -178,11 +1217,222 @@ int Database::DoFind(BytesSegment key, BufferAllocator^ valueAccessor) {
 	return resultCode;
 }
 
+void Database::StartWarmUp(List<array<Byte>^>^ keys) {
+	if (keys->Count == 0)
+		return;
+	warmUpKeys_ = keys;
+	warmUpTask_ = System::Threading::Tasks::Task::Factory->StartNew(gcnew System::Action(this, &Database::WarmUp),
+		System::Threading::Tasks::TaskCreationOptions::LongRunning);
+}
+
+//reads keys with empty partial value, so only the btree path down to the leaf page gets into the cache,
+//DB_THREAD environment requires memory flag on every returned DBT, even an empty one
+void Database::WarmUp() {
+	Byte ignored;
+	DBT valueDbt;
+	memset(&valueDbt, 0, sizeof(DBT));
+	valueDbt.data = &ignored;
+	valueDbt.flags = DB_DBT_PARTIAL | DB_DBT_USERMEM;
+	for each (array<Byte>^ key in warmUpKeys_) {
+		//client may hold write lock while closing the database, which waits for warm up
+		while (!env_->locker_->TryEnterReadLock(warmUpLockTimeoutInMilliseconds))
+			if (warmUpStopped_)
+				return;
+		try {
+			if (warmUpStopped_)
+				return;
+			BytesSegment keySegment(key);
+			DBT_FOR_BYTES_SEGMENT(key, keySegment);
+			int resultCode = db_->get(db_, nullptr, &keyDbt, &valueDbt, 0);
+			if (resultCode != DB_NOTFOUND)
+				CheckApiOk(resultCode, "db.get");
+		}
+		finally {
+			env_->locker_->ExitReadLock();
+		}
+	}
+}
+
+void Database::StopWarmUp() {
+	if (warmUpTask_ == nullptr)
+		return;
+	warmUpStopped_ = true;
+	try {
+		warmUpTask_->Wait();
+	}
+	catch (System::AggregateException^ exception) {
+		logger_->Warn("warm up failed, " + description_ + ", " + exception->InnerException->Message);
+	}
+	warmUpTask_ = nullptr;
+}
+
 void Database::Close() {
 	if (TestingEnvironment::ThrowOnDatabaseClose != nullptr && TestingEnvironment::ThrowOnDatabaseClose->Count > 0)
 		throw gcnew BdbException(TestingEnvironment::ThrowOnDatabaseClose->Dequeue());
+	StopWarmUp();
+	StopAsync();
+	StopTrace();
 	env_->CheckOpen();
 	env_->UntrackDatabase(this);
+	if (prefixCounts_ != nullptr && !config_->IsReadonly)
+		SavePrefixCounts();
+	//pooled handles must be closed before the database, their close failure doesn't leave the database open
+	int cursorsResultCode = 0;
+	if (cursorPool_ != nullptr) {
+		cursorsResultCode = cursorPool_->Clear();
+		delete cursorPool_;
+		cursorPool_ = nullptr;
+	}
+	//secondaries are closed before the primary they are associated with
+	int secondariesResultCode = 0;
+	if (secondaryIndexes_ != nullptr) {
+		secondariesResultCode = secondaryIndexes_->Close(env_->config_->IsPersistent ? 0 : DB_NOSYNC);
+		delete secondaryIndexes_;
+		secondaryIndexes_ = nullptr;
+	}
 	CheckApiOk(db_->close(db_, env_->config_->IsPersistent ? 0 : DB_NOSYNC), "db.close");
 	db_ = nullptr;
+	if (bloomFilter_ != nullptr) {
+		delete bloomFilter_;
+		bloomFilter_ = nullptr;
+	}
+	if (prefixCounts_ != nullptr) {
+		delete prefixCounts_;
+		prefixCounts_ = nullptr;
+	}
+	CheckApiOk(cursorsResultCode, "cursor.close");
+	CheckApiOk(secondariesResultCode, "db.close");
+}
+PartitionedDatabase::PartitionedDatabase(Environment^ env, String^ name, array<array<Byte>^>^ boundaries, array<Database^>^ partitions)
+	:env_(env), boundaries_(boundaries), partitions_(partitions),
+	BdbComponent(env->logger_, String::Format("partitioned database (file name [{0}], database name [{1}])", env->fileName_, name)) {
+}
+
+void PartitionedDatabase::CheckOpen() {
+	BdbComponent::CheckOpen();
+	env_->CheckOpen();
+}
+
+static int CompareBytes(BytesSegment key, array<Byte>^ boundary) {
+	int length = key.Length < boundary->Length ? key.Length : boundary->Length;
+	if (length > 0) {
+		pin_ptr<Byte> keyPtr = &key.DangerousGetBytes()[key.Offset];
+		pin_ptr<Byte> boundaryPtr = &boundary[0];
+		int result = memcmp(keyPtr, boundaryPtr, length);
+		if (result != 0)
+			return result;
+	}
+	return key.Length - boundary->Length;
+}
+
+static bool StartsWith(array<Byte>^ bytes, array<Byte>^ prefix) {
+	if (bytes->Length < prefix->Length)
+		return false;
+	for (int i = 0; i < prefix->Length; i++)
+		if (bytes[i] != prefix[i])
+			return false;
+	return true;
+}
+
+int PartitionedDatabase::GetPartitionIndex(BytesSegment key) {
+	CheckOpen();
+	int left = 0;
+	int right = boundaries_->Length;
+	while (left < right) {
+		int middle = (left + right) / 2;
+		if (CompareBytes(key, boundaries_[middle]) >= 0)
+			left = middle + 1;
+		else
+			right = middle;
+	}
+	return left;
+}
+
+Database^ PartitionedDatabase::GetPartition(int index) {
+	CheckOpen();
+	if (index < 0 || index >= partitions_->Length)
+		throw gcnew BdbException(String::Format("invalid partition index [{0}], partitions count [{1}], {2}", index, partitions_->Length, description_));
+	return partitions_[index];
+}
+
+void PartitionedDatabase::Add(BytesSegment key, BytesSegment value) {
+	partitions_[GetPartitionIndex(key)]->Add(key, value);
+}
+
+void PartitionedDatabase::Remove(BytesSegment key) {
+	partitions_[GetPartitionIndex(key)]->Remove(key);
+}
+
+BytesBuffer^ PartitionedDatabase::Find(BytesSegment key) {
+	return partitions_[GetPartitionIndex(key)]->Find(key);
+}
+
+//partitions entirely below left boundary or above right one are skipped, keys with right boundary prefix are within the range
+array<Database^>^ PartitionedDatabase::PartitionsFor(Range^ range) {
+	List<Database^>^ result = gcnew List<Database^>();
+	for (int i = 0; i < partitions_->Length; i++) {
+		if (i < boundaries_->Length && range->Left != nullptr && ByteHelpers::Compare(boundaries_[i], range->Left->Value) <= 0)
+			continue;
+		if (i > 0 && range->Right != nullptr && ByteHelpers::Compare(boundaries_[i - 1], range->Right->Value) > 0
+			&& !StartsWith(boundaries_[i - 1], range->Right->Value))
+			continue;
+		result->Add(partitions_[i]);
+	}
+	return result->ToArray();
+}
+
+//skip is applied by record numbers, whole partitions are dropped by their counts
+ICursor^ PartitionedDatabase::Query(Range^ range, Direction direction, int skip, int take) {
+	CheckOpen();
+	array<Database^>^ partitions = PartitionsFor(range);
+	if (direction == Direction::Descending)
+		System::Array::Reverse(partitions);
+	List<ICursor^>^ cursors = gcnew List<ICursor^>();
+	unsigned int skippedCount = 0;
+	try {
+		for each (Database^ partition in partitions) {
+			cursors->Add(partition->Query(range, direction, 0, take));
+			if (skip == 0)
+				continue;
+			unsigned int count = cursors[cursors->Count - 1]->GetTotalCount();
+			delete cursors[cursors->Count - 1];
+			cursors->RemoveAt(cursors->Count - 1);
+			if (static_cast<unsigned int>(skip) >= count) {
+				skip -= count;
+				skippedCount += count;
+				continue;
+			}
+			cursors->Add(partition->Query(range, direction, skip, take));
+			skip = 0;
+		}
+	}
+	catch (...) {
+		for each (ICursor^ cursor in cursors)
+			delete cursor;
+		throw;
+	}
+	return gcnew PartitionsCursor(cursors->ToArray(), take, skippedCount);
+}
+
+BytesTable^ PartitionedDatabase::Fetch(array<Range^>^ ranges, Direction direction, int take, unsigned int keySuffixOffset, FetchOptions options) {
+	CheckOpen();
+	SuffixMergingFetcher fetcher(partitions_, ranges, direction == Direction::Ascending ? 1 : -1, keySuffixOffset, options);
+	return fetcher.Fetch(options, take);
+}
+
+BytesTable^ PartitionedDatabase::Fetch(array<Range^>^ ranges, Direction direction, int take, KeySchema^ keySchema, int keySuffixField, FetchOptions options) {
+	CheckOpen();
+	if (keySuffixField < 0 || keySuffixField > keySchema->Fields->Length)
+		throw gcnew BdbException(String::Format("invalid key suffix field [{0}], key fields count [{1}], {2}",
+		keySuffixField, keySchema->Fields->Length, description_));
+	int keySuffixOffset = keySchema->GetFixedOffset(keySuffixField);
+	if (keySuffixOffset >= 0)
+		return Fetch(ranges, direction, take, keySuffixOffset, options);
+	SuffixMergingFetcher fetcher(partitions_, ranges, direction == Direction::Ascending ? 1 : -1, keySchema, keySuffixField, options);
+	return fetcher.Fetch(options, take);
+}
+
+void PartitionedDatabase::Close() {
+	for each (Database^ partition in partitions_)
+		partition->~Database();
 }
\ No newline at end of file
@@ -2,17 +2,61 @@
 
 #include "Shared.h"
 
+class NativeWorkerPool;
+class NativeBloomFilter;
+class NativeCursorPool;
+class NativeSecondaryIndexes;
+class NativePrefixCounts;
+
 namespace SimpleBdb {
 	namespace Driver {
 		namespace Implementation {
 			ref class BufferState;
 			ref class BufferAllocator;
+			ref class WarmList;
+			ref class GroupCommitter;
+			ref class FindCache;
+			ref class TraceRecorder;
+			ref class SlowOperationLog;
+			value struct ReadCounters;
+			ref class SuffixMergingFetcher;
 		}
 
 		public ref struct EnvironmentConfig {
 			System::String^ FileName;
 			long long CacheSizeInBytes;
 			bool IsPersistent;
+			//environment regions are kept in files near FileName instead of process heap,
+			//so restarted process reattaches to the warm cache
+			bool IsShared;
+			//0 means file backed regions, otherwise shared regions are placed in system shared memory with this base key
+			long long SharedMemoryKey;
+			//file with sampled hot keys, saved on close and preloaded on background threads on attach, null means disabled
+			System::String^ WarmListFileName;
+			//0 means 10000
+			int WarmListCapacity;
+			//cache is split into this many regions, 0 means 1
+			int CacheRegionsCount;
+			//0 means bdb default for all mpool and mutex settings below
+			int CacheHashBucketsCount;
+			int CacheHashMutexesCount;
+			//readonly database files smaller than this are mapped into memory instead of being read through the cache
+			long long MemoryMapSizeInBytes;
+			int MaxOpenFiles;
+			//cache flush yields for MaxWriteSleepInMicroseconds after each MaxWritesCount writes
+			int MaxWritesCount;
+			int MaxWriteSleepInMicroseconds;
+			//test-and-set spins before mutex blocks
+			int MutexSpinsCount;
+			//writes are logged and auto committed without sync, log is flushed by background thread,
+			//requires IsPersistent and not IsShared, as every open runs recovery, log files are kept near FileName
+			bool EnableGroupCommit;
+			//0 means 10
+			int GroupCommitIntervalInMilliseconds;
+			//native threads serving async database calls, 0 means twice processors count
+			int AsyncWorkersCount;
+			//async calls are rejected when this many are queued, 0 means 1024
+			int AsyncQueueLength;
 		};
 
 		public enum class CachePriority {
@@ -24,6 +68,17 @@ namespace SimpleBdb {
 			VeryHigh = 5
 		};
 
+		public enum class BtreeCompression {
+			None = 0,
+			Bdb = 1,
+			PrefixDelta = 2
+		};
+
+		public enum class PostingsOperation {
+			Union = 0,
+			Intersection = 1
+		};
+
 		public enum class Direction
 		{
 			Ascending = 0,
@@ -35,15 +90,32 @@ namespace SimpleBdb {
 			static BytesBufferConfig^ FixedTo(int size) { return gcnew BytesBufferConfig(max(size, minFixedSize), true); }
 			static BytesBufferConfig^ GrowFrom(int size) { return gcnew BytesBufferConfig(max(size, minFixedSize), false); }
 			static BytesBufferConfig^ MinFixed() { return FixedTo(minFixedSize); }
+			//starts from size, then buffers are sized to cover 99% of observed record sizes, seeded by a sample of records at attach.
+			//longer records grow only the buffer of the cursor that met them, so a few huge records don't inflate every fetch store
+			static BytesBufferConfig^ Adaptive(int size) { return gcnew BytesBufferConfig(max(size, minFixedSize), false, true); }
 		internal:
-			BytesBufferConfig(int size, bool fixed) :Size(size), Fixed(fixed) {
+			BytesBufferConfig(int size, bool fixed) :Size(size), Fixed(fixed), IsAdaptive(false) {
+			}
+			BytesBufferConfig(int size, bool fixed, bool adaptive) :Size(size), Fixed(fixed), IsAdaptive(adaptive) {
 			}
 			int Size;
 			bool Fixed;
+			bool IsAdaptive;
 		private:
 			static int minFixedSize = sizeof(unsigned int);
 		};
 
+		//secondary key of a record is bytes [ValueOffset, ValueOffset + ValueLength) of its value, followed by its key
+		//when AppendPrimaryKey, so secondary keys are unique. 0 ValueLength means up to the end of the value,
+		//records with shorter values are not indexed
+		public ref struct SecondaryIndexConfig {
+			//secondary is named database [<database name>.<Name>], Name [metadata] is reserved
+			System::String^ Name;
+			int ValueOffset;
+			int ValueLength;
+			bool AppendPrimaryKey;
+		};
+
 		public ref struct DatabaseConfig {
 			DatabaseConfig() :KeyBufferConfig(BytesBufferConfig::GrowFrom(100)), ValueBufferConfig(BytesBufferConfig::GrowFrom(100)) {
 			}
@@ -51,11 +123,131 @@ namespace SimpleBdb {
 			CachePriority CachePriority;
 			bool EnableRecno;
 			bool IsReadonly;
+			//readonly database file is mapped into memory and read through os page cache instead of bdb cache,
+			//file must not exceed EnvironmentConfig.MemoryMapSizeInBytes and must not be opened for write in the same environment
+			bool IsMemoryMapped;
+			//0 means bdb default
+			int PageSize;
+			//0 means bdb default
+			int BtreeMinKey;
+			//can't be combined with EnableRecno
+			BtreeCompression Compression;
+			//max ids in one posting list block, 0 means 128
+			int PostingListMaxBlockIds;
+			//can't be combined with EnableRecno
+			bool EnableSortedDuplicates;
+			//queued async calls of databases with higher priority are served first
+			int AsyncPriority;
+			//values of hot keys returned by Find are cached up to this size and invalidated by writes through this database,
+			//cached buffer is shared between callers and must not be modified, 0 means disabled
+			long long FindCacheSizeInBytes;
+			//bloom filter over keys lets Find answer absent keys without touching btree pages, 0 means disabled, 10 gives about 1% false positives.
+			//filter is built by key scan on attach and maintained by Add, it grows by layers as keys are added, so database filled after attach
+			//keeps the false positive rate within a few times of the configured one. Removed keys stay in it until RebuildBloomFilter,
+			//keys written by AddPosting are not tracked, so it must not be enabled for posting list databases
+			int BloomFilterBitsPerKey;
+			//idle bdb cursor handles kept for reuse by Query and Fetch, so fetch over many ranges doesn't open and close
+			//a handle per range, 0 means 128, negative disables reuse
+			int MaxIdleCursors;
+			//Add, Find, Query and Fetch calls slower than this are logged as warnings with their parameters, cursor seeks and steps,
+			//buffer small retries, copied bytes and cache misses. Query time is the time spent in reads of its cursor,
+			//reported on cursor dispose. Calls under the threshold only take timestamps, cache misses are environment wide
+			//since the previous slow call report, 0 means disabled
+			int SlowOperationThresholdInMilliseconds;
+			//secondaries are updated by bdb within the same put and del, missing ones are built from existing records on attach.
+			//index spec of the first attach is stored in [<Name>.metadata], attach with other ValueOffset, ValueLength
+			//or AppendPrimaryKey of an existing index throws. Can't be combined with EnableSortedDuplicates
+			array<SecondaryIndexConfig^>^ SecondaryIndexes;
+			//keys are counted per prefix of this many bytes in memory, so GetTotalCount of ranges with boundaries not longer
+			//than the prefix, e.g. Range.Prefix, sums counters instead of seeking by record numbers and doesn't need EnableRecno.
+			//counters are saved to [<Name>.metadata] on close and loaded by the next attach, which removes them until its own close,
+			//so attach after a crash rebuilds them by key scan. Add looks the key up by a cursor without reading its value
+			//to tell inserted keys from overwritten ones. Keys written by AddPosting are not counted, 0 means disabled.
+			//can't be combined with EnableSortedDuplicates
+			int CountedPrefixLength;
 			BytesBufferConfig^ KeyBufferConfig;
 			BytesBufferConfig^ ValueBufferConfig;
+		internal:
+			DatabaseConfig^ Clone() { return safe_cast<DatabaseConfig^>(MemberwiseClone()); }
+		};
+
+		public ref struct BulkLoadConfig {
+			//records come in ascending key order and are written as is, otherwise they are sorted by external merge sort
+			bool IsSorted;
+			//memory for one sorted run of unsorted records, larger input is spilled to temporary run files, 0 means 64MB
+			long long SortMemoryInBytes;
+			//btree page fill percent of the compaction after load, 0 means 95
+			int FillPercent;
+			//directory of temporary run files, null means directory of the environment file
+			System::String^ TempDirectory;
+		};
+
+		public value struct CacheStatistics
+		{
+			unsigned int st_ncache;
+			unsigned int st_pages;
+			unsigned int st_map;
+			unsigned int st_page_clean;
+			unsigned int st_page_dirty;
+			unsigned int st_hash_buckets;
+			unsigned long long st_cache_hit;
+			unsigned long long st_cache_miss;
+			unsigned long long st_page_in;
+			unsigned long long st_page_out;
+			unsigned long long st_ro_evict;
+			unsigned long long st_rw_evict;
+			unsigned long long st_hash_wait;
+			unsigned long long st_region_wait;
+		};
+
+		public value struct FindCacheStatistics
+		{
+			long long Hits;
+			long long Misses;
+			long long Evictions;
+			long long Invalidations;
+			long long SizeInBytes;
+			int EntriesCount;
+		};
+
+		//record sizes observed by adaptive buffers, empty for other configs
+		public value struct BufferStatistics
+		{
+			long long ObservedCount;
+			unsigned int MaxLength;
+			//99th percentile rounded up to histogram bucket bound
+			int PercentileLength;
+			//length buffers of new cursors start with
+			int ChunkLength;
+		};
+
+		public value struct BloomFilterStatistics
+		{
+			long long KeysCount;
+			long long Capacity;
+			//1 until added keys exceed capacity of the filter built on attach
+			int LayersCount;
+			long long MemoryInBytes;
+			long long RemovedKeysCount;
+			long long Checks;
+			long long Negatives;
+			long long FalsePositives;
+			double EstimatedFalsePositiveRate;
+			double ObservedFalsePositiveRate;
+		};
+
+		public value struct BulkLoadStatistics
+		{
+			long long RecordsCount;
+			//sorted runs spilled to temporary files, 0 when input fit into sort memory or was sorted
+			int RunsCount;
+			long long ElapsedMilliseconds;
+			double RecordsPerSecond;
+			unsigned int PagesCount;
 		};
 
 		ref class Database;
+		ref class PartitionedDatabase;
 
 		public ref class Environment : public Implementation::BdbComponent {
 		public:
@@ -64,6 +256,7 @@ namespace SimpleBdb {
 			//CDS is not used because we need atomic operations over multiple databases
 			//(index/inverted index). Client is responsible for locking,
 			//environment is only the container for single common RW-lock.
+			//Indexes declared by DatabaseConfig.SecondaryIndexes are updated by bdb within the primary write itself.
 			[NotNull]
 			property System::Threading::ReaderWriterLockSlim^ Locker {
 				System::Threading::ReaderWriterLockSlim^ get(){ return locker_; }
@@ -81,18 +274,47 @@ namespace SimpleBdb {
 			}
 			[NotNull]
 			System::String^ DumpStats();
+			CacheStatistics GetCacheStatistics();
 			[NotNull] Database^ AttachDatabase([NotNull] DatabaseConfig^ config);
+			//boundaries must be sorted ascending, partitions are named databases [<Name>.<index>] attached with the same config.
+			//boundaries of the first attach are stored in [<Name>.metadata], later attaches with other boundaries throw
+			[NotNull] PartitionedDatabase^ AttachPartitionedDatabase([NotNull] DatabaseConfig^ config, [NotNull] array<array<Byte>^>^ boundaries);
+			//completes when all writes done before the call are durable, may be ignored for fire-and-forget writes
+			[NotNull] System::Threading::Tasks::Task^ GetCommitTicket();
+			//builds database config.Name from scratch: records are written in key order into a temporary database,
+			//which is compacted and then renamed over the existing one. Equal keys keep the last value.
+			//database must not be attached during the load, attach it with AttachDatabase afterwards,
+			//its secondary indexes are removed and rebuilt by the attach. Open and rename steps take Locker write lock
+			//unless the caller holds it, so the load must not be called under Locker read lock. Records are written
+			//without the lock, so the caller holds the write lock itself when other databases of the file are written meanwhile.
+			//Rename is atomic only with EnableGroupCommit, otherwise crash between removal of the old database
+			//and rename of the loaded one leaves no database under config.Name until the load is repeated
+			BulkLoadStatistics BulkLoad([NotNull] DatabaseConfig^ config,
+				[NotNull] System::Collections::Generic::IEnumerable<System::Collections::Generic::KeyValuePair<array<Byte>^, array<Byte>^>>^ records,
+				[NotNull] BulkLoadConfig^ loadConfig);
 		internal:
 			void LogErrorViaBdb(int error, System::String^ message);
 			void TrackDatabase(Database^ database);
 			void UntrackDatabase(Database^ database);
+			NativeWorkerPool* GetWorkerPool();
+			u_int32_t DatabaseOpenFlags(bool readonly);
 
 			DB_ENV* dbEnv_;
 			EnvironmentConfig^ config_;
 			System::String^ fileName_;
+			Implementation::WarmList^ warmList_;
+			Implementation::GroupCommitter^ groupCommitter_;
+			NativeWorkerPool* workerPool_;
+			System::Object^ workerPoolSync_;
 		protected:
 			virtual void Close() override;
 		private:
+			void Create();
+			void Open();
+			bool EnterWriteLock();
+			void CheckPartitionBoundaries(DatabaseConfig^ config, array<array<Byte>^>^ boundaries);
+			void RenameDatabase(System::String^ sourceName, System::String^ targetName, System::Collections::Generic::List<System::String^>^ staleNames);
+			void RemoveDatabase(System::String^ name);
 			System::Collections::Generic::List<Database^>^ databases_;
 			System::Threading::ReaderWriterLockSlim^ locker_;
 		};
@@ -130,8 +352,55 @@ namespace SimpleBdb {
 			void Remove(SimpleBdb::Utils::BytesSegment key);
 			[CanBeNull] SimpleBdb::Utils::BytesBuffer^ Find(SimpleBdb::Utils::BytesSegment key);
 			[NotNull] SimpleBdb::Driver::ICursor^ Query([NotNull] SimpleBdb::Utils::Range^ range, Direction direction, int skip, int take);
+			//splits the range into ascending key ordered partitions to be read concurrently, one thread per cursor.
+			//partitions of recno database have equal records counts and are positioned by record numbers,
+			//otherwise split keys are estimated by key_range and partitions are only about equal, Fetch of them requires recno
+			[NotNull] array<SimpleBdb::Driver::ICursor^>^ QueryPartitions([NotNull] SimpleBdb::Utils::Range^ range, int partitionsCount);
 			[NotNull] SimpleBdb::Utils::BytesTable^ Fetch([NotNull] array<SimpleBdb::Utils::Range^>^ ranges, Direction direction, int take, unsigned int keySuffixOffset, FetchOptions options);
+			//merges by key suffix starting at field keySuffixField of keys written by KeyBuilder
+			[NotNull] SimpleBdb::Utils::BytesTable^ Fetch([NotNull] array<SimpleBdb::Utils::Range^>^ ranges, Direction direction, int take, [NotNull] SimpleBdb::Utils::KeySchema^ keySchema, int keySuffixField, FetchOptions options);
+			//fill and return target, e.g. rented from BytesTablePool, its arrays are grown only when too small
+			[NotNull] SimpleBdb::Utils::BytesTable^ Fetch([NotNull] array<SimpleBdb::Utils::Range^>^ ranges, Direction direction, int take, unsigned int keySuffixOffset, FetchOptions options, [NotNull] SimpleBdb::Utils::BytesTable^ target);
+			[NotNull] SimpleBdb::Utils::BytesTable^ Fetch([NotNull] array<SimpleBdb::Utils::Range^>^ ranges, Direction direction, int take, [NotNull] SimpleBdb::Utils::KeySchema^ keySchema, int keySuffixField, FetchOptions options, [NotNull] SimpleBdb::Utils::BytesTable^ target);
+			//skip > 0 requires recno, skipped records aren't read: start of every range is found by record numbers
+			//in O(ranges * log(records)) seeks. Records with equal suffixes in different ranges go in ranges order
+			[NotNull] SimpleBdb::Utils::BytesTable^ Fetch([NotNull] array<SimpleBdb::Utils::Range^>^ ranges, Direction direction, int skip, int take, unsigned int keySuffixOffset, FetchOptions options);
+			[NotNull] SimpleBdb::Utils::BytesTable^ Fetch([NotNull] array<SimpleBdb::Utils::Range^>^ ranges, Direction direction, int skip, int take, [NotNull] SimpleBdb::Utils::KeySchema^ keySchema, int keySuffixField, FetchOptions options);
+			//async variants run on environment native worker pool, native reads take client read lock on the worker and open cursors only under it,
+			//so caller must not hold write lock while waiting for the task,
+			//cancellation is checked between records, BdbException is thrown when the pool queue is full
+			[NotNull] System::Threading::Tasks::Task<SimpleBdb::Utils::BytesBuffer^>^ FindAsync(SimpleBdb::Utils::BytesSegment key, System::Threading::CancellationToken cancellationToken);
+			[NotNull] System::Threading::Tasks::Task<SimpleBdb::Utils::BytesTable^>^ ReadAsync([NotNull] SimpleBdb::Utils::Range^ range, Direction direction, int skip, int take, FetchOptions options, System::Threading::CancellationToken cancellationToken);
+			[NotNull] System::Threading::Tasks::Task<SimpleBdb::Utils::BytesTable^>^ FetchAsync([NotNull] array<SimpleBdb::Utils::Range^>^ ranges, Direction direction, int take, unsigned int keySuffixOffset, FetchOptions options, System::Threading::CancellationToken cancellationToken);
+			[NotNull] System::Threading::Tasks::Task<SimpleBdb::Utils::BytesTable^>^ FetchAsync([NotNull] array<SimpleBdb::Utils::Range^>^ ranges, Direction direction, int take, [NotNull] SimpleBdb::Utils::KeySchema^ keySchema, int keySuffixField, FetchOptions options, System::Threading::CancellationToken cancellationToken);
+			//posting lists are sorted id sets per term stored as delta coded blocks,
+			//database holding posting lists must not be used for anything else
+			void AddPosting(SimpleBdb::Utils::BytesSegment term, unsigned int id);
+			void RemovePosting(SimpleBdb::Utils::BytesSegment term, unsigned int id);
+			[NotNull] array<unsigned int>^ FetchPostings([NotNull] array<SimpleBdb::Utils::BytesSegment>^ terms, PostingsOperation operation, int take);
+			//sorted duplicates api, Add appends the value to key duplicates, Remove drops all of them
+			void RemoveDuplicate(SimpleBdb::Utils::BytesSegment key, SimpleBdb::Utils::BytesSegment value);
+			unsigned int GetDuplicatesCount(SimpleBdb::Utils::BytesSegment key);
+			//bulk reads duplicates in DB_MULTIPLE batches
+			[NotNull] SimpleBdb::Driver::ICursor^ QueryDuplicates(SimpleBdb::Utils::BytesSegment key, int take, bool bulk);
+			//merges duplicates of keys by value
+			[NotNull] SimpleBdb::Utils::BytesTable^ FetchDuplicates([NotNull] array<SimpleBdb::Utils::BytesSegment>^ keys, Direction direction, int take, FetchOptions options);
+			//secondary index api, range is over secondary keys, records are primary keys and values read by pget
+			[NotNull] SimpleBdb::Driver::ICursor^ QueryIndex([NotNull] System::String^ indexName, [NotNull] SimpleBdb::Utils::Range^ range, Direction direction, int take);
+			//take must be bounded, as secondaries don't keep record numbers
+			[NotNull] SimpleBdb::Utils::BytesTable^ FetchIndex([NotNull] System::String^ indexName, [NotNull] SimpleBdb::Utils::Range^ range, Direction direction, int take, FetchOptions options);
 			[NotNull] DatabaseStatistics GetStatistics(bool fast);
+			FindCacheStatistics GetFindCacheStatistics();
+			BloomFilterStatistics GetBloomFilterStatistics();
+			BufferStatistics GetKeyBufferStatistics();
+			BufferStatistics GetValueBufferStatistics();
+			//rescans keys to drop removed ones, client must hold exclusive lock, concurrent calls may use the old filter otherwise
+			void RebuildBloomFilter();
+			//appends every Add, Remove, Find, Query and Fetch call with its timing to fileName for replay, Query is appended when its cursor
+			//is disposed, with rows read and time spent in reads. withKeys = false records only key lengths so traces of sensitive data can leave the host
+			void StartTrace([NotNull] System::String^ fileName, bool withKeys);
+			//returns recorded calls count
+			long long StopTrace();
 			[NotNull]
 			property DatabaseConfig^ Config {
 				DatabaseConfig^ get() { return config_; }
@@ -141,16 +410,84 @@ namespace SimpleBdb {
 			void Open();
 			void LogErrorViaBdb(int error, System::String^ message);
 			void CheckRecordNumbersEnabled();
+			void CheckSortedDuplicatesEnabled();
+			void CheckMemoryMapped();
+			void StartWarmUp(System::Collections::Generic::List<array<Byte>^>^ keys);
 
 			DB* db_;
 			Environment^ env_;
 			DatabaseConfig^ config_;
 			Implementation::BufferState^ keysState_;
 			Implementation::BufferState^ valuesState_;
+			Implementation::FindCache^ findCache_;
+			System::Threading::CountdownEvent^ asyncPending_;
+			volatile bool* asyncStopped_;
+			NativeBloomFilter* bloomFilter_;
+			NativeCursorPool* cursorPool_;
+			//null when config has no secondary indexes
+			NativeSecondaryIndexes* secondaryIndexes_;
+			//null when counted prefix length is 0
+			NativePrefixCounts* prefixCounts_;
+			//null when slow operation log is disabled
+			Implementation::SlowOperationLog^ slowLog_;
+			//null when trace is not started
+			Implementation::TraceRecorder^ trace_;
 		protected:
 			virtual void Close() override;
 		private:
 			int DoFind(SimpleBdb::Utils::BytesSegment key, Implementation::BufferAllocator^ valueAccessor);
+			//keySuffixField < 0 means suffix is located by keySuffixOffset, slow fetch is reported by slow operation log
+			SimpleBdb::Utils::BytesTable^ DoFetch(Implementation::SuffixMergingFetcher% fetcher, array<SimpleBdb::Utils::Range^>^ ranges, Direction direction,
+				int skip, int take, unsigned int keySuffixOffset, int keySuffixField, FetchOptions options, SimpleBdb::Utils::BytesTable^ target);
+			void AddUntraced(SimpleBdb::Utils::BytesSegment key, SimpleBdb::Utils::BytesSegment value);
+			void RemoveUntraced(SimpleBdb::Utils::BytesSegment key);
+			SimpleBdb::Utils::BytesBuffer^ FindUntraced(SimpleBdb::Utils::BytesSegment key, Implementation::ReadCounters% counters);
+			unsigned int PostingListMaxBlockIds();
+			void WarmUp();
+			void StopWarmUp();
+			void StopAsync();
+			bool BloomFilterMayContain(SimpleBdb::Utils::BytesSegment key);
+			void OpenSecondaryIndexes(const char* fileName, u_int32_t flags);
+			void CheckSecondaryIndexes(const char* fileName, u_int32_t flags);
+			void OpenPrefixCounts(const char* fileName, u_int32_t flags);
+			void SavePrefixCounts();
+			int PutCounted(DBT* key, DBT* value);
+			DB* GetSecondary(System::String^ indexName);
+			System::Collections::Generic::List<array<Byte>^>^ warmUpKeys_;
+			System::Threading::Tasks::Task^ warmUpTask_;
+			volatile bool warmUpStopped_;
+			long long bloomChecks_;
+			long long bloomNegatives_;
+			long long bloomFalsePositives_;
+			long long bloomRemovedKeys_;
+		};
+
+		//key range partitioned set of databases, partition i holds keys within [boundaries[i - 1], boundaries[i]).
+		//each partition is a separate smaller btree, so root splits and hot leaf pages of one don't stall the others,
+		//point operations go to one partition, Query reads partitions one after another, Fetch merges them by key suffix
+		public ref class PartitionedDatabase : public Implementation::BdbComponent {
+		public:
+			void Add(SimpleBdb::Utils::BytesSegment key, SimpleBdb::Utils::BytesSegment value);
+			void Remove(SimpleBdb::Utils::BytesSegment key);
+			[CanBeNull] SimpleBdb::Utils::BytesBuffer^ Find(SimpleBdb::Utils::BytesSegment key);
+			[NotNull] SimpleBdb::Driver::ICursor^ Query([NotNull] SimpleBdb::Utils::Range^ range, Direction direction, int skip, int take);
+			[NotNull] SimpleBdb::Utils::BytesTable^ Fetch([NotNull] array<SimpleBdb::Utils::Range^>^ ranges, Direction direction, int take, unsigned int keySuffixOffset, FetchOptions options);
+			[NotNull] SimpleBdb::Utils::BytesTable^ Fetch([NotNull] array<SimpleBdb::Utils::Range^>^ ranges, Direction direction, int take, [NotNull] SimpleBdb::Utils::KeySchema^ keySchema, int keySuffixField, FetchOptions options);
+			int GetPartitionIndex(SimpleBdb::Utils::BytesSegment key);
+			[NotNull] Database^ GetPartition(int index);
+			property int PartitionsCount {
+				int get() { return partitions_->Length; }
+			}
+		internal:
+			PartitionedDatabase([NotNull] Environment^ env, [NotNull] System::String^ name, [NotNull] array<array<Byte>^>^ boundaries, [NotNull] array<Database^>^ partitions);
+			virtual void CheckOpen() override;
+		protected:
+			virtual void Close() override;
+		private:
+			array<Database^>^ PartitionsFor(SimpleBdb::Utils::Range^ range);
+			Environment^ env_;
+			array<array<Byte>^>^ boundaries_;
+			array<Database^>^ partitions_;
 		};
 
 		public ref class BdbException : System::Exception {
@@ -0,0 +1,259 @@
+#include "NativeBloom.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+namespace {
+	const unsigned int blockWordsCount = 8;
+	const unsigned int blockBitsCount = blockWordsCount * 64;
+	const unsigned int minCapacity = 1024;
+	const unsigned int maxHashesCount = 16;
+	//capacity doubles with every layer, so this bounds keys count far beyond what fits into memory
+	const unsigned int maxLayersCount = 24;
+	const unsigned long long maxLayerCapacity = 1ull << 31;
+	//each added layer gets this many more bits per key, so sum of layer false positive rates converges
+	const unsigned int layerExtraBitsPerKey = 2;
+	const unsigned int maxBitsPerKey = 32;
+	const unsigned int bulkBufferSize = 1024 * 1024;
+
+	void CheckApiOk(int resultCode, const char* api) {
+		if (resultCode != 0)
+			throw NativeBdbApiException(resultCode, api);
+	}
+
+	unsigned long long Mix(unsigned long long x) {
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdull;
+		x ^= x >> 33;
+		x *= 0xc4ceb9fe1a85ec53ull;
+		x ^= x >> 33;
+		return x;
+	}
+
+	//word at a time, keys are mostly longer than a few bytes
+	unsigned long long Hash(const Byte* key, unsigned int length) {
+		const unsigned long long multiplier = 0x9e3779b97f4a7c15ull;
+		unsigned long long result = length * multiplier;
+		unsigned int i = 0;
+		for (; i + sizeof(unsigned long long) <= length; i += sizeof(unsigned long long)) {
+			unsigned long long word;
+			memcpy(&word, key + i, sizeof(unsigned long long));
+			result = (result ^ Mix(word)) * multiplier;
+		}
+		unsigned long long tail = 0;
+		//key of zero length may be null
+		if (i < length)
+			memcpy(&tail, key + i, length - i);
+		return Mix((result ^ Mix(tail)) * multiplier);
+	}
+}
+
+struct NativeBloomFilter::Layer {
+	Layer(unsigned int capacity, unsigned int bitsPerKey);
+	void Add(unsigned long long hash);
+	bool MayContain(unsigned long long hash) const;
+	double EstimatedFalsePositiveRate() const;
+	unsigned int capacity;
+	unsigned int bitsPerKey;
+	unsigned int blocksCount;
+	unsigned int hashesCount;
+	unique_ptr<atomic<unsigned long long>[]> words;
+	atomic<unsigned int> keysCount;
+};
+
+NativeBloomFilter::Layer::Layer(unsigned int capacity, unsigned int bitsPerKey)
+	:capacity(capacity), bitsPerKey(bitsPerKey),
+	blocksCount(static_cast<unsigned int>((static_cast<unsigned long long>(capacity) * bitsPerKey + blockBitsCount - 1) / blockBitsCount)),
+	hashesCount(min(max(static_cast<unsigned int>(bitsPerKey * 0.69 + 0.5), 1u), maxHashesCount)),
+	words(new atomic<unsigned long long>[blocksCount * blockWordsCount]), keysCount(0) {
+	for (unsigned int i = 0; i < blocksCount * blockWordsCount; i++)
+		words[i].store(0, memory_order_relaxed);
+}
+
+//block is picked by high half of the hash, bits inside it by double hashing of the low half
+void NativeBloomFilter::Layer::Add(unsigned long long hash) {
+	atomic<unsigned long long>* block = &words[static_cast<unsigned int>(((hash >> 32) * blocksCount) >> 32) * blockWordsCount];
+	unsigned int first = static_cast<unsigned int>(hash);
+	unsigned int step = static_cast<unsigned int>(hash >> 17) | 1;
+	for (unsigned int i = 0; i < hashesCount; i++) {
+		unsigned int bit = (first + i * step) % blockBitsCount;
+		block[bit / 64].fetch_or(1ull << (bit % 64), memory_order_relaxed);
+	}
+	keysCount.fetch_add(1, memory_order_relaxed);
+}
+
+bool NativeBloomFilter::Layer::MayContain(unsigned long long hash) const {
+	const atomic<unsigned long long>* block = &words[static_cast<unsigned int>(((hash >> 32) * blocksCount) >> 32) * blockWordsCount];
+	unsigned int first = static_cast<unsigned int>(hash);
+	unsigned int step = static_cast<unsigned int>(hash >> 17) | 1;
+	for (unsigned int i = 0; i < hashesCount; i++) {
+		unsigned int bit = (first + i * step) % blockBitsCount;
+		if ((block[bit / 64].load(memory_order_relaxed) & (1ull << (bit % 64))) == 0)
+			return false;
+	}
+	return true;
+}
+
+double NativeBloomFilter::Layer::EstimatedFalsePositiveRate() const {
+	double bitsCount = static_cast<double>(blocksCount) * blockBitsCount;
+	double keys = keysCount.load(memory_order_relaxed);
+	return pow(1 - exp(-(hashesCount * keys) / bitsCount), static_cast<double>(hashesCount));
+}
+
+//layers are published by layersCount, so readers see only fully built ones
+struct NativeBloomFilter::State {
+	State() :layersCount(0) {
+	}
+	~State() {
+		for (unsigned int i = 0; i < layersCount.load(memory_order_relaxed); i++)
+			delete layers[i];
+	}
+	Layer* Last() const {
+		return layers[layersCount.load(memory_order_acquire) - 1];
+	}
+	void Append(Layer* layer) {
+		unsigned int count = layersCount.load(memory_order_relaxed);
+		layers[count] = layer;
+		layersCount.store(count + 1, memory_order_release);
+	}
+	//appends layer unless another thread did it since full was observed
+	Layer* Grow(Layer* full) {
+		lock_guard<mutex> lock(growSync);
+		Layer* last = Last();
+		if (last != full || layersCount.load(memory_order_relaxed) == maxLayersCount)
+			return last;
+		unsigned int capacity = static_cast<unsigned int>(min(2ull * full->capacity, maxLayerCapacity));
+		Layer* result = new Layer(capacity, min(full->bitsPerKey + layerExtraBitsPerKey, maxBitsPerKey));
+		Append(result);
+		return result;
+	}
+	Layer* layers[maxLayersCount];
+	atomic<unsigned int> layersCount;
+	mutex growSync;
+};
+
+NativeBloomFilter::NativeBloomFilter(unsigned int capacity, unsigned int bitsPerKey) :state_(new State()) {
+	try {
+		state_->Append(new Layer(max(capacity, minCapacity), bitsPerKey));
+	}
+	catch (...) {
+		delete state_;
+		throw;
+	}
+}
+
+NativeBloomFilter::~NativeBloomFilter() {
+	delete state_;
+}
+
+NativeBloomFilter* NativeBloomFilter::Build(DB* db, unsigned int bitsPerKey) {
+	vector<unsigned long long> hashes;
+	DBC* dbc;
+	CheckApiOk(db->cursor(db, nullptr, &dbc, 0), "db.cursor");
+	DBT keyDbt;
+	memset(&keyDbt, 0, sizeof(DBT));
+	keyDbt.flags = DB_DBT_REALLOC;
+	vector<Byte> buffer(bulkBufferSize);
+	try {
+		for (;;) {
+			DBT bulkDbt;
+			memset(&bulkDbt, 0, sizeof(DBT));
+			bulkDbt.data = &buffer[0];
+			bulkDbt.ulen = buffer.size();
+			bulkDbt.flags = DB_DBT_USERMEM;
+			int resultCode = dbc->get(dbc, &keyDbt, &bulkDbt, DB_NEXT | DB_MULTIPLE_KEY);
+			if (resultCode == DB_NOTFOUND)
+				break;
+			if (resultCode == DB_BUFFER_SMALL) {
+				buffer.resize((bulkDbt.size + 1023) / 1024 * 1024);
+				continue;
+			}
+			CheckApiOk(resultCode, "cursor.get.DB_NEXT|DB_MULTIPLE_KEY");
+			void* position;
+			DB_MULTIPLE_INIT(position, &bulkDbt);
+			for (;;) {
+				void* key;
+				void* value;
+				u_int32_t keyLength, valueLength;
+				DB_MULTIPLE_KEY_NEXT(position, &bulkDbt, key, keyLength, value, valueLength);
+				//values are read only because bulk gets can't skip them
+				(void)value;
+				(void)valueLength;
+				if (position == nullptr)
+					break;
+				hashes.push_back(Hash(static_cast<Byte*>(key), keyLength));
+			}
+		}
+	}
+	catch (...) {
+		dbc->close(dbc);
+		free(keyDbt.data);
+		throw;
+	}
+	free(keyDbt.data);
+	CheckApiOk(dbc->close(dbc), "cursor.close");
+	unsigned int keysCount = hashes.size();
+	NativeBloomFilter* result = new NativeBloomFilter(keysCount + keysCount / 2, bitsPerKey);
+	for (auto it = hashes.begin(); it != hashes.end(); it++)
+		result->AddHash(*it);
+	return result;
+}
+
+void NativeBloomFilter::Add(const Byte* key, unsigned int length) {
+	AddHash(Hash(key, length));
+}
+
+void NativeBloomFilter::AddHash(unsigned long long hash) {
+	Layer* layer = state_->Last();
+	if (layer->keysCount.load(memory_order_relaxed) >= layer->capacity)
+		layer = state_->Grow(layer);
+	layer->Add(hash);
+}
+
+//the last layer holds most keys, so it is checked first
+bool NativeBloomFilter::MayContain(const Byte* key, unsigned int length) const {
+	unsigned long long hash = Hash(key, length);
+	for (unsigned int i = state_->layersCount.load(memory_order_acquire); i > 0; i--)
+		if (state_->layers[i - 1]->MayContain(hash))
+			return true;
+	return false;
+}
+
+unsigned long long NativeBloomFilter::Capacity() const {
+	unsigned long long result = 0;
+	for (unsigned int i = 0; i < LayersCount(); i++)
+		result += state_->layers[i]->capacity;
+	return result;
+}
+
+unsigned long long NativeBloomFilter::KeysCount() const {
+	unsigned long long result = 0;
+	for (unsigned int i = 0; i < LayersCount(); i++)
+		result += state_->layers[i]->keysCount.load(memory_order_relaxed);
+	return result;
+}
+
+unsigned long long NativeBloomFilter::MemoryInBytes() const {
+	unsigned long long result = 0;
+	for (unsigned int i = 0; i < LayersCount(); i++)
+		result += static_cast<unsigned long long>(state_->layers[i]->blocksCount) * blockWordsCount * sizeof(unsigned long long);
+	return result;
+}
+
+unsigned int NativeBloomFilter::LayersCount() const {
+	return state_->layersCount.load(memory_order_acquire);
+}
+
+//a key is a false positive unless every layer rejects it
+double NativeBloomFilter::EstimatedFalsePositiveRate() const {
+	double passed = 1;
+	for (unsigned int i = 0; i < LayersCount(); i++)
+		passed *= 1 - state_->layers[i]->EstimatedFalsePositiveRate();
+	return 1 - passed;
+}
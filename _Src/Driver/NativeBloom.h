@@ -0,0 +1,32 @@
+#pragma once
+
+#include "NativeCursors.h"
+
+//blocked bloom filter, all bits of a key are set within one 64-byte block, so a lookup touches one cache line.
+//bits are set atomically, so concurrent Add doesn't lose bits of other keys, there are no false negatives.
+//filter grows by layers: once the last layer holds its capacity of keys, Add appends a layer of twice the capacity
+//with more bits per key, so false positive rate of a database filled after attach stays bounded without rescan.
+//layers are never removed before the filter is deleted, so MayContain runs concurrently with growth
+class NativeBloomFilter {
+public:
+	NativeBloomFilter(unsigned int capacity, unsigned int bitsPerKey);
+	~NativeBloomFilter();
+	//scans all keys of the database with bulk reads, capacity is sized with headroom for later adds
+	static NativeBloomFilter* Build(DB* db, unsigned int bitsPerKey);
+	void Add(const Byte* key, unsigned int length);
+	bool MayContain(const Byte* key, unsigned int length) const;
+	//sum over layers
+	unsigned long long Capacity() const;
+	unsigned long long KeysCount() const;
+	unsigned long long MemoryInBytes() const;
+	unsigned int LayersCount() const;
+	//expected false positive rate for the current keys count
+	double EstimatedFalsePositiveRate() const;
+private:
+	NativeBloomFilter(const NativeBloomFilter&);
+	NativeBloomFilter& operator=(const NativeBloomFilter&);
+	void AddHash(unsigned long long hash);
+	struct Layer;
+	struct State;
+	State* state_;
+};
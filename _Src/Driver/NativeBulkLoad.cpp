@@ -0,0 +1,280 @@
+#include "NativeBulkLoad.h"
+#include <algorithm>
+#include <queue>
+#include <sstream>
+#include <stdio.h>
+
+using namespace std;
+
+namespace {
+	//DB_MULTIPLE_KEY put buffer, records longer than it are put one by one
+	const size_t bulkBufferSize = 4 * 1024 * 1024;
+	const size_t runReadBufferSize = 64 * 1024;
+
+	void CheckApiOk(int resultCode, const char* api) {
+		if (resultCode != 0)
+			throw NativeBdbApiException(resultCode, api);
+	}
+
+	//bdb default btree order
+	int CompareKeys(const Byte* a, unsigned int aLength, const Byte* b, unsigned int bLength) {
+		unsigned int length = min(aLength, bLength);
+		//empty last key is passed as null, which memcmp doesn't accept even for 0 length
+		int result = length > 0 ? memcmp(a, b, length) : 0;
+		return result != 0 ? result : (aLength < bLength ? -1 : (aLength > bLength ? 1 : 0));
+	}
+
+	//record of a run in memory and on disk: u32 key length, u32 value length, key, value
+	struct RecordHeader {
+		unsigned int keyLength;
+		unsigned int valueLength;
+	};
+
+	class RunReader {
+	public:
+		RunReader(const string& fileName, unsigned int index) :index_(index), buffer_(runReadBufferSize) {
+			file_ = fopen(fileName.c_str(), "rb");
+			if (file_ == nullptr)
+				throw NativeBdbException("can't open bulk load run file [" + fileName + "]");
+			setvbuf(file_, &buffer_[0], _IOFBF, buffer_.size());
+		}
+		~RunReader() {
+			fclose(file_);
+		}
+		bool Next() {
+			RecordHeader header;
+			if (fread(&header, sizeof(header), 1, file_) != 1)
+				return false;
+			key_.resize(header.keyLength);
+			value_.resize(header.valueLength);
+			if ((header.keyLength > 0 && fread(&key_[0], header.keyLength, 1, file_) != 1)
+				|| (header.valueLength > 0 && fread(&value_[0], header.valueLength, 1, file_) != 1))
+				throw NativeBdbException("bulk load run file is truncated");
+			return true;
+		}
+		const Byte* Key() const { return key_.empty() ? nullptr : &key_[0]; }
+		unsigned int KeyLength() const { return static_cast<unsigned int>(key_.size()); }
+		const Byte* Value() const { return value_.empty() ? nullptr : &value_[0]; }
+		unsigned int ValueLength() const { return static_cast<unsigned int>(value_.size()); }
+		unsigned int Index() const { return index_; }
+	private:
+		RunReader(const RunReader&);
+		RunReader& operator=(const RunReader&);
+		FILE* file_;
+		unsigned int index_;
+		vector<char> buffer_;
+		vector<Byte> key_;
+		vector<Byte> value_;
+	};
+
+	//min heap by key, equal keys come from earlier runs first
+	struct RunReaderGreater {
+		bool operator()(const RunReader* a, const RunReader* b) const {
+			int result = CompareKeys(a->Key(), a->KeyLength(), b->Key(), b->KeyLength());
+			return result != 0 ? result > 0 : a->Index() > b->Index();
+		}
+	};
+}
+
+struct NativeBulkLoader::State {
+	DB* db;
+	bool sorted;
+	size_t memoryLimit;
+	string runFilePrefix;
+	vector<string> runFiles;
+	//unsorted records of the current run and their offsets
+	vector<Byte> arena;
+	vector<size_t> offsets;
+	vector<u_int32_t> bulkBuffer;
+	DBT bulkDbt;
+	void* position;
+	unsigned int pendingCount;
+	unsigned long long writtenCount;
+	vector<Byte> lastKey;
+
+	//records are packed without alignment
+	RecordHeader HeaderAt(size_t offset) const {
+		RecordHeader result;
+		memcpy(&result, &arena[offset], sizeof(RecordHeader));
+		return result;
+	}
+
+	const Byte* KeyAt(size_t offset) const {
+		return &arena[offset] + sizeof(RecordHeader);
+	}
+
+	void StartBulk() {
+		DB_MULTIPLE_WRITE_INIT(position, &bulkDbt);
+		pendingCount = 0;
+	}
+
+	void Flush() {
+		if (pendingCount == 0)
+			return;
+		DBT ignoredDbt;
+		memset(&ignoredDbt, 0, sizeof(DBT));
+		CheckApiOk(db->put(db, nullptr, &bulkDbt, &ignoredDbt, DB_MULTIPLE_KEY), "db.put.DB_MULTIPLE_KEY");
+		StartBulk();
+	}
+
+	void PutSingle(const Byte* key, unsigned int keyLength, const Byte* value, unsigned int valueLength) {
+		DBT keyDbt;
+		memset(&keyDbt, 0, sizeof(DBT));
+		keyDbt.data = const_cast<Byte*>(key);
+		keyDbt.size = keyLength;
+		DBT valueDbt;
+		memset(&valueDbt, 0, sizeof(DBT));
+		valueDbt.data = const_cast<Byte*>(value);
+		valueDbt.size = valueLength;
+		CheckApiOk(db->put(db, nullptr, &keyDbt, &valueDbt, 0), "db.put");
+	}
+
+	void Write(const Byte* key, unsigned int keyLength, const Byte* value, unsigned int valueLength) {
+		DB_MULTIPLE_KEY_WRITE_NEXT(position, &bulkDbt, key, keyLength, value, valueLength);
+		//failed write leaves the buffer as it was
+		if (position == nullptr) {
+			Flush();
+			DB_MULTIPLE_KEY_WRITE_NEXT(position, &bulkDbt, key, keyLength, value, valueLength);
+			if (position == nullptr) {
+				StartBulk();
+				PutSingle(key, keyLength, value, valueLength);
+				writtenCount++;
+				return;
+			}
+		}
+		pendingCount++;
+		writtenCount++;
+	}
+
+	void SortRun() {
+		stable_sort(offsets.begin(), offsets.end(), [this](size_t a, size_t b) {
+			return CompareKeys(KeyAt(a), HeaderAt(a).keyLength, KeyAt(b), HeaderAt(b).keyLength) < 0;
+		});
+	}
+};
+
+NativeBulkLoader::NativeBulkLoader(DB* db, bool sorted, size_t memoryLimit, const string& runFilePrefix) :state_(new State()) {
+	state_->db = db;
+	state_->sorted = sorted;
+	state_->memoryLimit = memoryLimit;
+	state_->runFilePrefix = runFilePrefix;
+	state_->bulkBuffer.resize(bulkBufferSize / sizeof(u_int32_t));
+	memset(&state_->bulkDbt, 0, sizeof(DBT));
+	state_->bulkDbt.data = &state_->bulkBuffer[0];
+	state_->bulkDbt.ulen = static_cast<u_int32_t>(bulkBufferSize);
+	state_->bulkDbt.flags = DB_DBT_USERMEM;
+	state_->writtenCount = 0;
+	state_->StartBulk();
+}
+
+NativeBulkLoader::~NativeBulkLoader() {
+	for (size_t i = 0; i < state_->runFiles.size(); i++)
+		remove(state_->runFiles[i].c_str());
+	delete state_;
+}
+
+void NativeBulkLoader::Add(const Byte* key, unsigned int keyLength, const Byte* value, unsigned int valueLength) {
+	if (state_->sorted) {
+		vector<Byte>& lastKey = state_->lastKey;
+		if (state_->writtenCount > 0 && CompareKeys(key, keyLength, lastKey.empty() ? nullptr : &lastKey[0], static_cast<unsigned int>(lastKey.size())) < 0) {
+			stringstream ss;
+			ss << "bulk load records are not sorted, record index [" << state_->writtenCount << "]";
+			throw NativeBdbException(ss.str());
+		}
+		lastKey.assign(key, key + keyLength);
+		state_->Write(key, keyLength, value, valueLength);
+		return;
+	}
+	vector<Byte>& arena = state_->arena;
+	size_t offset = arena.size();
+	RecordHeader header = { keyLength, valueLength };
+	arena.resize(offset + sizeof(RecordHeader) + keyLength + valueLength);
+	memcpy(&arena[offset], &header, sizeof(RecordHeader));
+	if (keyLength > 0)
+		memcpy(&arena[offset + sizeof(RecordHeader)], key, keyLength);
+	if (valueLength > 0)
+		memcpy(&arena[offset + sizeof(RecordHeader) + keyLength], value, valueLength);
+	state_->offsets.push_back(offset);
+	if (arena.size() + state_->offsets.size() * sizeof(size_t) >= state_->memoryLimit)
+		SpillRun();
+}
+
+void NativeBulkLoader::SpillRun() {
+	if (state_->offsets.empty())
+		return;
+	state_->SortRun();
+	stringstream ss;
+	ss << state_->runFilePrefix << state_->runFiles.size();
+	string fileName = ss.str();
+	FILE* file = fopen(fileName.c_str(), "wb");
+	if (file == nullptr)
+		throw NativeBdbException("can't create bulk load run file [" + fileName + "]");
+	state_->runFiles.push_back(fileName);
+	bool written = true;
+	for (size_t i = 0; i < state_->offsets.size() && written; i++) {
+		size_t offset = state_->offsets[i];
+		RecordHeader header = state_->HeaderAt(offset);
+		size_t length = sizeof(RecordHeader) + header.keyLength + header.valueLength;
+		written = fwrite(&state_->arena[offset], length, 1, file) == 1;
+	}
+	written = fclose(file) == 0 && written;
+	if (!written)
+		throw NativeBdbException("can't write bulk load run file [" + fileName + "]");
+	state_->arena.clear();
+	state_->offsets.clear();
+}
+
+unsigned long long NativeBulkLoader::Finish() {
+	if (!state_->sorted) {
+		if (state_->runFiles.empty()) {
+			state_->SortRun();
+			for (size_t i = 0; i < state_->offsets.size(); i++) {
+				size_t offset = state_->offsets[i];
+				RecordHeader header = state_->HeaderAt(offset);
+				const Byte* key = state_->KeyAt(offset);
+				state_->Write(key, header.keyLength, key + header.keyLength, header.valueLength);
+			}
+			state_->arena.clear();
+			state_->offsets.clear();
+		}
+		else {
+			SpillRun();
+			vector<RunReader*> readers;
+			priority_queue<RunReader*, vector<RunReader*>, RunReaderGreater> heap;
+			try {
+				for (unsigned int i = 0; i < state_->runFiles.size(); i++) {
+					readers.push_back(new RunReader(state_->runFiles[i], i));
+					if (readers.back()->Next())
+						heap.push(readers.back());
+				}
+				while (!heap.empty()) {
+					RunReader* reader = heap.top();
+					heap.pop();
+					state_->Write(reader->Key(), reader->KeyLength(), reader->Value(), reader->ValueLength());
+					if (reader->Next())
+						heap.push(reader);
+				}
+			}
+			catch (...) {
+				for (size_t i = 0; i < readers.size(); i++)
+					delete readers[i];
+				throw;
+			}
+			for (size_t i = 0; i < readers.size(); i++)
+				delete readers[i];
+		}
+	}
+	state_->Flush();
+	return state_->writtenCount;
+}
+
+unsigned int NativeBulkLoader::RunsCount() const {
+	return static_cast<unsigned int>(state_->runFiles.size());
+}
+
+void NativeCompact(DB* db, unsigned int fillPercent) {
+	DB_COMPACT compactData;
+	memset(&compactData, 0, sizeof(DB_COMPACT));
+	compactData.compact_fillpercent = fillPercent;
+	CheckApiOk(db->compact(db, nullptr, nullptr, nullptr, &compactData, DB_FREE_SPACE, nullptr), "db.compact");
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "NativeCursors.h"
+
+//writes records into an empty database in key order with DB_MULTIPLE_KEY puts, so btree pages are appended
+//instead of split in the middle. Unsorted records are sorted by external merge sort: runs of memoryLimit bytes
+//are sorted in memory and spilled to temporary files named runFilePrefix + run index, then merged on Finish.
+//records with equal keys keep the order they were added in, so the last one wins unless duplicates are sorted
+class NativeBulkLoader {
+public:
+	NativeBulkLoader(DB* db, bool sorted, size_t memoryLimit, const std::string& runFilePrefix);
+	//removes temporary files
+	~NativeBulkLoader();
+	//throws when sorted loader gets a key less than the previous one
+	void Add(const Byte* key, unsigned int keyLength, const Byte* value, unsigned int valueLength);
+	//writes all records, returns their count
+	unsigned long long Finish();
+	unsigned int RunsCount() const;
+private:
+	NativeBulkLoader(const NativeBulkLoader&);
+	NativeBulkLoader& operator=(const NativeBulkLoader&);
+	void SpillRun();
+	struct State;
+	State* state_;
+};
+
+//compacts btree pages to fillPercent and returns emptied pages to the file system
+void NativeCompact(DB* db, unsigned int fillPercent);
@@ -0,0 +1,117 @@
+#include "NativeCompression.h"
+#include <string.h>
+#include <errno.h>
+
+typedef unsigned char Byte;
+
+namespace {
+	const unsigned int maxVarintSize = 5;
+
+	unsigned int VarintSize(u_int32_t value) {
+		unsigned int result = 1;
+		while (value >= 0x80) {
+			value >>= 7;
+			result++;
+		}
+		return result;
+	}
+
+	Byte* WriteVarint(u_int32_t value, Byte* target) {
+		while (value >= 0x80) {
+			*target++ = (Byte)(value | 0x80);
+			value >>= 7;
+		}
+		*target++ = (Byte)value;
+		return target;
+	}
+
+	bool TryReadVarint(const Byte*& source, const Byte* end, u_int32_t& value) {
+		value = 0;
+		for (unsigned int shift = 0; shift < maxVarintSize * 7; shift += 7) {
+			if (source == end)
+				return false;
+			Byte b = *source++;
+			value |= (u_int32_t)(b & 0x7f) << shift;
+			if ((b & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	u_int32_t SharedPrefixLength(const DBT* previous, const DBT* current) {
+		if (previous == nullptr || previous->data == nullptr)
+			return 0;
+		u_int32_t length = previous->size < current->size ? previous->size : current->size;
+		const Byte* a = (const Byte*)previous->data;
+		const Byte* b = (const Byte*)current->data;
+		u_int32_t result = 0;
+		while (result < length && a[result] == b[result])
+			result++;
+		return result;
+	}
+
+	u_int32_t EntrySize(u_int32_t prefix, u_int32_t size) {
+		u_int32_t suffix = size - prefix;
+		return VarintSize(prefix) + VarintSize(suffix) + suffix;
+	}
+
+	Byte* WriteEntry(const DBT* source, u_int32_t prefix, Byte* target) {
+		u_int32_t suffix = source->size - prefix;
+		target = WriteVarint(prefix, target);
+		target = WriteVarint(suffix, target);
+		memcpy(target, (const Byte*)source->data + prefix, suffix);
+		return target + suffix;
+	}
+
+	bool TryReadEntry(const Byte*& source, const Byte* end, const DBT* previous, u_int32_t& prefix, u_int32_t& suffix, const Byte*& suffixData) {
+		if (!TryReadVarint(source, end, prefix) || !TryReadVarint(source, end, suffix))
+			return false;
+		if (prefix > 0 && (previous == nullptr || prefix > previous->size))
+			return false;
+		if ((u_int32_t)(end - source) < suffix)
+			return false;
+		suffixData = source;
+		source += suffix;
+		return true;
+	}
+
+	void CopyEntry(DBT* target, const DBT* previous, u_int32_t prefix, u_int32_t suffix, const Byte* suffixData) {
+		Byte* data = (Byte*)target->data;
+		if (prefix > 0)
+			memmove(data, previous->data, prefix);
+		memcpy(data + prefix, suffixData, suffix);
+	}
+}
+
+int NativePrefixDeltaCompress(DB* db, const DBT* prevKey, const DBT* prevValue, const DBT* key, const DBT* value, DBT* dest) {
+	u_int32_t keyPrefix = SharedPrefixLength(prevKey, key);
+	u_int32_t valuePrefix = SharedPrefixLength(prevValue, value);
+	dest->size = EntrySize(keyPrefix, key->size) + EntrySize(valuePrefix, value->size);
+	if (dest->size > dest->ulen)
+		return DB_BUFFER_SMALL;
+	Byte* target = (Byte*)dest->data;
+	target = WriteEntry(key, keyPrefix, target);
+	WriteEntry(value, valuePrefix, target);
+	return 0;
+}
+
+int NativePrefixDeltaDecompress(DB* db, const DBT* prevKey, const DBT* prevValue, DBT* compressed, DBT* destKey, DBT* destValue) {
+	const Byte* start = (const Byte*)compressed->data;
+	const Byte* source = start;
+	const Byte* end = start + compressed->size;
+	u_int32_t keyPrefix, keySuffix, valuePrefix, valueSuffix;
+	const Byte* keySuffixData;
+	const Byte* valueSuffixData;
+	if (!TryReadEntry(source, end, prevKey, keyPrefix, keySuffix, keySuffixData))
+		return EINVAL;
+	if (!TryReadEntry(source, end, prevValue, valuePrefix, valueSuffix, valueSuffixData))
+		return EINVAL;
+	destKey->size = keyPrefix + keySuffix;
+	destValue->size = valuePrefix + valueSuffix;
+	if (destKey->size > destKey->ulen || destValue->size > destValue->ulen)
+		return DB_BUFFER_SMALL;
+	CopyEntry(destKey, prevKey, keyPrefix, keySuffix, keySuffixData);
+	CopyEntry(destValue, prevValue, valuePrefix, valueSuffix, valueSuffixData);
+	compressed->size = (u_int32_t)(source - start);
+	return 0;
+}
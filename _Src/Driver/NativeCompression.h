@@ -0,0 +1,9 @@
+#pragma once
+
+#include "db.h"
+
+//prefix-delta btree compressor, entry layout is
+//[shared key prefix][key suffix length][key suffix][shared value prefix][value suffix length][value suffix],
+//all lengths are 7-bit varints, prefixes are shared with previous key/value on the page
+int NativePrefixDeltaCompress(DB* db, const DBT* prevKey, const DBT* prevValue, const DBT* key, const DBT* value, DBT* dest);
+int NativePrefixDeltaDecompress(DB* db, const DBT* prevKey, const DBT* prevValue, DBT* compressed, DBT* destKey, DBT* destValue);
@@ -1,5 +1,7 @@
 #include "NativeCursors.h"
+#include <algorithm>
 #include <sstream>
+#include <mutex>
 
 using namespace std;
 
@@ -17,10 +19,194 @@ namespace {
 	bool EqualBytes(DBT& dbt, NativeBoundary& boundary) {
 		return dbt.size == boundary.length_ && memcmp(dbt.data, boundary.data_, dbt.size) == 0;
 	}
+	//compares by 8 byte words, memcpy of a word compiles to a single unaligned load
+	bool StartsWith(const DBT& dbt, const NativeBoundary& prefix) {
+		if (dbt.size < (u_int32_t)prefix.length_)
+			return false;
+		const Byte* bytes = (const Byte*)dbt.data;
+		int i = 0;
+		for (; i + (int)sizeof(unsigned long long) <= prefix.length_; i += sizeof(unsigned long long)) {
+			unsigned long long left, right;
+			memcpy(&left, bytes + i, sizeof(left));
+			memcpy(&right, prefix.data_ + i, sizeof(right));
+			if (left != right)
+				return false;
+		}
+		for (; i < prefix.length_; i++)
+			if (bytes[i] != prefix.data_[i])
+				return false;
+		return true;
+	}
+	//[prefix, increment(prefix)) as built by SimpleBdb.Utils.Range.Prefix, holds exactly the keys starting with prefix
+	bool IsPrefixRange(const NativeRange& range) {
+		const NativeBoundary& left = range.left_;
+		const NativeBoundary& right = range.right_;
+		if (left.length_ == 0 || !left.inclusive_ || right.length_ != left.length_ || right.inclusive_)
+			return false;
+		int i = left.length_ - 1;
+		for (; i >= 0 && left.data_[i] == 0xff; i--)
+			if (right.data_[i] != 0)
+				return false;
+		return i >= 0 && right.data_[i] == left.data_[i] + 1 && memcmp(left.data_, right.data_, i) == 0;
+	}
+	int CompareBytes(const DBT& dbt, const vector<Byte>& bytes) {
+		int result = memcmp(dbt.data, &bytes[0], min(dbt.size, (u_int32_t)bytes.size()));
+		return result != 0 ? result : (int)dbt.size - (int)bytes.size();
+	}
+	//key argument is both the DB_SET_RANGE lookup key and the result
+	bool TryGetKey(DBC* dbc, vector<Byte>& key, u_int32_t flags) {
+		DBT keyDbt;
+		memset(&keyDbt, 0, sizeof(DBT));
+		keyDbt.flags = DB_DBT_REALLOC;
+		if (!key.empty()) {
+			keyDbt.data = malloc(key.size());
+			memcpy(keyDbt.data, &key[0], key.size());
+			keyDbt.size = key.size();
+		}
+		//DB_THREAD environment requires memory flag on returned DBT, even an empty one
+		Byte ignored;
+		DBT valueDbt;
+		memset(&valueDbt, 0, sizeof(DBT));
+		valueDbt.data = &ignored;
+		valueDbt.flags = DB_DBT_PARTIAL | DB_DBT_USERMEM;
+		int resultCode = dbc->get(dbc, &keyDbt, &valueDbt, flags);
+		if (resultCode == 0)
+			key.assign((Byte*)keyDbt.data, (Byte*)keyDbt.data + keyDbt.size);
+		free(keyDbt.data);
+		if (resultCode == DB_NOTFOUND)
+			return false;
+		CheckApiOk(resultCode, "cursor.get");
+		return true;
+	}
+	double KeyPosition(DB* db, vector<Byte>& key) {
+		DBT keyDbt;
+		memset(&keyDbt, 0, sizeof(DBT));
+		keyDbt.data = key.empty() ? nullptr : &key[0];
+		keyDbt.size = key.size();
+		DB_KEY_RANGE keyRange;
+		CheckApiOk(db->key_range(db, nullptr, &keyDbt, &keyRange, 0), "db.key_range");
+		return keyRange.less;
+	}
+	//8 bytes after common prefix of bounding keys are treated as big endian number to bisect on
+	unsigned long long ReadWord(const vector<Byte>& bytes, size_t offset) {
+		unsigned long long result = 0;
+		for (size_t i = 0; i < sizeof(unsigned long long); i++)
+			result = (result << 8) | (offset + i < bytes.size() ? bytes[offset + i] : 0);
+		return result;
+	}
+	void WriteWord(vector<Byte>& bytes, size_t offset, unsigned long long word) {
+		bytes.resize(offset + sizeof(unsigned long long));
+		for (size_t i = 0; i < sizeof(unsigned long long); i++)
+			bytes[offset + i] = (Byte)(word >> (56 - 8 * i));
+	}
+}
+
+void NativeKeySchema::AddField(unsigned int fixedLength, bool descending) {
+	Field field = { fixedLength, descending };
+	fields_.push_back(field);
+}
+
+unsigned int NativeKeySchema::FieldOffset(const Byte* key, unsigned int length) const {
+	unsigned int result = 0;
+	for (auto it = fields_.begin(); it != fields_.end() && result < length; it++) {
+		if (it->fixedLength_ > 0) {
+			result += it->fixedLength_;
+			continue;
+		}
+		//variable field ends with 0x00 0x01, inner zeros are escaped as 0x00 0xFF, descending fields are inverted
+		Byte escape = it->descending_ ? 0xFF : 0x00;
+		Byte escapedZero = it->descending_ ? 0x00 : 0xFF;
+		while (true) {
+			const Byte* found = (const Byte*)memchr(key + result, escape, length - result);
+			if (found == nullptr || found + 1 >= key + length)
+				return length;
+			result = (unsigned int)(found - key) + 2;
+			if (found[1] != escapedZero)
+				break;
+		}
+	}
+	return result < length ? result : length;
+}
+
+NativeDatabaseState& NativeDatabaseState::Attach(DB* db) {
+	if (db->app_private == nullptr)
+		db->app_private = new NativeDatabaseState();
+	return *Of(db);
+}
+
+void NativeDatabaseState::Release(DB* db) {
+	NativeDatabaseState* state = Of(db);
+	if (state != nullptr && state->cursorPool == nullptr && state->secondaryKey == nullptr) {
+		delete state;
+		db->app_private = nullptr;
+	}
 }
 
-NativeCursor::NativeCursor(DB* db) {
-	CheckApiOk(db->cursor(db, nullptr, &dbc_, 0), "db.cursor");
+struct NativeCursorPool::State {
+	mutex sync;
+	vector<DBC*> idle;
+};
+
+NativeCursorPool::NativeCursorPool(DB* db, unsigned int maxIdleCount) :db_(db), maxIdleCount_(maxIdleCount), state_(new State()) {
+	state_->idle.reserve(maxIdleCount);
+	NativeDatabaseState::Attach(db).cursorPool = this;
+}
+
+NativeCursorPool::~NativeCursorPool() {
+	Clear();
+	NativeDatabaseState::Of(db_)->cursorPool = nullptr;
+	NativeDatabaseState::Release(db_);
+	delete state_;
+}
+
+DBC* NativeCursorPool::Borrow() {
+	{
+		lock_guard<mutex> lock(state_->sync);
+		if (!state_->idle.empty()) {
+			DBC* result = state_->idle.back();
+			state_->idle.pop_back();
+			return result;
+		}
+	}
+	DBC* result;
+	CheckApiOk(db_->cursor(db_, nullptr, &result, 0), "db.cursor");
+	return result;
+}
+
+int NativeCursorPool::Return(DBC* dbc) {
+	{
+		lock_guard<mutex> lock(state_->sync);
+		if (state_->idle.size() < maxIdleCount_) {
+			state_->idle.push_back(dbc);
+			return 0;
+		}
+	}
+	return dbc->close(dbc);
+}
+
+int NativeCursorPool::Clear() {
+	vector<DBC*> idle;
+	{
+		lock_guard<mutex> lock(state_->sync);
+		idle.swap(state_->idle);
+	}
+	int result = 0;
+	for (auto it = idle.begin(); it != idle.end(); it++) {
+		int resultCode = (*it)->close(*it);
+		if (result == 0)
+			result = resultCode;
+	}
+	return result;
+}
+
+NativeCursor::NativeCursor(DB* db) :primaryKeyDbt_(nullptr), db_(db), pool_(NativeCursorPool::Of(db)) {
+	u_int32_t flags;
+	CheckApiOk(db->get_flags(db, &flags), "db.get_flags");
+	hasDuplicates_ = (flags & (DB_DUP | DB_DUPSORT)) != 0;
+	if (pool_ != nullptr)
+		dbc_ = pool_->Borrow();
+	else
+		CheckApiOk(db->cursor(db, nullptr, &dbc_, 0), "db.cursor");
 	memset(&keyDbt_, 0, sizeof(DBT));
 	keyDbt_.flags = DB_DBT_USERMEM;
 	memset(&valueDbt_, 0, sizeof(DBT));
@@ -28,11 +214,42 @@ NativeCursor::NativeCursor(DB* db) {
 }
 
 NativeCursor::~NativeCursor() {
-	CheckApiOk(dbc_->close(dbc_), "db.cursor");
+	if (pool_ != nullptr)
+		CheckApiOk(pool_->Return(dbc_), "cursor.close");
+	else
+		CheckApiOk(dbc_->close(dbc_), "db.cursor");
+}
+
+void NativeCursor::Count(u_int32_t flags, int resultCode, unsigned int copiedSize) {
+	switch (flags & DB_OPFLAGS_MASK) {
+	case DB_CURRENT:
+	case DB_GET_RECNO:
+		return;
+	case DB_NEXT:
+	case DB_PREV:
+	case DB_NEXT_DUP:
+	case DB_NEXT_NODUP:
+	case DB_PREV_DUP:
+	case DB_PREV_NODUP:
+		counters_.steps++;
+		break;
+	default:
+		counters_.seeks++;
+	}
+	if (resultCode == 0)
+		counters_.bytesCopied += copiedSize;
 }
 
 int NativeCursor::Get(u_int32_t flags) {
-	int resultCode = dbc_->get(dbc_, &keyDbt_, &valueDbt_, flags);
+	int resultCode;
+	if (primaryKeyDbt_ == nullptr) {
+		resultCode = dbc_->get(dbc_, &keyDbt_, &valueDbt_, flags);
+		Count(flags, resultCode, keyDbt_.size + valueDbt_.size);
+	}
+	else {
+		resultCode = dbc_->pget(dbc_, &keyDbt_, primaryKeyDbt_, &valueDbt_, flags);
+		Count(flags, resultCode, keyDbt_.size + primaryKeyDbt_->size + valueDbt_.size);
+	}
 	if (resultCode == DB_BUFFER_SMALL)
 		throw NativeBufferSmallException(keyDbt_.size, valueDbt_.size);
 	return resultCode;
@@ -55,14 +272,55 @@ int NativeCursor::GetCurrentRecordNumber() {
 	return LittleEndianBytesToInt32((Byte *)valueDbt_.data);
 }
 
-bool NativeCursor::TryMoveTo(Byte* key, int length) {
+void NativeCursor::SetKey(Byte* key, int length) {
 	if (length > keyDbt_.ulen)
 		throw NativeBufferSmallException(length, valueDbt_.ulen);
 	keyDbt_.size = length;
 	memcpy(keyDbt_.data, key, length);
+}
+
+bool NativeCursor::TryMoveTo(Byte* key, int length) {
+	SetKey(key, length);
 	return TryMove(DB_SET_RANGE, "cursor.get.DB_SET_RANGE");
 }
 
+bool NativeCursor::TryMoveToExact(Byte* key, int length) {
+	SetKey(key, length);
+	return TryMove(DB_SET, "cursor.get.DB_SET");
+}
+
+bool NativeCursor::TryMoveNextDuplicate() {
+	return TryMove(DB_NEXT_DUP, "cursor.get.DB_NEXT_DUP");
+}
+
+bool NativeCursor::TryMoveNextKey() {
+	return hasDuplicates_ ? TryMove(DB_NEXT_NODUP, "cursor.get.DB_NEXT_NODUP") : TryMoveNext();
+}
+
+bool NativeCursor::TryMoveToLastDuplicate() {
+	if (!hasDuplicates_)
+		return true;
+	return TryMove(DB_NEXT_NODUP, "cursor.get.DB_NEXT_NODUP") ? TryMovePrev() : TryMoveLast();
+}
+
+unsigned int NativeCursor::CountDuplicates() {
+	db_recno_t result;
+	CheckApiOk(dbc_->count(dbc_, &result, 0), "cursor.count");
+	return result;
+}
+
+int NativeCursor::GetMultiple(u_int32_t flags, DBT& bulkDbt) {
+	int resultCode = dbc_->get(dbc_, &keyDbt_, &bulkDbt, flags | DB_MULTIPLE);
+	Count(flags, resultCode, bulkDbt.size);
+	return resultCode;
+}
+
+unsigned int NativeCursor::PageSize() {
+	u_int32_t result;
+	CheckApiOk(db_->get_pagesize(db_, &result), "db.get_pagesize");
+	return result;
+}
+
 bool NativeCursor::TryMoveTo(int recordNumber) {
 	Int32ToLittleEndianBytes(recordNumber, (Byte *)keyDbt_.data);
 	keyDbt_.size = sizeof(int);
@@ -89,10 +347,15 @@ bool NativeCursor::TryMoveBy(int offset) {
 	return TryMoveTo(GetCurrentRecordNumber() + offset);
 }
 
-NativeRangeCursor::NativeRangeCursor(DB* db, NativeRange& range) :range_(std::move(range)), NativeCursor(db) {
+NativeRangeCursor::NativeRangeCursor(DB* db, NativeRange&& range, bool exactKey)
+	:NativeCursor(db), range_(std::move(range)), exactKey_(exactKey), prefix_(!exactKey && IsPrefixRange(range_)) {
 }
 
 bool NativeRangeCursor::Within(NativeBoundary& boundary, int direction) {
+	if (exactKey_)
+		return EqualBytes(keyDbt_, boundary);
+	if (prefix_)
+		return StartsWith(keyDbt_, range_.left_);
 	if (boundary.length_ == 0)
 		return true;
 	int result = memcmp(keyDbt_.data, boundary.data_, min(keyDbt_.size, (u_int32_t)boundary.length_));
@@ -106,13 +369,13 @@ bool NativeRangeCursor::TryMoveToLeftBoundary() {
 		return TryMoveFirst();
 	if (!TryMoveTo(range_.left_.data_, range_.left_.length_))
 		return false;
-	return !range_.left_.inclusive_ && EqualBytes(keyDbt_, range_.left_) ? TryMoveNext() : true;
+	return !range_.left_.inclusive_ && EqualBytes(keyDbt_, range_.left_) ? TryMoveNextKey() : true;
 }
 
 bool NativeRangeCursor::TryMoveToRightBoundary() {
 	if (range_.right_.length_ == 0 || !TryMoveTo(range_.right_.data_, range_.right_.length_))
 		return TryMoveLast();
-	return range_.right_.inclusive_ && EqualBytes(keyDbt_, range_.right_) ? true : TryMovePrev();
+	return range_.right_.inclusive_ && EqualBytes(keyDbt_, range_.right_) ? TryMoveToLastDuplicate() : TryMovePrev();
 }
 
 bool NativeRangeCursor::WithinLeft() {
@@ -124,8 +387,13 @@ bool NativeRangeCursor::WithinRight() {
 }
 
 NativeRangeCursorReader::NativeRangeCursorReader(DB* db, Byte* leftBytes, int leftLength, bool leftInclusive, Byte* rightBytes, int rightLength, bool rightInclusive, int direction, int skip, int take)
-	: direction_(direction), skip_(skip), take_(take), readRecordsCount_(0), state_(NotStarted),
-	NativeRangeCursor(db, NativeRange(NativeBoundary(leftLength, leftBytes, leftInclusive), NativeBoundary(rightLength, rightBytes, rightInclusive))) {
+	: direction_(direction), skip_(skip), take_(take), readRecordsCount_(0), mergeIndex_(0), state_(NotStarted),
+	NativeRangeCursor(db, NativeRange(NativeBoundary(leftLength, leftBytes, leftInclusive), NativeBoundary(rightLength, rightBytes, rightInclusive)), false) {
+}
+
+NativeRangeCursorReader::NativeRangeCursorReader(DB* db, Byte* key, int keyLength, int direction)
+	: direction_(direction), skip_(0), take_(-1), readRecordsCount_(0), mergeIndex_(0), state_(NotStarted),
+	NativeRangeCursor(db, NativeRange(NativeBoundary(keyLength, key, true), NativeBoundary(keyLength, key, true)), true) {
 }
 
 bool NativeRangeCursorReader::Read(unsigned int& keyLength, unsigned int& valueLength) {
@@ -197,6 +465,8 @@ unsigned int NativeRangeCursorReader::GetTotalCount() {
 }
 
 bool NativeRangeCursorReader::DoTryMoveFirst() {
+	if (direction_ > 0 && !partitionFrom_.empty())
+		return TryMoveTo(&partitionFrom_[0], partitionFrom_.size());
 	return direction_ > 0 ? TryMoveToLeftBoundary() : TryMoveToRightBoundary();
 }
 
@@ -209,22 +479,154 @@ bool NativeRangeCursorReader::DoTryMoveBy(int offset) {
 }
 
 bool NativeRangeCursorReader::DoWithin() {
+	if (direction_ > 0 && !partitionTo_.empty() && CompareBytes(keyDbt_, partitionTo_) >= 0)
+		return false;
 	return direction_ > 0 ? WithinRight() : WithinLeft();
 }
 
-NativeCursorSuffixComparer::NativeCursorSuffixComparer(unsigned int keySuffixOffset, int direction)
-	:keySuffixOffset_(keySuffixOffset), direction_(direction) {
+void NativeRangeCursorReader::LimitTo(const vector<Byte>& from, const vector<Byte>& to) {
+	if (direction_ < 0)
+		throw NativeBdbException("partition limits are supported by ascending readers only");
+	partitionFrom_ = from;
+	partitionTo_ = to;
 }
 
+//bisection runs between the first and the last keys of the range, so common prefix of keys doesn't degrade it
+vector<vector<Byte>> NativeSplitRange(DB* db, const vector<Byte>& left, const vector<Byte>& right, unsigned int partitionsCount) {
+	vector<vector<Byte>> result;
+	vector<Byte> first(left);
+	vector<Byte> last(right);
+	DBC* dbc;
+	CheckApiOk(db->cursor(db, nullptr, &dbc, 0), "db.cursor");
+	bool found;
+	try {
+		found = TryGetKey(dbc, first, first.empty() ? DB_FIRST : DB_SET_RANGE);
+		if (found)
+			found = last.empty() ? TryGetKey(dbc, last, DB_LAST) : TryGetKey(dbc, last, DB_SET_RANGE) ? TryGetKey(dbc, last, DB_PREV) : TryGetKey(dbc, last, DB_LAST);
+	}
+	catch (...) {
+		dbc->close(dbc);
+		throw;
+	}
+	CheckApiOk(dbc->close(dbc), "cursor.close");
+	if (!found)
+		return result;
+	size_t prefixLength = 0;
+	while (prefixLength < first.size() && prefixLength < last.size() && first[prefixLength] == last[prefixLength])
+		prefixLength++;
+	unsigned long long low = ReadWord(first, prefixLength);
+	unsigned long long high = ReadWord(last, prefixLength);
+	if (high <= low + 1)
+		return result;
+	double lowPosition = KeyPosition(db, first);
+	double highPosition = KeyPosition(db, last);
+	vector<Byte> candidate(first.begin(), first.begin() + prefixLength);
+	unsigned long long previous = low;
+	for (unsigned int i = 1; i < partitionsCount; i++) {
+		double target = lowPosition + (highPosition - lowPosition) * i / partitionsCount;
+		unsigned long long from = previous;
+		unsigned long long to = high;
+		while (to - from > 1) {
+			unsigned long long middle = from + (to - from) / 2;
+			WriteWord(candidate, prefixLength, middle);
+			if (KeyPosition(db, candidate) < target)
+				from = middle;
+			else
+				to = middle;
+		}
+		if (to >= high)
+			break;
+		WriteWord(candidate, prefixLength, to);
+		result.push_back(candidate);
+		previous = to;
+	}
+	return result;
+}
+
+namespace {
+	const unsigned int sampleBufferSize = 64 * 1024;
+
+	//reads one bulk buffer of records starting at key, empty key means the first record
+	void SampleRecordSizes(DBC* dbc, const vector<Byte>& key, vector<Byte>& buffer, vector<unsigned int>& keySizes, vector<unsigned int>& valueSizes) {
+		DBT keyDbt;
+		memset(&keyDbt, 0, sizeof(DBT));
+		keyDbt.flags = DB_DBT_REALLOC;
+		if (!key.empty()) {
+			keyDbt.data = malloc(key.size());
+			memcpy(keyDbt.data, &key[0], key.size());
+			keyDbt.size = key.size();
+		}
+		u_int32_t flags = (key.empty() ? DB_FIRST : DB_SET_RANGE) | DB_MULTIPLE_KEY;
+		DBT bulkDbt;
+		int resultCode;
+		for (;;) {
+			memset(&bulkDbt, 0, sizeof(DBT));
+			bulkDbt.data = &buffer[0];
+			bulkDbt.ulen = buffer.size();
+			bulkDbt.flags = DB_DBT_USERMEM;
+			resultCode = dbc->get(dbc, &keyDbt, &bulkDbt, flags);
+			if (resultCode != DB_BUFFER_SMALL)
+				break;
+			buffer.resize((bulkDbt.size + 1023) / 1024 * 1024);
+		}
+		free(keyDbt.data);
+		if (resultCode == DB_NOTFOUND)
+			return;
+		CheckApiOk(resultCode, "cursor.get.DB_MULTIPLE_KEY");
+		void* position;
+		DB_MULTIPLE_INIT(position, &bulkDbt);
+		for (;;) {
+			//only sizes are sampled, both data pointers go to one scratch variable which is null after the last record
+			void* record;
+			u_int32_t keyLength, valueLength;
+			DB_MULTIPLE_KEY_NEXT(position, &bulkDbt, record, keyLength, record, valueLength);
+			if (record == nullptr)
+				break;
+			keySizes.push_back(keyLength);
+			valueSizes.push_back(valueLength);
+		}
+	}
+}
+
+void NativeSampleRecordSizes(DB* db, unsigned int samplesCount, vector<unsigned int>& keySizes, vector<unsigned int>& valueSizes) {
+	vector<vector<Byte>> starts(1);
+	vector<vector<Byte>> splits = NativeSplitRange(db, vector<Byte>(), vector<Byte>(), samplesCount);
+	starts.insert(starts.end(), splits.begin(), splits.end());
+	vector<Byte> buffer(sampleBufferSize);
+	DBC* dbc;
+	CheckApiOk(db->cursor(db, nullptr, &dbc, 0), "db.cursor");
+	try {
+		for (auto it = starts.begin(); it != starts.end(); it++)
+			SampleRecordSizes(dbc, *it, buffer, keySizes, valueSizes);
+	}
+	catch (...) {
+		dbc->close(dbc);
+		throw;
+	}
+	CheckApiOk(dbc->close(dbc), "cursor.close");
+}
+
+NativeCursorSuffixComparer::NativeCursorSuffixComparer(unsigned int keySuffixOffset, const NativeKeySchema& keySchema, bool byValue, int direction)
+	:keySuffixOffset_(keySuffixOffset), keySchema_(keySchema), byValue_(byValue), direction_(direction) {
+}
+
+//top of the heap is the next record, equal suffixes are taken in readers order
 bool NativeCursorSuffixComparer::operator()(const NativeRangeCursorReader* a, const NativeRangeCursorReader* b) const {
-	return direction_ > 0 ? Compare(a, b) > 0 : Compare(a, b) < 0;
+	int result = Compare(a, b);
+	if (result == 0)
+		return a->mergeIndex_ > b->mergeIndex_;
+	return direction_ > 0 ? result > 0 : result < 0;
 }
 
 int NativeCursorSuffixComparer::Compare(const NativeRangeCursorReader* a, const NativeRangeCursorReader* b) const {
-	unsigned int aLength = a->keyDbt_.size <= keySuffixOffset_ ? 0 : a->keyDbt_.size - keySuffixOffset_;
-	unsigned int bLength = b->keyDbt_.size <= keySuffixOffset_ ? 0 : b->keyDbt_.size - keySuffixOffset_;
-	const Byte* aBytes = (Byte*)a->keyDbt_.data + keySuffixOffset_;
-	const Byte* bBytes = (Byte*)b->keyDbt_.data + keySuffixOffset_;
+	const DBT& aDbt = Compared(a);
+	const DBT& bDbt = Compared(b);
+	unsigned int aOffset = SuffixOffset(aDbt);
+	unsigned int bOffset = SuffixOffset(bDbt);
+	unsigned int aLength = aDbt.size <= aOffset ? 0 : aDbt.size - aOffset;
+	unsigned int bLength = bDbt.size <= bOffset ? 0 : bDbt.size - bOffset;
+	const Byte* aBytes = (Byte*)aDbt.data + aOffset;
+	const Byte* bBytes = (Byte*)bDbt.data + bOffset;
 	if (aLength == bLength)
 		return CompareBytes(aBytes, bBytes, aLength);
 	if (aLength < bLength) {
@@ -235,20 +637,27 @@ int NativeCursorSuffixComparer::Compare(const NativeRangeCursorReader* a, const
 	return result != 0 ? result : 1;
 }
 
+const DBT& NativeCursorSuffixComparer::Compared(const NativeRangeCursorReader* reader) const {
+	return byValue_ ? reader->valueDbt_ : reader->keyDbt_;
+}
+
+unsigned int NativeCursorSuffixComparer::SuffixOffset(const DBT& key) const {
+	return keySchema_.IsEmpty() ? keySuffixOffset_ : keySchema_.FieldOffset((const Byte*)key.data, key.size);
+}
+
 int NativeCursorSuffixComparer::CompareBytes(const Byte* a, const Byte* b, unsigned int count) const {
 	return count == 0 ? 0 : memcmp(a, b, count);
 }
 
 template <typename TReader>
 NativeReaderFetcher<TReader>::NativeReaderFetcher(TReader& reader, bool needKeys, bool needValues, unsigned int take)
-	:reader_(reader), needKeys_(needKeys), needValues_(needValues), storeIndex_(0), positionsIndex_(0), recordsFetched_(0), take_(take) {
+	:needKeys_(needKeys), needValues_(needValues), take_(take), reader_(reader), storeIndex_(0), recordsFetched_(0), cancellation_(nullptr) {
 }
 
 template <typename TReader>
 unsigned int NativeReaderFetcher<TReader>::FetchInto(Byte* store, unsigned int* positions) {
 	store_ = store;
 	positions_ = positions;
-	unsigned int positionsIncrement = needKeys_ && needValues_ ? 4 : 2;
 	unsigned int storeIncrement = 0;
 	if (needKeys_)
 		storeIncrement += reader_.keyDbt_.ulen;
@@ -256,37 +665,55 @@ unsigned int NativeReaderFetcher<TReader>::FetchInto(Byte* store, unsigned int*
 		storeIncrement += reader_.valueDbt_.ulen;
 	unsigned int keyLength, valueLength;
 	while (recordsFetched_ < take_) {
+		if (cancellation_ != nullptr && cancellation_->IsCancelled())
+			return CompactColumns();
 		if (needKeys_)
 			SetStart(reader_.keyDbt_, false);
 		if (needValues_)
 			SetStart(reader_.valueDbt_, needKeys_);
 		if (!reader_.Read(keyLength, valueLength))
-			return recordsFetched_;
+			return CompactColumns();
 		if (needKeys_)
 			SetSize(false, keyLength);
 		if (needValues_)
 			SetSize(needKeys_, valueLength);
-		positionsIndex_ += positionsIncrement;
 		storeIndex_ += storeIncrement;
 		recordsFetched_++;
 	}
-	return recordsFetched_;
+	return CompactColumns();
+}
+
+//columns are stored one after another, value column starts after take_ key positions until fetch is complete
+template <typename TReader>
+unsigned int NativeReaderFetcher<TReader>::PositionIndex(bool shifted) {
+	return ((shifted ? take_ : 0) + recordsFetched_) * 2;
 }
 
 template <typename TReader>
 void NativeReaderFetcher<TReader>::SetStart(DBT& source, bool shifted) {
 	unsigned int storeIndex = storeIndex_ + (shifted ? reader_.keyDbt_.ulen : 0);
 	source.data = &store_[storeIndex];
-	positions_[positionsIndex_ + (shifted ? 2 : 0)] = storeIndex;
+	positions_[PositionIndex(shifted)] = storeIndex;
 }
 
 template <typename TReader>
 void NativeReaderFetcher<TReader>::SetSize(bool shifted, unsigned int size) {
-	positions_[positionsIndex_ + 1 + (shifted ? 2 : 0)] = size;
+	positions_[PositionIndex(shifted) + 1] = size;
 }
 
-NativeSuffixMergingRangeCursorReader::NativeSuffixMergingRangeCursorReader(unsigned int keySuffixOffset, bool needKeys, bool needValues, NativeRangeCursorReader** readers, unsigned int readersCount, int direction)
-	:needKeys_(needKeys), needValues_(needValues), startedReadersCount_(0), lastReader_(nullptr), readers_(readers), readersCount_(readersCount), ReadersHeap(NativeCursorSuffixComparer(keySuffixOffset, direction)) {
+//moves value column right after the filled part of key column, so column i of the result starts at i * rows
+template <typename TReader>
+unsigned int NativeReaderFetcher<TReader>::CompactColumns() {
+	if (needKeys_ && needValues_ && recordsFetched_ < take_)
+		memmove(positions_ + recordsFetched_ * 2, positions_ + take_ * 2, recordsFetched_ * 2 * sizeof(unsigned int));
+	return recordsFetched_;
+}
+
+NativeSuffixMergingRangeCursorReader::NativeSuffixMergingRangeCursorReader(unsigned int keySuffixOffset, const NativeKeySchema& keySchema, bool byValue, bool needKeys, bool needValues, NativeRangeCursorReader** readers, unsigned int readersCount, int direction)
+	:ReadersHeap(NativeCursorSuffixComparer(keySuffixOffset, keySchema, byValue, direction)), needKeys_(needKeys), needValues_(needValues), startedReadersCount_(0), lastReader_(nullptr),
+	readers_(readers), readersCount_(readersCount), keyBuffer_(nullptr), keyChunkSize_(0), valueBuffer_(nullptr), valueChunkSize_(0), skip_(0) {
+	for (unsigned int i = 0; i < readersCount_; i++)
+		readers_[i]->mergeIndex_ = i;
 }
 
 NativeSuffixMergingRangeCursorReader::~NativeSuffixMergingRangeCursorReader() {
@@ -295,8 +722,8 @@ NativeSuffixMergingRangeCursorReader::~NativeSuffixMergingRangeCursorReader() {
 	delete[] readers_;
 	if (lastReader_ != nullptr)
 		delete lastReader_;
-	for each (NativeRangeCursorReader* reader in c)
-		delete reader;
+	for (auto it = c.begin(); it != c.end(); it++)
+		delete *it;
 }
 
 void NativeSuffixMergingRangeCursorReader::CopyDbt(DBT& target, DBT& source, unsigned int& length) {
@@ -305,6 +732,11 @@ void NativeSuffixMergingRangeCursorReader::CopyDbt(DBT& target, DBT& source, uns
 }
 
 bool NativeSuffixMergingRangeCursorReader::Read(unsigned int& keyLength, unsigned int& valueLength) {
+	//selection may throw buffer small, it's repeated from scratch after buffers grow
+	if (skip_ > 0 && startedReadersCount_ == 0) {
+		SelectReadersSkips();
+		skip_ = 0;
+	}
 	if (startedReadersCount_ < readersCount_)
 		for (int i = startedReadersCount_; i < readersCount_; i++) {
 			TryPush(readers_[i]);
@@ -336,43 +768,371 @@ void NativeSuffixMergingRangeCursorReader::TryPush(NativeRangeCursorReader* read
 	unsigned int keyLength, valueLength;
 	if (reader->Read(keyLength, valueLength))
 		push(reader);
-	else
+	else {
+		finishedCounters_.Add(reader->Counters());
 		delete reader;
+	}
+}
+
+NativeReadCounters NativeSuffixMergingRangeCursorReader::Counters() const {
+	NativeReadCounters result = finishedCounters_;
+	for (int i = startedReadersCount_; i < readersCount_; i++)
+		result.Add(readers_[i]->Counters());
+	for (auto it = c.begin(); it != c.end(); it++)
+		result.Add((*it)->Counters());
+	if (lastReader_ != nullptr)
+		result.Add(lastReader_->Counters());
+	return result;
+}
+
+void NativeSuffixMergingRangeCursorReader::ReadSuffix(unsigned int readerIndex, int firstRecordNumber, unsigned int count, unsigned int position, vector<Byte>& suffix) {
+	NativeRangeCursorReader* reader = readers_[readerIndex];
+	unsigned int rank = reader->direction_ > 0 ? position : count - 1 - position;
+	if (!reader->TryMoveTo(firstRecordNumber + static_cast<int>(rank))) {
+		stringstream ss;
+		ss << "can't move cursor to record number [" << firstRecordNumber + rank << "]";
+		throw NativeBdbException(ss.str());
+	}
+	const Byte* key = static_cast<const Byte*>(reader->keyDbt_.data);
+	unsigned int offset = min(comp.SuffixOffset(reader->keyDbt_), reader->keyDbt_.size);
+	suffix.assign(key + offset, key + reader->keyDbt_.size);
+}
+
+//records of the range with suffix less than (or equal to) suffix, in ascending key order
+unsigned int NativeSuffixMergingRangeCursorReader::CountBelow(unsigned int readerIndex, int firstRecordNumber, unsigned int count,
+	const vector<Byte>& prefix, const vector<Byte>& suffix, bool inclusive) {
+	NativeRangeCursorReader* reader = readers_[readerIndex];
+	vector<Byte> key(prefix);
+	key.insert(key.end(), suffix.begin(), suffix.end());
+	if (!reader->TryMoveTo(key.data(), static_cast<int>(key.size())))
+		return count;
+	bool equal = reader->keyDbt_.size == key.size() && (key.empty() || memcmp(reader->keyDbt_.data, key.data(), key.size()) == 0);
+	int result = reader->GetCurrentRecordNumber() - firstRecordNumber;
+	if (result < 0)
+		return 0;
+	if (static_cast<unsigned int>(result) >= count)
+		return count;
+	return static_cast<unsigned int>(result) + (inclusive && equal ? 1 : 0);
+}
+
+namespace {
+	struct SkipCandidate {
+		unsigned int readerIndex;
+		unsigned int position;
+		vector<Byte> suffix;
+	};
 }
 
-template<typename Iter>
-static void ConnectChildrenDbtsTo(Iter first, Iter last, Byte*& keyPtr, unsigned int keyLength, Byte*& valuePtr, unsigned int valueLength) {
-	for (Iter it = first; it != last; it++)
-		ConnectDbts(*it, keyPtr, keyLength, valuePtr, valueLength);
+//order statistic selection: records of the merge are ordered by (suffix, reader index), reader i has to skip
+//its records before the skip_-th one, which lie within [low[i], high[i]]. Each step takes the middle record of every
+//window, pivots on their weighted median and counts records before the pivot in every range by DB_SET_RANGE
+//to prefix + suffix and record numbers. A quarter of all windows is dropped per step, so the cost is
+//O(readers * log(records)) seeks instead of reading skip_ records
+void NativeSuffixMergingRangeCursorReader::SelectReadersSkips() {
+	if (readersCount_ == 0)
+		return;
+	vector<int> firsts(readersCount_, 0);
+	vector<unsigned int> counts(readersCount_, 0);
+	vector<vector<Byte>> prefixes(readersCount_);
+	unsigned long long totalCount = 0;
+	for (unsigned int i = 0; i < readersCount_; i++) {
+		NativeRangeCursorReader* reader = readers_[i];
+		if (!reader->TryMoveToLeftBoundary())
+			continue;
+		const Byte* key = static_cast<const Byte*>(reader->keyDbt_.data);
+		prefixes[i].assign(key, key + min(comp.SuffixOffset(reader->keyDbt_), reader->keyDbt_.size));
+		firsts[i] = reader->GetCurrentRecordNumber();
+		if (!reader->TryMoveToRightBoundary())
+			continue;
+		int count = reader->GetCurrentRecordNumber() - firsts[i] + 1;
+		counts[i] = count < 0 ? 0 : count;
+		totalCount += counts[i];
+	}
+	int direction = readers_[0]->direction_;
+	vector<unsigned int> low(readersCount_, 0);
+	vector<unsigned int> high(counts);
+	vector<unsigned int> before(readersCount_);
+	if (skip_ >= totalCount)
+		low = counts;
+	else
+		for (;;) {
+			vector<SkipCandidate> candidates;
+			unsigned long long windowsCount = 0;
+			for (unsigned int i = 0; i < readersCount_; i++)
+				if (low[i] < high[i]) {
+					SkipCandidate candidate;
+					candidate.readerIndex = i;
+					candidate.position = (low[i] + high[i]) / 2;
+					ReadSuffix(i, firsts[i], counts[i], candidate.position, candidate.suffix);
+					candidates.push_back(candidate);
+					windowsCount += high[i] - low[i];
+				}
+			if (candidates.empty())
+				break;
+			sort(candidates.begin(), candidates.end(), [direction](const SkipCandidate& a, const SkipCandidate& b) {
+				if (a.suffix != b.suffix)
+					return direction > 0 ? a.suffix < b.suffix : b.suffix < a.suffix;
+				return a.readerIndex < b.readerIndex;
+			});
+			const SkipCandidate* pivot = nullptr;
+			unsigned long long accumulated = 0;
+			for (auto it = candidates.begin(); pivot == nullptr; it++) {
+				accumulated += high[it->readerIndex] - low[it->readerIndex];
+				if (accumulated * 2 >= windowsCount)
+					pivot = &*it;
+			}
+			unsigned long long beforeCount = 0;
+			for (unsigned int i = 0; i < readersCount_; i++) {
+				if (i == pivot->readerIndex)
+					before[i] = pivot->position;
+				else if (counts[i] == 0)
+					before[i] = 0;
+				else {
+					//ties go to the reader with lower index
+					bool inclusive = (i < pivot->readerIndex) == (direction > 0);
+					unsigned int below = CountBelow(i, firsts[i], counts[i], prefixes[i], pivot->suffix, inclusive);
+					before[i] = direction > 0 ? below : counts[i] - below;
+				}
+				beforeCount += before[i];
+			}
+			if (beforeCount == skip_) {
+				low = before;
+				break;
+			}
+			for (unsigned int i = 0; i < readersCount_; i++)
+				if (beforeCount < skip_)
+					low[i] = max(low[i], i == pivot->readerIndex ? before[i] + 1 : before[i]);
+				else
+					high[i] = min(high[i], before[i]);
+		}
+	for (unsigned int i = 0; i < readersCount_; i++)
+		if (low[i] >= counts[i])
+			readers_[i]->take_ = 0;
+		else
+			readers_[i]->skip_ = static_cast<int>(low[i]);
+}
+
+void NativeGrowChunks(vector<Byte>& buffer, unsigned int chunksCount, unsigned int chunkSize, unsigned int newChunkSize) {
+	if (newChunkSize <= chunkSize)
+		return;
+	bool filled = buffer.size() >= chunksCount * chunkSize;
+	buffer.resize(chunksCount * newChunkSize);
+	if (filled)
+		for (unsigned int i = chunksCount; i-- > 1;)
+			memmove(&buffer[i * newChunkSize], &buffer[i * chunkSize], chunkSize);
 }
 
-template<typename Iter>
-static void LoadCurrent(Iter first, Iter last) {
-	for (Iter it = first; it != last; it++)
-		(*it)->LoadCurrent();
+void NativeSuffixMergingRangeCursorReader::RebindDbt(DBT& dbt, Byte* oldBuffer, unsigned int oldLength, Byte* buffer, unsigned int length) {
+	unsigned int chunkIndex = static_cast<unsigned int>((static_cast<Byte*>(dbt.data) - oldBuffer) / oldLength);
+	dbt.data = buffer + chunkIndex * length;
+	dbt.ulen = length;
 }
 
-static void ConnectDbts(NativeRangeCursorReader* reader, Byte*& keyPtr, unsigned int keyLength, Byte*& valuePtr, unsigned int valueLength) {
-	reader->ConnectDbtsTo(keyPtr, keyLength, valuePtr, valueLength);
-	keyPtr += keyLength;
-	valuePtr += valueLength;
+void NativeSuffixMergingRangeCursorReader::Rebind(NativeRangeCursorReader* reader, Byte* keyBuffer, unsigned int keyLength, Byte* valueBuffer, unsigned int valueLength) {
+	RebindDbt(reader->keyDbt_, keyBuffer_, keyChunkSize_, keyBuffer, keyLength);
+	RebindDbt(reader->valueDbt_, valueBuffer_, valueChunkSize_, valueBuffer, valueLength);
 }
 
+//reader i owns chunk i for its whole life and the merged record takes the last chunk.
+//buffers are grown by moving every chunk to its new start (NativeGrowChunks), so heap members keep their current records
+//and are only rebound, the last reader is reloaded because its failed move may have overwritten the key
 void NativeSuffixMergingRangeCursorReader::ConnectDbtsTo(Byte* keyBuffer, unsigned int keyLength, Byte* valueBuffer, unsigned int valueLength) {
-	Byte* keyPtr = keyBuffer;
-	Byte* valuePtr = valueBuffer;
-	ConnectChildrenDbtsTo(readers_ + startedReadersCount_, readers_ + readersCount_, keyPtr, keyLength, valuePtr, valueLength);
-	ConnectChildrenDbtsTo(c.begin(), c.end(), keyPtr, keyLength, valuePtr, valueLength);
-	LoadCurrent(c.begin(), c.end());
-	if (lastReader_ != nullptr) {
-		ConnectDbts(lastReader_, keyPtr, keyLength, valuePtr, valueLength);
-		lastReader_->LoadCurrent();
-	}
-	keyDbt_.data = keyPtr;
+	if (keyBuffer_ == nullptr)
+		for (unsigned int i = 0; i < readersCount_; i++)
+			readers_[i]->ConnectDbtsTo(keyBuffer + i * keyLength, keyLength, valueBuffer + i * valueLength, valueLength);
+	else {
+		for (unsigned int i = startedReadersCount_; i < readersCount_; i++)
+			Rebind(readers_[i], keyBuffer, keyLength, valueBuffer, valueLength);
+		for (auto it = c.begin(); it != c.end(); it++)
+			Rebind(*it, keyBuffer, keyLength, valueBuffer, valueLength);
+		if (lastReader_ != nullptr) {
+			Rebind(lastReader_, keyBuffer, keyLength, valueBuffer, valueLength);
+			lastReader_->LoadCurrent();
+		}
+	}
+	keyBuffer_ = keyBuffer;
+	keyChunkSize_ = keyLength;
+	valueBuffer_ = valueBuffer;
+	valueChunkSize_ = valueLength;
+	keyDbt_.data = keyBuffer + readersCount_ * keyLength;
+	keyDbt_.ulen = keyLength;
+	valueDbt_.data = valueBuffer + readersCount_ * valueLength;
+	valueDbt_.ulen = valueLength;
+}
+
+NativeDuplicatesCursorReader::NativeDuplicatesCursorReader(DB* db, Byte* key, int keyLength, int take, unsigned int bulkBufferSize)
+	:NativeCursor(db), readRecordsCount_(0), key_(keyLength, key, true), take_(take), started_(false), finished_(false), bulk_(bulkBufferSize > 0), bulkPosition_(nullptr) {
+	memset(&bulkDbt_, 0, sizeof(DBT));
+	if (!bulk_)
+		return;
+	//bulk buffer must be a multiple of 1024 and not less than the page size
+	bulkDbt_.ulen = (max(bulkBufferSize, PageSize()) + 1023) / 1024 * 1024;
+	bulkDbt_.data = malloc(bulkDbt_.ulen);
+	if (bulkDbt_.data == nullptr)
+		throw bad_alloc();
+	bulkDbt_.flags = DB_DBT_USERMEM;
+}
+
+NativeDuplicatesCursorReader::~NativeDuplicatesCursorReader() {
+	free(bulkDbt_.data);
+}
+
+bool NativeDuplicatesCursorReader::Read(unsigned int& keyLength, unsigned int& valueLength) {
+	if (finished_)
+		return false;
+	if (take_ == 0 || (take_ > 0 && readRecordsCount_ == take_) || !(bulk_ ? TryReadBulk() : TryReadSingle())) {
+		finished_ = true;
+		return false;
+	}
+	readRecordsCount_++;
+	keyLength = keyDbt_.size;
+	valueLength = valueDbt_.size;
+	return true;
+}
+
+bool NativeDuplicatesCursorReader::TryReadSingle() {
+	bool result = started_ ? TryMoveNextDuplicate() : TryMoveToExact(key_.data_, key_.length_);
+	started_ = true;
+	return result;
+}
+
+bool NativeDuplicatesCursorReader::TryReadBulk() {
+	while (true) {
+		if (bulkPosition_ != nullptr) {
+			void* position = bulkPosition_;
+			void* data;
+			u_int32_t length;
+			DB_MULTIPLE_NEXT(position, &bulkDbt_, data, length);
+			if (data != nullptr) {
+				if (key_.length_ > keyDbt_.ulen || length > valueDbt_.ulen)
+					throw NativeBufferSmallException(key_.length_, length);
+				keyDbt_.size = key_.length_;
+				memcpy(keyDbt_.data, key_.data_, key_.length_);
+				valueDbt_.size = length;
+				memcpy(valueDbt_.data, data, length);
+				bulkPosition_ = position;
+				return true;
+			}
+		}
+		if (!TryLoadBulk(started_ ? DB_NEXT_DUP : DB_SET))
+			return false;
+		started_ = true;
+		DB_MULTIPLE_INIT(bulkPosition_, &bulkDbt_);
+	}
+}
+
+bool NativeDuplicatesCursorReader::TryLoadBulk(u_int32_t flags) {
+	if (key_.length_ > keyDbt_.ulen)
+		throw NativeBufferSmallException(key_.length_, valueDbt_.ulen);
+	keyDbt_.size = key_.length_;
+	memcpy(keyDbt_.data, key_.data_, key_.length_);
+	int resultCode = GetMultiple(flags, bulkDbt_);
+	if (resultCode == DB_BUFFER_SMALL) {
+		u_int32_t size = (bulkDbt_.size + 1023) / 1024 * 1024;
+		void* data = realloc(bulkDbt_.data, size);
+		if (data == nullptr)
+			throw bad_alloc();
+		bulkDbt_.data = data;
+		bulkDbt_.ulen = size;
+		resultCode = GetMultiple(flags, bulkDbt_);
+	}
+	if (resultCode == DB_NOTFOUND)
+		return false;
+	CheckApiOk(resultCode, flags == DB_SET ? "cursor.get.DB_SET|DB_MULTIPLE" : "cursor.get.DB_NEXT_DUP|DB_MULTIPLE");
+	return true;
+}
+
+unsigned int NativeDuplicatesCursorReader::GetTotalCount() {
+	if (started_)
+		return readRecordsCount_ == 0 ? 0 : CountDuplicates();
+	return TryMoveToExact(key_.data_, key_.length_) ? CountDuplicates() : 0;
+}
+
+void NativeDuplicatesCursorReader::ConnectDbtsTo(Byte* keyBuffer, unsigned int keyLength, Byte* valueBuffer, unsigned int valueLength) {
+	keyDbt_.data = keyBuffer;
+	keyDbt_.ulen = keyLength;
+	valueDbt_.data = valueBuffer;
+	valueDbt_.ulen = valueLength;
+}
+
+namespace {
+	const unsigned int secondaryInitialBufferSize = 256;
+
+	void ConnectDbt(DBT& dbt, vector<Byte>& buffer) {
+		dbt.data = &buffer[0];
+		dbt.ulen = static_cast<u_int32_t>(buffer.size());
+	}
+
+	void GrowBuffer(vector<Byte>& buffer, unsigned int size, bool& grown) {
+		if (size > buffer.size()) {
+			buffer.resize(size);
+			grown = true;
+		}
+	}
+}
+
+NativeSecondaryCursorReader::NativeSecondaryCursorReader(DB* secondary, Byte* leftBytes, int leftLength, bool leftInclusive, Byte* rightBytes, int rightLength, bool rightInclusive, int direction, int take)
+	:readRecordsCount_(0), reader_(secondary, leftBytes, leftLength, leftInclusive, rightBytes, rightLength, rightInclusive, direction, 0, take),
+	secondaryKey_(secondaryInitialBufferSize), primaryKey_(secondaryInitialBufferSize), value_(secondaryInitialBufferSize), pending_(false) {
+	memset(&primaryKeyDbt_, 0, sizeof(DBT));
+	primaryKeyDbt_.flags = DB_DBT_USERMEM;
+	memset(&keyDbt_, 0, sizeof(DBT));
+	memset(&valueDbt_, 0, sizeof(DBT));
+	reader_.primaryKeyDbt_ = &primaryKeyDbt_;
+}
+
+void NativeSecondaryCursorReader::ConnectReader() {
+	ConnectDbt(reader_.keyDbt_, secondaryKey_);
+	ConnectDbt(primaryKeyDbt_, primaryKey_);
+	ConnectDbt(reader_.valueDbt_, value_);
+}
+
+//bdb sets size of the small dbt to the required one, boundary longer than the key buffer is reported by the exception only
+void NativeSecondaryCursorReader::Grow(const NativeBufferSmallException& e) {
+	bool grown = false;
+	GrowBuffer(secondaryKey_, max(e.KeySize(), reader_.keyDbt_.size), grown);
+	GrowBuffer(primaryKey_, primaryKeyDbt_.size, grown);
+	GrowBuffer(value_, max(e.ValueSize(), reader_.valueDbt_.size), grown);
+	if (!grown) {
+		secondaryKey_.resize(secondaryKey_.size() * 2);
+		primaryKey_.resize(primaryKey_.size() * 2);
+		value_.resize(value_.size() * 2);
+	}
+}
+
+//buffer small of own buffers is retried in place, small connected buffers keep the record pending until the next call
+bool NativeSecondaryCursorReader::Read(unsigned int& keyLength, unsigned int& valueLength) {
+	while (!pending_) {
+		ConnectReader();
+		try {
+			unsigned int secondaryKeyLength, primaryValueLength;
+			if (!reader_.Read(secondaryKeyLength, primaryValueLength))
+				return false;
+			pending_ = true;
+		}
+		catch (const NativeBufferSmallException& e) {
+			Grow(e);
+		}
+	}
+	if (primaryKeyDbt_.size > keyDbt_.ulen || reader_.valueDbt_.size > valueDbt_.ulen)
+		throw NativeBufferSmallException(primaryKeyDbt_.size, reader_.valueDbt_.size);
+	keyLength = keyDbt_.size = primaryKeyDbt_.size;
+	memcpy(keyDbt_.data, primaryKeyDbt_.data, keyLength);
+	valueLength = valueDbt_.size = reader_.valueDbt_.size;
+	memcpy(valueDbt_.data, reader_.valueDbt_.data, valueLength);
+	pending_ = false;
+	readRecordsCount_++;
+	return true;
+}
+
+void NativeSecondaryCursorReader::ConnectDbtsTo(Byte* keyBuffer, unsigned int keyLength, Byte* valueBuffer, unsigned int valueLength) {
+	keyDbt_.data = keyBuffer;
 	keyDbt_.ulen = keyLength;
-	valueDbt_.data = valuePtr;
+	valueDbt_.data = valueBuffer;
 	valueDbt_.ulen = valueLength;
 }
 
 template class NativeReaderFetcher < NativeSuffixMergingRangeCursorReader > ;
+template class NativeReaderFetcher < NativeSecondaryCursorReader > ;
+template class NativeReaderFetcher < NativeDuplicatesCursorReader > ;
 template class NativeReaderFetcher < NativeRangeCursorReader > ;
\ No newline at end of file
@@ -1,4 +1,7 @@
+#pragma once
+
 #include "db.h"
+#include <string.h>
 #include <exception>
 #include <utility>
 #include <string>
@@ -38,6 +41,12 @@ private:
 	const std::string message_;
 };
 
+//polled by long native loops between records
+class NativeCancellation {
+public:
+	virtual bool IsCancelled() const = 0;
+};
+
 class NativeBoundary {
 public:
 	NativeBoundary() :length_(0), data_(nullptr) {
@@ -87,7 +96,84 @@ private:
 	const NativeRange& operator=(NativeRange& source);
 };
 
+//key layout written by SimpleBdb.Utils.KeyBuilder, used to locate suffix field by index
+class NativeKeySchema {
+public:
+	void AddField(unsigned int fixedLength, bool descending);
+	unsigned int FieldOffset(const Byte* key, unsigned int length) const;
+	bool IsEmpty() const { return fields_.empty(); }
+private:
+	struct Field {
+		unsigned int fixedLength_;
+		bool descending_;
+	};
+	std::vector<Field> fields_;
+};
+
+class NativeCursorPool;
+struct NativeSecondaryKey;
+
+//native extensions of one database handle attached via app_private, so every reader and bdb callback over the DB* picks them up.
+//created by the first attached extension and deleted by Release of the last one
+struct NativeDatabaseState {
+	NativeDatabaseState() :cursorPool(nullptr), secondaryKey(nullptr) {
+	}
+	NativeCursorPool* cursorPool;
+	//key extractor of a secondary database, see NativeSecondaryIndexes
+	const NativeSecondaryKey* secondaryKey;
+	static NativeDatabaseState* Of(DB* db) { return static_cast<NativeDatabaseState*>(db->app_private); }
+	static NativeDatabaseState& Attach(DB* db);
+	//detaches and deletes the state when no extension is left
+	static void Release(DB* db);
+};
+
+//idle DBC handles of one database, NativeCursor borrows one instead of opening and returns it instead of closing.
+//pool is attached to the database via NativeDatabaseState, so every reader over the DB* picks it up.
+//returned handles keep their last position and bdb adjusts all open cursors on page splits and deletes,
+//so idle count is bounded
+class NativeCursorPool {
+public:
+	NativeCursorPool(DB* db, unsigned int maxIdleCount);
+	//closes idle handles and detaches from database, borrowed handles must be returned before
+	~NativeCursorPool();
+	static NativeCursorPool* Of(DB* db) {
+		NativeDatabaseState* state = NativeDatabaseState::Of(db);
+		return state != nullptr ? state->cursorPool : nullptr;
+	}
+	DBC* Borrow();
+	//returns bdb result code of close when the pool is full
+	int Return(DBC* dbc);
+	//closes idle handles, returns the first failed close result code
+	int Clear();
+private:
+	NativeCursorPool(const NativeCursorPool&);
+	NativeCursorPool& operator=(const NativeCursorPool&);
+	struct State;
+	DB* db_;
+	unsigned int maxIdleCount_;
+	State* state_;
+};
+
+//work done by cursor reads, reported by slow operation log
+struct NativeReadCounters {
+	NativeReadCounters() :seeks(0), steps(0), bytesCopied(0) {
+	}
+	void Add(const NativeReadCounters& other) {
+		seeks += other.seeks;
+		steps += other.steps;
+		bytesCopied += other.bytesCopied;
+	}
+	//positioning gets, which descend the btree
+	unsigned int seeks;
+	//gets moving to the adjacent record or bulk batch
+	unsigned int steps;
+	//bytes copied by bdb into connected buffers
+	unsigned long long bytesCopied;
+};
+
 class NativeCursor {
+public:
+	const NativeReadCounters& Counters() const { return counters_; }
 protected:
 	NativeCursor(DB* db);
 	virtual ~NativeCursor();
@@ -98,20 +184,34 @@ protected:
 	bool TryMoveNext();
 	bool TryMovePrev();
 	bool TryMoveBy(int offset);
-	template <typename Iter> friend void LoadCurrent(Iter first, Iter last);
 	bool TryMoveTo(Byte* key, int length);
 	bool TryMoveTo(int recordNumber);
+	bool TryMoveToExact(Byte* key, int length);
+	bool TryMoveNextDuplicate();
+	bool TryMoveNextKey();
+	bool TryMoveToLastDuplicate();
+	unsigned int CountDuplicates();
+	int GetMultiple(u_int32_t flags, DBT& bulkDbt);
+	unsigned int PageSize();
 	DBT keyDbt_;
 	DBT valueDbt_;
+	//gets of cursor over secondary database read primary key into it by pget, null for plain gets
+	DBT* primaryKeyDbt_;
+	bool hasDuplicates_;
 private:
 	bool TryMove(u_int32_t flags, const char* api);
 	int Get(u_int32_t flags);
+	void SetKey(Byte* key, int length);
+	void Count(u_int32_t flags, int resultCode, unsigned int copiedSize);
+	DB* db_;
 	DBC* dbc_;
+	NativeCursorPool* pool_;
+	NativeReadCounters counters_;
 };
 
 class NativeRangeCursor : public NativeCursor {
 protected:
-	NativeRangeCursor(DB* db, NativeRange& range);
+	NativeRangeCursor(DB* db, NativeRange&& range, bool exactKey);
 	bool TryMoveToLeftBoundary();
 	bool TryMoveToRightBoundary();
 	bool WithinLeft();
@@ -119,6 +219,10 @@ protected:
 	NativeRange range_;
 private:
 	bool Within(NativeBoundary& boundary, int direction);
+	//range of duplicates of the single key, boundaries are compared for equality instead of by prefix
+	bool exactKey_;
+	//range built by Range.Prefix, both boundaries are checked by one starts with comparison
+	bool prefix_;
 };
 
 template<typename TReader> class NativeReaderFetcher;
@@ -126,10 +230,15 @@ template<typename TReader> class NativeReaderFetcher;
 class NativeRangeCursorReader : public NativeRangeCursor {
 public:
 	NativeRangeCursorReader(DB* db, Byte* leftBytes, int leftLength, bool leftInclusive, Byte* rightBytes, int rightLength, bool rightInclusive, int direction, int skip, int take);
+	NativeRangeCursorReader(DB* db, Byte* key, int keyLength, int direction);
 	bool Read(unsigned int& keyLength, unsigned int& valueLength);
 	unsigned int GetTotalCount();
 	void ConnectDbtsTo(Byte* keyBuffer, unsigned int keyLength, Byte* valueBuffer, unsigned int valueLength);
+	//ascending reader starts at from and stops before to, keys are compared as whole byte strings, empty means no limit
+	void LimitTo(const std::vector<Byte>& from, const std::vector<Byte>& to);
 	int readRecordsCount_;
+	//index among readers of the merge, orders records with equal suffixes
+	unsigned int mergeIndex_;
 protected:
 	bool DoTryMoveFirst();
 	bool DoTryMoveNext();
@@ -148,6 +257,8 @@ private:
 	int skip_;
 	int take_;
 	State state_;
+	std::vector<Byte> partitionFrom_;
+	std::vector<Byte> partitionTo_;
 
 	class RecordNumberKeeper {
 	public:
@@ -159,16 +270,33 @@ private:
 	};
 	friend class NativeCursorSuffixComparer;
 	friend class NativeSuffixMergingRangeCursorReader;
+	friend class NativeSecondaryCursorReader;
 	friend class NativeReaderFetcher<NativeRangeCursorReader>;
 };
 
+//picks up to partitionsCount - 1 increasing keys splitting the range into parts with about equal records count,
+//positions are estimated by DB->key_range btree descents, so records themselves are not read
+std::vector<std::vector<Byte>> NativeSplitRange(DB* db, const std::vector<Byte>& left, const std::vector<Byte>& right, unsigned int partitionsCount);
+
+//sizes of records read by one bulk get from the start of the database and from samplesCount - 1 split keys,
+//seeds adaptive buffer sizes at attach without traversing the whole btree as DB->stat does
+void NativeSampleRecordSizes(DB* db, unsigned int samplesCount, std::vector<unsigned int>& keySizes, std::vector<unsigned int>& valueSizes);
+
+//grows buffer of chunksCount chunks keeping content of every chunk at the start of its new place,
+//so readers connected to the chunks can be rebound instead of reloading their records
+void NativeGrowChunks(std::vector<Byte>& buffer, unsigned int chunksCount, unsigned int chunkSize, unsigned int newChunkSize);
+
 class NativeCursorSuffixComparer {
 public:
-	NativeCursorSuffixComparer(unsigned int keySuffixOffset, int direction);
+	NativeCursorSuffixComparer(unsigned int keySuffixOffset, const NativeKeySchema& keySchema, bool byValue, int direction);
 	bool operator()(const NativeRangeCursorReader* a, const NativeRangeCursorReader* b) const;
+	unsigned int SuffixOffset(const DBT& key) const;
 private:
 	unsigned int keySuffixOffset_;
+	NativeKeySchema keySchema_;
+	bool byValue_;
 	int direction_;
+	inline const DBT& Compared(const NativeRangeCursorReader* reader) const;
 	inline int CompareBytes(const Byte* a, const Byte* b, unsigned int count) const;
 	inline int Compare(const NativeRangeCursorReader* a, const NativeRangeCursorReader* b) const;
 };
@@ -177,11 +305,16 @@ typedef std::priority_queue<NativeRangeCursorReader*, std::vector<NativeRangeCur
 
 class NativeSuffixMergingRangeCursorReader: private ReadersHeap {
 public:
-	NativeSuffixMergingRangeCursorReader(unsigned int keySuffixOffset, bool needKeys, bool needValues, NativeRangeCursorReader** readers, unsigned int readersCount, int direction);
+	NativeSuffixMergingRangeCursorReader(unsigned int keySuffixOffset, const NativeKeySchema& keySchema, bool byValue, bool needKeys, bool needValues, NativeRangeCursorReader** readers, unsigned int readersCount, int direction);
 	~NativeSuffixMergingRangeCursorReader();
 	bool Read(unsigned int& keyLength, unsigned int& valueLength);
 	void ConnectDbtsTo(Byte* keyBuffer, unsigned int keyLength, Byte* valueBuffer, unsigned int valueLength);
 	unsigned int GetTotalCount();
+	//skips count first records of the merge before the first read, requires DB_RECNUM.
+	//every range must hold keys ordered by suffix, as ranges sharing key bytes before the suffix do
+	void Skip(unsigned int count) { skip_ = count; }
+	//sum of merged readers counters
+	NativeReadCounters Counters() const;
 private:
 	bool needKeys_;
 	bool needValues_;
@@ -191,12 +324,74 @@ private:
 	unsigned int readersCount_;
 	DBT keyDbt_;
 	DBT valueDbt_;
+	//buffers of the last connect, chunk of reader is found by its dbt offset within them
+	Byte* keyBuffer_;
+	unsigned int keyChunkSize_;
+	Byte* valueBuffer_;
+	unsigned int valueChunkSize_;
+	unsigned int skip_;
+	//counters of finished and deleted readers
+	NativeReadCounters finishedCounters_;
+	void SelectReadersSkips();
+	void ReadSuffix(unsigned int readerIndex, int firstRecordNumber, unsigned int count, unsigned int position, std::vector<Byte>& suffix);
+	unsigned int CountBelow(unsigned int readerIndex, int firstRecordNumber, unsigned int count, const std::vector<Byte>& prefix, const std::vector<Byte>& suffix, bool inclusive);
 	void CopyDbt(DBT& target, DBT& source, unsigned int& length);
 	void TryPush(NativeRangeCursorReader* reader);
+	void Rebind(NativeRangeCursorReader* reader, Byte* keyBuffer, unsigned int keyLength, Byte* valueBuffer, unsigned int valueLength);
+	static void RebindDbt(DBT& dbt, Byte* oldBuffer, unsigned int oldLength, Byte* buffer, unsigned int length);
 
 	friend class NativeReaderFetcher<NativeSuffixMergingRangeCursorReader>;
 };
 
+//iterates duplicates of the single key either one by one or in DB_MULTIPLE batches
+class NativeDuplicatesCursorReader : public NativeCursor {
+public:
+	NativeDuplicatesCursorReader(DB* db, Byte* key, int keyLength, int take, unsigned int bulkBufferSize);
+	~NativeDuplicatesCursorReader();
+	bool Read(unsigned int& keyLength, unsigned int& valueLength);
+	unsigned int GetTotalCount();
+	void ConnectDbtsTo(Byte* keyBuffer, unsigned int keyLength, Byte* valueBuffer, unsigned int valueLength);
+	int readRecordsCount_;
+private:
+	bool TryReadSingle();
+	bool TryReadBulk();
+	bool TryLoadBulk(u_int32_t flags);
+	NativeBoundary key_;
+	int take_;
+	bool started_;
+	bool finished_;
+	bool bulk_;
+	DBT bulkDbt_;
+	void* bulkPosition_;
+
+	friend class NativeReaderFetcher<NativeDuplicatesCursorReader>;
+};
+
+//reads primary records of a secondary database range: keys are primary keys, values are primary values.
+//secondary keys are read into own buffers, only primary records are copied into connected ones
+class NativeSecondaryCursorReader {
+public:
+	NativeSecondaryCursorReader(DB* secondary, Byte* leftBytes, int leftLength, bool leftInclusive, Byte* rightBytes, int rightLength, bool rightInclusive, int direction, int take);
+	bool Read(unsigned int& keyLength, unsigned int& valueLength);
+	void ConnectDbtsTo(Byte* keyBuffer, unsigned int keyLength, Byte* valueBuffer, unsigned int valueLength);
+	const NativeReadCounters& Counters() const { return reader_.Counters(); }
+	int readRecordsCount_;
+private:
+	void Grow(const NativeBufferSmallException& e);
+	void ConnectReader();
+	NativeRangeCursorReader reader_;
+	std::vector<Byte> secondaryKey_;
+	std::vector<Byte> primaryKey_;
+	std::vector<Byte> value_;
+	DBT primaryKeyDbt_;
+	DBT keyDbt_;
+	DBT valueDbt_;
+	//record read by reader_ but not copied yet because connected buffers are small
+	bool pending_;
+
+	friend class NativeReaderFetcher<NativeSecondaryCursorReader>;
+};
+
 template <typename TReader>
 class NativeReaderFetcher {
 public:
@@ -205,18 +400,25 @@ public:
 	inline unsigned int FilledStoreSize() {
 		return storeIndex_;
 	}
+	//FetchInto returns fetched so far records once cancellation is requested
+	inline void SetCancellation(const NativeCancellation* cancellation) {
+		cancellation_ = cancellation;
+	}
+	//completes fetch interrupted by NativeBufferSmallException without resuming it, returns fetched rows count
+	unsigned int CompactColumns();
 	bool needKeys_;
 	bool needValues_;
 	unsigned int take_;
 private:
 	TReader& reader_;
 	unsigned int storeIndex_;
-	unsigned int positionsIndex_;
 	unsigned int recordsFetched_;
+	const NativeCancellation* cancellation_;
 
 	Byte* store_;
 	unsigned int* positions_;
 
+	unsigned int PositionIndex(bool shifted);
 	void SetStart(DBT& b, bool shifted);
 	void SetSize(bool shifted, unsigned int size);
 };
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "NativeMetadata.h"
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+namespace {
+	void CheckApiOk(int resultCode, const char* api) {
+		if (resultCode != 0)
+			throw NativeBdbApiException(resultCode, api);
+	}
+
+	void InitKey(DBT& dbt, const char* key) {
+		memset(&dbt, 0, sizeof(DBT));
+		dbt.data = const_cast<char*>(key);
+		dbt.size = static_cast<u_int32_t>(strlen(key));
+	}
+}
+
+NativeMetadata::NativeMetadata(DB_ENV* env, const char* fileName, const char* name, u_int32_t openFlags)
+	:db_(nullptr), readonly_((openFlags & DB_RDONLY) != 0) {
+	DB* db;
+	CheckApiOk(db_create(&db, env, 0), "db_create");
+	int resultCode = db->open(db, nullptr, fileName, name, DB_BTREE, openFlags, 0);
+	if (resultCode != 0) {
+		db->close(db, 0);
+		if (resultCode == ENOENT && readonly_)
+			return;
+		throw NativeBdbApiException(resultCode, "db.open");
+	}
+	db_ = db;
+}
+
+NativeMetadata::~NativeMetadata() {
+	if (db_ != nullptr)
+		db_->close(db_, 0);
+}
+
+bool NativeMetadata::TryGet(const char* key, vector<Byte>& value) const {
+	if (db_ == nullptr)
+		return false;
+	DBT keyDbt;
+	InitKey(keyDbt, key);
+	DBT valueDbt;
+	memset(&valueDbt, 0, sizeof(DBT));
+	valueDbt.flags = DB_DBT_MALLOC;
+	int resultCode = db_->get(db_, nullptr, &keyDbt, &valueDbt, 0);
+	if (resultCode == DB_NOTFOUND)
+		return false;
+	CheckApiOk(resultCode, "db.get");
+	const Byte* data = static_cast<const Byte*>(valueDbt.data);
+	value.assign(data, data + valueDbt.size);
+	free(valueDbt.data);
+	return true;
+}
+
+void NativeMetadata::Put(const char* key, const vector<Byte>& value) {
+	if (db_ == nullptr || readonly_)
+		throw NativeBdbException(string("can't write readonly metadata, key [") + key + "]");
+	DBT keyDbt;
+	InitKey(keyDbt, key);
+	DBT valueDbt;
+	memset(&valueDbt, 0, sizeof(DBT));
+	valueDbt.data = value.empty() ? nullptr : const_cast<Byte*>(&value[0]);
+	valueDbt.size = static_cast<u_int32_t>(value.size());
+	CheckApiOk(db_->put(db_, nullptr, &keyDbt, &valueDbt, 0), "db.put");
+}
+
+void NativeMetadata::Remove(const char* key) {
+	if (db_ == nullptr || readonly_)
+		return;
+	DBT keyDbt;
+	InitKey(keyDbt, key);
+	int resultCode = db_->del(db_, nullptr, &keyDbt, 0);
+	if (resultCode != DB_NOTFOUND)
+		CheckApiOk(resultCode, "db.del");
+}
+
+bool NativeMetadata::Match(const char* key, const vector<Byte>& value) {
+	vector<Byte> stored;
+	if (TryGet(key, stored))
+		return stored == value;
+	if (!readonly_)
+		Put(key, value);
+	return true;
+}
+
+void NativeMetadata::Close() {
+	DB* db = db_;
+	db_ = nullptr;
+	if (db != nullptr)
+		CheckApiOk(db->close(db, 0), "db.close");
+}
+
+void NativeAppendField(vector<Byte>& target, const Byte* bytes, unsigned int length) {
+	for (int shift = 0; shift < 32; shift += 8)
+		target.push_back(static_cast<Byte>(length >> shift));
+	if (length > 0)
+		target.insert(target.end(), bytes, bytes + length);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "NativeCursors.h"
+#include <vector>
+
+//records describing a database, kept in <name>.metadata database of the same file, so settings fixed
+//on the first attach are checked on later attaches instead of silently reading the data with other ones
+class NativeMetadata {
+public:
+	//metadata database is not created by readonly open, missing one reads as empty
+	NativeMetadata(DB_ENV* env, const char* fileName, const char* name, u_int32_t openFlags);
+	~NativeMetadata();
+	bool TryGet(const char* key, std::vector<Byte>& value) const;
+	void Put(const char* key, const std::vector<Byte>& value);
+	void Remove(const char* key);
+	//stores value when key is missing, returns false when stored value differs
+	bool Match(const char* key, const std::vector<Byte>& value);
+	void Close();
+private:
+	NativeMetadata(const NativeMetadata&);
+	NativeMetadata& operator=(const NativeMetadata&);
+	DB* db_;
+	bool readonly_;
+};
+
+//appends length prefixed field, so concatenated fields compare equal only when every field does
+void NativeAppendField(std::vector<Byte>& target, const Byte* bytes, unsigned int length);
@@ -0,0 +1,455 @@
+#include "NativePostings.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSSE3__) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+#define NATIVE_POSTINGS_SSSE3
+#include <tmmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+	const unsigned int idLength = sizeof(unsigned int);
+	const Byte escape = 0x00;
+	const Byte escapedZero = 0xFF;
+	const Byte terminator = 0x01;
+
+	void CheckApiOk(int resultCode, const char* api) {
+		if (resultCode != 0)
+			throw NativeBdbApiException(resultCode, api);
+	}
+
+	void ThrowCorrupted() {
+		throw NativeBdbException("posting list block is corrupted");
+	}
+
+	Byte* WriteVarint(unsigned int value, Byte* target) {
+		while (value >= 0x80) {
+			*target++ = (Byte)(value | 0x80);
+			value >>= 7;
+		}
+		*target++ = (Byte)value;
+		return target;
+	}
+
+	const Byte* ReadVarint(const Byte* source, const Byte* end, unsigned int& value) {
+		value = 0;
+		for (unsigned int shift = 0; shift < 35; shift += 7) {
+			if (source == end)
+				ThrowCorrupted();
+			Byte b = *source++;
+			value |= (unsigned int)(b & 0x7f) << shift;
+			if ((b & 0x80) == 0)
+				return source;
+		}
+		ThrowCorrupted();
+		return source;
+	}
+
+	unsigned int DeltaLength(unsigned int delta) {
+		return delta < (1u << 8) ? 1 : delta < (1u << 16) ? 2 : delta < (1u << 24) ? 3 : 4;
+	}
+
+	unsigned int EntryLength(Byte control, unsigned int entry) {
+		return ((control >> (entry * 2)) & 3) + 1;
+	}
+
+	struct ControlTable {
+		ControlTable() {
+			for (unsigned int control = 0; control < 256; control++) {
+				Byte offset = 0;
+				for (unsigned int entry = 0; entry < 4; entry++) {
+					unsigned int length = EntryLength((Byte)control, entry);
+					for (unsigned int b = 0; b < 4; b++)
+						shuffles_[control][entry * 4 + b] = b < length ? (Byte)(offset + b) : 0x80;
+					offset += (Byte)length;
+				}
+				lengths_[control] = offset;
+			}
+#if defined(NATIVE_POSTINGS_SSSE3) && defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 1);
+			hasSsse3_ = (info[2] & (1 << 9)) != 0;
+#elif defined(NATIVE_POSTINGS_SSSE3)
+			hasSsse3_ = true;
+#else
+			hasSsse3_ = false;
+#endif
+		}
+		Byte shuffles_[256][16];
+		Byte lengths_[256];
+		bool hasSsse3_;
+	};
+
+	const ControlTable controlTable;
+
+	unsigned int DecodeScalar(const Byte* control, const Byte*& data, unsigned int from, unsigned int count, unsigned int previous, unsigned int* ids) {
+		for (unsigned int i = from; i < count; i++) {
+			unsigned int length = EntryLength(control[i / 4], i % 4);
+			unsigned int delta = 0;
+			for (unsigned int b = 0; b < length; b++)
+				delta |= (unsigned int)data[b] << (8 * b);
+			data += length;
+			previous += delta;
+			ids[i] = previous;
+		}
+		return previous;
+	}
+
+#ifdef NATIVE_POSTINGS_SSSE3
+	unsigned int DecodeSsse3(const Byte* control, const Byte*& data, const Byte* end, unsigned int& decoded, unsigned int count, unsigned int* ids) {
+		unsigned int previous = 0;
+		unsigned int i = 0;
+		for (; i + 4 <= count && data + 16 <= end; i += 4) {
+			Byte c = control[i / 4];
+			__m128i deltas = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)data),
+				_mm_loadu_si128((const __m128i*)controlTable.shuffles_[c]));
+			deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 4));
+			deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 8));
+			deltas = _mm_add_epi32(deltas, _mm_set1_epi32((int)previous));
+			_mm_storeu_si128((__m128i*)(ids + i), deltas);
+			previous = ids[i + 3];
+			data += controlTable.lengths_[c];
+		}
+		decoded = i;
+		return previous;
+	}
+#endif
+
+	void AppendEscaped(vector<Byte>& target, const Byte* source, unsigned int length) {
+		for (unsigned int i = 0; i < length; i++) {
+			target.push_back(source[i]);
+			if (source[i] == escape)
+				target.push_back(escapedZero);
+		}
+		target.push_back(escape);
+		target.push_back(terminator);
+	}
+
+	void WriteBigEndian(unsigned int value, Byte* target) {
+		target[0] = (Byte)(value >> 24);
+		target[1] = (Byte)(value >> 16);
+		target[2] = (Byte)(value >> 8);
+		target[3] = (Byte)value;
+	}
+
+	unsigned int ReadBigEndian(const Byte* source) {
+		return ((unsigned int)source[0] << 24) | ((unsigned int)source[1] << 16) | ((unsigned int)source[2] << 8) | source[3];
+	}
+}
+
+unsigned int NativePostingsMaxEncodedSize(unsigned int count) {
+	return 5 + (count + 3) / 4 + count * idLength;
+}
+
+unsigned int NativePostingsEncode(const unsigned int* ids, unsigned int count, Byte* target) {
+	Byte* start = target;
+	Byte* control = WriteVarint(count, target);
+	unsigned int controlLength = (count + 3) / 4;
+	memset(control, 0, controlLength);
+	Byte* data = control + controlLength;
+	unsigned int previous = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		unsigned int delta = ids[i] - previous;
+		previous = ids[i];
+		unsigned int length = DeltaLength(delta);
+		control[i / 4] |= (Byte)((length - 1) << ((i % 4) * 2));
+		for (unsigned int b = 0; b < length; b++)
+			data[b] = (Byte)(delta >> (8 * b));
+		data += length;
+	}
+	return (unsigned int)(data - start);
+}
+
+unsigned int NativePostingsDecodedCount(const Byte* source, unsigned int length) {
+	unsigned int result;
+	ReadVarint(source, source + length, result);
+	return result;
+}
+
+unsigned int NativePostingsDecode(const Byte* source, unsigned int length, unsigned int* ids) {
+	const Byte* end = source + length;
+	unsigned int count;
+	const Byte* control = ReadVarint(source, end, count);
+	unsigned int controlLength = (count + 3) / 4;
+	if ((unsigned int)(end - control) < controlLength)
+		ThrowCorrupted();
+	const Byte* data = control + controlLength;
+	unsigned int dataLength = 0;
+	for (unsigned int i = 0; i < count; i++)
+		dataLength += EntryLength(control[i / 4], i % 4);
+	if ((unsigned int)(end - data) < dataLength)
+		ThrowCorrupted();
+	unsigned int decoded = 0;
+	unsigned int previous = 0;
+#ifdef NATIVE_POSTINGS_SSSE3
+	if (controlTable.hasSsse3_)
+		previous = DecodeSsse3(control, data, end, decoded, count, ids);
+#endif
+	DecodeScalar(control, data, decoded, count, previous, ids);
+	return count;
+}
+
+NativePostingsBlockCursor::NativePostingsBlockCursor(DB* db, DB_TXN* txn, const Byte* term, unsigned int termLength) :db_(db) {
+	AppendEscaped(key_, term, termLength);
+	prefixLength_ = (unsigned int)key_.size();
+	CheckApiOk(db->cursor(db, txn, &dbc_, 0), "db.cursor");
+	memset(&keyDbt_, 0, sizeof(DBT));
+	keyDbt_.flags = DB_DBT_REALLOC;
+	memset(&valueDbt_, 0, sizeof(DBT));
+	valueDbt_.flags = DB_DBT_REALLOC;
+}
+
+NativePostingsBlockCursor::~NativePostingsBlockCursor() {
+	dbc_->close(dbc_);
+	free(keyDbt_.data);
+	free(valueDbt_.data);
+}
+
+void NativePostingsBlockCursor::SetKey(unsigned int id) {
+	key_.resize(prefixLength_ + idLength);
+	WriteBigEndian(id, &key_[prefixLength_]);
+}
+
+bool NativePostingsBlockCursor::TryGet(u_int32_t flags, const char* api) {
+	if (flags == DB_SET_RANGE) {
+		void* data = realloc(keyDbt_.data, key_.size());
+		if (data == nullptr)
+			throw bad_alloc();
+		keyDbt_.data = data;
+		keyDbt_.size = (u_int32_t)key_.size();
+		memcpy(keyDbt_.data, &key_[0], key_.size());
+	}
+	int resultCode = dbc_->get(dbc_, &keyDbt_, &valueDbt_, flags);
+	if (resultCode == DB_NOTFOUND)
+		return false;
+	CheckApiOk(resultCode, api);
+	return true;
+}
+
+bool NativePostingsBlockCursor::IsTermBlock() const {
+	return keyDbt_.size == prefixLength_ + idLength && memcmp(keyDbt_.data, &key_[0], prefixLength_) == 0;
+}
+
+unsigned int NativePostingsBlockCursor::BlockFirstId() const {
+	return ReadBigEndian((const Byte*)keyDbt_.data + prefixLength_);
+}
+
+void NativePostingsBlockCursor::DecodeBlock() {
+	const Byte* value = (const Byte*)valueDbt_.data;
+	unsigned int count = NativePostingsDecodedCount(value, valueDbt_.size);
+	//vectorized decoder stores 4 ids at once
+	ids_.resize((count + 3) / 4 * 4);
+	if (count > 0)
+		NativePostingsDecode(value, valueDbt_.size, &ids_[0]);
+	ids_.resize(count);
+}
+
+//block with the greatest first id not exceeding id, or the first block of the term if there is no such one
+bool NativePostingsBlockCursor::TrySeekBlock(unsigned int id) {
+	SetKey(id);
+	bool found = TryGet(DB_SET_RANGE, "cursor.get.DB_SET_RANGE");
+	if (found && IsTermBlock() && BlockFirstId() == id)
+		return true;
+	bool hasPrevious = found ? TryGet(DB_PREV, "cursor.get.DB_PREV") : TryGet(DB_LAST, "cursor.get.DB_LAST");
+	if (hasPrevious && IsTermBlock())
+		return true;
+	SetKey(id);
+	return TryGet(DB_SET_RANGE, "cursor.get.DB_SET_RANGE") && IsTermBlock();
+}
+
+bool NativePostingsBlockCursor::TryMoveToFirstBlock() {
+	SetKey(0);
+	return TryGet(DB_SET_RANGE, "cursor.get.DB_SET_RANGE") && IsTermBlock();
+}
+
+bool NativePostingsBlockCursor::TryMoveToNextBlock() {
+	return TryGet(DB_NEXT, "cursor.get.DB_NEXT") && IsTermBlock();
+}
+
+NativePostingsWriter::NativePostingsWriter(DB* db, DB_TXN* txn, const Byte* term, unsigned int termLength, unsigned int maxBlockIds)
+	:NativePostingsBlockCursor(db, txn, term, termLength), db_(db), txn_(txn), maxBlockIds_(maxBlockIds < 1 ? 1 : maxBlockIds) {
+}
+
+void NativePostingsWriter::Add(unsigned int id) {
+	if (!TrySeekBlock(id)) {
+		ids_.assign(1, id);
+		PutBlock(ids_.begin(), ids_.end());
+		return;
+	}
+	DecodeBlock();
+	unsigned int firstId = BlockFirstId();
+	vector<unsigned int>::iterator position = lower_bound(ids_.begin(), ids_.end(), id);
+	if (position != ids_.end() && *position == id)
+		return;
+	ids_.insert(position, id);
+	if (ids_[0] != firstId)
+		DeleteBlock(firstId);
+	if (ids_.size() <= maxBlockIds_) {
+		PutBlock(ids_.begin(), ids_.end());
+		return;
+	}
+	vector<unsigned int>::const_iterator middle = ids_.begin() + ids_.size() / 2;
+	PutBlock(ids_.begin(), middle);
+	PutBlock(middle, ids_.end());
+}
+
+void NativePostingsWriter::Remove(unsigned int id) {
+	if (!TrySeekBlock(id) || BlockFirstId() > id)
+		return;
+	DecodeBlock();
+	unsigned int firstId = BlockFirstId();
+	vector<unsigned int>::iterator position = lower_bound(ids_.begin(), ids_.end(), id);
+	if (position == ids_.end() || *position != id)
+		return;
+	ids_.erase(position);
+	if (ids_.empty() || ids_[0] != firstId)
+		DeleteBlock(firstId);
+	if (!ids_.empty())
+		PutBlock(ids_.begin(), ids_.end());
+}
+
+void NativePostingsWriter::PutBlock(vector<unsigned int>::const_iterator first, vector<unsigned int>::const_iterator last) {
+	unsigned int count = (unsigned int)(last - first);
+	SetKey(*first);
+	value_.resize(NativePostingsMaxEncodedSize(count));
+	DBT keyDbt;
+	memset(&keyDbt, 0, sizeof(DBT));
+	keyDbt.data = &key_[0];
+	keyDbt.size = (u_int32_t)key_.size();
+	DBT valueDbt;
+	memset(&valueDbt, 0, sizeof(DBT));
+	valueDbt.data = &value_[0];
+	valueDbt.size = NativePostingsEncode(&*first, count, &value_[0]);
+	CheckApiOk(db_->put(db_, txn_, &keyDbt, &valueDbt, 0), "db.put");
+}
+
+void NativePostingsWriter::DeleteBlock(unsigned int firstId) {
+	SetKey(firstId);
+	DBT keyDbt;
+	memset(&keyDbt, 0, sizeof(DBT));
+	keyDbt.data = &key_[0];
+	keyDbt.size = (u_int32_t)key_.size();
+	CheckApiOk(db_->del(db_, txn_, &keyDbt, 0), "db.del");
+}
+
+NativePostingsCursor::NativePostingsCursor(DB* db, const Byte* term, unsigned int termLength)
+	:NativePostingsBlockCursor(db, nullptr, term, termLength), index_(0) {
+}
+
+bool NativePostingsCursor::TryLoad(bool found) {
+	if (!found)
+		return false;
+	DecodeBlock();
+	index_ = 0;
+	return !ids_.empty();
+}
+
+bool NativePostingsCursor::TryStart() {
+	return TryLoad(TryMoveToFirstBlock());
+}
+
+bool NativePostingsCursor::TryMoveNext() {
+	if (++index_ < ids_.size())
+		return true;
+	return TryLoad(TryMoveToNextBlock());
+}
+
+bool NativePostingsCursor::TrySkipTo(unsigned int target) {
+	if (Current() >= target)
+		return true;
+	if (target <= ids_.back()) {
+		index_ = lower_bound(ids_.begin() + index_, ids_.end(), target) - ids_.begin();
+		return true;
+	}
+	if (!TrySeekBlock(target))
+		return false;
+	DecodeBlock();
+	index_ = lower_bound(ids_.begin(), ids_.end(), target) - ids_.begin();
+	if (index_ < ids_.size())
+		return true;
+	return TryLoad(TryMoveToNextBlock());
+}
+
+NativePostingsReader::NativePostingsReader() :started_(false) {
+}
+
+NativePostingsReader::~NativePostingsReader() {
+	for (size_t i = 0; i < cursors_.size(); i++)
+		delete cursors_[i];
+}
+
+void NativePostingsReader::AddTerm(DB* db, const Byte* term, unsigned int termLength) {
+	cursors_.reserve(cursors_.size() + 1);
+	cursors_.push_back(new NativePostingsCursor(db, term, termLength));
+}
+
+unsigned int NativePostingsReader::FetchInto(unsigned int* target, unsigned int count) {
+	unsigned int result = 0;
+	while (result < count && Read(target[result]))
+		result++;
+	return result;
+}
+
+NativePostingsUnionReader::NativePostingsUnionReader() {
+}
+
+bool NativePostingsUnionReader::Read(unsigned int& id) {
+	if (!started_) {
+		started_ = true;
+		for (size_t i = 0; i < cursors_.size(); i++)
+			if (cursors_[i]->TryStart())
+				heap_.push(cursors_[i]);
+	}
+	if (heap_.empty())
+		return false;
+	id = heap_.top()->Current();
+	while (!heap_.empty() && heap_.top()->Current() == id) {
+		NativePostingsCursor* cursor = heap_.top();
+		heap_.pop();
+		if (cursor->TryMoveNext())
+			heap_.push(cursor);
+	}
+	return true;
+}
+
+NativePostingsIntersectionReader::NativePostingsIntersectionReader() :finished_(false) {
+}
+
+bool NativePostingsIntersectionReader::Read(unsigned int& id) {
+	if (finished_ || cursors_.empty())
+		return false;
+	if (!started_) {
+		started_ = true;
+		for (size_t i = 0; i < cursors_.size(); i++)
+			if (!cursors_[i]->TryStart()) {
+				finished_ = true;
+				return false;
+			}
+	}
+	else if (!cursors_[0]->TryMoveNext()) {
+		finished_ = true;
+		return false;
+	}
+	unsigned int candidate = cursors_[0]->Current();
+	size_t matched = 0;
+	for (size_t i = 0; matched < cursors_.size(); i = (i + 1) % cursors_.size()) {
+		if (!cursors_[i]->TrySkipTo(candidate)) {
+			finished_ = true;
+			return false;
+		}
+		if (cursors_[i]->Current() == candidate)
+			matched++;
+		else {
+			candidate = cursors_[i]->Current();
+			matched = 1;
+		}
+	}
+	id = candidate;
+	return true;
+}
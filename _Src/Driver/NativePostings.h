@@ -0,0 +1,101 @@
+#pragma once
+
+#include "NativeCursors.h"
+#include <vector>
+#include <queue>
+
+//posting list block value is [varint count][control bytes][data bytes], ids are delta coded,
+//each control byte holds 2-bit byte lengths of 4 deltas (stream vbyte), so 4 deltas are decoded by one byte shuffle.
+//block key is [escaped term][0x00 0x01][big-endian first id], the same encoding KeyBuilder uses for strings
+unsigned int NativePostingsMaxEncodedSize(unsigned int count);
+unsigned int NativePostingsEncode(const unsigned int* ids, unsigned int count, Byte* target);
+unsigned int NativePostingsDecodedCount(const Byte* source, unsigned int length);
+unsigned int NativePostingsDecode(const Byte* source, unsigned int length, unsigned int* ids);
+
+class NativePostingsBlockCursor {
+protected:
+	NativePostingsBlockCursor(DB* db, DB_TXN* txn, const Byte* term, unsigned int termLength);
+	virtual ~NativePostingsBlockCursor();
+	bool TrySeekBlock(unsigned int id);
+	bool TryMoveToFirstBlock();
+	bool TryMoveToNextBlock();
+	unsigned int BlockFirstId() const;
+	void DecodeBlock();
+	void SetKey(unsigned int id);
+	std::vector<unsigned int> ids_;
+	std::vector<Byte> key_;
+private:
+	bool TryGet(u_int32_t flags, const char* api);
+	bool IsTermBlock() const;
+	DB* db_;
+	DBC* dbc_;
+	unsigned int prefixLength_;
+	DBT keyDbt_;
+	DBT valueDbt_;
+	NativePostingsBlockCursor(const NativePostingsBlockCursor& source);
+	const NativePostingsBlockCursor& operator=(NativePostingsBlockCursor& source);
+};
+
+//one Add or Remove may delete a block and put two, txn makes them one change, null means auto commit of each write.
+//writer must be destroyed before txn is resolved, as its cursor belongs to the txn
+class NativePostingsWriter : private NativePostingsBlockCursor {
+public:
+	NativePostingsWriter(DB* db, DB_TXN* txn, const Byte* term, unsigned int termLength, unsigned int maxBlockIds);
+	void Add(unsigned int id);
+	void Remove(unsigned int id);
+private:
+	void PutBlock(std::vector<unsigned int>::const_iterator first, std::vector<unsigned int>::const_iterator last);
+	void DeleteBlock(unsigned int firstId);
+	DB* db_;
+	DB_TXN* txn_;
+	unsigned int maxBlockIds_;
+	std::vector<Byte> value_;
+};
+
+class NativePostingsCursor : private NativePostingsBlockCursor {
+public:
+	NativePostingsCursor(DB* db, const Byte* term, unsigned int termLength);
+	bool TryStart();
+	bool TryMoveNext();
+	//moves to the first id not less than target
+	bool TrySkipTo(unsigned int target);
+	unsigned int Current() const { return ids_[index_]; }
+private:
+	bool TryLoad(bool found);
+	size_t index_;
+};
+
+class NativePostingsReader {
+public:
+	NativePostingsReader();
+	virtual ~NativePostingsReader();
+	void AddTerm(DB* db, const Byte* term, unsigned int termLength);
+	virtual bool Read(unsigned int& id) = 0;
+	unsigned int FetchInto(unsigned int* target, unsigned int count);
+protected:
+	std::vector<NativePostingsCursor*> cursors_;
+	bool started_;
+};
+
+class NativePostingsCursorComparer {
+public:
+	bool operator()(const NativePostingsCursor* a, const NativePostingsCursor* b) const {
+		return a->Current() > b->Current();
+	}
+};
+
+class NativePostingsUnionReader : public NativePostingsReader {
+public:
+	NativePostingsUnionReader();
+	virtual bool Read(unsigned int& id);
+private:
+	std::priority_queue<NativePostingsCursor*, std::vector<NativePostingsCursor*>, NativePostingsCursorComparer> heap_;
+};
+
+class NativePostingsIntersectionReader : public NativePostingsReader {
+public:
+	NativePostingsIntersectionReader();
+	virtual bool Read(unsigned int& id);
+private:
+	bool finished_;
+};
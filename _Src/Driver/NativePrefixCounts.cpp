@@ -0,0 +1,231 @@
+#include "NativePrefixCounts.h"
+#include "NativeMetadata.h"
+#include <map>
+#include <mutex>
+#include <string.h>
+
+using namespace std;
+
+namespace {
+	const unsigned int bulkBufferSize = 1024 * 1024;
+
+	void CheckApiOk(int resultCode, const char* api) {
+		if (resultCode != 0)
+			throw NativeBdbApiException(resultCode, api);
+	}
+
+	//vector comparison is lexicographic by unsigned bytes, the same as bdb default btree order
+	typedef map<vector<Byte>, unsigned int> Counts;
+
+	void AppendNumber(vector<Byte>& target, unsigned long long value, unsigned int bytesCount) {
+		for (unsigned int i = 0; i < bytesCount; i++)
+			target.push_back(static_cast<Byte>(value >> (8 * i)));
+	}
+
+	bool TryReadNumber(const vector<Byte>& source, size_t& position, unsigned int bytesCount, unsigned long long& value) {
+		if (source.size() - position < bytesCount)
+			return false;
+		value = 0;
+		for (unsigned int i = 0; i < bytesCount; i++)
+			value |= static_cast<unsigned long long>(source[position + i]) << (8 * i);
+		position += bytesCount;
+		return true;
+	}
+}
+
+struct NativePrefixCounts::State {
+	State() :keysCount(0) {
+	}
+	mutable mutex sync;
+	Counts counts;
+	unsigned long long keysCount;
+
+	Counts::const_iterator Bound(const Byte* key, unsigned int length, bool upper) const {
+		vector<Byte> boundary(key, key + length);
+		return upper ? counts.upper_bound(boundary) : counts.lower_bound(boundary);
+	}
+};
+
+NativePrefixCounts::NativePrefixCounts(unsigned int prefixLength) :state_(new State()), prefixLength_(prefixLength) {
+}
+
+NativePrefixCounts::~NativePrefixCounts() {
+	delete state_;
+}
+
+NativePrefixCounts* NativePrefixCounts::Build(DB* db, unsigned int prefixLength) {
+	NativePrefixCounts* result = new NativePrefixCounts(prefixLength);
+	DBC* dbc;
+	DBT keyDbt;
+	memset(&keyDbt, 0, sizeof(DBT));
+	keyDbt.flags = DB_DBT_REALLOC;
+	try {
+		CheckApiOk(db->cursor(db, nullptr, &dbc, 0), "db.cursor");
+	}
+	catch (...) {
+		delete result;
+		throw;
+	}
+	vector<Byte> buffer(bulkBufferSize);
+	try {
+		for (;;) {
+			DBT bulkDbt;
+			memset(&bulkDbt, 0, sizeof(DBT));
+			bulkDbt.data = &buffer[0];
+			bulkDbt.ulen = buffer.size();
+			bulkDbt.flags = DB_DBT_USERMEM;
+			int resultCode = dbc->get(dbc, &keyDbt, &bulkDbt, DB_NEXT | DB_MULTIPLE_KEY);
+			if (resultCode == DB_NOTFOUND)
+				break;
+			if (resultCode == DB_BUFFER_SMALL) {
+				buffer.resize((bulkDbt.size + 1023) / 1024 * 1024);
+				continue;
+			}
+			CheckApiOk(resultCode, "cursor.get.DB_NEXT|DB_MULTIPLE_KEY");
+			void* position;
+			DB_MULTIPLE_INIT(position, &bulkDbt);
+			for (;;) {
+				void* key;
+				void* value;
+				u_int32_t keyLength, valueLength;
+				DB_MULTIPLE_KEY_NEXT(position, &bulkDbt, key, keyLength, value, valueLength);
+				if (key == nullptr)
+					break;
+				(void)value;
+				(void)valueLength;
+				result->Add(static_cast<Byte*>(key), keyLength);
+			}
+		}
+	}
+	catch (...) {
+		dbc->close(dbc);
+		free(keyDbt.data);
+		delete result;
+		throw;
+	}
+	free(keyDbt.data);
+	int resultCode = dbc->close(dbc);
+	if (resultCode != 0) {
+		delete result;
+		CheckApiOk(resultCode, "cursor.close");
+	}
+	return result;
+}
+
+//prefix length, keys count, prefixes count, then length prefixed prefixes each followed by its count
+NativePrefixCounts* NativePrefixCounts::Load(const vector<Byte>& source, unsigned int prefixLength) {
+	size_t position = 0;
+	unsigned long long savedPrefixLength, keysCount, prefixesCount;
+	if (!TryReadNumber(source, position, 4, savedPrefixLength) || savedPrefixLength != prefixLength)
+		return nullptr;
+	if (!TryReadNumber(source, position, 8, keysCount) || !TryReadNumber(source, position, 4, prefixesCount))
+		return nullptr;
+	NativePrefixCounts* result = new NativePrefixCounts(prefixLength);
+	unsigned long long countsSum = 0;
+	for (unsigned long long i = 0; i < prefixesCount; i++) {
+		unsigned long long length, count;
+		if (!TryReadNumber(source, position, 4, length) || length > prefixLength || source.size() - position < length) {
+			delete result;
+			return nullptr;
+		}
+		vector<Byte> prefix(source.begin() + position, source.begin() + position + static_cast<size_t>(length));
+		position += static_cast<size_t>(length);
+		if (!TryReadNumber(source, position, 4, count) || count == 0) {
+			delete result;
+			return nullptr;
+		}
+		result->state_->counts[prefix] = static_cast<unsigned int>(count);
+		countsSum += count;
+	}
+	if (position != source.size() || countsSum != keysCount || result->state_->counts.size() != prefixesCount) {
+		delete result;
+		return nullptr;
+	}
+	result->state_->keysCount = keysCount;
+	return result;
+}
+
+void NativePrefixCounts::Save(vector<Byte>& target) const {
+	lock_guard<mutex> lock(state_->sync);
+	AppendNumber(target, prefixLength_, 4);
+	AppendNumber(target, state_->keysCount, 8);
+	AppendNumber(target, state_->counts.size(), 4);
+	for (Counts::const_iterator it = state_->counts.begin(); it != state_->counts.end(); it++) {
+		NativeAppendField(target, it->first.empty() ? nullptr : &it->first[0], static_cast<unsigned int>(it->first.size()));
+		AppendNumber(target, it->second, 4);
+	}
+}
+
+int NativePrefixCounts::Put(DB* db, DB_TXN* txn, DBT* key, DBT* value, bool& inserted) {
+	inserted = false;
+	DBC* dbc;
+	int resultCode = db->cursor(db, txn, &dbc, 0);
+	if (resultCode != 0)
+		return resultCode;
+	DBT existingDbt;
+	memset(&existingDbt, 0, sizeof(DBT));
+	existingDbt.flags = DB_DBT_USERMEM | DB_DBT_PARTIAL;
+	resultCode = dbc->get(dbc, key, &existingDbt, DB_SET);
+	if (resultCode == 0)
+		resultCode = dbc->put(dbc, key, value, DB_CURRENT);
+	else if (resultCode == DB_NOTFOUND) {
+		resultCode = dbc->put(dbc, key, value, DB_KEYFIRST);
+		inserted = resultCode == 0;
+	}
+	int closeResultCode = dbc->close(dbc);
+	return resultCode != 0 ? resultCode : closeResultCode;
+}
+
+void NativePrefixCounts::Add(const Byte* key, unsigned int length) {
+	vector<Byte> prefix(key, key + min(length, prefixLength_));
+	lock_guard<mutex> lock(state_->sync);
+	state_->counts[prefix]++;
+	state_->keysCount++;
+}
+
+//empty prefixes are erased, so the map holds only prefixes of existing keys
+void NativePrefixCounts::Remove(const Byte* key, unsigned int length) {
+	vector<Byte> prefix(key, key + min(length, prefixLength_));
+	lock_guard<mutex> lock(state_->sync);
+	Counts::iterator it = state_->counts.find(prefix);
+	if (it == state_->counts.end())
+		return;
+	if (--it->second == 0)
+		state_->counts.erase(it);
+	state_->keysCount--;
+}
+
+//prefix p of keys lies entirely within [left, ...) when p >= left, as left is not longer than p,
+//or p is a whole key shorter than the prefix. Boundary of prefix length splits its own prefix
+//when it is exclusive on the left or inclusive on the right, keys longer than the boundary fall on both sides
+bool NativePrefixCounts::TryCount(const Byte* left, unsigned int leftLength, bool leftInclusive,
+	const Byte* right, unsigned int rightLength, bool rightInclusive, unsigned int& result) const {
+	if (left != nullptr && (leftLength > prefixLength_ || (leftLength == prefixLength_ && !leftInclusive)))
+		return false;
+	if (right != nullptr && (rightLength > prefixLength_ || (rightLength == prefixLength_ && rightInclusive)))
+		return false;
+	lock_guard<mutex> lock(state_->sync);
+	if (left == nullptr && right == nullptr) {
+		result = static_cast<unsigned int>(state_->keysCount);
+		return true;
+	}
+	Counts::const_iterator from = left == nullptr ? state_->counts.begin() : state_->Bound(left, leftLength, !leftInclusive);
+	Counts::const_iterator to = right == nullptr ? state_->counts.end() : state_->Bound(right, rightLength, rightInclusive);
+	result = 0;
+	//inverted range, e.g. Range.Empty(), has its right bound before the left one
+	if (to != state_->counts.end() && (from == state_->counts.end() || to->first < from->first))
+		return true;
+	for (Counts::const_iterator it = from; it != to; it++)
+		result += it->second;
+	return true;
+}
+
+unsigned int NativePrefixCounts::PrefixesCount() const {
+	lock_guard<mutex> lock(state_->sync);
+	return static_cast<unsigned int>(state_->counts.size());
+}
+
+unsigned long long NativePrefixCounts::KeysCount() const {
+	lock_guard<mutex> lock(state_->sync);
+	return state_->keysCount;
+}
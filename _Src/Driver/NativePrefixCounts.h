@@ -0,0 +1,33 @@
+#pragma once
+
+#include "NativeCursors.h"
+
+//keys count per key prefix of prefixLength bytes, keys shorter than it are counted under the whole key.
+//counts are kept in key order, so a range with boundaries not longer than the prefix is counted
+//by summing the prefixes within it, without touching btree pages
+class NativePrefixCounts {
+public:
+	NativePrefixCounts(unsigned int prefixLength);
+	~NativePrefixCounts();
+	//scans all keys of the database with bulk reads
+	static NativePrefixCounts* Build(DB* db, unsigned int prefixLength);
+	//counts saved by Save, returns null when they are malformed or saved for other prefix length
+	static NativePrefixCounts* Load(const std::vector<Byte>& source, unsigned int prefixLength);
+	void Save(std::vector<Byte>& target) const;
+	//overwrites existing key in place after a cursor lookup that doesn't read its value, inserted tells whether key is new
+	static int Put(DB* db, DB_TXN* txn, DBT* key, DBT* value, bool& inserted);
+	//called only for keys actually inserted or deleted
+	void Add(const Byte* key, unsigned int length);
+	void Remove(const Byte* key, unsigned int length);
+	//null boundary is unbounded, returns false when a boundary splits a prefix and the range must be counted by btree
+	bool TryCount(const Byte* left, unsigned int leftLength, bool leftInclusive,
+		const Byte* right, unsigned int rightLength, bool rightInclusive, unsigned int& result) const;
+	unsigned int PrefixesCount() const;
+	unsigned long long KeysCount() const;
+private:
+	NativePrefixCounts(const NativePrefixCounts&);
+	NativePrefixCounts& operator=(const NativePrefixCounts&);
+	struct State;
+	State* state_;
+	unsigned int prefixLength_;
+};
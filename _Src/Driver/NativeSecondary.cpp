@@ -0,0 +1,99 @@
+#include "NativeSecondary.h"
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+namespace {
+	void CheckApiOk(int resultCode, const char* api) {
+		if (resultCode != 0)
+			throw NativeBdbApiException(resultCode, api);
+	}
+
+	//DB->associate callback, result references the value when primary key is not appended
+	int ExtractSecondaryKey(DB* secondary, const DBT* key, const DBT* value, DBT* result) {
+		const NativeSecondaryKey* secondaryKey = NativeDatabaseState::Of(secondary)->secondaryKey;
+		if (value->size < secondaryKey->valueOffset + secondaryKey->valueLength)
+			return DB_DONOTINDEX;
+		u_int32_t length = secondaryKey->valueLength > 0 ? secondaryKey->valueLength : value->size - secondaryKey->valueOffset;
+		Byte* bytes = static_cast<Byte*>(value->data) + secondaryKey->valueOffset;
+		memset(result, 0, sizeof(DBT));
+		if (!secondaryKey->appendPrimaryKey) {
+			result->data = bytes;
+			result->size = length;
+			return 0;
+		}
+		Byte* data = static_cast<Byte*>(malloc(length + key->size));
+		if (data == nullptr)
+			return ENOMEM;
+		memcpy(data, bytes, length);
+		memcpy(data + length, key->data, key->size);
+		result->data = data;
+		result->size = length + key->size;
+		result->flags = DB_DBT_APPMALLOC;
+		return 0;
+	}
+}
+
+struct NativeSecondaryIndexes::State {
+	vector<DB*> secondaries;
+	vector<NativeSecondaryKey*> keys;
+};
+
+NativeSecondaryIndexes::NativeSecondaryIndexes(DB* primary) :primary_(primary), state_(new State()) {
+}
+
+NativeSecondaryIndexes::~NativeSecondaryIndexes() {
+	Close(0);
+	delete state_;
+}
+
+void NativeSecondaryIndexes::Open(const char* fileName, const char* name, const NativeSecondaryKey& key, u_int32_t openFlags, bool build) {
+	DB* secondary;
+	CheckApiOk(db_create(&secondary, primary_->get_env(primary_), 0), "db_create");
+	NativeSecondaryKey* ownKey = new NativeSecondaryKey(key);
+	NativeDatabaseState::Attach(secondary).secondaryKey = ownKey;
+	int resultCode = key.appendPrimaryKey ? 0 : secondary->set_flags(secondary, DB_DUPSORT);
+	const char* api = "db.set_flags";
+	if (resultCode == 0) {
+		resultCode = secondary->open(secondary, nullptr, fileName, name, DB_BTREE, openFlags, 0);
+		api = "db.open";
+	}
+	if (resultCode == 0) {
+		resultCode = primary_->associate(primary_, nullptr, secondary, &ExtractSecondaryKey, build ? DB_CREATE : 0);
+		api = "db.associate";
+	}
+	if (resultCode != 0) {
+		NativeDatabaseState::Of(secondary)->secondaryKey = nullptr;
+		NativeDatabaseState::Release(secondary);
+		delete ownKey;
+		secondary->close(secondary, 0);
+		throw NativeBdbApiException(resultCode, api);
+	}
+	state_->secondaries.push_back(secondary);
+	state_->keys.push_back(ownKey);
+}
+
+DB* NativeSecondaryIndexes::Secondary(unsigned int index) const {
+	return state_->secondaries[index];
+}
+
+unsigned int NativeSecondaryIndexes::Count() const {
+	return static_cast<unsigned int>(state_->secondaries.size());
+}
+
+int NativeSecondaryIndexes::Close(u_int32_t flags) {
+	int result = 0;
+	for (size_t i = 0; i < state_->secondaries.size(); i++) {
+		DB* secondary = state_->secondaries[i];
+		NativeDatabaseState::Of(secondary)->secondaryKey = nullptr;
+		NativeDatabaseState::Release(secondary);
+		int resultCode = secondary->close(secondary, flags);
+		if (result == 0)
+			result = resultCode;
+		delete state_->keys[i];
+	}
+	state_->secondaries.clear();
+	state_->keys.clear();
+	return result;
+}
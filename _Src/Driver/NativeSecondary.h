@@ -0,0 +1,32 @@
+#pragma once
+
+#include "NativeCursors.h"
+
+//secondary key of a primary record is bytes [valueOffset, valueOffset + valueLength) of its value, followed by the primary key
+//when appendPrimaryKey. 0 valueLength means up to the end of the value, records with shorter values are not indexed
+struct NativeSecondaryKey {
+	unsigned int valueOffset;
+	unsigned int valueLength;
+	bool appendPrimaryKey;
+};
+
+//secondary databases of one primary, bdb updates them within every put and del of the primary through DB->associate.
+//secondary without appended primary key holds sorted duplicates, primary with duplicates can't be associated
+class NativeSecondaryIndexes {
+public:
+	explicit NativeSecondaryIndexes(DB* primary);
+	//closes secondaries left open
+	~NativeSecondaryIndexes();
+	//empty secondary is built from existing primary records when build is set
+	void Open(const char* fileName, const char* name, const NativeSecondaryKey& key, u_int32_t openFlags, bool build);
+	DB* Secondary(unsigned int index) const;
+	unsigned int Count() const;
+	//secondaries are closed before the primary, returns the first failed close result code
+	int Close(u_int32_t flags);
+private:
+	NativeSecondaryIndexes(const NativeSecondaryIndexes&);
+	NativeSecondaryIndexes& operator=(const NativeSecondaryIndexes&);
+	struct State;
+	DB* primary_;
+	State* state_;
+};
@@ -0,0 +1,285 @@
+#include "NativeWorkers.h"
+#include <memory>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+namespace {
+	struct CallbackExit {
+		CallbackExit(NativeWorkCallback* callback) :callback(callback) {
+		}
+		~CallbackExit() {
+			if (callback != nullptr)
+				callback->Exit();
+		}
+		NativeWorkCallback* callback;
+	};
+}
+
+NativeWorkItem::NativeWorkItem(const volatile bool* ownerStopped)
+	:callback_(nullptr), ownerStopped_(ownerStopped), cancelled_(false), status_(Pending), errorNumber_(0), api_(nullptr) {
+}
+
+NativeWorkItem::~NativeWorkItem() {
+	if (callback_ != nullptr)
+		delete callback_;
+}
+
+void NativeWorkItem::SetCallback(NativeWorkCallback* callback) {
+	callback_ = callback;
+}
+
+void NativeWorkItem::Cancel() {
+	cancelled_ = true;
+}
+
+bool NativeWorkItem::IsCancelled() const {
+	return cancelled_ || (ownerStopped_ != nullptr && *ownerStopped_);
+}
+
+void NativeWorkItem::Execute() {
+	if (IsCancelled() || (callback_ != nullptr && !callback_->Enter(*this)))
+		status_ = Cancelled;
+	else {
+		CallbackExit exit(callback_);
+		try {
+			Run();
+			//partial result of interrupted item is useless
+			status_ = IsCancelled() ? Cancelled : Completed;
+		}
+		catch (const NativeBdbApiException& e) {
+			status_ = ApiFailed;
+			errorNumber_ = e.ErrorNumber();
+			api_ = e.Api();
+		}
+		catch (const NativeBdbException& e) {
+			status_ = Failed;
+			message_ = e.Message();
+		}
+		catch (const exception& e) {
+			status_ = Failed;
+			message_ = e.what();
+		}
+	}
+	Finish();
+}
+
+void NativeWorkItem::Abandon() {
+	status_ = Abandoned;
+	Finish();
+}
+
+void NativeWorkItem::Finish() {
+	if (callback_ != nullptr)
+		callback_->Finish(*this);
+}
+
+struct NativeWorkerPool::State {
+	struct Entry {
+		NativeWorkItem* item;
+		int priority;
+		unsigned long long sequence;
+	};
+	struct EntryLess {
+		bool operator()(const Entry& x, const Entry& y) const {
+			return x.priority != y.priority ? x.priority < y.priority : x.sequence > y.sequence;
+		}
+	};
+	State(unsigned int maxQueueLength) :maxQueueLength(maxQueueLength), sequence(0), stopped(false) {
+	}
+	mutex sync;
+	condition_variable available;
+	priority_queue<Entry, vector<Entry>, EntryLess> queue;
+	vector<thread> threads;
+	unsigned int maxQueueLength;
+	unsigned long long sequence;
+	bool stopped;
+};
+
+NativeWorkerPool::NativeWorkerPool(unsigned int threadsCount, unsigned int maxQueueLength) :state_(new State(maxQueueLength)) {
+	for (unsigned int i = 0; i < threadsCount; i++)
+		state_->threads.push_back(thread(&NativeWorkerPool::Run, state_));
+}
+
+NativeWorkerPool::~NativeWorkerPool() {
+	vector<NativeWorkItem*> abandoned;
+	{
+		lock_guard<mutex> lock(state_->sync);
+		state_->stopped = true;
+		for (; !state_->queue.empty(); state_->queue.pop())
+			abandoned.push_back(state_->queue.top().item);
+	}
+	state_->available.notify_all();
+	for (auto it = abandoned.begin(); it != abandoned.end(); it++) {
+		(*it)->Abandon();
+		delete *it;
+	}
+	for (auto it = state_->threads.begin(); it != state_->threads.end(); it++)
+		it->join();
+	delete state_;
+}
+
+bool NativeWorkerPool::TryEnqueue(NativeWorkItem* item, int priority) {
+	{
+		lock_guard<mutex> lock(state_->sync);
+		if (state_->stopped || state_->queue.size() >= state_->maxQueueLength)
+			return false;
+		State::Entry entry = { item, priority, state_->sequence++ };
+		state_->queue.push(entry);
+	}
+	state_->available.notify_one();
+	return true;
+}
+
+void NativeWorkerPool::Run(State* state) {
+	for (;;) {
+		NativeWorkItem* item;
+		{
+			unique_lock<mutex> lock(state->sync);
+			while (!state->stopped && state->queue.empty())
+				state->available.wait(lock);
+			if (state->stopped)
+				return;
+			item = state->queue.top().item;
+			state->queue.pop();
+		}
+		item->Execute();
+		delete item;
+	}
+}
+
+NativeFindWorkItem::NativeFindWorkItem(DB* db, const Byte* key, unsigned int keyLength, unsigned int valueCapacity, const volatile bool* ownerStopped)
+	:NativeWorkItem(ownerStopped), db_(db), key_(key, key + keyLength), value_(valueCapacity), found_(false) {
+}
+
+void NativeFindWorkItem::Run() {
+	DBT keyDbt;
+	memset(&keyDbt, 0, sizeof(DBT));
+	keyDbt.data = key_.empty() ? nullptr : &key_[0];
+	keyDbt.size = key_.size();
+	for (;;) {
+		DBT valueDbt;
+		memset(&valueDbt, 0, sizeof(DBT));
+		valueDbt.data = value_.empty() ? nullptr : &value_[0];
+		valueDbt.ulen = value_.size();
+		valueDbt.flags = DB_DBT_USERMEM;
+		int resultCode = db_->get(db_, nullptr, &keyDbt, &valueDbt, 0);
+		if (resultCode == DB_BUFFER_SMALL) {
+			value_.resize(valueDbt.size);
+			continue;
+		}
+		if (resultCode == DB_NOTFOUND) {
+			found_ = false;
+			value_.clear();
+			return;
+		}
+		if (resultCode != 0)
+			throw NativeBdbApiException(resultCode, "db.get");
+		found_ = true;
+		value_.resize(valueDbt.size);
+		return;
+	}
+}
+
+NativeRangeReaderFactory::NativeRangeReaderFactory(DB* db, const Byte* leftBytes, int leftLength, bool leftInclusive, const Byte* rightBytes, int rightLength, bool rightInclusive,
+	int direction, int skip, int take)
+	:db_(db), left_(leftBytes, leftBytes + leftLength), leftInclusive_(leftInclusive), right_(rightBytes, rightBytes + rightLength), rightInclusive_(rightInclusive),
+	direction_(direction), skip_(skip), take_(take) {
+}
+
+NativeRangeCursorReader* NativeRangeReaderFactory::Create() {
+	return new NativeRangeCursorReader(db_, left_.empty() ? nullptr : &left_[0], left_.size(), leftInclusive_,
+		right_.empty() ? nullptr : &right_[0], right_.size(), rightInclusive_, direction_, skip_, take_);
+}
+
+NativeMergingReaderFactory::NativeMergingReaderFactory(unsigned int keySuffixOffset, const NativeKeySchema& keySchema, bool needKeys, bool needValues, int direction)
+	:keySuffixOffset_(keySuffixOffset), keySchema_(keySchema), needKeys_(needKeys), needValues_(needValues), direction_(direction) {
+}
+
+NativeMergingReaderFactory::~NativeMergingReaderFactory() {
+	for (auto it = ranges_.begin(); it != ranges_.end(); it++)
+		delete *it;
+}
+
+void NativeMergingReaderFactory::AddRange(NativeRangeReaderFactory* range) {
+	ranges_.push_back(range);
+}
+
+//merging reader takes ownership of readers array
+NativeSuffixMergingRangeCursorReader* NativeMergingReaderFactory::Create() {
+	unsigned int readersCount = ranges_.size();
+	NativeRangeCursorReader** readers = new NativeRangeCursorReader*[readersCount];
+	unsigned int createdCount = 0;
+	try {
+		for (; createdCount < readersCount; createdCount++)
+			readers[createdCount] = ranges_[createdCount]->Create();
+		return new NativeSuffixMergingRangeCursorReader(keySuffixOffset_, keySchema_, false, needKeys_, needValues_, readers, readersCount, direction_);
+	}
+	catch (...) {
+		for (unsigned int i = 0; i < createdCount; i++)
+			delete readers[i];
+		delete[] readers;
+		throw;
+	}
+}
+
+template <typename TReader>
+NativeFetchWorkItem<TReader>::NativeFetchWorkItem(NativeReaderFactory<TReader>* factory, unsigned int chunksCount, unsigned int keyChunkSize, unsigned int valueChunkSize,
+	bool needKeys, bool needValues, int take, unsigned int skip, unsigned int readRetriesCount, const volatile bool* ownerStopped)
+	:NativeWorkItem(ownerStopped), factory_(factory), chunksCount_(chunksCount), keyChunkSize_(keyChunkSize), valueChunkSize_(valueChunkSize),
+	needKeys_(needKeys), needValues_(needValues), take_(take), skip_(skip), readRetriesCount_(readRetriesCount), rowsCount_(0) {
+}
+
+template <typename TReader>
+NativeFetchWorkItem<TReader>::~NativeFetchWorkItem() {
+	delete factory_;
+}
+
+template <typename TReader>
+void NativeFetchWorkItem<TReader>::Run() {
+	unique_ptr<TReader> reader(factory_->Create());
+	unique_ptr<NativeReaderFetcher<TReader>> fetcher;
+	vector<Byte> keyBuffer;
+	vector<Byte> valueBuffer;
+	unsigned int attemptsCount = 0;
+	for (;;)
+		try {
+			keyBuffer.resize(chunksCount_ * keyChunkSize_);
+			valueBuffer.resize(chunksCount_ * valueChunkSize_);
+			reader->ConnectDbtsTo(&keyBuffer[0], keyChunkSize_, &valueBuffer[0], valueChunkSize_);
+			if (take_ < 0) {
+				unsigned int totalCount = reader->GetTotalCount();
+				take_ = totalCount > skip_ ? totalCount - skip_ : 0;
+			}
+			if (take_ == 0)
+				return;
+			if (fetcher.get() == nullptr) {
+				fetcher.reset(new NativeReaderFetcher<TReader>(*reader, needKeys_, needValues_, take_));
+				fetcher->SetCancellation(this);
+				positions_.resize((needKeys_ && needValues_ ? 4 : 2) * take_);
+			}
+			unsigned int storeSize = ((needKeys_ ? keyChunkSize_ : 0) + (needValues_ ? valueChunkSize_ : 0)) * take_;
+			if (store_.size() < storeSize)
+				store_.resize(storeSize);
+			rowsCount_ = fetcher->FetchInto(&store_[0], &positions_[0]);
+			return;
+		}
+		catch (const NativeBufferSmallException& e) {
+			if (++attemptsCount >= ((take_ < 0 ? 0 : take_) + 1) * readRetriesCount_ * 10)
+				throw NativeBdbException("fetch assertion failure, buffers grow too many times");
+			if (e.KeySize() > keyChunkSize_) {
+				NativeGrowChunks(keyBuffer, chunksCount_, keyChunkSize_, e.KeySize());
+				keyChunkSize_ = e.KeySize();
+			}
+			if (e.ValueSize() > valueChunkSize_) {
+				NativeGrowChunks(valueBuffer, chunksCount_, valueChunkSize_, e.ValueSize());
+				valueChunkSize_ = e.ValueSize();
+			}
+		}
+}
+
+template class NativeFetchWorkItem < NativeSuffixMergingRangeCursorReader > ;
+template class NativeFetchWorkItem < NativeRangeCursorReader > ;
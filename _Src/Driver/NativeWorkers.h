@@ -0,0 +1,161 @@
+#pragma once
+
+#include "NativeCursors.h"
+#include <string>
+#include <vector>
+
+class NativeWorkItem;
+
+//picks up results of finished item, called on worker thread right before the item is deleted
+class NativeWorkCallback {
+public:
+	virtual ~NativeWorkCallback() {
+	}
+	virtual void Finish(NativeWorkItem& item) = 0;
+	//called on worker thread before the item is run, e.g. to take client read lock, so native reads don't overlap writes.
+	//false means the item was cancelled while waiting, Exit is called after the run only when Enter returned true
+	virtual bool Enter(NativeWorkItem&) {
+		return true;
+	}
+	virtual void Exit() {
+	}
+};
+
+//unit of native work queued to NativeWorkerPool, pool owns the item once it is queued
+class NativeWorkItem : public NativeCancellation {
+public:
+	enum Status { Pending, Completed, Cancelled, Abandoned, ApiFailed, Failed };
+	//ownerStopped is raised by owner of native handles used by the item, e.g. closing database
+	NativeWorkItem(const volatile bool* ownerStopped);
+	virtual ~NativeWorkItem();
+	//takes ownership of callback
+	void SetCallback(NativeWorkCallback* callback);
+	void Execute();
+	//pool is stopped before the item is started
+	void Abandon();
+	void Cancel();
+	virtual bool IsCancelled() const;
+	Status GetStatus() const { return status_; }
+	int ErrorNumber() const { return errorNumber_; }
+	const char* Api() const { return api_; }
+	const std::string& Message() const { return message_; }
+protected:
+	virtual void Run() = 0;
+private:
+	NativeWorkItem(const NativeWorkItem&);
+	NativeWorkItem& operator=(const NativeWorkItem&);
+	void Finish();
+	NativeWorkCallback* callback_;
+	const volatile bool* ownerStopped_;
+	volatile bool cancelled_;
+	Status status_;
+	int errorNumber_;
+	const char* api_;
+	std::string message_;
+};
+
+//fixed set of native threads, so blocking page reads of many concurrent calls don't pin managed threads.
+//queue is bounded, higher priority items are served first, fifo within the same priority
+class NativeWorkerPool {
+public:
+	NativeWorkerPool(unsigned int threadsCount, unsigned int maxQueueLength);
+	//abandons queued items and waits for running ones
+	~NativeWorkerPool();
+	//false when queue is full, item is not taken then
+	bool TryEnqueue(NativeWorkItem* item, int priority);
+private:
+	NativeWorkerPool(const NativeWorkerPool&);
+	NativeWorkerPool& operator=(const NativeWorkerPool&);
+	struct State;
+	static void Run(State* state);
+	State* state_;
+};
+
+class NativeFindWorkItem : public NativeWorkItem {
+public:
+	NativeFindWorkItem(DB* db, const Byte* key, unsigned int keyLength, unsigned int valueCapacity, const volatile bool* ownerStopped);
+	bool Found() const { return found_; }
+	const std::vector<Byte>& Value() const { return value_; }
+protected:
+	virtual void Run();
+private:
+	DB* db_;
+	std::vector<Byte> key_;
+	std::vector<Byte> value_;
+	bool found_;
+};
+
+//creates reader of NativeFetchWorkItem on worker thread, so bdb cursors are opened only after NativeWorkCallback::Enter
+//and are not held while the item waits in the queue
+template <typename TReader>
+class NativeReaderFactory {
+public:
+	virtual ~NativeReaderFactory() {
+	}
+	virtual TReader* Create() = 0;
+};
+
+//boundaries are copied, so the factory doesn't refer to managed arrays of the range
+class NativeRangeReaderFactory : public NativeReaderFactory<NativeRangeCursorReader> {
+public:
+	NativeRangeReaderFactory(DB* db, const Byte* leftBytes, int leftLength, bool leftInclusive, const Byte* rightBytes, int rightLength, bool rightInclusive,
+		int direction, int skip, int take);
+	virtual NativeRangeCursorReader* Create();
+private:
+	DB* db_;
+	std::vector<Byte> left_;
+	bool leftInclusive_;
+	std::vector<Byte> right_;
+	bool rightInclusive_;
+	int direction_;
+	int skip_;
+	int take_;
+};
+
+class NativeMergingReaderFactory : public NativeReaderFactory<NativeSuffixMergingRangeCursorReader> {
+public:
+	NativeMergingReaderFactory(unsigned int keySuffixOffset, const NativeKeySchema& keySchema, bool needKeys, bool needValues, int direction);
+	virtual ~NativeMergingReaderFactory();
+	//takes ownership of range, ranges are merged in the order of adding
+	void AddRange(NativeRangeReaderFactory* range);
+	virtual NativeSuffixMergingRangeCursorReader* Create();
+private:
+	NativeMergingReaderFactory(const NativeMergingReaderFactory&);
+	NativeMergingReaderFactory& operator=(const NativeMergingReaderFactory&);
+	unsigned int keySuffixOffset_;
+	NativeKeySchema keySchema_;
+	bool needKeys_;
+	bool needValues_;
+	int direction_;
+	std::vector<NativeRangeReaderFactory*> ranges_;
+};
+
+//native counterpart of AbstractCursor::Fetch, buffers are native and grown on NativeBufferSmallException the same way
+template <typename TReader>
+class NativeFetchWorkItem : public NativeWorkItem {
+public:
+	//takes ownership of factory, reader is created and closed within Run. take < 0 means all records after skip
+	NativeFetchWorkItem(NativeReaderFactory<TReader>* factory, unsigned int chunksCount, unsigned int keyChunkSize, unsigned int valueChunkSize,
+		bool needKeys, bool needValues, int take, unsigned int skip, unsigned int readRetriesCount, const volatile bool* ownerStopped);
+	virtual ~NativeFetchWorkItem();
+	unsigned int RowsCount() const { return rowsCount_; }
+	const std::vector<Byte>& Store() const { return store_; }
+	const std::vector<unsigned int>& Positions() const { return positions_; }
+	unsigned int KeyChunkSize() const { return keyChunkSize_; }
+	unsigned int ValueChunkSize() const { return valueChunkSize_; }
+protected:
+	virtual void Run();
+private:
+	NativeReaderFactory<TReader>* factory_;
+	unsigned int chunksCount_;
+	unsigned int keyChunkSize_;
+	unsigned int valueChunkSize_;
+	bool needKeys_;
+	bool needValues_;
+	int take_;
+	unsigned int skip_;
+	unsigned int readRetriesCount_;
+	unsigned int rowsCount_;
+	std::vector<Byte> store_;
+	std::vector<unsigned int> positions_;
+};
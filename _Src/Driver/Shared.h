@@ -18,6 +18,8 @@ namespace SimpleBdb {
 		public interface class ICursor : public SimpleBdb::Utils::IForwardReader<SimpleBdb::Utils::BytesRecord^> {
 			unsigned int GetTotalCount();
 			SimpleBdb::Utils::BytesTable^ Fetch(FetchOptions options);
+			//fills and returns target, its arrays are reused when big enough
+			SimpleBdb::Utils::BytesTable^ Fetch(FetchOptions options, SimpleBdb::Utils::BytesTable^ target);
 		};
 
 		//here, because can't inherit from forward declared class
@@ -31,14 +33,16 @@ namespace SimpleBdb {
 				System::String^ description_;
 				inline bool IsDisposed();
 				virtual void CheckOpen();
+				System::String^ FormatApiMessage(int resultCode, System::String^ api);
 			protected:
 				BdbComponent([NotNull] SimpleBdb::Utils::ILogger^ logger, [NotNull] System::String^ description);
 				virtual void Close() abstract;
 				void CheckApiOk(int resultCode, System::String^ api);
-				System::String^ FormatApiMessage(int resultCode, System::String^ api);
 
 				typedef void(*BdbLogFunc)(const DB_ENV *, const char *, const char *);
 				BdbLogFunc GetLogFunc();
+				//Close is called by the finalizer, referenced managed objects may be already finalized
+				bool finalizing_;
 			private:
 				[System::Runtime::InteropServices::UnmanagedFunctionPointer(System::Runtime::InteropServices::CallingConvention::Cdecl)]
 				delegate void LogErrorDelegate(const DB_ENV *, const char *prefix, const char *message);
@@ -1,4 +1,6 @@
-﻿using System.Collections.Generic;
+﻿using System;
+using System.Collections.Generic;
+using System.Threading.Tasks;
 using JetBrains.Annotations;
 using SimpleBdb.Driver;
 using SimpleBdb.Utils;
@@ -19,6 +21,34 @@ namespace SimpleBdb.Extensions
 			return database.Query(range, direction, skip, -1);
 		}
 
+		//reads partitions of the range on dedicated threads, handler gets partition index and is called concurrently,
+		//records within a partition come in key order and partitions are numbered in key order
+		public static void ScanParallel([NotNull] this Database database, [NotNull] Range range, int partitionsCount,
+			[NotNull] Action<int, BytesRecord> handler)
+		{
+			var partitions = database.QueryPartitions(range, partitionsCount);
+			try
+			{
+				var tasks = new Task[partitions.Length];
+				for (var i = 0; i < partitions.Length; i++)
+				{
+					var index = i;
+					tasks[i] = Task.Factory.StartNew(() =>
+					{
+						BytesRecord record;
+						while (partitions[index].Read(out record))
+							handler(index, record);
+					}, TaskCreationOptions.LongRunning);
+				}
+				Task.WaitAll(tasks);
+			}
+			finally
+			{
+				foreach (var partition in partitions)
+					partition.Dispose();
+			}
+		}
+
 		public static uint GetCount([NotNull] this Database database, [NotNull] Range range)
 		{
 			using (var cursor = database.Query(range, Direction.Ascending))
@@ -0,0 +1,133 @@
+#include "SimpleBdbNative.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//usage: simplebdb_native_benchmark <directory> [recordsCount] [batchSize]
+//loads records with batch puts, then measures point gets, paged range fetch and merged fetch
+namespace {
+	typedef chrono::steady_clock Clock;
+
+	void Check(int status, const char* call) {
+		if (status == SBDB_OK || status == SBDB_NOT_FOUND)
+			return;
+		fprintf(stderr, "%s failed, status [%d], %s\n", call, status, sbdb_last_error());
+		exit(1);
+	}
+
+	double SecondsSince(Clock::time_point start) {
+		return chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	void Report(const char* name, unsigned long long operations, double seconds) {
+		printf("%-16s %12llu ops %10.3f s %14.0f ops/s\n", name, operations, seconds, operations / seconds);
+	}
+
+	//8 byte big endian id after 1 byte shard prefix, so shards can be merged by suffix
+	void WriteKey(unsigned char* target, unsigned int shard, unsigned long long id) {
+		target[0] = static_cast<unsigned char>('a' + shard);
+		for (int i = 0; i < 8; i++)
+			target[1 + i] = static_cast<unsigned char>(id >> (56 - 8 * i));
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <directory> [recordsCount] [batchSize]\n", argv[0]);
+		return 1;
+	}
+	string fileName = string(argv[1]) + "/benchmark.db";
+	unsigned int recordsCount = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 1000000;
+	unsigned int batchSize = argc > 3 ? static_cast<unsigned int>(atoi(argv[3])) : 1000;
+	const unsigned int shardsCount = 30;
+	const unsigned int keyLength = 9;
+	const unsigned int valueLength = 32;
+	remove(fileName.c_str());
+
+	sbdb_env* env;
+	Check(sbdb_env_open(fileName.c_str(), 512ull * 1024 * 1024, &env), "sbdb_env_open");
+	sbdb_db* db;
+	Check(sbdb_db_open(env, "benchmark", 0, 0, &db), "sbdb_db_open");
+
+	vector<unsigned char> batch(batchSize * (keyLength + valueLength));
+	vector<sbdb_segment> keys(batchSize), values(batchSize);
+	Clock::time_point start = Clock::now();
+	for (unsigned int loaded = 0; loaded < recordsCount;) {
+		unsigned int count = min(batchSize, recordsCount - loaded);
+		for (unsigned int i = 0; i < count; i++) {
+			unsigned int id = loaded + i;
+			unsigned char* record = &batch[i * (keyLength + valueLength)];
+			WriteKey(record, id % shardsCount, id);
+			memset(record + keyLength, static_cast<int>(id), valueLength);
+			keys[i].start = i * (keyLength + valueLength);
+			keys[i].length = keyLength;
+			values[i].start = keys[i].start + keyLength;
+			values[i].length = valueLength;
+		}
+		Check(sbdb_put_batch(db, &batch[0], &keys[0], &values[0], count), "sbdb_put_batch");
+		loaded += count;
+	}
+	Report("put_batch", recordsCount, SecondsSince(start));
+
+	unsigned char key[keyLength];
+	unsigned char value[valueLength];
+	unsigned int length;
+	unsigned int getsCount = min(recordsCount, 1000000u);
+	start = Clock::now();
+	for (unsigned int i = 0; i < getsCount; i++) {
+		unsigned int id = static_cast<unsigned int>((i * 2654435761ull) % recordsCount);
+		WriteKey(key, id % shardsCount, id);
+		Check(sbdb_get(db, key, keyLength, value, valueLength, &length), "sbdb_get");
+	}
+	Report("get", getsCount, SecondsSince(start));
+
+	const unsigned int pageSize = 1000;
+	sbdb_range line;
+	memset(&line, 0, sizeof(line));
+	sbdb_cursor* cursor;
+	Check(sbdb_cursor_open(db, &line, 1, 0, -1, SBDB_FETCH_KEYS_AND_VALUES, &cursor), "sbdb_cursor_open");
+	vector<unsigned char> store(pageSize * sbdb_cursor_row_size(cursor));
+	vector<sbdb_segment> positions(pageSize * 2);
+	unsigned long long fetched = 0;
+	start = Clock::now();
+	for (;;) {
+		unsigned int rowsCount;
+		Check(sbdb_cursor_fetch(cursor, pageSize, &store[0], static_cast<unsigned int>(store.size()), &positions[0], &rowsCount), "sbdb_cursor_fetch");
+		if (rowsCount == 0)
+			break;
+		fetched += rowsCount;
+	}
+	Report("range_fetch", fetched, SecondsSince(start));
+	Check(sbdb_cursor_close(cursor), "sbdb_cursor_close");
+
+	unsigned char prefixes[shardsCount];
+	vector<sbdb_range> ranges(shardsCount);
+	for (unsigned int i = 0; i < shardsCount; i++) {
+		prefixes[i] = static_cast<unsigned char>('a' + i);
+		ranges[i].left.data = ranges[i].right.data = &prefixes[i];
+		ranges[i].left.length = ranges[i].right.length = 1;
+		ranges[i].left.inclusive = ranges[i].right.inclusive = 1;
+	}
+	const unsigned int mergesCount = 1000;
+	fetched = 0;
+	start = Clock::now();
+	for (unsigned int i = 0; i < mergesCount; i++) {
+		Check(sbdb_cursor_open_merged(db, &ranges[0], shardsCount, -1, 1, SBDB_FETCH_VALUES, &cursor), "sbdb_cursor_open_merged");
+		unsigned int rowsCount;
+		Check(sbdb_cursor_fetch(cursor, 100, &store[0], static_cast<unsigned int>(store.size()), &positions[0], &rowsCount), "sbdb_cursor_fetch");
+		fetched += rowsCount;
+		Check(sbdb_cursor_close(cursor), "sbdb_cursor_close");
+	}
+	Report("merged_fetch_100", mergesCount, SecondsSince(start));
+
+	Check(sbdb_db_close(db), "sbdb_db_close");
+	Check(sbdb_env_close(env), "sbdb_env_close");
+	remove(fileName.c_str());
+	return 0;
+}
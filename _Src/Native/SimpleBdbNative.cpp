@@ -0,0 +1,439 @@
+#include "SimpleBdbNative.h"
+#include "NativeCursors.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	const unsigned int defaultKeyChunkSize = 64;
+	const unsigned int defaultValueChunkSize = 256;
+	//same as DatabaseConfig.MaxIdleCursors default
+	const unsigned int maxIdleCursors = 128;
+	const unsigned int gb = 1024 * 1024 * 1024;
+
+	thread_local string lastError;
+	thread_local int lastErrorCode = 0;
+
+	int Fail(int status, const string& message, int errorCode = 0) {
+		lastError = message;
+		lastErrorCode = errorCode;
+		return status;
+	}
+
+	void CheckApiOk(int resultCode, const char* api) {
+		if (resultCode != 0)
+			throw NativeBdbApiException(resultCode, api);
+	}
+
+	//converts native exceptions to statuses, so nothing is thrown across the C boundary
+	template <typename F>
+	int Invoke(F f) {
+		try {
+			return f();
+		}
+		catch (const NativeBdbApiException& e) {
+			ostringstream message;
+			message << "api [" << e.Api() << "] failed, error code [" << e.ErrorNumber() << "], " << db_strerror(e.ErrorNumber());
+			return Fail(SBDB_API_FAILED, message.str(), e.ErrorNumber());
+		}
+		catch (const NativeBdbException& e) {
+			return Fail(SBDB_FAILED, e.Message());
+		}
+		catch (const bad_alloc&) {
+			return Fail(SBDB_FAILED, "out of memory");
+		}
+		catch (const exception& e) {
+			return Fail(SBDB_FAILED, e.what());
+		}
+	}
+
+	void EnsureAtLeast(atomic<unsigned int>& target, unsigned int value) {
+		unsigned int current = target.load(memory_order_relaxed);
+		while (current < value && !target.compare_exchange_weak(current, value, memory_order_relaxed))
+			;
+	}
+
+	DBT MakeDbt(const unsigned char* data, unsigned int length) {
+		DBT result;
+		memset(&result, 0, sizeof(DBT));
+		result.data = const_cast<unsigned char*>(data);
+		result.size = length;
+		return result;
+	}
+
+	NativeRangeCursorReader* CreateReader(DB* db, const sbdb_range& range, int direction, unsigned int skip, int take) {
+		return new NativeRangeCursorReader(db,
+			const_cast<Byte*>(range.left.data), range.left.length, range.left.inclusive != 0,
+			const_cast<Byte*>(range.right.data), range.right.length, range.right.inclusive != 0,
+			direction, skip, take);
+	}
+}
+
+struct sbdb_env {
+	DB_ENV* dbEnv;
+	string fileName;
+};
+
+//chunk sizes grow to the longest record seen, so later cursors don't hit the same NativeBufferSmallException
+struct sbdb_db {
+	DB* db;
+	sbdb_env* env;
+	unique_ptr<NativeCursorPool> cursorPool;
+	atomic<unsigned int> keyChunkSize;
+	atomic<unsigned int> valueChunkSize;
+};
+
+struct sbdb_cursor {
+	virtual ~sbdb_cursor() {
+	}
+	virtual int Fetch(unsigned int maxRows, Byte* store, unsigned int storeCapacity, sbdb_segment* positions, unsigned int* rowsCount) = 0;
+	virtual unsigned int RowSize() const = 0;
+	virtual unsigned int GetTotalCount() = 0;
+};
+
+namespace {
+	//native counterpart of AbstractCursor, reader dbts are connected to chunksCount chunks of owned buffers
+	template <typename TReader>
+	class ReaderCursor : public sbdb_cursor {
+	public:
+		ReaderCursor(sbdb_db* db, TReader* reader, unsigned int chunksCount, unsigned int options)
+			:db_(db), reader_(reader), chunksCount_(chunksCount),
+			needKeys_((options & SBDB_FETCH_KEYS) != 0), needValues_((options & SBDB_FETCH_VALUES) != 0),
+			keyChunkSize_(db->keyChunkSize.load(memory_order_relaxed)), valueChunkSize_(db->valueChunkSize.load(memory_order_relaxed)) {
+			Connect();
+		}
+
+		virtual int Fetch(unsigned int maxRows, Byte* store, unsigned int storeCapacity, sbdb_segment* positions, unsigned int* rowsCount) {
+			*rowsCount = 0;
+			for (;;) {
+				unsigned int take = min(maxRows, storeCapacity / RowSize());
+				if (take == 0) {
+					if (maxRows == 0)
+						return SBDB_OK;
+					ostringstream message;
+					message << "store capacity [" << storeCapacity << "] is less than row size [" << RowSize() << "]";
+					return Fail(SBDB_BUFFER_SMALL, message.str());
+				}
+				NativeReaderFetcher<TReader> fetcher(*reader_, needKeys_, needValues_, take);
+				try {
+					*rowsCount = fetcher.FetchInto(store, reinterpret_cast<unsigned int*>(positions));
+					return SBDB_OK;
+				}
+				catch (const NativeBufferSmallException& e) {
+					*rowsCount = fetcher.CompactColumns();
+					Grow(e.KeySize(), e.ValueSize());
+				}
+				//row size changed, so the rest goes to the next call
+				if (*rowsCount > 0)
+					return SBDB_OK;
+			}
+		}
+
+		virtual unsigned int RowSize() const {
+			return (needKeys_ ? keyChunkSize_ : 0) + (needValues_ ? valueChunkSize_ : 0);
+		}
+
+		virtual unsigned int GetTotalCount() {
+			for (;;)
+				try {
+					return reader_->GetTotalCount();
+				}
+				catch (const NativeBufferSmallException& e) {
+					Grow(e.KeySize(), e.ValueSize());
+				}
+		}
+
+	private:
+		void Grow(unsigned int keySize, unsigned int valueSize) {
+			NativeGrowChunks(keyBuffer_, chunksCount_, keyChunkSize_, keySize);
+			NativeGrowChunks(valueBuffer_, chunksCount_, valueChunkSize_, valueSize);
+			keyChunkSize_ = max(keyChunkSize_, keySize);
+			valueChunkSize_ = max(valueChunkSize_, valueSize);
+			EnsureAtLeast(db_->keyChunkSize, keyChunkSize_);
+			EnsureAtLeast(db_->valueChunkSize, valueChunkSize_);
+			Connect();
+		}
+
+		void Connect() {
+			keyBuffer_.resize(keyChunkSize_ * chunksCount_);
+			valueBuffer_.resize(valueChunkSize_ * chunksCount_);
+			reader_->ConnectDbtsTo(&keyBuffer_[0], keyChunkSize_, &valueBuffer_[0], valueChunkSize_);
+		}
+
+		sbdb_db* db_;
+		unique_ptr<TReader> reader_;
+		unsigned int chunksCount_;
+		bool needKeys_;
+		bool needValues_;
+		unsigned int keyChunkSize_;
+		unsigned int valueChunkSize_;
+		vector<Byte> keyBuffer_;
+		vector<Byte> valueBuffer_;
+	};
+
+	bool ValidOptions(unsigned int options) {
+		return options >= SBDB_FETCH_KEYS && options <= SBDB_FETCH_KEYS_AND_VALUES;
+	}
+}
+
+const char* sbdb_last_error(void) {
+	return lastError.c_str();
+}
+
+int sbdb_last_error_code(void) {
+	return lastErrorCode;
+}
+
+int sbdb_env_open(const char* fileName, unsigned long long cacheSizeInBytes, sbdb_env** result) {
+	if (fileName == nullptr || result == nullptr)
+		return Fail(SBDB_INVALID_ARGUMENT, "file name and result are required");
+	return Invoke([&]() -> int {
+		DB_ENV* dbEnv;
+		CheckApiOk(db_env_create(&dbEnv, 0), "db_env_create");
+		try {
+			if (cacheSizeInBytes > 0)
+				CheckApiOk(dbEnv->set_cachesize(dbEnv, static_cast<u_int32_t>(cacheSizeInBytes / gb), static_cast<u_int32_t>(cacheSizeInBytes % gb), 1), "env.set_cachesize");
+			string fileNameString(fileName);
+			size_t separator = fileNameString.find_last_of("/\\");
+			string home = separator == string::npos ? "." : fileNameString.substr(0, separator);
+			CheckApiOk(dbEnv->open(dbEnv, home.c_str(), DB_CREATE | DB_THREAD | DB_INIT_MPOOL | DB_PRIVATE, 0), "env.open");
+			sbdb_env* env = new sbdb_env();
+			env->dbEnv = dbEnv;
+			env->fileName = fileNameString;
+			*result = env;
+			return SBDB_OK;
+		}
+		catch (...) {
+			dbEnv->close(dbEnv, 0);
+			throw;
+		}
+	});
+}
+
+int sbdb_env_close(sbdb_env* env) {
+	if (env == nullptr)
+		return Fail(SBDB_INVALID_ARGUMENT, "environment is required");
+	return Invoke([&]() -> int {
+		unique_ptr<sbdb_env> owned(env);
+		CheckApiOk(env->dbEnv->close(env->dbEnv, 0), "env.close");
+		return SBDB_OK;
+	});
+}
+
+int sbdb_db_open(sbdb_env* env, const char* name, unsigned int flags, unsigned int pageSize, sbdb_db** result) {
+	if (env == nullptr || name == nullptr || result == nullptr)
+		return Fail(SBDB_INVALID_ARGUMENT, "environment, name and result are required");
+	if ((flags & SBDB_DB_RECNO) != 0 && (flags & SBDB_DB_SORTED_DUPLICATES) != 0)
+		return Fail(SBDB_INVALID_ARGUMENT, "sorted duplicates can't be used with record numbers");
+	return Invoke([&]() -> int {
+		DB* db;
+		CheckApiOk(db_create(&db, env->dbEnv, 0), "db_create");
+		try {
+			if ((flags & SBDB_DB_RECNO) != 0)
+				CheckApiOk(db->set_flags(db, DB_RECNUM), "db.set_flags");
+			if ((flags & SBDB_DB_SORTED_DUPLICATES) != 0)
+				CheckApiOk(db->set_flags(db, DB_DUPSORT), "db.set_flags");
+			if (pageSize > 0)
+				CheckApiOk(db->set_pagesize(db, pageSize), "db.set_pagesize");
+			u_int32_t openFlags = (flags & SBDB_DB_READONLY) != 0 ? DB_RDONLY : DB_CREATE;
+			CheckApiOk(db->open(db, nullptr, env->fileName.c_str(), name, DB_BTREE, openFlags, 0), "db.open");
+			sbdb_db* handle = new sbdb_db();
+			handle->db = db;
+			handle->env = env;
+			handle->cursorPool.reset(new NativeCursorPool(db, maxIdleCursors));
+			handle->keyChunkSize = defaultKeyChunkSize;
+			handle->valueChunkSize = defaultValueChunkSize;
+			*result = handle;
+			return SBDB_OK;
+		}
+		catch (...) {
+			db->close(db, 0);
+			throw;
+		}
+	});
+}
+
+int sbdb_db_close(sbdb_db* db) {
+	if (db == nullptr)
+		return Fail(SBDB_INVALID_ARGUMENT, "database is required");
+	return Invoke([&]() -> int {
+		unique_ptr<sbdb_db> owned(db);
+		int cursorsResultCode = db->cursorPool->Clear();
+		db->cursorPool.reset();
+		CheckApiOk(db->db->close(db->db, 0), "db.close");
+		CheckApiOk(cursorsResultCode, "cursor.close");
+		return SBDB_OK;
+	});
+}
+
+int sbdb_get(sbdb_db* db, const unsigned char* key, unsigned int keyLength, unsigned char* value, unsigned int valueCapacity, unsigned int* valueLength) {
+	if (db == nullptr || valueLength == nullptr)
+		return Fail(SBDB_INVALID_ARGUMENT, "database and value length are required");
+	return Invoke([&]() -> int {
+		DBT keyDbt = MakeDbt(key, keyLength);
+		DBT valueDbt = MakeDbt(value, 0);
+		valueDbt.ulen = valueCapacity;
+		valueDbt.flags = DB_DBT_USERMEM;
+		int resultCode = db->db->get(db->db, nullptr, &keyDbt, &valueDbt, 0);
+		if (resultCode == DB_NOTFOUND)
+			return SBDB_NOT_FOUND;
+		*valueLength = valueDbt.size;
+		if (resultCode == DB_BUFFER_SMALL) {
+			ostringstream message;
+			message << "value capacity [" << valueCapacity << "] is less than value length [" << valueDbt.size << "]";
+			return Fail(SBDB_BUFFER_SMALL, message.str());
+		}
+		CheckApiOk(resultCode, "db.get");
+		return SBDB_OK;
+	});
+}
+
+int sbdb_put(sbdb_db* db, const unsigned char* key, unsigned int keyLength, const unsigned char* value, unsigned int valueLength) {
+	if (db == nullptr)
+		return Fail(SBDB_INVALID_ARGUMENT, "database is required");
+	return Invoke([&]() -> int {
+		DBT keyDbt = MakeDbt(key, keyLength);
+		DBT valueDbt = MakeDbt(value, valueLength);
+		CheckApiOk(db->db->put(db->db, nullptr, &keyDbt, &valueDbt, 0), "db.put");
+		return SBDB_OK;
+	});
+}
+
+int sbdb_del(sbdb_db* db, const unsigned char* key, unsigned int keyLength) {
+	if (db == nullptr)
+		return Fail(SBDB_INVALID_ARGUMENT, "database is required");
+	return Invoke([&]() -> int {
+		DBT keyDbt = MakeDbt(key, keyLength);
+		int resultCode = db->db->del(db->db, nullptr, &keyDbt, 0);
+		if (resultCode == DB_NOTFOUND)
+			return SBDB_NOT_FOUND;
+		CheckApiOk(resultCode, "db.del");
+		return SBDB_OK;
+	});
+}
+
+//bulk buffer holds data from the start and four u_int32_t offsets and lengths per record from the end
+int sbdb_put_batch(sbdb_db* db, const unsigned char* store, const sbdb_segment* keys, const sbdb_segment* values, unsigned int count) {
+	if (db == nullptr || (count > 0 && (store == nullptr || keys == nullptr || values == nullptr)))
+		return Fail(SBDB_INVALID_ARGUMENT, "database, store, keys and values are required");
+	if (count == 0)
+		return SBDB_OK;
+	return Invoke([&]() -> int {
+		size_t dataLength = 0;
+		for (unsigned int i = 0; i < count; i++)
+			dataLength += keys[i].length + values[i].length;
+		size_t bulkLength = (dataLength + (4 * static_cast<size_t>(count) + 1) * sizeof(u_int32_t) + 1023) / 1024 * 1024;
+		if (bulkLength > 0xFFFFFFFFu)
+			throw NativeBdbException("batch is too large");
+		vector<Byte> bulk(bulkLength);
+		DBT bulkDbt;
+		memset(&bulkDbt, 0, sizeof(DBT));
+		bulkDbt.data = &bulk[0];
+		bulkDbt.ulen = static_cast<u_int32_t>(bulkLength);
+		bulkDbt.flags = DB_DBT_USERMEM;
+		void* position;
+		DB_MULTIPLE_WRITE_INIT(position, &bulkDbt);
+		for (unsigned int i = 0; i < count; i++) {
+			DB_MULTIPLE_KEY_WRITE_NEXT(position, &bulkDbt, store + keys[i].start, keys[i].length, store + values[i].start, values[i].length);
+			if (position == nullptr)
+				throw NativeBdbException("batch put assertion failure, bulk buffer overflow");
+		}
+		DBT ignoredDbt;
+		memset(&ignoredDbt, 0, sizeof(DBT));
+		CheckApiOk(db->db->put(db->db, nullptr, &bulkDbt, &ignoredDbt, DB_MULTIPLE_KEY), "db.put.DB_MULTIPLE_KEY");
+		return SBDB_OK;
+	});
+}
+
+int sbdb_cursor_open(sbdb_db* db, const sbdb_range* range, int direction, unsigned int skip, int take, unsigned int options, sbdb_cursor** result) {
+	if (db == nullptr || range == nullptr || result == nullptr)
+		return Fail(SBDB_INVALID_ARGUMENT, "database, range and result are required");
+	if ((direction != 1 && direction != -1) || !ValidOptions(options))
+		return Fail(SBDB_INVALID_ARGUMENT, "invalid direction or fetch options");
+	return Invoke([&]() -> int {
+		unique_ptr<NativeRangeCursorReader> reader(CreateReader(db->db, *range, direction, skip, take));
+		*result = new ReaderCursor<NativeRangeCursorReader>(db, reader.get(), 1, options);
+		reader.release();
+		return SBDB_OK;
+	});
+}
+
+namespace {
+	//one chunk per range reader plus one for the merged record, as SuffixMergingFetcher allocates
+	int OpenMerged(sbdb_db* db, const sbdb_range* ranges, unsigned int rangesCount, int direction, unsigned int keySuffixOffset,
+		const NativeKeySchema& keySchema, unsigned int options, sbdb_cursor** result) {
+		if (db == nullptr || (rangesCount > 0 && ranges == nullptr) || result == nullptr)
+			return Fail(SBDB_INVALID_ARGUMENT, "database, ranges and result are required");
+		if ((direction != 1 && direction != -1) || !ValidOptions(options))
+			return Fail(SBDB_INVALID_ARGUMENT, "invalid direction or fetch options");
+		return Invoke([&]() -> int {
+			NativeRangeCursorReader** readers = new NativeRangeCursorReader*[rangesCount];
+			unsigned int created = 0;
+			try {
+				for (; created < rangesCount; created++)
+					readers[created] = CreateReader(db->db, ranges[created], direction, 0, -1);
+			}
+			catch (...) {
+				for (unsigned int i = 0; i < created; i++)
+					delete readers[i];
+				delete[] readers;
+				throw;
+			}
+			//merging reader owns readers from here
+			unique_ptr<NativeSuffixMergingRangeCursorReader> reader(new NativeSuffixMergingRangeCursorReader(keySuffixOffset, keySchema, false,
+				(options & SBDB_FETCH_KEYS) != 0, (options & SBDB_FETCH_VALUES) != 0, readers, rangesCount, direction));
+			*result = new ReaderCursor<NativeSuffixMergingRangeCursorReader>(db, reader.get(), rangesCount + 1, options);
+			reader.release();
+			return SBDB_OK;
+		});
+	}
+}
+
+int sbdb_cursor_open_merged(sbdb_db* db, const sbdb_range* ranges, unsigned int rangesCount, int direction, unsigned int keySuffixOffset, unsigned int options, sbdb_cursor** result) {
+	return OpenMerged(db, ranges, rangesCount, direction, keySuffixOffset, NativeKeySchema(), options, result);
+}
+
+int sbdb_cursor_open_merged_by_field(sbdb_db* db, const sbdb_range* ranges, unsigned int rangesCount, int direction, const sbdb_key_field* fields, unsigned int fieldsCount, unsigned int options, sbdb_cursor** result) {
+	if (fieldsCount > 0 && fields == nullptr)
+		return Fail(SBDB_INVALID_ARGUMENT, "fields are required");
+	NativeKeySchema keySchema;
+	for (unsigned int i = 0; i < fieldsCount; i++)
+		keySchema.AddField(fields[i].fixedLength, fields[i].descending != 0);
+	return OpenMerged(db, ranges, rangesCount, direction, 0, keySchema, options, result);
+}
+
+int sbdb_cursor_fetch(sbdb_cursor* cursor, unsigned int maxRows, unsigned char* store, unsigned int storeCapacity, sbdb_segment* positions, unsigned int* rowsCount) {
+	if (cursor == nullptr || rowsCount == nullptr || (maxRows > 0 && (store == nullptr || positions == nullptr)))
+		return Fail(SBDB_INVALID_ARGUMENT, "cursor, store, positions and rows count are required");
+	return Invoke([&]() -> int {
+		return cursor->Fetch(maxRows, store, storeCapacity, positions, rowsCount);
+	});
+}
+
+unsigned int sbdb_cursor_row_size(const sbdb_cursor* cursor) {
+	return cursor == nullptr ? 0 : cursor->RowSize();
+}
+
+int sbdb_cursor_total_count(sbdb_cursor* cursor, unsigned int* result) {
+	if (cursor == nullptr || result == nullptr)
+		return Fail(SBDB_INVALID_ARGUMENT, "cursor and result are required");
+	return Invoke([&]() -> int {
+		*result = cursor->GetTotalCount();
+		return SBDB_OK;
+	});
+}
+
+int sbdb_cursor_close(sbdb_cursor* cursor) {
+	if (cursor == nullptr)
+		return Fail(SBDB_INVALID_ARGUMENT, "cursor is required");
+	return Invoke([&]() -> int {
+		delete cursor;
+		return SBDB_OK;
+	});
+}
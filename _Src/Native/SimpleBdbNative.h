@@ -0,0 +1,114 @@
+#pragma once
+
+/*
+ * C ABI over the native engine of the driver (NativeCursors), for hosts that can't load the C++/CLI assembly.
+ * Calls are batch oriented: one fetch fills many rows into caller buffers, one batch put writes many records,
+ * so per call interop overhead stays amortized. Handles are not synchronized, callers serialize writes
+ * the same way driver clients do. Every function returns SBDB_OK or an error status, sbdb_last_error
+ * describes the last failure of the calling thread.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+#define SBDB_API __declspec(dllexport)
+#else
+#define SBDB_API __attribute__((visibility("default")))
+#endif
+
+enum {
+	SBDB_OK = 0,
+	SBDB_NOT_FOUND = 1,
+	/* value or store doesn't fit caller buffer, required size is reported */
+	SBDB_BUFFER_SMALL = 2,
+	SBDB_INVALID_ARGUMENT = 3,
+	/* bdb call failed, sbdb_last_error_code holds bdb error code */
+	SBDB_API_FAILED = 4,
+	SBDB_FAILED = 5
+};
+
+/* same values as SimpleBdb.Driver.FetchOptions */
+enum {
+	SBDB_FETCH_KEYS = 1,
+	SBDB_FETCH_VALUES = 2,
+	SBDB_FETCH_KEYS_AND_VALUES = 3
+};
+
+enum {
+	SBDB_DB_READONLY = 1,
+	SBDB_DB_RECNO = 2,
+	SBDB_DB_SORTED_DUPLICATES = 4
+};
+
+typedef struct sbdb_env sbdb_env;
+typedef struct sbdb_db sbdb_db;
+typedef struct sbdb_cursor sbdb_cursor;
+
+/* layout of SimpleBdb.Utils.SegmentPosition */
+typedef struct sbdb_segment {
+	unsigned int start;
+	unsigned int length;
+} sbdb_segment;
+
+/* empty boundary is unbounded, boundaries are key prefixes as in SimpleBdb.Utils.Range */
+typedef struct sbdb_boundary {
+	const unsigned char* data;
+	unsigned int length;
+	int inclusive;
+} sbdb_boundary;
+
+typedef struct sbdb_range {
+	sbdb_boundary left;
+	sbdb_boundary right;
+} sbdb_range;
+
+/* field of SimpleBdb.Utils.KeySchema, fixedLength 0 means variable length field */
+typedef struct sbdb_key_field {
+	unsigned int fixedLength;
+	int descending;
+} sbdb_key_field;
+
+SBDB_API const char* sbdb_last_error(void);
+SBDB_API int sbdb_last_error_code(void);
+
+/* private environment, databases are stored in fileName, its directory holds temporary files */
+SBDB_API int sbdb_env_open(const char* fileName, unsigned long long cacheSizeInBytes, sbdb_env** result);
+/* databases of environment must be closed before */
+SBDB_API int sbdb_env_close(sbdb_env* env);
+
+/* pageSize 0 keeps bdb default */
+SBDB_API int sbdb_db_open(sbdb_env* env, const char* name, unsigned int flags, unsigned int pageSize, sbdb_db** result);
+/* cursors of database must be closed before */
+SBDB_API int sbdb_db_close(sbdb_db* db);
+
+/* SBDB_BUFFER_SMALL sets valueLength to required capacity */
+SBDB_API int sbdb_get(sbdb_db* db, const unsigned char* key, unsigned int keyLength, unsigned char* value, unsigned int valueCapacity, unsigned int* valueLength);
+SBDB_API int sbdb_put(sbdb_db* db, const unsigned char* key, unsigned int keyLength, const unsigned char* value, unsigned int valueLength);
+/* SBDB_NOT_FOUND when key is absent */
+SBDB_API int sbdb_del(sbdb_db* db, const unsigned char* key, unsigned int keyLength);
+/* record i is keys[i], values[i] segments of store, written by one DB_MULTIPLE_KEY put */
+SBDB_API int sbdb_put_batch(sbdb_db* db, const unsigned char* store, const sbdb_segment* keys, const sbdb_segment* values, unsigned int count);
+
+/* direction is 1 or -1, take < 0 means all records after skip */
+SBDB_API int sbdb_cursor_open(sbdb_db* db, const sbdb_range* range, int direction, unsigned int skip, int take, unsigned int options, sbdb_cursor** result);
+/* merges ranges by key suffix starting at keySuffixOffset, as SimpleBdb.Driver.Database.Fetch */
+SBDB_API int sbdb_cursor_open_merged(sbdb_db* db, const sbdb_range* ranges, unsigned int rangesCount, int direction, unsigned int keySuffixOffset, unsigned int options, sbdb_cursor** result);
+/* merges by the key suffix that starts after fields, which are the schema fields preceding the suffix field */
+SBDB_API int sbdb_cursor_open_merged_by_field(sbdb_db* db, const sbdb_range* ranges, unsigned int rangesCount, int direction, const sbdb_key_field* fields, unsigned int fieldsCount, unsigned int options, sbdb_cursor** result);
+/*
+ * fetches up to maxRows next rows into store, positions are laid out by column as in SimpleBdb.Utils.BytesTable:
+ * key column at [0, rowsCount), value column at [rowsCount, 2 * rowsCount), positions must hold maxRows per column.
+ * rowsCount 0 means the cursor is exhausted. every row takes sbdb_cursor_row_size bytes of store,
+ * the size grows after a record longer than seen before, SBDB_BUFFER_SMALL is returned when not even one row fits
+ */
+SBDB_API int sbdb_cursor_fetch(sbdb_cursor* cursor, unsigned int maxRows, unsigned char* store, unsigned int storeCapacity, sbdb_segment* positions, unsigned int* rowsCount);
+SBDB_API unsigned int sbdb_cursor_row_size(const sbdb_cursor* cursor);
+/* requires SBDB_DB_RECNO */
+SBDB_API int sbdb_cursor_total_count(sbdb_cursor* cursor, unsigned int* result);
+SBDB_API int sbdb_cursor_close(sbdb_cursor* cursor);
+
+#ifdef __cplusplus
+}
+#endif
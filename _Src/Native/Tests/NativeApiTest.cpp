@@ -0,0 +1,221 @@
+#include "SimpleBdbNative.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	int failuresCount = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: check failed: %s, last error: %s\n", __FILE__, __LINE__, #condition, sbdb_last_error()); \
+			failuresCount++; \
+		} \
+	} while (0)
+
+	const unsigned char* Bytes(const string& s) {
+		return reinterpret_cast<const unsigned char*>(s.data());
+	}
+
+	string Segment(const vector<unsigned char>& store, const sbdb_segment& segment) {
+		return string(reinterpret_cast<const char*>(&store[segment.start]), segment.length);
+	}
+
+	sbdb_range Line() {
+		sbdb_range result;
+		memset(&result, 0, sizeof(result));
+		return result;
+	}
+
+	sbdb_range Prefix(const string& prefix) {
+		sbdb_range result;
+		result.left.data = result.right.data = Bytes(prefix);
+		result.left.length = result.right.length = static_cast<unsigned int>(prefix.size());
+		result.left.inclusive = result.right.inclusive = 1;
+		return result;
+	}
+
+	//each test gets its own environment file
+	class Fixture {
+	public:
+		Fixture(const string& directory, const string& name, unsigned int dbFlags) :env_(nullptr), db_(nullptr) {
+			string fileName = directory + "/" + name + ".db";
+			remove(fileName.c_str());
+			CHECK(sbdb_env_open(fileName.c_str(), 16 * 1024 * 1024, &env_) == SBDB_OK);
+			CHECK(sbdb_db_open(env_, "testDb", dbFlags, 0, &db_) == SBDB_OK);
+		}
+		~Fixture() {
+			CHECK(sbdb_db_close(db_) == SBDB_OK);
+			CHECK(sbdb_env_close(env_) == SBDB_OK);
+		}
+		sbdb_db* Db() { return db_; }
+		void Put(const string& key, const string& value) {
+			CHECK(sbdb_put(db_, Bytes(key), static_cast<unsigned int>(key.size()), Bytes(value), static_cast<unsigned int>(value.size())) == SBDB_OK);
+		}
+	private:
+		sbdb_env* env_;
+		sbdb_db* db_;
+	};
+
+	void PutGetDelete(const string& directory) {
+		Fixture fixture(directory, "PutGetDelete", 0);
+		fixture.Put("k1", "value1");
+		unsigned char value[16];
+		unsigned int valueLength = 0;
+		CHECK(sbdb_get(fixture.Db(), Bytes("k1"), 2, value, sizeof(value), &valueLength) == SBDB_OK);
+		CHECK(string(reinterpret_cast<char*>(value), valueLength) == "value1");
+		CHECK(sbdb_get(fixture.Db(), Bytes("k1"), 2, value, 3, &valueLength) == SBDB_BUFFER_SMALL);
+		CHECK(valueLength == 6);
+		CHECK(sbdb_get(fixture.Db(), Bytes("k2"), 2, value, sizeof(value), &valueLength) == SBDB_NOT_FOUND);
+		CHECK(sbdb_del(fixture.Db(), Bytes("k1"), 2) == SBDB_OK);
+		CHECK(sbdb_del(fixture.Db(), Bytes("k1"), 2) == SBDB_NOT_FOUND);
+		CHECK(sbdb_get(fixture.Db(), Bytes("k1"), 2, value, sizeof(value), &valueLength) == SBDB_NOT_FOUND);
+	}
+
+	void BatchPutAndPagedFetch(const string& directory) {
+		Fixture fixture(directory, "BatchPutAndPagedFetch", SBDB_DB_RECNO);
+		string batch;
+		vector<sbdb_segment> keys, values;
+		char buffer[32];
+		for (int i = 0; i < 1000; i++) {
+			snprintf(buffer, sizeof(buffer), "key%04d", i);
+			sbdb_segment key = { static_cast<unsigned int>(batch.size()), 7 };
+			batch += buffer;
+			snprintf(buffer, sizeof(buffer), "value%d", i);
+			sbdb_segment value = { static_cast<unsigned int>(batch.size()), static_cast<unsigned int>(strlen(buffer)) };
+			batch += buffer;
+			keys.push_back(key);
+			values.push_back(value);
+		}
+		CHECK(sbdb_put_batch(fixture.Db(), Bytes(batch), &keys[0], &values[0], 1000) == SBDB_OK);
+
+		sbdb_range range = Line();
+		sbdb_cursor* cursor;
+		CHECK(sbdb_cursor_open(fixture.Db(), &range, 1, 10, -1, SBDB_FETCH_KEYS_AND_VALUES, &cursor) == SBDB_OK);
+		unsigned int totalCount = 0;
+		CHECK(sbdb_cursor_total_count(cursor, &totalCount) == SBDB_OK);
+		CHECK(totalCount == 1000);
+		const unsigned int pageSize = 100;
+		vector<unsigned char> store(pageSize * sbdb_cursor_row_size(cursor));
+		vector<sbdb_segment> positions(pageSize * 2);
+		int expected = 10;
+		for (;;) {
+			unsigned int rowsCount = 0;
+			CHECK(sbdb_cursor_fetch(cursor, pageSize, &store[0], static_cast<unsigned int>(store.size()), &positions[0], &rowsCount) == SBDB_OK);
+			if (rowsCount == 0)
+				break;
+			for (unsigned int i = 0; i < rowsCount; i++, expected++) {
+				snprintf(buffer, sizeof(buffer), "key%04d", expected);
+				CHECK(Segment(store, positions[i]) == buffer);
+				snprintf(buffer, sizeof(buffer), "value%d", expected);
+				CHECK(Segment(store, positions[rowsCount + i]) == buffer);
+			}
+		}
+		CHECK(expected == 1000);
+		CHECK(sbdb_cursor_close(cursor) == SBDB_OK);
+	}
+
+	void LongValuesGrowRowSize(const string& directory) {
+		Fixture fixture(directory, "LongValuesGrowRowSize", 0);
+		fixture.Put("a", "short");
+		fixture.Put("b", string(1000, 'x'));
+		fixture.Put("c", string(3000, 'y'));
+		sbdb_range range = Line();
+		sbdb_cursor* cursor;
+		CHECK(sbdb_cursor_open(fixture.Db(), &range, 1, 0, -1, SBDB_FETCH_VALUES, &cursor) == SBDB_OK);
+		vector<unsigned char> store(2000);
+		vector<sbdb_segment> positions(10);
+		unsigned int rowsCount = 0;
+		CHECK(sbdb_cursor_fetch(cursor, 10, &store[0], 2000, &positions[0], &rowsCount) == SBDB_OK);
+		CHECK(rowsCount == 1);
+		CHECK(Segment(store, positions[0]) == "short");
+		CHECK(sbdb_cursor_fetch(cursor, 10, &store[0], 2000, &positions[0], &rowsCount) == SBDB_OK);
+		CHECK(rowsCount == 1);
+		CHECK(Segment(store, positions[0]) == string(1000, 'x'));
+		CHECK(sbdb_cursor_fetch(cursor, 10, &store[0], 2000, &positions[0], &rowsCount) == SBDB_BUFFER_SMALL);
+		CHECK(rowsCount == 0);
+		CHECK(sbdb_cursor_row_size(cursor) == 3000);
+		store.resize(sbdb_cursor_row_size(cursor));
+		CHECK(sbdb_cursor_fetch(cursor, 10, &store[0], static_cast<unsigned int>(store.size()), &positions[0], &rowsCount) == SBDB_OK);
+		CHECK(rowsCount == 1);
+		CHECK(Segment(store, positions[0]) == string(3000, 'y'));
+		CHECK(sbdb_cursor_fetch(cursor, 10, &store[0], static_cast<unsigned int>(store.size()), &positions[0], &rowsCount) == SBDB_OK);
+		CHECK(rowsCount == 0);
+		CHECK(sbdb_cursor_close(cursor) == SBDB_OK);
+	}
+
+	void MergedFetchOrdersBySuffix(const string& directory) {
+		Fixture fixture(directory, "MergedFetchOrdersBySuffix", 0);
+		fixture.Put("a1", "a1");
+		fixture.Put("a4", "a4");
+		fixture.Put("b2", "b2");
+		fixture.Put("b3", "b3");
+		fixture.Put("c0", "c0");
+		sbdb_range ranges[] = { Prefix("a"), Prefix("b") };
+		sbdb_cursor* cursor;
+		CHECK(sbdb_cursor_open_merged(fixture.Db(), ranges, 2, -1, 1, SBDB_FETCH_VALUES, &cursor) == SBDB_OK);
+		vector<unsigned char> store(3 * sbdb_cursor_row_size(cursor));
+		vector<sbdb_segment> positions(3);
+		unsigned int rowsCount = 0;
+		CHECK(sbdb_cursor_fetch(cursor, 3, &store[0], static_cast<unsigned int>(store.size()), &positions[0], &rowsCount) == SBDB_OK);
+		CHECK(rowsCount == 3);
+		CHECK(Segment(store, positions[0]) == "a4");
+		CHECK(Segment(store, positions[1]) == "b3");
+		CHECK(Segment(store, positions[2]) == "b2");
+		CHECK(sbdb_cursor_fetch(cursor, 3, &store[0], static_cast<unsigned int>(store.size()), &positions[0], &rowsCount) == SBDB_OK);
+		CHECK(rowsCount == 1);
+		CHECK(Segment(store, positions[0]) == "a1");
+		CHECK(sbdb_cursor_close(cursor) == SBDB_OK);
+	}
+
+	void MergedByFieldSkipsSchemaFields(const string& directory) {
+		Fixture fixture(directory, "MergedByFieldSkipsSchemaFields", 0);
+		fixture.Put("a1", "a1");
+		fixture.Put("b2", "b2");
+		fixture.Put("a3", "a3");
+		sbdb_range ranges[] = { Prefix("a"), Prefix("b") };
+		sbdb_key_field fields[] = { { 1, 0 } };
+		sbdb_cursor* cursor;
+		CHECK(sbdb_cursor_open_merged_by_field(fixture.Db(), ranges, 2, 1, fields, 1, SBDB_FETCH_VALUES, &cursor) == SBDB_OK);
+		vector<unsigned char> store(3 * sbdb_cursor_row_size(cursor));
+		vector<sbdb_segment> positions(3);
+		unsigned int rowsCount = 0;
+		CHECK(sbdb_cursor_fetch(cursor, 3, &store[0], static_cast<unsigned int>(store.size()), &positions[0], &rowsCount) == SBDB_OK);
+		CHECK(rowsCount == 3);
+		CHECK(Segment(store, positions[0]) == "a1");
+		CHECK(Segment(store, positions[1]) == "b2");
+		CHECK(Segment(store, positions[2]) == "a3");
+		CHECK(sbdb_cursor_close(cursor) == SBDB_OK);
+	}
+
+	void InvalidArguments(const string& directory) {
+		Fixture fixture(directory, "InvalidArguments", 0);
+		sbdb_range range = Line();
+		sbdb_cursor* cursor;
+		CHECK(sbdb_cursor_open(fixture.Db(), &range, 0, 0, -1, SBDB_FETCH_KEYS, &cursor) == SBDB_INVALID_ARGUMENT);
+		CHECK(sbdb_cursor_open(fixture.Db(), &range, 1, 0, -1, 0, &cursor) == SBDB_INVALID_ARGUMENT);
+		sbdb_db* db;
+		CHECK(sbdb_db_open(nullptr, "x", 0, 0, &db) == SBDB_INVALID_ARGUMENT);
+		CHECK(string(sbdb_last_error()) == "environment, name and result are required");
+	}
+}
+
+int main(int argc, char** argv) {
+	string directory = argc > 1 ? argv[1] : ".";
+	PutGetDelete(directory);
+	BatchPutAndPagedFetch(directory);
+	LongValuesGrowRowSize(directory);
+	MergedFetchOrdersBySuffix(directory);
+	MergedByFieldSkipsSchemaFields(directory);
+	InvalidArguments(directory);
+	if (failuresCount > 0) {
+		fprintf(stderr, "%d checks failed\n", failuresCount);
+		return 1;
+	}
+	printf("all checks passed\n");
+	return 0;
+}
@@ -0,0 +1,416 @@
+#include "SimpleBdbNative.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//usage: simplebdb_trace_replay <trace> <environment file> <database name> [threadsCount] [speed] [dbFlags]
+//replays a trace written by SimpleBdb.Driver.Database.StartTrace, environment file is modified, so pass a copy.
+//speed 1 keeps recorded call times, 2 replays twice faster, 0 issues calls as fast as workers can.
+//traces without keys get random keys of recorded lengths, so they measure call mix and sizes rather than hit rates.
+//Query and unbounded Fetch replay reading of the recorded rows count. Records are replayed in the order of start,
+//Query is written to the trace on cursor dispose, so it follows calls started after it
+namespace {
+	typedef chrono::steady_clock Clock;
+
+	enum Operation { Add = 1, Remove = 2, Find = 3, Query = 4, Fetch = 5, OperationsCount = 6 };
+	const char* const operationNames[OperationsCount] = { "", "add", "remove", "find", "query", "fetch" };
+	const unsigned int queryPageSize = 100;
+	const unsigned int fetchPageSize = 1000;
+
+	struct Boundary {
+		bool present;
+		bool inclusive;
+		string value;
+	};
+
+	struct Range {
+		Boundary left;
+		Boundary right;
+	};
+
+	struct Record {
+		Operation operation;
+		long long start;
+		int duration;
+		int result;
+		string key;
+		unsigned int valueLength;
+		vector<Range> ranges;
+		int direction;
+		unsigned int skip;
+		int take;
+		unsigned int keySuffixOffset;
+		vector<sbdb_key_field> fields;
+		unsigned int options;
+	};
+
+	//little endian reader over the whole trace, keys are generated when the trace holds only lengths
+	class TraceReader {
+	public:
+		TraceReader(const string& fileName) :offset_(0), random_(42) {
+			ifstream file(fileName.c_str(), ios::binary);
+			if (!file)
+				throw runtime_error("can't open trace " + fileName);
+			bytes_.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+			if (Take(8) != "SBDBTRC1")
+				throw runtime_error("not a trace file " + fileName);
+			withKeys_ = ReadByte() != 0;
+		}
+		bool WithKeys() const { return withKeys_; }
+		bool Read(Record& record) {
+			if (offset_ == bytes_.size())
+				return false;
+			record.operation = static_cast<Operation>(ReadByte());
+			record.start = static_cast<long long>(ReadInteger(8));
+			record.duration = static_cast<int>(ReadInteger(4));
+			record.result = static_cast<int>(ReadInteger(4));
+			switch (record.operation) {
+			case Add:
+				record.key = ReadBytes();
+				record.valueLength = static_cast<unsigned int>(ReadInteger(4));
+				break;
+			case Remove:
+			case Find:
+				record.key = ReadBytes();
+				break;
+			case Query:
+				record.ranges.assign(1, ReadRange());
+				record.direction = static_cast<signed char>(ReadByte());
+				record.skip = static_cast<unsigned int>(ReadInteger(4));
+				record.take = static_cast<int>(ReadInteger(4));
+				break;
+			case Fetch: {
+				unsigned int rangesCount = static_cast<unsigned int>(ReadInteger(4));
+				record.ranges.clear();
+				for (unsigned int i = 0; i < rangesCount; i++)
+					record.ranges.push_back(ReadRange());
+				record.direction = static_cast<signed char>(ReadByte());
+				record.take = static_cast<int>(ReadInteger(4));
+				record.keySuffixOffset = static_cast<unsigned int>(ReadInteger(4));
+				unsigned int fieldsCount = static_cast<unsigned int>(ReadInteger(4));
+				record.fields.resize(fieldsCount);
+				for (unsigned int i = 0; i < fieldsCount; i++) {
+					record.fields[i].fixedLength = static_cast<unsigned int>(ReadInteger(4));
+					record.fields[i].descending = ReadByte();
+				}
+				record.options = ReadByte();
+				break;
+			}
+			default:
+				throw runtime_error("unknown operation in trace");
+			}
+			return true;
+		}
+	private:
+		string Take(size_t length) {
+			if (bytes_.size() - offset_ < length)
+				throw runtime_error("trace is truncated");
+			string result(bytes_.begin() + offset_, bytes_.begin() + offset_ + length);
+			offset_ += length;
+			return result;
+		}
+		unsigned char ReadByte() {
+			return static_cast<unsigned char>(Take(1)[0]);
+		}
+		unsigned long long ReadInteger(int size) {
+			string bytes = Take(size);
+			unsigned long long result = 0;
+			for (int i = size - 1; i >= 0; i--)
+				result = (result << 8) | static_cast<unsigned char>(bytes[i]);
+			return result;
+		}
+		string ReadBytes() {
+			unsigned int length = static_cast<unsigned int>(ReadInteger(4));
+			if (withKeys_)
+				return Take(length);
+			string result(length, '\0');
+			for (unsigned int i = 0; i < length; i++)
+				result[i] = static_cast<char>(random_() & 0xff);
+			return result;
+		}
+		Range ReadRange() {
+			Range result;
+			result.left = ReadBoundary();
+			result.right = ReadBoundary();
+			return result;
+		}
+		Boundary ReadBoundary() {
+			Boundary result;
+			unsigned char flags = ReadByte();
+			result.present = (flags & 1) != 0;
+			result.inclusive = (flags & 2) != 0;
+			if (result.present)
+				result.value = ReadBytes();
+			return result;
+		}
+		vector<char> bytes_;
+		size_t offset_;
+		bool withKeys_;
+		mt19937 random_;
+	};
+
+	//handles of the C ABI aren't synchronized, so writes are exclusive as they are for driver clients
+	class ReadWriteLock {
+	public:
+		ReadWriteLock() :readersCount_(0), writing_(false) {}
+		void LockRead() {
+			unique_lock<mutex> lock(mutex_);
+			released_.wait(lock, [this]() { return !writing_; });
+			readersCount_++;
+		}
+		void UnlockRead() {
+			lock_guard<mutex> lock(mutex_);
+			if (--readersCount_ == 0)
+				released_.notify_all();
+		}
+		void LockWrite() {
+			unique_lock<mutex> lock(mutex_);
+			released_.wait(lock, [this]() { return !writing_ && readersCount_ == 0; });
+			writing_ = true;
+		}
+		void UnlockWrite() {
+			lock_guard<mutex> lock(mutex_);
+			writing_ = false;
+			released_.notify_all();
+		}
+	private:
+		mutex mutex_;
+		condition_variable released_;
+		unsigned int readersCount_;
+		bool writing_;
+	};
+
+	struct Sample {
+		int operation;
+		bool failed;
+		long long replayed;
+		long long recorded;
+	};
+
+	sbdb_range ToNative(const Range& range) {
+		sbdb_range result;
+		memset(&result, 0, sizeof(result));
+		if (range.left.present) {
+			result.left.data = reinterpret_cast<const unsigned char*>(range.left.value.data());
+			result.left.length = static_cast<unsigned int>(range.left.value.size());
+			result.left.inclusive = range.left.inclusive ? 1 : 0;
+		}
+		if (range.right.present) {
+			result.right.data = reinterpret_cast<const unsigned char*>(range.right.value.data());
+			result.right.length = static_cast<unsigned int>(range.right.value.size());
+			result.right.inclusive = range.right.inclusive ? 1 : 0;
+		}
+		return result;
+	}
+
+	const unsigned char* Bytes(const string& s) {
+		return reinterpret_cast<const unsigned char*>(s.data());
+	}
+
+	class Replayer {
+	public:
+		Replayer(sbdb_db* db, const vector<Record>& records, double speed) :db_(db), records_(records), speed_(speed), next_(0) {}
+		void Run(vector<Sample>& samples) {
+			vector<unsigned char> value(256);
+			vector<unsigned char> store;
+			vector<sbdb_segment> positions;
+			for (;;) {
+				size_t index = next_++;
+				if (index >= records_.size())
+					return;
+				const Record& record = records_[index];
+				if (speed_ > 0)
+					this_thread::sleep_until(started_ + chrono::microseconds(static_cast<long long>(record.start / speed_)));
+				Clock::time_point start = Clock::now();
+				int status = Execute(record, value, store, positions);
+				Sample sample;
+				sample.operation = record.operation;
+				sample.failed = status != SBDB_OK && status != SBDB_NOT_FOUND;
+				sample.replayed = chrono::duration_cast<chrono::microseconds>(Clock::now() - start).count();
+				sample.recorded = record.duration;
+				samples.push_back(sample);
+			}
+		}
+		void Start() { started_ = Clock::now(); }
+	private:
+		int Execute(const Record& record, vector<unsigned char>& value, vector<unsigned char>& store, vector<sbdb_segment>& positions) {
+			unsigned int keyLength = static_cast<unsigned int>(record.key.size());
+			if (record.operation == Add || record.operation == Remove) {
+				lock_.LockWrite();
+				int status;
+				if (record.operation == Add) {
+					if (value.size() < record.valueLength)
+						value.resize(record.valueLength);
+					status = sbdb_put(db_, Bytes(record.key), keyLength, value.empty() ? nullptr : &value[0], record.valueLength);
+				}
+				else
+					status = sbdb_del(db_, Bytes(record.key), keyLength);
+				lock_.UnlockWrite();
+				return status;
+			}
+			lock_.LockRead();
+			int status;
+			if (record.operation == Find) {
+				unsigned int valueLength;
+				status = sbdb_get(db_, Bytes(record.key), keyLength, &value[0], static_cast<unsigned int>(value.size()), &valueLength);
+				if (status == SBDB_BUFFER_SMALL) {
+					value.resize(valueLength);
+					status = sbdb_get(db_, Bytes(record.key), keyLength, &value[0], valueLength, &valueLength);
+				}
+			}
+			else
+				status = Read(record, store, positions);
+			lock_.UnlockRead();
+			return status;
+		}
+		int Read(const Record& record, vector<unsigned char>& store, vector<sbdb_segment>& positions) {
+			vector<sbdb_range> ranges;
+			for (size_t i = 0; i < record.ranges.size(); i++)
+				ranges.push_back(ToNative(record.ranges[i]));
+			sbdb_cursor* cursor;
+			unsigned int pageSize;
+			int left;
+			int status;
+			if (record.operation == Query) {
+				status = sbdb_cursor_open(db_, &ranges[0], record.direction, record.skip, record.take, SBDB_FETCH_KEYS_AND_VALUES, &cursor);
+				pageSize = queryPageSize;
+				left = record.result;
+			}
+			else {
+				const sbdb_range* rangesPtr = ranges.empty() ? nullptr : &ranges[0];
+				unsigned int rangesCount = static_cast<unsigned int>(ranges.size());
+				status = record.fields.empty()
+					? sbdb_cursor_open_merged(db_, rangesPtr, rangesCount, record.direction, record.keySuffixOffset, record.options, &cursor)
+					: sbdb_cursor_open_merged_by_field(db_, rangesPtr, rangesCount, record.direction, &record.fields[0],
+						static_cast<unsigned int>(record.fields.size()), record.options, &cursor);
+				pageSize = fetchPageSize;
+				left = record.take >= 0 && record.take < INT_MAX ? record.take : record.result;
+			}
+			if (status != SBDB_OK)
+				return status;
+			positions.resize(pageSize * 2);
+			while (left > 0) {
+				unsigned int maxRows = min(static_cast<unsigned int>(left), pageSize);
+				unsigned int required = maxRows * sbdb_cursor_row_size(cursor);
+				if (store.size() < required)
+					store.resize(required);
+				unsigned int rowsCount;
+				status = sbdb_cursor_fetch(cursor, maxRows, &store[0], static_cast<unsigned int>(store.size()), &positions[0], &rowsCount);
+				if (status == SBDB_BUFFER_SMALL)
+					continue;
+				if (status != SBDB_OK || rowsCount == 0)
+					break;
+				left -= static_cast<int>(rowsCount);
+			}
+			int closeStatus = sbdb_cursor_close(cursor);
+			return status != SBDB_OK ? status : closeStatus;
+		}
+		sbdb_db* db_;
+		const vector<Record>& records_;
+		double speed_;
+		atomic<size_t> next_;
+		Clock::time_point started_;
+		ReadWriteLock lock_;
+	};
+
+	long long Percentile(const vector<long long>& sorted, double percentile) {
+		if (sorted.empty())
+			return 0;
+		size_t index = static_cast<size_t>(percentile * (sorted.size() - 1));
+		return sorted[index];
+	}
+
+	void Report(const char* name, vector<long long>& replayed, vector<long long>& recorded, unsigned long long failedCount) {
+		sort(replayed.begin(), replayed.end());
+		sort(recorded.begin(), recorded.end());
+		printf("%-8s %10llu calls %8llu failed, micros p50/p90/p99/max replayed %6lld %6lld %6lld %8lld recorded %6lld %6lld %6lld %8lld\n",
+			name, static_cast<unsigned long long>(replayed.size()), failedCount,
+			Percentile(replayed, 0.5), Percentile(replayed, 0.9), Percentile(replayed, 0.99), replayed.empty() ? 0 : replayed.back(),
+			Percentile(recorded, 0.5), Percentile(recorded, 0.9), Percentile(recorded, 0.99), recorded.empty() ? 0 : recorded.back());
+	}
+
+	void Check(int status, const char* call) {
+		if (status == SBDB_OK)
+			return;
+		fprintf(stderr, "%s failed, status [%d], %s\n", call, status, sbdb_last_error());
+		exit(1);
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc < 4) {
+		fprintf(stderr, "usage: %s <trace> <environment file> <database name> [threadsCount] [speed] [dbFlags]\n", argv[0]);
+		return 1;
+	}
+	unsigned int threadsCount = argc > 4 ? static_cast<unsigned int>(atoi(argv[4])) : 1;
+	double speed = argc > 5 ? atof(argv[5]) : 1;
+	unsigned int dbFlags = argc > 6 ? static_cast<unsigned int>(atoi(argv[6])) : 0;
+	if (threadsCount == 0)
+		threadsCount = 1;
+
+	vector<Record> records;
+	bool withKeys;
+	try {
+		TraceReader reader(argv[1]);
+		withKeys = reader.WithKeys();
+		Record record;
+		while (reader.Read(record))
+			records.push_back(record);
+		stable_sort(records.begin(), records.end(), [](const Record& x, const Record& y) { return x.start < y.start; });
+	}
+	catch (const exception& e) {
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+	printf("%llu calls, keys %s\n", static_cast<unsigned long long>(records.size()), withKeys ? "recorded" : "generated");
+
+	sbdb_env* env;
+	Check(sbdb_env_open(argv[2], 256ull * 1024 * 1024, &env), "sbdb_env_open");
+	sbdb_db* db;
+	Check(sbdb_db_open(env, argv[3], dbFlags, 0, &db), "sbdb_db_open");
+
+	Replayer replayer(db, records, speed);
+	vector<vector<Sample>> samples(threadsCount);
+	vector<thread> threads;
+	Clock::time_point start = Clock::now();
+	replayer.Start();
+	for (unsigned int i = 0; i < threadsCount; i++)
+		threads.push_back(thread(&Replayer::Run, &replayer, ref(samples[i])));
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+	vector<long long> replayed[OperationsCount], recorded[OperationsCount];
+	unsigned long long failedCounts[OperationsCount] = {};
+	for (size_t i = 0; i < samples.size(); i++)
+		for (size_t j = 0; j < samples[i].size(); j++) {
+			const Sample& sample = samples[i][j];
+			replayed[sample.operation].push_back(sample.replayed);
+			recorded[sample.operation].push_back(sample.recorded);
+			if (sample.failed)
+				failedCounts[sample.operation]++;
+		}
+	printf("replayed in %.3f s, %u threads, speed %g\n", seconds, threadsCount, speed);
+	for (int operation = Add; operation < OperationsCount; operation++)
+		if (!replayed[operation].empty())
+			Report(operationNames[operation], replayed[operation], recorded[operation], failedCounts[operation]);
+
+	Check(sbdb_db_close(db), "sbdb_db_close");
+	Check(sbdb_env_close(env), "sbdb_env_close");
+	return 0;
+}
@@ -0,0 +1,75 @@
+using System.Linq;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Extensions;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiAdaptiveBuffersTest : TestBase
+	{
+		[Test]
+		public void SizesSeededFromSampleAtAttach()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				using (var db = env.AttachDatabase(defaultDbConfig))
+					for (var i = 0; i < 100; i++)
+						db.Add(i.ToString("key000"), new string('v', 20));
+				defaultDbConfig.KeyBufferConfig = BytesBufferConfig.Adaptive(100);
+				defaultDbConfig.ValueBufferConfig = BytesBufferConfig.Adaptive(100);
+				using (var db = env.AttachDatabase(defaultDbConfig))
+				{
+					Assert.That(db.GetKeyBufferStatistics().ChunkLength, Is.EqualTo(6));
+					var valueStatistics = db.GetValueBufferStatistics();
+					Assert.That(valueStatistics.MaxLength, Is.EqualTo(20));
+					Assert.That(valueStatistics.ChunkLength, Is.EqualTo(23));
+				}
+			}
+		}
+
+		[Test]
+		public void RareLongValue_DoesNotInflateChunks()
+		{
+			defaultDbConfig.ValueBufferConfig = BytesBufferConfig.Adaptive(16);
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 1000; i++)
+					db.Add(new BytesSegment(new[] {(byte) (i%2), (byte) (i/256), (byte) (i%256)}), new BytesSegment(new byte[10]));
+				var longValue = Enumerable.Range(0, 10000).Select(x => (byte) x).ToArray();
+				db.Add(new BytesSegment(new byte[] {1, 1, 1}), new BytesSegment(longValue));
+				var ranges = new[]
+				{
+					Range.Segment(new byte[] {0}, new byte[] {0}),
+					Range.Segment(new byte[] {1}, new byte[] {1})
+				};
+				var result = db.Fetch(ranges, Direction.Ascending, 2000, 1, FetchOptions.KeysAndValues);
+				Assert.That(result.RowsCount, Is.EqualTo(1000));
+				var keys = result.GetColumn(0, x => x[1]*256 + x[2]);
+				Assert.That(keys, Is.EqualTo(Enumerable.Range(0, 1000).ToArray()));
+				var lengths = result.GetColumn(1, x => x.Length);
+				Assert.That(lengths.Count(x => x == 10000), Is.EqualTo(1));
+				Assert.That(lengths.Count(x => x == 10), Is.EqualTo(999));
+				var statistics = db.GetValueBufferStatistics();
+				Assert.That(statistics.MaxLength, Is.EqualTo(10000));
+				Assert.That(statistics.ChunkLength, Is.EqualTo(11));
+			}
+		}
+
+		[Test]
+		public void GrowConfig_NotObserved()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("key", "value");
+				Assert.That(db.Find(new BytesSegment(Bytes("key"))).String(), Is.EqualTo("value"));
+				Assert.That(db.GetValueBufferStatistics().ObservedCount, Is.EqualTo(0));
+				Assert.That(db.GetValueBufferStatistics().ChunkLength, Is.EqualTo(100));
+			}
+		}
+	}
+}
@@ -0,0 +1,172 @@
+using System;
+using System.Linq;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+using Environment = SimpleBdb.Driver.Environment;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiAsyncTest : TestBase
+	{
+		[Test]
+		public void FindAsync()
+		{
+			defaultDbConfig.ValueBufferConfig = BytesBufferConfig.GrowFrom(4);
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("key", "long value to grow buffer");
+				Assert.That(db.FindAsync(new BytesSegment(Bytes("key")), CancellationToken.None).Result.String(),
+					Is.EqualTo("long value to grow buffer"));
+				Assert.That(db.FindAsync(new BytesSegment(Bytes("absent")), CancellationToken.None).Result, Is.Null);
+			}
+		}
+
+		[Test]
+		public void ReadAsync_SameAsQuery()
+		{
+			defaultDbConfig.EnableRecno = true;
+			defaultDbConfig.ValueBufferConfig = BytesBufferConfig.GrowFrom(4);
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("1", "v1").Add("2", "v2").Add("3", "long v3").Add("4", "v4");
+				var result = db.ReadAsync(Range.Line(), Direction.Ascending, 1, -1, FetchOptions.KeysAndValues, CancellationToken.None).Result;
+				Assert.That(result.RowsCount, Is.EqualTo(3));
+				Assert.That(result.GetColumn(0).Select(x => Encoding.ASCII.GetString(x.ToByteArray())), Is.EqualTo(new[] {"2", "3", "4"}));
+				Assert.That(result.GetColumn(1).Select(x => Encoding.ASCII.GetString(x.ToByteArray())), Is.EqualTo(new[] {"v2", "long v3", "v4"}));
+			}
+		}
+
+		[Test]
+		public void FetchAsync_SameAsFetch()
+		{
+			defaultDbConfig.ValueBufferConfig = BytesBufferConfig.GrowFrom(4);
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add(new byte[] {1, 2}, new byte[] {10});
+				db.Add(new byte[] {2, 1}, new byte[] {20});
+				db.Add(new byte[] {2, 3}, new byte[] {30, 40, 50, 60, 70});
+				var ranges = new[]
+				{
+					Range.Segment(new byte[] {1, 2}, new byte[] {1, 2}),
+					Range.Segment(new byte[] {2, 1}, new byte[] {2, 3})
+				};
+				var expected = db.Fetch(ranges, Direction.Ascending, 5, 1, FetchOptions.Values);
+				var result = db.FetchAsync(ranges, Direction.Ascending, 5, 1, FetchOptions.Values, CancellationToken.None).Result;
+				Assert.That(result.RowsCount, Is.EqualTo(expected.RowsCount));
+				Assert.That(result.store, Is.EqualTo(expected.store));
+				Assert.That(result.positions, Is.EqualTo(expected.positions));
+			}
+		}
+
+		[Test]
+		public void CancelledToken_TaskCancelled()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("key", "value");
+				var task = db.FindAsync(new BytesSegment(Bytes("key")), new CancellationToken(true));
+				var error = Assert.Throws<AggregateException>(() => task.Wait());
+				Assert.That(error.InnerException, Is.InstanceOf<TaskCanceledException>());
+			}
+		}
+
+		[Test]
+		public void QueueIsFull_CorrectException()
+		{
+			defaultEnvConfig.AsyncWorkersCount = 1;
+			defaultEnvConfig.AsyncQueueLength = 1;
+			defaultDbConfig.EnableRecno = true;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 10000; i++)
+					db.Add("key" + i, "value" + i);
+				var localDb = db;
+				var error = Assert.Throws<BdbException>(delegate
+				{
+					for (var i = 0; i < 100; i++)
+						localDb.ReadAsync(Range.Line(), Direction.Ascending, 0, -1, FetchOptions.KeysAndValues, CancellationToken.None);
+				});
+				Assert.That(error.Message,
+					Is.EqualTo(string.Format("async queue is full, database (file name [{0}], database name [testDb])", fileFullPath)));
+			}
+		}
+
+		[Test]
+		public void FetchAsync_DoesNotRunDuringWrites()
+		{
+			const int batchesCount = 50;
+			const int batchSize = 100;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				env.Locker.EnterWriteLock();
+				var blocked = db.FetchAsync(new[] {Range.Line()}, Direction.Ascending, 10, 0u, FetchOptions.Keys, CancellationToken.None);
+				Assert.That(blocked.Wait(300), Is.False);
+				env.Locker.ExitWriteLock();
+				Assert.That(blocked.Result.RowsCount, Is.EqualTo(0));
+
+				var writer = Task.Factory.StartNew(() =>
+				{
+					for (var b = 0; b < batchesCount; b++)
+					{
+						env.Locker.EnterWriteLock();
+						try
+						{
+							for (var i = 0; i < batchSize; i++)
+								db.Add(string.Format("key{0:D3}-{1:D3}", b, i), new string('v', 200));
+						}
+						finally
+						{
+							env.Locker.ExitWriteLock();
+						}
+					}
+				}, TaskCreationOptions.LongRunning);
+				while (!writer.IsCompleted)
+				{
+					var tasks = Enumerable.Range(0, 10)
+						.Select(i => db.FetchAsync(new[] {Range.Prefix(Bytes("key"))}, Direction.Ascending, batchesCount*batchSize, 4u, FetchOptions.Keys, CancellationToken.None))
+						.ToArray();
+					foreach (var task in tasks)
+						Assert.That(task.Result.RowsCount%batchSize, Is.EqualTo(0));
+				}
+				writer.Wait();
+			}
+		}
+
+		[Test]
+		public void DatabaseClose_WaitsForPendingCalls()
+		{
+			defaultDbConfig.EnableRecno = true;
+			Task<BytesTable>[] tasks;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 1000; i++)
+					db.Add("key" + i, "value" + i);
+				tasks = Enumerable.Range(0, 10)
+					.Select(i => db.ReadAsync(Range.Line(), Direction.Ascending, 0, -1, FetchOptions.Keys, CancellationToken.None))
+					.ToArray();
+			}
+			foreach (var task in tasks)
+				try
+				{
+					Assert.That(task.Result.RowsCount, Is.EqualTo(1000));
+				}
+				catch (AggregateException e)
+				{
+					Assert.That(e.InnerException, Is.InstanceOf<TaskCanceledException>());
+				}
+		}
+	}
+}
@@ -0,0 +1,123 @@
+using System.Threading;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiBloomFilterTest : TestBase
+	{
+		public override void SetUp()
+		{
+			base.SetUp();
+			defaultDbConfig.BloomFilterBitsPerKey = 10;
+		}
+
+		[Test]
+		public void ExistingKeys_FoundAfterAttach()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				using (var db = env.AttachDatabase(defaultDbConfig))
+					for (var i = 0; i < 1000; i++)
+						db.Add("key" + i, "value" + i);
+				using (var db = env.AttachDatabase(defaultDbConfig))
+				{
+					Assert.That(db.GetBloomFilterStatistics().KeysCount, Is.EqualTo(1000));
+					for (var i = 0; i < 1000; i++)
+						Assert.That(db.Find(new BytesSegment(Bytes("key" + i))).String(), Is.EqualTo("value" + i));
+				}
+			}
+		}
+
+		[Test]
+		public void AbsentKeys_MostlyRejectedByFilter()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 1000; i++)
+					db.Add("key" + i, "value" + i);
+				for (var i = 0; i < 1000; i++)
+					Assert.That(db.Find(new BytesSegment(Bytes("absent" + i))), Is.Null);
+				var statistics = db.GetBloomFilterStatistics();
+				Assert.That(statistics.Checks, Is.EqualTo(1000));
+				Assert.That(statistics.Negatives + statistics.FalsePositives, Is.EqualTo(1000));
+				Assert.That(statistics.ObservedFalsePositiveRate, Is.LessThan(0.05));
+				Assert.That(statistics.EstimatedFalsePositiveRate, Is.LessThan(0.05));
+				Assert.That(statistics.MemoryInBytes, Is.GreaterThan(0));
+			}
+		}
+
+		[Test]
+		public void FilledAfterAttach_FilterGrows()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 20000; i++)
+					db.Add("key" + i, "value" + i);
+				for (var i = 0; i < 20000; i += 97)
+					Assert.That(db.Find(new BytesSegment(Bytes("key" + i))).String(), Is.EqualTo("value" + i));
+				for (var i = 0; i < 1000; i++)
+					Assert.That(db.Find(new BytesSegment(Bytes("absent" + i))), Is.Null);
+				var statistics = db.GetBloomFilterStatistics();
+				Assert.That(statistics.KeysCount, Is.EqualTo(20000));
+				Assert.That(statistics.LayersCount, Is.GreaterThan(1));
+				Assert.That(statistics.Capacity, Is.GreaterThanOrEqualTo(20000));
+				Assert.That(statistics.ObservedFalsePositiveRate, Is.LessThan(0.05));
+				Assert.That(statistics.EstimatedFalsePositiveRate, Is.LessThan(0.05));
+			}
+		}
+
+		[Test]
+		public void AbsentKey_FindAsyncReturnsNull()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("key", "value");
+				Assert.That(db.FindAsync(new BytesSegment(Bytes("absent")), CancellationToken.None).Result, Is.Null);
+				Assert.That(db.FindAsync(new BytesSegment(Bytes("key")), CancellationToken.None).Result.String(),
+					Is.EqualTo("value"));
+			}
+		}
+
+		[Test]
+		public void RemovedKeys_DroppedByRebuild()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 100; i++)
+					db.Add("key" + i, "value" + i);
+				for (var i = 0; i < 50; i++)
+					db.Remove(new BytesSegment(Bytes("key" + i)));
+				Assert.That(db.Find(new BytesSegment(Bytes("key0"))), Is.Null);
+				Assert.That(db.GetBloomFilterStatistics().RemovedKeysCount, Is.EqualTo(50));
+				db.RebuildBloomFilter();
+				var statistics = db.GetBloomFilterStatistics();
+				Assert.That(statistics.KeysCount, Is.EqualTo(50));
+				Assert.That(statistics.RemovedKeysCount, Is.EqualTo(0));
+				for (var i = 50; i < 100; i++)
+					Assert.That(db.Find(new BytesSegment(Bytes("key" + i))).String(), Is.EqualTo("value" + i));
+			}
+		}
+
+		[Test]
+		public void NotEnabled_CorrectException()
+		{
+			defaultDbConfig.BloomFilterBitsPerKey = 0;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				var localDb = db;
+				var error = Assert.Throws<BdbException>(() => localDb.GetBloomFilterStatistics());
+				Assert.That(error.Message,
+					Is.EqualTo(string.Format("bloom filter is not enabled, database (file name [{0}], database name [testDb])", fileFullPath)));
+			}
+		}
+	}
+}
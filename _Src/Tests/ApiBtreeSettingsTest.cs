@@ -0,0 +1,62 @@
+using System.Linq;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiBtreeSettingsTest : TestBase
+	{
+		[Test]
+		public void PageSizeAndMinKey()
+		{
+			defaultDbConfig.PageSize = 16*1024;
+			defaultDbConfig.BtreeMinKey = 4;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				var statistics = db.GetStatistics(false);
+				Assert.That(statistics.bt_pagesize, Is.EqualTo(16*1024));
+				Assert.That(statistics.bt_minkey, Is.EqualTo(4));
+			}
+		}
+
+		[TestCase(BtreeCompression.Bdb)]
+		[TestCase(BtreeCompression.PrefixDelta)]
+		public void CompressedDatabase_ReadsWhatWasWritten(BtreeCompression compression)
+		{
+			defaultDbConfig.Compression = compression;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 1000; i++)
+					db.Add("prefix/" + i.ToString("D5"), "value" + i % 10);
+				db.Add("other", "v");
+				Assert.That(db.Find(new BytesSegment(Bytes("prefix/00123"))).String(), Is.EqualTo("value3"));
+				var keys = db.Query(Range.Prefix(Bytes("prefix/")), Direction.Descending, 0, 3)
+					.Fetch(FetchOptions.Keys)
+					.GetColumn(0)
+					.Select(x => System.Text.Encoding.ASCII.GetString(x.ToByteArray()))
+					.ToArray();
+				Assert.That(keys, Is.EqualTo(new[] {"prefix/00999", "prefix/00998", "prefix/00997"}));
+			}
+		}
+
+		[Test]
+		public void CompressionWithRecno_CorrectException()
+		{
+			defaultDbConfig.EnableRecno = true;
+			defaultDbConfig.Compression = BtreeCompression.PrefixDelta;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				var localEnv = env;
+				var error = Assert.Throws<BdbException>(() => localEnv.AttachDatabase(defaultDbConfig));
+				Assert.That(error.Message,
+					Is.EqualTo(string.Format("btree compression can't be used with record numbers, database (file name [{0}], database name [testDb])",
+						fileFullPath)));
+			}
+		}
+	}
+}
@@ -0,0 +1,59 @@
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiBulkLoadTest : TestBase
+	{
+		[Test]
+		public void UnsortedRecords_MergedFromRunsInKeyOrder()
+		{
+			var keys = Enumerable.Range(0, 1000).Select(i => i*7919%1000).ToArray();
+			var records = keys.Select(k => Record("key" + k.ToString("D4"), "value" + k))
+				.Concat(new[] {Record("key0500", "last")});
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				using (var db = env.AttachDatabase(defaultDbConfig))
+					db.Add("stale", "value");
+				var statistics = env.BulkLoad(defaultDbConfig, records, new BulkLoadConfig {SortMemoryInBytes = 4096});
+				Assert.That(statistics.RecordsCount, Is.EqualTo(1001));
+				Assert.That(statistics.RunsCount, Is.GreaterThan(1));
+				Assert.That(statistics.PagesCount, Is.GreaterThan(0));
+				using (var db = env.AttachDatabase(defaultDbConfig))
+				{
+					var table = db
+						.Query(Range.Line(), Direction.Ascending, 0, -1)
+						.Fetch(FetchOptions.Keys | FetchOptions.Values);
+					var loadedKeys = table.GetColumn(0, x => Encoding.ASCII.GetString(x.ToByteArray()));
+					Assert.That(loadedKeys, Is.EqualTo(Enumerable.Range(0, 1000).Select(k => "key" + k.ToString("D4")).ToList()));
+					Assert.That(db.Find(new BytesSegment(Bytes("key0500"))).String(), Is.EqualTo("last"));
+					Assert.That(db.Find(new BytesSegment(Bytes("stale"))), Is.Null);
+				}
+			}
+		}
+
+		[Test]
+		public void SortedConfig_UnsortedRecords_CorrectException()
+		{
+			var records = new[] {Record("b", "1"), Record("a", "2")};
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				var exception = Assert.Throws<BdbException>(() => env.BulkLoad(defaultDbConfig, records, new BulkLoadConfig {IsSorted = true}));
+				Assert.That(exception.Message, Is.StringContaining("not sorted"));
+				using (var db = env.AttachDatabase(defaultDbConfig))
+					Assert.That(db.Find(new BytesSegment(Bytes("b"))), Is.Null);
+			}
+		}
+
+		private static KeyValuePair<byte[], byte[]> Record(string key, string value)
+		{
+			return new KeyValuePair<byte[], byte[]>(Bytes(key), Bytes(value));
+		}
+	}
+}
@@ -0,0 +1,108 @@
+using System.Linq;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiDuplicatesTest : TestBase
+	{
+		public override void SetUp()
+		{
+			base.SetUp();
+			defaultDbConfig.EnableSortedDuplicates = true;
+		}
+
+		[TestCase(false)]
+		[TestCase(true)]
+		public void QueryDuplicates(bool bulk)
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("a", "2").Add("a", "1").Add("a", "3").Add("a", "1").Add("ab", "0").Add("b", "0");
+				Assert.That(db.GetDuplicatesCount(Segment("a")), Is.EqualTo(3));
+				Assert.That(db.GetDuplicatesCount(Segment("c")), Is.EqualTo(0));
+				db.QueryDuplicates(Segment("a"), -1, bulk)
+					.AssertRead("a", "1")
+					.AssertRead("a", "2")
+					.AssertRead("a", "3")
+					.AssertStop();
+				db.QueryDuplicates(Segment("c"), -1, bulk).AssertStop();
+				var values = db.QueryDuplicates(Segment("a"), 2, bulk)
+					.Fetch(FetchOptions.Values)
+					.GetColumn(0)
+					.Select(x => System.Text.Encoding.ASCII.GetString(x.ToByteArray()))
+					.ToArray();
+				Assert.That(values, Is.EqualTo(new[] {"1", "2"}));
+			}
+		}
+
+		[Test]
+		public void BulkRead_ManyDuplicates()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				var expected = Enumerable.Range(0, 10000).Select(x => x.ToString("D6")).ToArray();
+				foreach (var value in expected)
+					db.Add("key", value);
+				var cursor = db.QueryDuplicates(Segment("key"), -1, true);
+				Assert.That(cursor.GetTotalCount(), Is.EqualTo(10000));
+				Assert.That(cursor.Fetch(FetchOptions.Values).GetColumn(0).Select(x => System.Text.Encoding.ASCII.GetString(x.ToByteArray())), Is.EqualTo(expected));
+			}
+		}
+
+		[Test]
+		public void RemoveDuplicate()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("a", "1").Add("a", "2");
+				db.RemoveDuplicate(Segment("a"), Segment("1"));
+				db.RemoveDuplicate(Segment("a"), Segment("3"));
+				db.QueryDuplicates(Segment("a"), -1, false).AssertRead("a", "2").AssertStop();
+				db.Remove(Segment("a"));
+				Assert.That(db.GetDuplicatesCount(Segment("a")), Is.EqualTo(0));
+			}
+		}
+
+		[TestCase(Direction.Ascending, new[] {"1", "2", "3", "4", "5"})]
+		[TestCase(Direction.Descending, new[] {"5", "4", "3", "2", "1"})]
+		public void FetchDuplicates_MergesByValue(Direction direction, string[] expected)
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("a", "1").Add("a", "4").Add("b", "2").Add("b", "3").Add("b", "5").Add("ab", "0").Add("c", "9");
+				var values = db.FetchDuplicates(new[] {Segment("a"), Segment("b"), Segment("x")}, direction, -1, FetchOptions.Values)
+					.GetColumn(0)
+					.Select(x => System.Text.Encoding.ASCII.GetString(x.ToByteArray()))
+					.ToArray();
+				Assert.That(values, Is.EqualTo(expected));
+			}
+		}
+
+		[Test]
+		public void DuplicatesWithRecno_CorrectException()
+		{
+			defaultDbConfig.EnableRecno = true;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				var localEnv = env;
+				var error = Assert.Throws<BdbException>(() => localEnv.AttachDatabase(defaultDbConfig));
+				Assert.That(error.Message,
+					Is.EqualTo(string.Format("sorted duplicates can't be used with record numbers, database (file name [{0}], database name [testDb])",
+						fileFullPath)));
+			}
+		}
+
+		private static BytesSegment Segment(string s)
+		{
+			return new BytesSegment(Bytes(s));
+		}
+	}
+}
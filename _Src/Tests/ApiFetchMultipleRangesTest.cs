@@ -1,4 +1,5 @@
-﻿using NUnit.Framework;
+﻿using System.Linq;
+using NUnit.Framework;
 using SimpleBdb.Driver;
 using SimpleBdb.Extensions;
 using SimpleBdb.Tests.Helpers;
@@ -247,5 +248,102 @@ namespace SimpleBdb.Tests
 				Assert.That(result.positions[2].length, Is.EqualTo(1));
 			}
 		}
+
+		[Test]
+		public void SuffixFieldAfterVariableLengthField()
+		{
+			defaultDbConfig.ValueBufferConfig = BytesBufferConfig.FixedTo(4);
+			var schema = new KeySchema(KeySchema.Ascending(KeyFieldType.String), KeySchema.Descending(KeyFieldType.Int32));
+			var key = new KeyBuilder(schema);
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add(key.Reset().Append("a").Append(1).ToSegment(), new BytesSegment(new byte[] { 1 }));
+				db.Add(key.Reset().Append("a").Append(4).ToSegment(), new BytesSegment(new byte[] { 4 }));
+				db.Add(key.Reset().Append("bbb").Append(3).ToSegment(), new BytesSegment(new byte[] { 3 }));
+				db.Add(key.Reset().Append("bbb").Append(-2).ToSegment(), new BytesSegment(new byte[] { 2 }));
+				db.Add(key.Reset().Append("c").Append(5).ToSegment(), new BytesSegment(new byte[] { 5 }));
+				var ranges = new[]
+				{
+					key.Reset().Append("a").ToPrefixRange(),
+					key.Reset().Append("bbb").ToPrefixRange()
+				};
+				var result = db.Fetch(ranges, Direction.Ascending, 3, schema, 1, FetchOptions.Values);
+				Assert.That(result.GetColumn(0, x => x[0]), Is.EqualTo(new byte[] { 4, 3, 1 }));
+			}
+		}
+
+		[TestCase(2)]
+		[TestCase(-1)]
+		public void RepeatedFetch_ReusedCursorsSeeLaterWrites(int maxIdleCursors)
+		{
+			defaultDbConfig.ValueBufferConfig = BytesBufferConfig.FixedTo(4);
+			defaultDbConfig.MaxIdleCursors = maxIdleCursors;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add(new byte[] { 1, 2 }, new byte[] { 1 });
+				db.Add(new byte[] { 2, 3 }, new byte[] { 2 });
+				db.Add(new byte[] { 3, 1 }, new byte[] { 3 });
+				var ranges = new[]
+				{
+					Range.Segment(new byte[] { 1 }, new byte[] { 1 }),
+					Range.Segment(new byte[] { 2 }, new byte[] { 2 }),
+					Range.Segment(new byte[] { 3 }, new byte[] { 3 })
+				};
+				var result = db.Fetch(ranges, Direction.Ascending, 10, 1, FetchOptions.Values);
+				Assert.That(result.GetColumn(0, x => x[0]), Is.EqualTo(new byte[] { 3, 1, 2 }));
+				db.Remove(new BytesSegment(new byte[] { 1, 2 }));
+				db.Add(new byte[] { 2, 0 }, new byte[] { 4 });
+				result = db.Fetch(ranges, Direction.Ascending, 10, 1, FetchOptions.Values);
+				Assert.That(result.GetColumn(0, x => x[0]), Is.EqualTo(new byte[] { 4, 3, 2 }));
+			}
+		}
+
+		[TestCase(Direction.Ascending)]
+		[TestCase(Direction.Descending)]
+		public void Skip_SamePagesAsSequentialFetch(Direction direction)
+		{
+			defaultDbConfig.EnableRecno = true;
+			defaultDbConfig.ValueBufferConfig = BytesBufferConfig.FixedTo(4);
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (byte i = 0; i < 20; i++)
+				{
+					db.Add(new byte[] { 1, (byte) (i*2) }, new byte[] { 1, (byte) (i*2) });
+					db.Add(new byte[] { 2, (byte) (i*2 + 1) }, new byte[] { 2, (byte) (i*2 + 1) });
+					if (i%3 == 0)
+						db.Add(new byte[] { 3, i }, new byte[] { 3, i });
+				}
+				db.Add(new byte[] { 4, 0 }, new byte[] { 4, 0 });
+				var ranges = new[]
+				{
+					Range.Prefix(new byte[] { 1 }),
+					Range.Prefix(new byte[] { 2 }),
+					Range.Prefix(new byte[] { 3 }),
+					Range.Prefix(new byte[] { 5 })
+				};
+				var all = db.Fetch(ranges, direction, -1, 1, FetchOptions.Values).GetColumn(0, x => x[0]*256 + x[1]);
+				Assert.That(all.Count, Is.EqualTo(47));
+				for (var skip = 0; skip <= all.Count + 1; skip++)
+				{
+					var page = db.Fetch(ranges, direction, skip, 3, 1, FetchOptions.Values).GetColumn(0, x => x[0]*256 + x[1]);
+					Assert.That(page, Is.EqualTo(all.Skip(skip).Take(3).ToArray()), "skip " + skip);
+				}
+				Assert.That(db.Fetch(ranges, direction, 40, -1, 1, FetchOptions.Values).RowsCount, Is.EqualTo(7));
+			}
+		}
+
+		[Test]
+		public void Skip_RecnoDisabled_CorrectException()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				var error = Assert.Throws<BdbException>(() => db.Fetch(new[] { Range.Line() }, Direction.Ascending, 1, 1, 0u, FetchOptions.Keys));
+				Assert.That(error.Message, Is.StringContaining("record numbers"));
+			}
+		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,101 @@
+using System.Threading;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiFindCacheTest : TestBase
+	{
+		public override void SetUp()
+		{
+			base.SetUp();
+			defaultDbConfig.FindCacheSizeInBytes = 1024*1024;
+		}
+
+		[Test]
+		public void SecondFind_ReturnsCachedBuffer()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("key", "value");
+				var first = db.Find(new BytesSegment(Bytes("key")));
+				var second = db.Find(new BytesSegment(Bytes("key")));
+				Assert.That(second, Is.SameAs(first));
+				Assert.That(second.String(), Is.EqualTo("value"));
+				var statistics = db.GetFindCacheStatistics();
+				Assert.That(statistics.Hits, Is.EqualTo(1));
+				Assert.That(statistics.Misses, Is.EqualTo(1));
+				Assert.That(statistics.EntriesCount, Is.EqualTo(1));
+			}
+		}
+
+		[Test]
+		public void FindAsync_MissFillsCache()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("key", "value");
+				var first = db.FindAsync(new BytesSegment(Bytes("key")), CancellationToken.None).Result;
+				var second = db.FindAsync(new BytesSegment(Bytes("key")), CancellationToken.None).Result;
+				Assert.That(second, Is.SameAs(first));
+				Assert.That(db.Find(new BytesSegment(Bytes("key"))), Is.SameAs(first));
+				var statistics = db.GetFindCacheStatistics();
+				Assert.That(statistics.Hits, Is.EqualTo(2));
+				Assert.That(statistics.Misses, Is.EqualTo(1));
+			}
+		}
+
+		[Test]
+		public void Writes_InvalidateCachedValue()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("key", "value");
+				db.Find(new BytesSegment(Bytes("key")));
+				db.Add("key", "new value");
+				Assert.That(db.Find(new BytesSegment(Bytes("key"))).String(), Is.EqualTo("new value"));
+				db.Remove(new BytesSegment(Bytes("key")));
+				Assert.That(db.Find(new BytesSegment(Bytes("key"))), Is.Null);
+				Assert.That(db.GetFindCacheStatistics().Invalidations, Is.EqualTo(2));
+			}
+		}
+
+		[Test]
+		public void SizeIsBounded()
+		{
+			defaultDbConfig.FindCacheSizeInBytes = 64*1024;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 10000; i++)
+					db.Add("key" + i, "value" + i);
+				for (var i = 0; i < 10000; i++)
+					Assert.That(db.Find(new BytesSegment(Bytes("key" + i))).String(), Is.EqualTo("value" + i));
+				var statistics = db.GetFindCacheStatistics();
+				Assert.That(statistics.SizeInBytes, Is.LessThanOrEqualTo(64*1024));
+				Assert.That(statistics.Evictions, Is.GreaterThan(0));
+				Assert.That(statistics.EntriesCount, Is.LessThan(10000));
+			}
+		}
+
+		[Test]
+		public void NotEnabled_CorrectException()
+		{
+			defaultDbConfig.FindCacheSizeInBytes = 0;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				var localDb = db;
+				var error = Assert.Throws<BdbException>(() => localDb.GetFindCacheStatistics());
+				Assert.That(error.Message,
+					Is.EqualTo(string.Format("find cache is not enabled, database (file name [{0}], database name [testDb])", fileFullPath)));
+			}
+		}
+	}
+}
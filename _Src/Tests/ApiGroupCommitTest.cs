@@ -0,0 +1,113 @@
+using System.Linq;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiGroupCommitTest : TestBase
+	{
+		public override void SetUp()
+		{
+			base.SetUp();
+			defaultEnvConfig.IsPersistent = true;
+			defaultEnvConfig.EnableGroupCommit = true;
+		}
+
+		[Test]
+		public void Ticket_CompletesAfterFlush()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("key", "value");
+				Assert.That(env.GetCommitTicket().Wait(5000));
+			}
+		}
+
+		[Test]
+		public void CommittedData_SurvivesReopen()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 100; i++)
+					db.Add("key" + i, "value" + i);
+				db.Remove(new BytesSegment(Bytes("key0")));
+				env.GetCommitTicket().Wait();
+			}
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				Assert.That(db.Find(new BytesSegment(Bytes("key0"))), Is.Null);
+				Assert.That(db.Find(new BytesSegment(Bytes("key50"))).String(), Is.EqualTo("value50"));
+			}
+		}
+
+		[Test]
+		public void SortedDuplicates_RemoveInsideTransaction()
+		{
+			defaultDbConfig.EnableSortedDuplicates = true;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("key", "a");
+				db.Add("key", "b");
+				db.RemoveDuplicate(new BytesSegment(Bytes("key")), new BytesSegment(Bytes("a")));
+				Assert.That(db.GetDuplicatesCount(new BytesSegment(Bytes("key"))), Is.EqualTo(1));
+			}
+		}
+
+		[Test]
+		public void Postings_BlockSplitsCommittedAndSurviveReopen()
+		{
+			defaultDbConfig.PostingListMaxBlockIds = 4;
+			var term = new BytesSegment(Bytes("term"));
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var id = 100u; id > 0; id--)
+					db.AddPosting(term, id);
+				db.RemovePosting(term, 50);
+				env.GetCommitTicket().Wait();
+			}
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+				Assert.That(db.FetchPostings(new[] {term}, PostingsOperation.Union, 0),
+					Is.EqualTo(Enumerable.Range(1, 100).Where(x => x != 50).Select(x => (uint) x).ToArray()));
+		}
+
+		[Test]
+		public void NotPersistent_CorrectException()
+		{
+			defaultEnvConfig.IsPersistent = false;
+			var error = Assert.Throws<BdbException>(() => new Environment(defaultEnvConfig, moqLogger.Object));
+			Assert.That(error.Message,
+				Is.EqualTo(string.Format("group commit requires persistent environment, environment (file name [{0}])", fileFullPath)));
+		}
+
+		[Test]
+		public void Shared_CorrectException()
+		{
+			defaultEnvConfig.IsShared = true;
+			var error = Assert.Throws<BdbException>(() => new Environment(defaultEnvConfig, moqLogger.Object));
+			Assert.That(error.Message,
+				Is.EqualTo(string.Format("group commit is not supported by shared environment, environment (file name [{0}])", fileFullPath)));
+		}
+
+		[Test]
+		public void NotEnabled_CorrectException()
+		{
+			defaultEnvConfig.EnableGroupCommit = false;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				var localEnv = env;
+				var error = Assert.Throws<BdbException>(() => localEnv.GetCommitTicket());
+				Assert.That(error.Message,
+					Is.EqualTo(string.Format("group commit is not enabled, environment (file name [{0}])", fileFullPath)));
+			}
+		}
+	}
+}
@@ -0,0 +1,131 @@
+using System.Collections.Generic;
+using System.Linq;
+using System.Text;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiPartitionedDatabaseTest : TestBase
+	{
+		private byte[][] boundaries;
+
+		public override void SetUp()
+		{
+			base.SetUp();
+			boundaries = new[] {Bytes("c"), Bytes("f")};
+		}
+
+		[Test]
+		public void PointOperations_RoutedToPartition()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachPartitionedDatabase(defaultDbConfig, boundaries))
+			{
+				Assert.That(db.PartitionsCount, Is.EqualTo(3));
+				Add(db, "a", "b", "c", "e", "f", "z");
+				Assert.That(db.GetPartitionIndex(new BytesSegment(Bytes("b"))), Is.EqualTo(0));
+				Assert.That(db.GetPartitionIndex(new BytesSegment(Bytes("c"))), Is.EqualTo(1));
+				Assert.That(db.GetPartitionIndex(new BytesSegment(Bytes("z"))), Is.EqualTo(2));
+				Assert.That(db.Find(new BytesSegment(Bytes("e"))).String(), Is.EqualTo("value e"));
+				Assert.That(db.GetPartition(1).Find(new BytesSegment(Bytes("e"))).String(), Is.EqualTo("value e"));
+				Assert.That(db.GetPartition(0).Find(new BytesSegment(Bytes("e"))), Is.Null);
+				db.Remove(new BytesSegment(Bytes("e")));
+				Assert.That(db.Find(new BytesSegment(Bytes("e"))), Is.Null);
+			}
+		}
+
+		[Test]
+		public void Query_ReadsPartitionsInOrder()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachPartitionedDatabase(defaultDbConfig, boundaries))
+			{
+				Add(db, "a", "b", "c", "e", "f", "z");
+				Assert.That(ReadKeys(db.Query(Range.Line(), Direction.Ascending, 0, -1)), Is.EqualTo(new[] {"a", "b", "c", "e", "f", "z"}));
+				Assert.That(ReadKeys(db.Query(Range.Line(), Direction.Descending, 0, 4)), Is.EqualTo(new[] {"z", "f", "e", "c"}));
+				Assert.That(ReadKeys(db.Query(Range.Segment(Bytes("b"), Bytes("e")), Direction.Ascending, 0, -1)), Is.EqualTo(new[] {"b", "c", "e"}));
+			}
+		}
+
+		[Test]
+		public void Query_SkipAcrossPartitions()
+		{
+			defaultDbConfig.EnableRecno = true;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachPartitionedDatabase(defaultDbConfig, boundaries))
+			{
+				Add(db, "a", "b", "c", "e", "f", "z");
+				using (var cursor = db.Query(Range.Line(), Direction.Ascending, 3, 2))
+				{
+					Assert.That(cursor.GetTotalCount(), Is.EqualTo(6));
+					var table = cursor.Fetch(FetchOptions.Keys);
+					Assert.That(table.GetColumn(0, x => Encoding.ASCII.GetString(x.ToByteArray())), Is.EqualTo(new[] {"e", "f"}));
+				}
+			}
+		}
+
+		[Test]
+		public void Fetch_MergesPartitionsBySuffix()
+		{
+			defaultDbConfig.EnableRecno = true;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachPartitionedDatabase(defaultDbConfig, boundaries))
+			{
+				Add(db, "b2", "b4", "c1", "c3");
+				var ranges = new[] {Range.Segment(Bytes("b"), Bytes("b")), Range.Segment(Bytes("c"), Bytes("c"))};
+				var result = db.Fetch(ranges, Direction.Ascending, -1, 1, FetchOptions.Keys);
+				Assert.That(result.GetColumn(0, x => Encoding.ASCII.GetString(x.ToByteArray())), Is.EqualTo(new[] {"c1", "b2", "c3", "b4"}));
+			}
+		}
+
+		[Test]
+		public void UnsortedBoundaries_CorrectException()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				var localEnv = env;
+				var error = Assert.Throws<BdbException>(() => localEnv.AttachPartitionedDatabase(defaultDbConfig, new[] {Bytes("f"), Bytes("c")}));
+				Assert.That(error.Message, Is.EqualTo(string.Format(
+					"partition boundaries must be sorted ascending, boundary index [1], database name [testDb], environment (file name [{0}])", fileFullPath)));
+			}
+		}
+
+		[Test]
+		public void OtherBoundariesOnReattach_CorrectException()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				using (var db = env.AttachPartitionedDatabase(defaultDbConfig, boundaries))
+					Add(db, "a", "e", "z");
+				using (var db = env.AttachPartitionedDatabase(defaultDbConfig, new[] {Bytes("c"), Bytes("f")}))
+					Assert.That(db.Find(new BytesSegment(Bytes("e"))).String(), Is.EqualTo("value e"));
+				var localEnv = env;
+				var error = Assert.Throws<BdbException>(() => localEnv.AttachPartitionedDatabase(defaultDbConfig, new[] {Bytes("d")}));
+				Assert.That(error.Message, Is.EqualTo(string.Format(
+					"partition boundaries don't match boundaries of the first attach, database name [testDb], environment (file name [{0}])", fileFullPath)));
+			}
+		}
+
+		private void Add(PartitionedDatabase db, params string[] keys)
+		{
+			foreach (var key in keys)
+				db.Add(new BytesSegment(Bytes(key)), new BytesSegment(Bytes("value " + key)));
+		}
+
+		private static string[] ReadKeys(ICursor cursor)
+		{
+			var result = new List<string>();
+			using (cursor)
+			{
+				BytesRecord record;
+				while (cursor.Read(out record))
+					result.Add(record.Key.String());
+			}
+			return result.ToArray();
+		}
+	}
+}
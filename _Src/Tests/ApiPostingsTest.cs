@@ -0,0 +1,66 @@
+using System.Linq;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiPostingsTest : TestBase
+	{
+		[Test]
+		public void AddRemoveAcrossBlocks()
+		{
+			defaultDbConfig.PostingListMaxBlockIds = 4;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				var expected = Enumerable.Range(0, 50).Select(x => (uint) (x*x*1000)).ToList();
+				foreach (var id in expected.AsEnumerable().Reverse())
+					db.AddPosting(Term("a"), id);
+				db.AddPosting(Term("a"), 4000);
+				db.AddPosting(Term("ab"), 1);
+				Assert.That(db.FetchPostings(new[] {Term("a")}, PostingsOperation.Union, 0), Is.EqualTo(expected));
+
+				db.RemovePosting(Term("a"), 0);
+				db.RemovePosting(Term("a"), 2401000);
+				db.RemovePosting(Term("a"), 7);
+				expected.Remove(0);
+				expected.Remove(2401000);
+				Assert.That(db.FetchPostings(new[] {Term("a")}, PostingsOperation.Union, 0), Is.EqualTo(expected));
+				Assert.That(db.FetchPostings(new[] {Term("a")}, PostingsOperation.Union, 3), Is.EqualTo(expected.Take(3)));
+			}
+		}
+
+		[Test]
+		public void UnionAndIntersection()
+		{
+			defaultDbConfig.PostingListMaxBlockIds = 3;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (uint i = 0; i < 100; i++)
+				{
+					if (i%2 == 0)
+						db.AddPosting(Term("even"), i);
+					if (i%3 == 0)
+						db.AddPosting(Term("three"), i);
+					if (i%5 == 0)
+						db.AddPosting(Term("five"), i);
+				}
+				var terms = new[] {Term("even"), Term("three"), Term("five")};
+				Assert.That(db.FetchPostings(terms, PostingsOperation.Intersection, 0), Is.EqualTo(new uint[] {0, 30, 60, 90}));
+				Assert.That(db.FetchPostings(terms, PostingsOperation.Union, 0),
+					Is.EqualTo(Enumerable.Range(0, 100).Where(x => x%2 == 0 || x%3 == 0 || x%5 == 0).Select(x => (uint) x)));
+				Assert.That(db.FetchPostings(new[] {Term("even"), Term("missing")}, PostingsOperation.Intersection, 0), Is.Empty);
+				Assert.That(db.FetchPostings(new BytesSegment[0], PostingsOperation.Union, 0), Is.Empty);
+			}
+		}
+
+		private static BytesSegment Term(string s)
+		{
+			return new BytesSegment(Bytes(s));
+		}
+	}
+}
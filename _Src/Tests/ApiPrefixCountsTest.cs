@@ -0,0 +1,91 @@
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Extensions;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiPrefixCountsTest : TestBase
+	{
+		public override void SetUp()
+		{
+			base.SetUp();
+			defaultDbConfig.CountedPrefixLength = 2;
+		}
+
+		[Test]
+		public void AddAndRemove_CountOnlyInsertedAndDeletedKeys()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("aa1", "v").Add("aa2", "v").Add("ab1", "v").Add("b", "v");
+				db.Add("aa1", "overwritten");
+				db.Remove(new BytesSegment(Bytes("ab1")));
+				db.Remove(new BytesSegment(Bytes("absent")));
+				Assert.That(db.GetCount(Range.Prefix(Bytes("aa"))), Is.EqualTo(2));
+				Assert.That(db.GetCount(Range.Prefix(Bytes("ab"))), Is.EqualTo(0));
+				Assert.That(db.GetCount(Range.Prefix(Bytes("a"))), Is.EqualTo(2));
+				Assert.That(db.GetCount(Range.Line()), Is.EqualTo(3));
+				Assert.That(db.Find(Bytes("aa1")).String(), Is.EqualTo("overwritten"));
+			}
+		}
+
+		[Test]
+		public void ExistingKeys_CountedOnAttach()
+		{
+			var config = new DatabaseConfig {Name = defaultDbConfig.Name};
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				using (var db = env.AttachDatabase(config))
+					for (var i = 0; i < 1000; i++)
+						db.Add(new[] {(byte) (i%10), (byte) (i/10), (byte) i}, Bytes("v"));
+				using (var db = env.AttachDatabase(defaultDbConfig))
+				{
+					Assert.That(db.GetCount(Range.Prefix(new byte[] {3})), Is.EqualTo(100));
+					Assert.That(db.GetCount(Range.Prefix(new byte[] {3, 5})), Is.EqualTo(1));
+					Assert.That(db.GetCount(Range.Segment(new byte[] {2}, new byte[] {4})), Is.EqualTo(200));
+					var table = db.Fetch(new[] {Range.Prefix(new byte[] {1}), Range.Prefix(new byte[] {7})}, Direction.Ascending, -1, 1u, FetchOptions.Keys);
+					Assert.That(table.RowsCount, Is.EqualTo(200));
+				}
+			}
+		}
+
+		[Test]
+		public void SavedCounts_LoadedOnReattach()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				using (var db = env.AttachDatabase(defaultDbConfig))
+					db.Add("aa1", "v").Add("aa2", "v").Add("ab1", "v");
+				using (var db = env.AttachDatabase(defaultDbConfig))
+				{
+					Assert.That(db.GetCount(Range.Prefix(Bytes("aa"))), Is.EqualTo(2));
+					db.Add("aa3", "v").Add("aa1", "overwritten");
+				}
+				using (var db = env.AttachDatabase(defaultDbConfig))
+					Assert.That(db.GetCount(Range.Prefix(Bytes("aa"))), Is.EqualTo(3));
+				defaultDbConfig.CountedPrefixLength = 3;
+				using (var db = env.AttachDatabase(defaultDbConfig))
+				{
+					Assert.That(db.GetCount(Range.Prefix(Bytes("aa1"))), Is.EqualTo(1));
+					Assert.That(db.GetCount(Range.Line()), Is.EqualTo(4));
+				}
+			}
+		}
+
+		[Test]
+		public void BoundaryLongerThanPrefix_RequiresRecno()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("aa1", "v");
+				var exception = Assert.Throws<BdbException>(() => db.GetCount(Range.Prefix(Bytes("aa1"))));
+				Assert.That(exception.Message, Is.StringContaining("record numbers"));
+			}
+		}
+	}
+}
@@ -0,0 +1,105 @@
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Linq;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Extensions;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiQueryPartitionsTest : TestBase
+	{
+		[Test]
+		public void Recno_PartitionsHaveEqualCounts()
+		{
+			defaultDbConfig.EnableRecno = true;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 1000; i++)
+					db.Add("key" + i.ToString("D4"), "value" + i);
+				var partitions = db.QueryPartitions(Range.Line(), 4);
+				Assert.That(partitions.Length, Is.EqualTo(4));
+				Assert.That(partitions.Select(x => x.GetTotalCount()), Is.All.EqualTo(250));
+				Assert.That(ReadAll(partitions), Is.EqualTo(Enumerable.Range(0, 1000).Select(x => "key" + x.ToString("D4")).ToArray()));
+			}
+		}
+
+		[Test]
+		public void NoRecno_PartitionsCoverRangeInOrder()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 10000; i++)
+					db.Add("key" + i.ToString("D5"), "value" + i);
+				var partitions = db.QueryPartitions(Range.Segment(Bytes("key01000"), Bytes("key08999")), 4);
+				Assert.That(partitions.Length, Is.GreaterThan(1));
+				Assert.That(ReadAll(partitions), Is.EqualTo(Enumerable.Range(1000, 8000).Select(x => "key" + x.ToString("D5")).ToArray()));
+			}
+		}
+
+		[Test]
+		public void NoRecno_KeysPrefixingSplitKeys_NotLost()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				var keys = new List<string>();
+				for (var i = 0; i < 100; i++)
+					for (var j = 0; j < 20; j++)
+					{
+						var key = ((char) ('a' + i%26)).ToString() + i.ToString("D3") + new string('x', j);
+						keys.Add(key);
+						db.Add(key, "value");
+					}
+				keys.Sort(string.CompareOrdinal);
+				var partitions = db.QueryPartitions(Range.Line(), 8);
+				Assert.That(ReadAll(partitions), Is.EqualTo(keys.ToArray()));
+			}
+		}
+
+		[Test]
+		public void ScanParallel_ReadsEveryRecord()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 10000; i++)
+					db.Add("key" + i.ToString("D5"), "value" + i);
+				var keys = new ConcurrentBag<string>();
+				db.ScanParallel(Range.Line(), 4, (partition, record) => keys.Add(record.Key.String()));
+				Assert.That(keys.OrderBy(x => x), Is.EqualTo(Enumerable.Range(0, 10000).Select(x => "key" + x.ToString("D5")).ToArray()));
+			}
+		}
+
+		[Test]
+		public void InvalidPartitionsCount_CorrectException()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				var localDb = db;
+				var error = Assert.Throws<BdbException>(() => localDb.QueryPartitions(Range.Line(), 0));
+				Assert.That(error.Message,
+					Is.EqualTo(string.Format("invalid partitions count [0], database (file name [{0}], database name [testDb])", fileFullPath)));
+			}
+		}
+
+		private static string[] ReadAll(IEnumerable<ICursor> partitions)
+		{
+			var result = new List<string>();
+			foreach (var partition in partitions)
+				using (partition)
+				{
+					BytesRecord record;
+					while (partition.Read(out record))
+						result.Add(record.Key.String());
+				}
+			return result.ToArray();
+		}
+	}
+}
@@ -236,6 +236,25 @@ namespace SimpleBdb.Tests
 			}
 		}
 
+		[Test]
+		public void LongPrefix_Descending_StopsAtFirstMismatchAfterWord()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("prefix-01", "short")
+					.Add("prefix-012", "v1")
+					.Add("prefix-012345", "v2")
+					.Add("prefix-013", "after")
+					.Add("prefix-011", "before");
+				using (var reader = db.Query(Range.Prefix(Bytes("prefix-012")), Direction.Descending, 0, -1))
+					reader
+						.AssertRead("prefix-012345")
+						.AssertRead("prefix-012")
+						.AssertStop();
+			}
+		}
+
 		[Test]
 		public void GetAll()
 		{
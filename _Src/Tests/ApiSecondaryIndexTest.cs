@@ -0,0 +1,88 @@
+using System.Linq;
+using System.Text;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiSecondaryIndexTest : TestBase
+	{
+		public override void SetUp()
+		{
+			base.SetUp();
+			defaultDbConfig.SecondaryIndexes = new[]
+			{
+				new SecondaryIndexConfig {Name = "byGroup", ValueOffset = 0, ValueLength = 2, AppendPrimaryKey = true}
+			};
+		}
+
+		[Test]
+		public void Writes_MaintainIndex()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("k1", "b:first")
+					.Add("k2", "a:second")
+					.Add("k3", "b:third")
+					.Add("k4", "x");
+				using (var cursor = db.QueryIndex("byGroup", Range.Prefix(Bytes("b:")), Direction.Ascending, -1))
+					cursor.AssertRead("k1", "b:first").AssertRead("k3", "b:third").AssertStop();
+				db.Add("k1", "a:moved");
+				db.Remove(new BytesSegment(Bytes("k3")));
+				using (var cursor = db.QueryIndex("byGroup", Range.Prefix(Bytes("b:")), Direction.Ascending, -1))
+					cursor.AssertStop();
+				using (var cursor = db.QueryIndex("byGroup", Range.Line(), Direction.Descending, -1))
+					cursor.AssertRead("k2", "a:second").AssertRead("k1", "a:moved").AssertStop();
+			}
+		}
+
+		[Test]
+		public void ExistingRecords_IndexedOnAttach()
+		{
+			var config = new DatabaseConfig {Name = defaultDbConfig.Name};
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				using (var db = env.AttachDatabase(config))
+					for (var i = 0; i < 100; i++)
+						db.Add("key" + i.ToString("D2"), (i%2 == 0 ? "ev" : "od") + i);
+				using (var db = env.AttachDatabase(defaultDbConfig))
+				{
+					var table = db.FetchIndex("byGroup", Range.Prefix(Bytes("od")), Direction.Ascending, 100, FetchOptions.Keys);
+					Assert.That(table.GetColumn(0, x => Encoding.ASCII.GetString(x.ToByteArray())),
+						Is.EqualTo(Enumerable.Range(0, 100).Where(i => i%2 == 1).Select(i => "key" + i.ToString("D2")).ToList()));
+				}
+			}
+		}
+
+		[Test]
+		public void FetchIndex_UnboundedTake_CorrectException()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				var exception = Assert.Throws<BdbException>(() => db.FetchIndex("byGroup", Range.Line(), Direction.Ascending, -1, FetchOptions.Keys));
+				Assert.That(exception.Message, Is.StringContaining("bounded take"));
+				exception = Assert.Throws<BdbException>(() => db.QueryIndex("absent", Range.Line(), Direction.Ascending, -1));
+				Assert.That(exception.Message, Is.StringContaining("secondary index [absent] is not configured"));
+			}
+		}
+
+		[Test]
+		public void OtherSpecOnReattach_CorrectException()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				using (var db = env.AttachDatabase(defaultDbConfig))
+					db.Add("k1", "b:first");
+				defaultDbConfig.SecondaryIndexes[0].ValueLength = 1;
+				var localEnv = env;
+				var exception = Assert.Throws<BdbException>(() => localEnv.AttachDatabase(defaultDbConfig));
+				Assert.That(exception.Message, Is.StringContaining("secondary index [byGroup] doesn't match its first attach"));
+			}
+		}
+	}
+}
@@ -0,0 +1,108 @@
+using System.IO;
+using System.Threading;
+using Moq;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiSharedEnvironmentTest : TestBase
+	{
+		public override void SetUp()
+		{
+			base.SetUp();
+			defaultEnvConfig.IsShared = true;
+			defaultEnvConfig.IsPersistent = true;
+		}
+
+		[Test]
+		public void Reattach_SeesDataAndWarmCache()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+				for (var i = 0; i < 1000; i++)
+					db.Add("key" + i, "value" + i);
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				var cachedPages = env.GetCacheStatistics().st_pages;
+				var statistics = db.GetStatistics(false);
+				Assert.That(cachedPages, Is.GreaterThanOrEqualTo(statistics.bt_leaf_pg + statistics.bt_int_pg));
+				Assert.That(db.Find(new BytesSegment(Bytes("key500"))).String(), Is.EqualTo("value500"));
+			}
+		}
+
+		[Test]
+		public void WarmList_SavedOnCloseAndPreloadedOnAttach()
+		{
+			defaultEnvConfig.IsShared = false;
+			defaultEnvConfig.WarmListFileName = "testDirectory\\warmList";
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 1000; i++)
+					db.Add("key" + i, "value" + i);
+				for (var i = 0; i < 1000; i++)
+					db.Find(new BytesSegment(Bytes("key" + i%10)));
+			}
+			Assert.That(File.Exists("testDirectory\\warmList"));
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+				Assert.That(db.Find(new BytesSegment(Bytes("key5"))).String(), Is.EqualTo("value5"));
+		}
+
+		[Test]
+		public void WarmList_PreloadsKeysWithoutFailure()
+		{
+			defaultEnvConfig.IsShared = false;
+			defaultEnvConfig.WarmListFileName = "testDirectory\\warmList";
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 10000; i++)
+					db.Add("key" + i, "value" + i);
+				for (var i = 0; i < 10000; i++)
+					db.Find(new BytesSegment(Bytes("key" + i%1000)));
+			}
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (env.AttachDatabase(defaultDbConfig))
+			{
+				//warm up is done when pages stop coming in
+				var pagesIn = 0ul;
+				for (var i = 0; i < 100; i++)
+				{
+					Thread.Sleep(50);
+					var current = env.GetCacheStatistics().st_page_in;
+					if (current > 0 && current == pagesIn)
+						break;
+					pagesIn = current;
+				}
+				Assert.That(pagesIn, Is.GreaterThan(1));
+			}
+			moqLogger.Verify(x => x.Warn(It.Is<string>(s => s.Contains("warm up failed"))), Times.Never());
+		}
+
+		[Test]
+		public void SharedMemoryKeyOutOfLongRange_CorrectException()
+		{
+			defaultEnvConfig.SharedMemoryKey = long.MaxValue;
+			var exception = Assert.Throws<BdbException>(() => new Environment(defaultEnvConfig, moqLogger.Object));
+			Assert.That(exception.Message, Is.StringContaining("doesn't fit into long"));
+		}
+
+		[Test]
+		public void WarmList_CorruptedFile_Ignored()
+		{
+			File.WriteAllBytes("testDirectory\\warmList", new byte[] {1, 2, 3});
+			defaultEnvConfig.IsShared = false;
+			defaultEnvConfig.WarmListFileName = "testDirectory\\warmList";
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+				Assert.That(db.Find(new BytesSegment(Bytes("key"))), Is.Null);
+			moqLogger.Verify(x => x.Warn(It.IsAny<string>()));
+		}
+	}
+}
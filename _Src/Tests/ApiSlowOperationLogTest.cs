@@ -0,0 +1,82 @@
+using Moq;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiSlowOperationLogTest : TestBase
+	{
+		private const int recordsCount = 100000;
+
+		[Test]
+		public void SlowQuery_ReportedOnDisposeWithCounters()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				Fill(env);
+				defaultDbConfig.SlowOperationThresholdInMilliseconds = 1;
+				using (var db = env.AttachDatabase(defaultDbConfig))
+				{
+					using (var cursor = db.Query(Range.Line(), Direction.Ascending, 0, -1))
+					{
+						BytesRecord record;
+						while (cursor.Read(out record))
+						{
+						}
+						moqLogger.Verify(x => x.Warn(It.Is<string>(s => s.StartsWith("slow Query"))), Times.Never());
+					}
+					moqLogger.Verify(x => x.Warn(It.Is<string>(s => s.StartsWith("slow Query")
+						&& s.Contains("boundary lengths [--]") && s.Contains(string.Format("rows [{0}]", recordsCount))
+						&& s.Contains("seeks [1]") && s.Contains(string.Format("steps [{0}]", recordsCount)))), Times.Once());
+				}
+			}
+		}
+
+		[Test]
+		public void SlowFetch_ReportedWithParameters()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				Fill(env);
+				defaultDbConfig.SlowOperationThresholdInMilliseconds = 1;
+				using (var db = env.AttachDatabase(defaultDbConfig))
+				{
+					var ranges = new[] {Range.Prefix(Bytes("key1")), Range.Prefix(Bytes("key2"))};
+					var table = db.Fetch(ranges, Direction.Descending, recordsCount, 3, FetchOptions.Keys);
+					moqLogger.Verify(x => x.Warn(It.Is<string>(s => s.StartsWith("slow Fetch")
+						&& s.Contains(string.Format("ranges [2], boundary lengths [4-4, 4-4], direction [-1], skip [0], take [{0}], key suffix offset [3]", recordsCount))
+						&& s.Contains(string.Format("rows [{0}]", table.RowsCount)))), Times.Once());
+				}
+			}
+		}
+
+		[Test]
+		public void FastOperations_NotReported()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				Fill(env);
+				defaultDbConfig.SlowOperationThresholdInMilliseconds = 60*1000;
+				using (var db = env.AttachDatabase(defaultDbConfig))
+				{
+					db.Add("key", "value");
+					Assert.That(db.Find(new BytesSegment(Bytes("key"))).String(), Is.EqualTo("value"));
+					using (var cursor = db.Query(Range.Line(), Direction.Ascending, 0, 10))
+						cursor.Fetch(FetchOptions.KeysAndValues);
+					db.Fetch(new[] {Range.Line()}, Direction.Ascending, 10, 0, FetchOptions.Keys);
+				}
+				moqLogger.Verify(x => x.Warn(It.Is<string>(s => s.StartsWith("slow"))), Times.Never());
+			}
+		}
+
+		private void Fill(Environment env)
+		{
+			using (var db = env.AttachDatabase(defaultDbConfig))
+				for (var i = 0; i < recordsCount; i++)
+					db.Add("key" + i, "value" + i);
+		}
+	}
+}
@@ -311,5 +311,59 @@ namespace SimpleBdb.Tests
 				Assert.That(env.Databases, Is.Empty);
 			}
 		}
+
+		[Test]
+		public void CacheTuningIsApplied()
+		{
+			defaultEnvConfig.CacheSizeInBytes = 8*1024*1024;
+			defaultEnvConfig.CacheRegionsCount = 4;
+			defaultEnvConfig.CacheHashBucketsCount = 4096;
+			defaultEnvConfig.CacheHashMutexesCount = 64;
+			defaultEnvConfig.MaxOpenFiles = 16;
+			defaultEnvConfig.MaxWritesCount = 32;
+			defaultEnvConfig.MaxWriteSleepInMicroseconds = 100;
+			defaultEnvConfig.MutexSpinsCount = 200;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("k", "v");
+				var statistics = env.GetCacheStatistics();
+				Assert.That(statistics.st_ncache, Is.EqualTo(4));
+				Assert.That(statistics.st_hash_buckets, Is.GreaterThanOrEqualTo(4096));
+			}
+		}
+
+		[Test]
+		public void MemoryMappedDatabase_PagesAreMapped()
+		{
+			defaultEnvConfig.IsPersistent = true;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+				for (var i = 0; i < 1000; i++)
+					db.Add("k" + i, "v" + i);
+			defaultEnvConfig.MemoryMapSizeInBytes = 64*1024*1024;
+			defaultDbConfig.IsReadonly = true;
+			defaultDbConfig.IsMemoryMapped = true;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				Assert.That(db.Find(new BytesSegment(Bytes("k500"))).String(), Is.EqualTo("v500"));
+				Assert.That(env.GetCacheStatistics().st_map, Is.GreaterThan(0));
+			}
+		}
+
+		[Test]
+		public void MemoryMappedDatabase_NotReadonly_CorrectException()
+		{
+			defaultDbConfig.IsMemoryMapped = true;
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			{
+				var localEnv = env;
+				var error = Assert.Throws<BdbException>(() => localEnv.AttachDatabase(defaultDbConfig));
+				Assert.That(error.Message,
+					Is.EqualTo(string.Format("memory mapped database must be readonly, database (file name [{0}], database name [testDb])",
+						fileFullPath)));
+			}
+		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,61 @@
+using System.IO;
+using System.Text;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class ApiTraceTest : TestBase
+	{
+		private const string traceFileName = "testDirectory\\trace";
+
+		[Test]
+		public void WithoutKeys_RecordsOnlyLengths()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.StartTrace(traceFileName, false);
+				db.Add("key1", "value1");
+				db.Add("key2", "value2");
+				Assert.That(db.Find(new BytesSegment(Bytes("key1"))), Is.Not.Null);
+				Assert.That(db.Find(new BytesSegment(Bytes("key3"))), Is.Null);
+				db.Remove(new BytesSegment(Bytes("key2")));
+				Assert.That(db.StopTrace(), Is.EqualTo(5));
+			}
+			var bytes = File.ReadAllBytes(traceFileName);
+			Assert.That(Encoding.ASCII.GetString(bytes, 0, 8), Is.EqualTo("SBDBTRC1"));
+			Assert.That(bytes[8], Is.EqualTo(0));
+			//header, 17 bytes per record prefix, 4 bytes per key length, 4 bytes per value length
+			Assert.That(bytes.Length, Is.EqualTo(9 + 5*(17 + 4) + 2*4));
+			Assert.That(Encoding.ASCII.GetString(bytes), Is.Not.StringContaining("key"));
+		}
+
+		[Test]
+		public void WithKeys_RecordsKeysAndQueries()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				db.Add("key1", "value1");
+				db.StartTrace(traceFileName, true);
+				Assert.Throws<BdbException>(() => db.StartTrace(traceFileName + "2", true));
+				db.Find(new BytesSegment(Bytes("key1")));
+				using (var cursor = db.Query(Range.Prefix(Bytes("key")), Direction.Descending, 0, 10))
+					cursor.AssertRead("key1");
+				Assert.That(db.StopTrace(), Is.EqualTo(2));
+				Assert.That(db.StopTrace(), Is.EqualTo(0));
+			}
+			var bytes = File.ReadAllBytes(traceFileName);
+			Assert.That(bytes[8], Is.EqualTo(1));
+			Assert.That(bytes[9], Is.EqualTo(3));
+			Assert.That(Encoding.ASCII.GetString(bytes, 9 + 17 + 4, 4), Is.EqualTo("key1"));
+			Assert.That(bytes[9 + 17 + 4 + 4], Is.EqualTo(4));
+			//query is written on dispose with rows read as result
+			Assert.That(System.BitConverter.ToInt32(bytes, 9 + 17 + 4 + 4 + 13), Is.EqualTo(1));
+		}
+	}
+}
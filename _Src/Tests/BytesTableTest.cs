@@ -0,0 +1,94 @@
+using System;
+using System.Linq;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+using Environment = SimpleBdb.Driver.Environment;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class BytesTableTest : TestBase
+	{
+		[Test]
+		public void TypedColumns_DecodedFromKeysAndValues()
+		{
+			var builder = new KeyBuilder(new KeySchema(KeySchema.Ascending(KeyFieldType.Int64), KeySchema.Ascending(KeyFieldType.Int32)));
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = -50; i < 50; i++)
+				{
+					var key = builder.Reset().Append(i*1000000000000L).Append(-i).ToByteArray();
+					var value = BitConverter.GetBytes(i*0.5).Concat(BitConverter.GetBytes(i*7)).ToArray();
+					db.Add(key, value);
+				}
+				BytesTable table;
+				using (var cursor = db.Query(Range.Line(), Direction.Ascending, 0, -1))
+					table = cursor.Fetch(FetchOptions.KeysAndValues);
+				var expected = Enumerable.Range(-50, 100).ToArray();
+				Assert.That(table.GetInt64Column(0, 0, FieldEncoding.KeyOrdered), Is.EqualTo(expected.Select(x => x*1000000000000L).ToArray()));
+				Assert.That(table.GetInt32Column(0, 8, FieldEncoding.KeyOrdered), Is.EqualTo(expected.Select(x => -x).ToArray()));
+				Assert.That(table.GetDoubleColumn(1, 0, FieldEncoding.LittleEndian), Is.EqualTo(expected.Select(x => x*0.5).ToArray()));
+				Assert.That(table.GetInt32Column(1, 8, FieldEncoding.LittleEndian), Is.EqualTo(expected.Select(x => x*7).ToArray()));
+				Assert.That(table.GetSegment(3, 1).CopyToByteArray(), Is.EqualTo(BitConverter.GetBytes(-47*0.5).Concat(BitConverter.GetBytes(-47*7)).ToArray()));
+			}
+		}
+
+		[Test]
+		public void BigEndianColumn()
+		{
+			var table = new BytesTable(new byte[] { 0, 0, 1, 2, 0xFF, 0xFF, 0xFF, 0xFE },
+				new[] { new SegmentPosition { start = 0, length = 4 }, new SegmentPosition { start = 4, length = 4 } }, 2, 1);
+			Assert.That(table.GetInt32Column(0, 0, FieldEncoding.BigEndian), Is.EqualTo(new[] { 258, -2 }));
+		}
+
+		[Test]
+		public void FieldOutOfCell_Throws()
+		{
+			var table = new BytesTable(new byte[] { 1, 2, 3, 4, 5, 6 },
+				new[] { new SegmentPosition { start = 0, length = 4 }, new SegmentPosition { start = 4, length = 2 } }, 2, 1);
+			var error = Assert.Throws<InvalidOperationException>(() => table.GetInt32Column(0, 0, FieldEncoding.LittleEndian));
+			Assert.That(error.Message, Is.EqualTo("field is out of cell, row [1], column [0], offset [0], width [4], length [2]"));
+		}
+
+		[Test]
+		public void Concat_KeepsColumns()
+		{
+			var first = new BytesTable(new byte[] { 1, 2, 11, 12 },
+				new[] { new SegmentPosition { start = 0, length = 1 }, new SegmentPosition { start = 1, length = 1 },
+					new SegmentPosition { start = 2, length = 1 }, new SegmentPosition { start = 3, length = 1 } }, 2, 2);
+			var second = new BytesTable(new byte[] { 3, 13 },
+				new[] { new SegmentPosition { start = 0, length = 1 }, new SegmentPosition { start = 1, length = 1 } }, 1, 2);
+			var result = BytesTable.Concat(new[] { first, second }, 2, 3);
+			Assert.That(result.GetColumn(0).Select(x => x.CopyToByteArray()[0]).ToArray(), Is.EqualTo(new byte[] { 1, 2, 3 }));
+			Assert.That(result.GetColumn(1).Select(x => x.CopyToByteArray()[0]).ToArray(), Is.EqualTo(new byte[] { 11, 12, 13 }));
+		}
+
+		[Test]
+		public void Pool_ReturnsRecycledTables()
+		{
+			var pool = new BytesTablePool(1, 16);
+			var first = pool.Rent();
+			first.ReserveStore(16, 0);
+			var second = pool.Rent();
+			second.ReserveStore(8, 0);
+			pool.Return(first);
+			pool.Return(second);
+			Assert.That(pool.Count, Is.EqualTo(1));
+			Assert.That(pool.Rent(), Is.SameAs(first));
+			Assert.That(pool.Rent(), Is.Not.SameAs(second));
+		}
+
+		[Test]
+		public void Pool_DropsLargeTables()
+		{
+			var pool = new BytesTablePool(4, 16);
+			var table = pool.Rent();
+			table.ReserveStore(17, 0);
+			pool.Return(table);
+			Assert.That(pool.Count, Is.EqualTo(0));
+		}
+	}
+}
@@ -1,6 +1,7 @@
 ﻿using System;
 using System.Collections.Generic;
 using System.Linq;
+using System.Text;
 using NUnit.Framework;
 using SimpleBdb.Driver;
 using SimpleBdb.Extensions;
@@ -94,11 +95,11 @@ namespace SimpleBdb.Tests
 					db.Add(keys, values);
 					expectedStore.AddRange(keys);
 					expectedStore.AddRange(values);
-					expectedPositions[i * 2].start = storePosition;
-					expectedPositions[i * 2].length = 4;
+					expectedPositions[i].start = storePosition;
+					expectedPositions[i].length = 4;
 					storePosition += 4;
-					expectedPositions[i * 2 + 1].start = storePosition;
-					expectedPositions[i * 2 + 1].length = 4;
+					expectedPositions[50 + i].start = storePosition;
+					expectedPositions[50 + i].length = 4;
 					storePosition += 4;
 				}
 				var fetchResult = DoFetch(db, FetchOptions.KeysAndValues, 50);
@@ -135,11 +136,11 @@ namespace SimpleBdb.Tests
 				Assert.That(fetchResult.positions.Length, Is.EqualTo(4));
 				Assert.That(fetchResult.positions[0].start, Is.EqualTo(0));
 				Assert.That(fetchResult.positions[0].length, Is.EqualTo(1));
-				Assert.That(fetchResult.positions[1].start, Is.EqualTo(100));
-				Assert.That(fetchResult.positions[1].length, Is.EqualTo(1));
+				Assert.That(fetchResult.positions[1].start, Is.EqualTo(200));
+				Assert.That(fetchResult.positions[1].length, Is.EqualTo(3));
 
-				Assert.That(fetchResult.positions[2].start, Is.EqualTo(200));
-				Assert.That(fetchResult.positions[2].length, Is.EqualTo(3));
+				Assert.That(fetchResult.positions[2].start, Is.EqualTo(100));
+				Assert.That(fetchResult.positions[2].length, Is.EqualTo(1));
 				Assert.That(fetchResult.positions[3].start, Is.EqualTo(300));
 				Assert.That(fetchResult.positions[3].length, Is.EqualTo(4));
 			}
@@ -281,5 +282,64 @@ namespace SimpleBdb.Tests
 				Assert.That(fetchResult.positions[3].length, Is.EqualTo(7));
 			}
 		}
+
+		[Test]
+		public void FetchIntoTable_ReusesArrays()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 30; i++)
+					db.Add("key" + i.ToString("D2"), "value" + i);
+				var table = new BytesTable();
+				byte[] store = null;
+				SegmentPosition[] positions = null;
+				for (var page = 0; page < 3; page++)
+					using (var cursor = db.Query(Range.Line(), Direction.Ascending, page*10, 10))
+					{
+						Assert.That(cursor.Fetch(FetchOptions.KeysAndValues, table), Is.SameAs(table));
+						Assert.That(table.RowsCount, Is.EqualTo(10));
+						Assert.That(table.ColumnsCount, Is.EqualTo(2));
+						Assert.That(Encoding.ASCII.GetString(table.GetSegment(0, 0).ToByteArray()), Is.EqualTo("key" + (page*10).ToString("D2")));
+						Assert.That(Encoding.ASCII.GetString(table.GetSegment(9, 1).ToByteArray()), Is.EqualTo("value" + (page*10 + 9)));
+						if (page > 0)
+						{
+							Assert.That(table.store, Is.SameAs(store));
+							Assert.That(table.positions, Is.SameAs(positions));
+						}
+						store = table.store;
+						positions = table.positions;
+					}
+				using (var cursor = db.Query(Range.Line(), Direction.Ascending, 25, 10))
+				{
+					cursor.Fetch(FetchOptions.Keys, table);
+					Assert.That(table.RowsCount, Is.EqualTo(5));
+					Assert.That(table.ColumnsCount, Is.EqualTo(1));
+					Assert.That(table.store, Is.SameAs(store));
+					Assert.That(table.GetColumn(0, x => Encoding.ASCII.GetString(x.ToByteArray())), Is.EqualTo(new[] { "key25", "key26", "key27", "key28", "key29" }));
+				}
+			}
+		}
+
+		[Test]
+		public void MergingFetchIntoTable_GrowsOnlyWhenNeeded()
+		{
+			using (var env = new Environment(defaultEnvConfig, moqLogger.Object))
+			using (var db = env.AttachDatabase(defaultDbConfig))
+			{
+				for (var i = 0; i < 20; i++)
+					db.Add(new byte[] { 1, (byte) i }, new byte[] { (byte) i });
+				var table = new BytesTable();
+				db.Fetch(new[] { Range.Prefix(new byte[] { 1 }) }, Direction.Ascending, 5, 1, FetchOptions.Values, table);
+				var store = table.store;
+				Assert.That(table.GetColumn(0, x => x[0]), Is.EqualTo(new byte[] { 0, 1, 2, 3, 4 }));
+				db.Fetch(new[] { Range.Prefix(new byte[] { 1 }) }, Direction.Descending, 3, 1, FetchOptions.Values, table);
+				Assert.That(table.store, Is.SameAs(store));
+				Assert.That(table.GetColumn(0, x => x[0]), Is.EqualTo(new byte[] { 19, 18, 17 }));
+				db.Fetch(new[] { Range.Prefix(new byte[] { 1 }) }, Direction.Ascending, 20, 1, FetchOptions.Values, table);
+				Assert.That(table.store, Is.Not.SameAs(store));
+				Assert.That(table.RowsCount, Is.EqualTo(20));
+			}
+		}
 	}
 }
\ No newline at end of file
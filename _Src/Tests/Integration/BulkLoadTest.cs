@@ -0,0 +1,57 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests.Integration
+{
+	[TestFixture]
+	[Category("Manual")]
+	public class BulkLoadTest : TestBase
+	{
+		private const int recordsCount = 2000000;
+		private const int valueSize = 50;
+		private const long mb = 1024*1024;
+
+		//[Test]
+		public void BulkLoadVersusAddLoop()
+		{
+			FileTestHelpers.RecreateDirectory("testDirectory");
+			var config = new EnvironmentConfig
+			{
+				FileName = defaultEnvConfig.FileName,
+				CacheSizeInBytes = 256*mb
+			};
+			var random = new Random(0);
+			var ids = Enumerable.Range(0, recordsCount).OrderBy(x => random.Next()).ToArray();
+			var value = new byte[valueSize];
+			using (var environment = new Driver.Environment(config, moqLogger.Object))
+			{
+				var stopwatch = Stopwatch.StartNew();
+				using (var database = environment.AttachDatabase(new DatabaseConfig {Name = "added"}))
+				{
+					foreach (var id in ids)
+						database.Add(new BytesSegment(Key(id)), new BytesSegment(value));
+					Console.Out.WriteLine("add loop - {0:F0} records/s, {1} pages",
+						recordsCount/stopwatch.Elapsed.TotalSeconds, database.GetStatistics(false).bt_pagecnt);
+				}
+				var records = ids.Select(id => new KeyValuePair<byte[], byte[]>(Key(id), value));
+				var statistics = environment.BulkLoad(new DatabaseConfig {Name = "loaded"}, records,
+					new BulkLoadConfig {SortMemoryInBytes = 32*mb});
+				Console.Out.WriteLine("bulk load - {0:F0} records/s, {1} pages, {2} runs",
+					statistics.RecordsPerSecond, statistics.PagesCount, statistics.RunsCount);
+			}
+		}
+
+		private static byte[] Key(int id)
+		{
+			var result = BitConverter.GetBytes(id);
+			Array.Reverse(result);
+			return result;
+		}
+	}
+}
@@ -0,0 +1,112 @@
+using System;
+using System.Diagnostics;
+using System.Linq;
+using System.Threading;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests.Integration
+{
+	[TestFixture]
+	[Category("Manual")]
+	public class CacheScalingLoadTest : TestBase
+	{
+		private const int itemsCount = 1000000;
+		private const int keySize = 32;
+		private const int valueSize = 100;
+		private const int secondsPerCase = 10;
+		private const long mb = 1024 * 1024;
+		private static readonly int[] threadCounts = {1, 2, 4, 8, 16, 32};
+
+		//[Test]
+		public void ThroughputByThreadCount()
+		{
+			Fill();
+			ScalingCase("default", c => { });
+			ScalingCase("8 regions, 64k buckets, 1k mutexes, 1k spins", delegate(EnvironmentConfig c)
+			{
+				c.CacheRegionsCount = 8;
+				c.CacheHashBucketsCount = 64*1024;
+				c.CacheHashMutexesCount = 1024;
+				c.MutexSpinsCount = 1000;
+			});
+		}
+
+		private void ScalingCase(string caption, Action<EnvironmentConfig> configure)
+		{
+			var config = CreateEnvironmentConfig();
+			configure(config);
+			using (var environment = new Driver.Environment(config, moqLogger.Object))
+			using (var database = environment.AttachDatabase(defaultDbConfig))
+			{
+				//warm up, so every case measures cache hits only
+				for (var i = 0; i < itemsCount; i++)
+					database.Find(new BytesSegment(Key(i)));
+				foreach (var threadCount in threadCounts)
+				{
+					var before = environment.GetCacheStatistics();
+					var finds = new long[threadCount];
+					var stop = false;
+					var threads = Enumerable.Range(0, threadCount)
+						.Select(t => new Thread(delegate()
+						{
+							var random = new Random(t);
+							while (!Volatile.Read(ref stop))
+							{
+								database.Find(new BytesSegment(Key(random.Next(itemsCount))));
+								finds[t]++;
+							}
+						}))
+						.ToArray();
+					var stopwatch = Stopwatch.StartNew();
+					foreach (var thread in threads)
+						thread.Start();
+					Thread.Sleep(secondsPerCase*1000);
+					Volatile.Write(ref stop, true);
+					foreach (var thread in threads)
+						thread.Join();
+					stopwatch.Stop();
+					var after = environment.GetCacheStatistics();
+					Console.Out.WriteLine("{0}, {1} threads - {2:F0} finds/sec, hash waits [{3}], region waits [{4}]",
+						caption, threadCount, finds.Sum()/stopwatch.Elapsed.TotalSeconds,
+						after.st_hash_wait - before.st_hash_wait, after.st_region_wait - before.st_region_wait);
+				}
+			}
+		}
+
+		private void Fill()
+		{
+			using (var environment = new Driver.Environment(CreateEnvironmentConfig(), moqLogger.Object))
+			using (var database = environment.AttachDatabase(defaultDbConfig))
+			{
+				var random = new Random();
+				var value = new byte[valueSize];
+				for (var i = 0; i < itemsCount; i++)
+				{
+					random.NextBytes(value);
+					database.Add(Key(i), value);
+				}
+			}
+		}
+
+		private EnvironmentConfig CreateEnvironmentConfig()
+		{
+			return new EnvironmentConfig
+			{
+				FileName = defaultEnvConfig.FileName,
+				CacheSizeInBytes = 512*mb,
+				IsPersistent = true
+			};
+		}
+
+		private static byte[] Key(int index)
+		{
+			var result = new byte[keySize];
+			BitConverter.GetBytes(unchecked((uint) index*2654435761u)).CopyTo(result, 0);
+			BitConverter.GetBytes(index).CopyTo(result, 4);
+			return result;
+		}
+	}
+}
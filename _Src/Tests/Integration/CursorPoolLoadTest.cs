@@ -0,0 +1,78 @@
+﻿using System;
+using System.Diagnostics;
+using System.Linq;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests.Integration
+{
+	[TestFixture]
+	[Category("Manual")]
+	public class CursorPoolLoadTest : TestBase
+	{
+		private const int prefixCount = 10000;
+		private const int itemsPerPrefix = 20;
+		private const int valueSize = 20;
+		private const int fetchesCount = 10000;
+		private const int takeCount = 10;
+		private const long mb = 1024*1024;
+		private static readonly int[] rangeCounts = {1, 30, 100};
+
+		//[Test]
+		public void ShortFetchLatencyByRangesCount()
+		{
+			FileTestHelpers.RecreateDirectory("testDirectory");
+			var config = new EnvironmentConfig
+			{
+				FileName = defaultEnvConfig.FileName,
+				CacheSizeInBytes = 512*mb
+			};
+			using (var environment = new Driver.Environment(config, moqLogger.Object))
+			{
+				using (var database = environment.AttachDatabase(defaultDbConfig))
+				{
+					var value = new byte[valueSize];
+					for (var prefix = 0; prefix < prefixCount; prefix++)
+						for (var item = 0; item < itemsPerPrefix; item++)
+							database.Add(new BytesSegment(Key(prefix, item)), new BytesSegment(value));
+				}
+				foreach (var rangesCount in rangeCounts)
+				{
+					FetchCase(environment, rangesCount, -1);
+					FetchCase(environment, rangesCount, 0);
+				}
+			}
+		}
+
+		private void FetchCase(Driver.Environment environment, int rangesCount, int maxIdleCursors)
+		{
+			var dbConfig = new DatabaseConfig {Name = defaultDbConfig.Name, MaxIdleCursors = maxIdleCursors};
+			using (var database = environment.AttachDatabase(dbConfig))
+			{
+				var random = new Random(0);
+				var latencies = new double[fetchesCount];
+				for (var i = 0; i < fetchesCount; i++)
+				{
+					var ranges = Enumerable.Range(0, rangesCount)
+						.Select(r => random.Next(prefixCount))
+						.Select(p => Range.Segment(BitConverter.GetBytes(p), BitConverter.GetBytes(p)))
+						.ToArray();
+					var stopwatch = Stopwatch.StartNew();
+					database.Fetch(ranges, Direction.Ascending, takeCount, 4, FetchOptions.Values);
+					latencies[i] = stopwatch.Elapsed.TotalMilliseconds;
+				}
+				Array.Sort(latencies);
+				Console.Out.WriteLine("ranges {0}, cursor reuse {1} - fetch of {2} median {3:F3} millis, p99 {4:F3} millis",
+					rangesCount, maxIdleCursors < 0 ? "off" : "on", takeCount,
+					latencies[fetchesCount/2], latencies[fetchesCount*99/100]);
+			}
+		}
+
+		private static byte[] Key(int prefix, int item)
+		{
+			return BitConverter.GetBytes(prefix).Concat(BitConverter.GetBytes(item)).ToArray();
+		}
+	}
+}
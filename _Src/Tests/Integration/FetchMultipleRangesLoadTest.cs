@@ -94,20 +94,71 @@ namespace SimpleBdb.Tests.Integration
 			Console.Out.WriteLine("{0} - average {1} millis", caption, times.Average());
 		}
 
+		//[Test]
+		public void BtreeSettings()
+		{
+			GenerateTrash();
+			PrepareTestRanges();
+			BtreeSettingsCase("default", _ => { });
+			BtreeSettingsCase("page 16k", c => c.PageSize = 16 * 1024);
+			BtreeSettingsCase("page 64k, minkey 8", delegate(DatabaseConfig c)
+			{
+				c.PageSize = 64 * 1024;
+				c.BtreeMinKey = 8;
+			});
+			BtreeSettingsCase("bdb compression", c => c.Compression = BtreeCompression.Bdb);
+			BtreeSettingsCase("prefix delta compression", c => c.Compression = BtreeCompression.PrefixDelta);
+			BtreeSettingsCase("page 16k, prefix delta compression", delegate(DatabaseConfig c)
+			{
+				c.PageSize = 16 * 1024;
+				c.Compression = BtreeCompression.PrefixDelta;
+			});
+		}
+
+		private void BtreeSettingsCase(string caption, Action<DatabaseConfig> configure)
+		{
+			database.Dispose();
+			environment.Dispose();
+			FileTestHelpers.RecreateDirectory("testDirectory");
+			var config = CreateDatabaseConfig();
+			config.EnableRecno = false;
+			configure(config);
+			OpenDatabase(config);
+			SaveTrashToBdb(trash);
+			var statistics = database.GetStatistics(false);
+			Console.Out.WriteLine("{0} - leaf pages [{1}], internal pages [{2}], levels [{3}], page size [{4}]",
+				caption, statistics.bt_leaf_pg, statistics.bt_int_pg, statistics.bt_levels, statistics.bt_pagesize);
+			var cacheBefore = environment.GetCacheStatistics();
+			ExecuteTest(caption, DoQueryFast);
+			var cacheAfter = environment.GetCacheStatistics();
+			Console.Out.WriteLine("{0} - cache hits [{1}], cache misses [{2}]", caption,
+				cacheAfter.st_cache_hit - cacheBefore.st_cache_hit, cacheAfter.st_cache_miss - cacheBefore.st_cache_miss);
+		}
+
 		public override void SetUp()
 		{
 			base.SetUp();
 			defaultEnvConfig.CacheSizeInBytes = 64 * mb;
 			defaultEnvConfig.IsPersistent = true;
-			environment = new Driver.Environment(defaultEnvConfig, moqLogger.Object);
-			database = environment.AttachDatabase(new DatabaseConfig
+			OpenDatabase(CreateDatabaseConfig());
+		}
+
+		private static DatabaseConfig CreateDatabaseConfig()
+		{
+			return new DatabaseConfig
 			{
 				Name = "loadTest",
 				EnableRecno = true,
 				CachePriority = CachePriority.VeryHigh,
 				KeyBufferConfig = BytesBufferConfig.FixedTo(keySize),
 				ValueBufferConfig = BytesBufferConfig.FixedTo(valueSize)
-			});
+			};
+		}
+
+		private void OpenDatabase(DatabaseConfig config)
+		{
+			environment = new Driver.Environment(defaultEnvConfig, moqLogger.Object);
+			database = environment.AttachDatabase(config);
 		}
 
 		public override void TearDown()
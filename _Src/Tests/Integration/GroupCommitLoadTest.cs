@@ -0,0 +1,83 @@
+using System;
+using System.Diagnostics;
+using System.Linq;
+using System.Threading;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+
+namespace SimpleBdb.Tests.Integration
+{
+	[TestFixture]
+	[Category("Manual")]
+	public class GroupCommitLoadTest : TestBase
+	{
+		private const int keySize = 32;
+		private const int valueSize = 100;
+		private const int threadsCount = 8;
+		private const int secondsPerCase = 10;
+		private const long mb = 1024 * 1024;
+		private static readonly int[] intervals = {1, 5, 10, 50, 100};
+
+		//[Test]
+		public void ThroughputAndDurabilityLatency()
+		{
+			foreach (var interval in intervals)
+				IntervalCase(interval);
+		}
+
+		private void IntervalCase(int interval)
+		{
+			FileTestHelpers.RecreateDirectory("testDirectory");
+			var config = new EnvironmentConfig
+			{
+				FileName = defaultEnvConfig.FileName,
+				CacheSizeInBytes = 256*mb,
+				IsPersistent = true,
+				EnableGroupCommit = true,
+				GroupCommitIntervalInMilliseconds = interval
+			};
+			using (var environment = new Driver.Environment(config, moqLogger.Object))
+			using (var database = environment.AttachDatabase(defaultDbConfig))
+			{
+				var writes = new long[threadsCount];
+				var waits = new double[threadsCount];
+				var maxWaits = new double[threadsCount];
+				var stop = false;
+				var threads = Enumerable.Range(0, threadsCount)
+					.Select(t => new Thread(delegate()
+					{
+						var random = new Random(t);
+						var key = new byte[keySize];
+						var value = new byte[valueSize];
+						while (!Volatile.Read(ref stop))
+						{
+							random.NextBytes(key);
+							random.NextBytes(value);
+							database.Add(key, value);
+							writes[t]++;
+							//every 100th write waits for durability, the rest are fire-and-forget
+							if (writes[t]%100 != 0)
+								continue;
+							var stopwatch = Stopwatch.StartNew();
+							environment.GetCommitTicket().Wait();
+							var wait = stopwatch.Elapsed.TotalMilliseconds;
+							waits[t] += wait;
+							maxWaits[t] = Math.Max(maxWaits[t], wait);
+						}
+					}))
+					.ToArray();
+				var total = Stopwatch.StartNew();
+				foreach (var thread in threads)
+					thread.Start();
+				Thread.Sleep(secondsPerCase*1000);
+				Volatile.Write(ref stop, true);
+				foreach (var thread in threads)
+					thread.Join();
+				total.Stop();
+				Console.Out.WriteLine("interval {0} millis - {1:F0} writes/sec, durability latency avg {2:F1} millis, max {3:F1} millis",
+					interval, writes.Sum()/total.Elapsed.TotalSeconds, waits.Sum()/(writes.Sum()/100), maxWaits.Max());
+			}
+		}
+	}
+}
@@ -0,0 +1,90 @@
+using System;
+using System.Diagnostics;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests.Integration
+{
+	[TestFixture]
+	[Category("Manual")]
+	public class MemoryMappedLoadTest : TestBase
+	{
+		private const int itemsCount = 2000000;
+		private const int keySize = 32;
+		private const int valueSize = 100;
+		private const int scansCount = 5;
+		private const long mb = 1024 * 1024;
+
+		//[Test]
+		public void RssAndScanLatency()
+		{
+			Fill();
+			ScanCase("cache", 512*mb, false);
+			ScanCase("memory mapped", 16*mb, true);
+		}
+
+		private void ScanCase(string caption, long cacheSize, bool memoryMapped)
+		{
+			var process = Process.GetCurrentProcess();
+			GC.Collect();
+			process.Refresh();
+			var privateBefore = process.PrivateMemorySize64;
+			var workingSetBefore = process.WorkingSet64;
+			var environmentConfig = CreateEnvironmentConfig(cacheSize);
+			environmentConfig.MemoryMapSizeInBytes = memoryMapped ? 4096*mb : 0;
+			var databaseConfig = new DatabaseConfig
+			{
+				Name = defaultDbConfig.Name,
+				IsReadonly = true,
+				IsMemoryMapped = memoryMapped
+			};
+			using (var environment = new Driver.Environment(environmentConfig, moqLogger.Object))
+			using (var database = environment.AttachDatabase(databaseConfig))
+				for (var i = 0; i < scansCount; i++)
+				{
+					var stopwatch = Stopwatch.StartNew();
+					var count = 0;
+					var reader = database.Query(Range.Line(), Direction.Ascending, 0, int.MaxValue);
+					BytesRecord record;
+					while (reader.Read(out record))
+						count++;
+					stopwatch.Stop();
+					Assert.That(count, Is.EqualTo(itemsCount));
+					process.Refresh();
+					Console.Out.WriteLine("{0}, scan {1} - {2} millis, private bytes +{3} mb, working set +{4} mb, mapped pages [{5}]",
+						caption, i, stopwatch.ElapsedMilliseconds, (process.PrivateMemorySize64 - privateBefore)/mb,
+						(process.WorkingSet64 - workingSetBefore)/mb, environment.GetCacheStatistics().st_map);
+				}
+		}
+
+		private void Fill()
+		{
+			using (var environment = new Driver.Environment(CreateEnvironmentConfig(512*mb), moqLogger.Object))
+			using (var database = environment.AttachDatabase(defaultDbConfig))
+			{
+				var random = new Random();
+				var key = new byte[keySize];
+				var value = new byte[valueSize];
+				for (var i = 0; i < itemsCount; i++)
+				{
+					random.NextBytes(key);
+					BitConverter.GetBytes(i).CopyTo(key, 0);
+					random.NextBytes(value);
+					database.Add(key, value);
+				}
+			}
+		}
+
+		private EnvironmentConfig CreateEnvironmentConfig(long cacheSize)
+		{
+			return new EnvironmentConfig
+			{
+				FileName = defaultEnvConfig.FileName,
+				CacheSizeInBytes = cacheSize,
+				IsPersistent = true
+			};
+		}
+	}
+}
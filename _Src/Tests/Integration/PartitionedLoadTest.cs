@@ -0,0 +1,77 @@
+using System;
+using System.Diagnostics;
+using System.Linq;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests.Integration
+{
+	[TestFixture]
+	[Category("Manual")]
+	public class PartitionedLoadTest : TestBase
+	{
+		private const int keySize = 16;
+		private const int valueSize = 100;
+		private const int recordsCount = 2000000;
+		private const int scansCount = 1000;
+		private const int recordsPerScan = 1000;
+		private const long mb = 1024*1024;
+		private static readonly int[] partitionCounts = {1, 2, 4, 8, 16};
+
+		//[Test]
+		public void WriteThroughputAndScanLatency()
+		{
+			foreach (var partitionsCount in partitionCounts)
+				PartitionsCase(partitionsCount);
+		}
+
+		private void PartitionsCase(int partitionsCount)
+		{
+			FileTestHelpers.RecreateDirectory("testDirectory");
+			var config = new EnvironmentConfig
+			{
+				FileName = defaultEnvConfig.FileName,
+				CacheSizeInBytes = 512*mb
+			};
+			//keys are uniformly random, so equal first byte spans give equal partitions
+			var boundaries = Enumerable.Range(1, partitionsCount - 1)
+				.Select(i => new[] {(byte) (i*256/partitionsCount)})
+				.ToArray();
+			using (var environment = new Driver.Environment(config, moqLogger.Object))
+			using (var database = environment.AttachPartitionedDatabase(defaultDbConfig, boundaries))
+			{
+				var random = new Random(0);
+				var key = new byte[keySize];
+				var value = new byte[valueSize];
+				var writes = Stopwatch.StartNew();
+				for (var i = 0; i < recordsCount; i++)
+				{
+					random.NextBytes(key);
+					random.NextBytes(value);
+					database.Add(new BytesSegment(key), new BytesSegment(value));
+				}
+				writes.Stop();
+				var latencies = new double[scansCount];
+				for (var i = 0; i < scansCount; i++)
+				{
+					random.NextBytes(key);
+					var stopwatch = Stopwatch.StartNew();
+					using (var cursor = database.Query(Range.Segment((byte[]) key.Clone(), new byte[] {255}), Direction.Ascending, 0, recordsPerScan))
+					{
+						BytesRecord record;
+						while (cursor.Read(out record))
+						{
+						}
+					}
+					latencies[i] = stopwatch.Elapsed.TotalMilliseconds;
+				}
+				Array.Sort(latencies);
+				Console.Out.WriteLine("partitions {0} - {1:F0} writes/sec, scan of {2} records median {3:F2} millis, p99 {4:F2} millis",
+					partitionsCount, recordsCount/writes.Elapsed.TotalSeconds, recordsPerScan,
+					latencies[scansCount/2], latencies[scansCount*99/100]);
+			}
+		}
+	}
+}
@@ -0,0 +1,94 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using NUnit.Framework;
+using SimpleBdb.Driver;
+using SimpleBdb.Tests.Helpers;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests.Integration
+{
+	[TestFixture]
+	[Category("Manual")]
+	public class WarmRestartLoadTest : TestBase
+	{
+		private const int itemsCount = 2000000;
+		private const int hotItemsCount = 100000;
+		private const int keySize = 32;
+		private const int valueSize = 100;
+		private const int findsPerWindow = 20000;
+		private const int windowsCount = 30;
+		private const long mb = 1024 * 1024;
+
+		private readonly Random random = new Random();
+
+		//[Test]
+		public void TimeToSteadyState()
+		{
+			Fill();
+			RestartCase("private", c => { });
+			RestartCase("private, warm list", c => c.WarmListFileName = "testDirectory\\warmList");
+			RestartCase("shared", c => c.IsShared = true);
+		}
+
+		private void RestartCase(string caption, Action<EnvironmentConfig> configure)
+		{
+			var config = CreateEnvironmentConfig();
+			configure(config);
+			//first run warms the cache and saves the warm list, second one is the restart to measure
+			for (var run = 0; run < 2; run++)
+				using (var environment = new Driver.Environment(config, moqLogger.Object))
+				using (var database = environment.AttachDatabase(defaultDbConfig))
+				{
+					var windows = new List<double>();
+					for (var window = 0; window < windowsCount; window++)
+					{
+						var stopwatch = Stopwatch.StartNew();
+						for (var i = 0; i < findsPerWindow; i++)
+							Assert.That(database.Find(new BytesSegment(Key(random.Next(hotItemsCount)))), Is.Not.Null);
+						stopwatch.Stop();
+						windows.Add(stopwatch.Elapsed.TotalMilliseconds*1000/findsPerWindow);
+					}
+					if (run == 0)
+						continue;
+					var steady = windows.Skip(windowsCount/2).Average();
+					var steadyWindow = windows.FindIndex(x => x <= steady*1.1);
+					Console.Out.WriteLine("{0} - first window {1:F1} micros/find, steady {2:F1} micros/find, reached after {3} finds",
+						caption, windows[0], steady, (steadyWindow + 1)*findsPerWindow);
+				}
+		}
+
+		private void Fill()
+		{
+			using (var environment = new Driver.Environment(CreateEnvironmentConfig(), moqLogger.Object))
+			using (var database = environment.AttachDatabase(defaultDbConfig))
+			{
+				var value = new byte[valueSize];
+				for (var i = 0; i < itemsCount; i++)
+				{
+					random.NextBytes(value);
+					database.Add(Key(i), value);
+				}
+			}
+		}
+
+		private EnvironmentConfig CreateEnvironmentConfig()
+		{
+			return new EnvironmentConfig
+			{
+				FileName = defaultEnvConfig.FileName,
+				CacheSizeInBytes = 256*mb,
+				IsPersistent = true
+			};
+		}
+
+		private static byte[] Key(int index)
+		{
+			var result = new byte[keySize];
+			BitConverter.GetBytes(unchecked((uint) index*2654435761u)).CopyTo(result, 0);
+			BitConverter.GetBytes(index).CopyTo(result, 4);
+			return result;
+		}
+	}
+}
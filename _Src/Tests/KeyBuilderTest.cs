@@ -0,0 +1,71 @@
+using System.Linq;
+using NUnit.Framework;
+using SimpleBdb.Utils;
+
+namespace SimpleBdb.Tests
+{
+	[TestFixture]
+	public class KeyBuilderTest
+	{
+		[Test]
+		public void IntegersPreserveOrder()
+		{
+			var builder = new KeyBuilder(new KeySchema(KeySchema.Ascending(KeyFieldType.Int32)));
+			var values = new[] { int.MinValue, -100, -1, 0, 1, 255, 256, int.MaxValue };
+			var keys = values.Select(x => builder.Reset().Append(x).ToByteArray()).ToArray();
+			for (var i = 1; i < keys.Length; i++)
+				Assert.That(ByteHelpers.Compare(keys[i - 1], keys[i]), Is.LessThan(0));
+			Assert.That(keys[3], Is.EqualTo(new byte[] { 0x80, 0, 0, 0 }));
+		}
+
+		[Test]
+		public void DescendingFieldReversesOrder()
+		{
+			var builder = new KeyBuilder(new KeySchema(KeySchema.Descending(KeyFieldType.Int64)));
+			var a = builder.Reset().Append(-5L).ToByteArray();
+			var b = builder.Reset().Append(7L).ToByteArray();
+			Assert.That(ByteHelpers.Compare(a, b), Is.GreaterThan(0));
+		}
+
+		[Test]
+		public void StringsAreEscapedAndTerminated()
+		{
+			var builder = new KeyBuilder(new KeySchema(KeySchema.Ascending(KeyFieldType.String), KeySchema.Ascending(KeyFieldType.UInt32)));
+			Assert.That(builder.Reset().Append("a\0b").Append(1u).ToByteArray(),
+				Is.EqualTo(new byte[] { (byte) 'a', 0, 0xFF, (byte) 'b', 0, 1, 0, 0, 0, 1 }));
+		}
+
+		[TestCase("a", "ab")]
+		[TestCase("a", "a\0")]
+		[TestCase("a\0", "a\u0001")]
+		[TestCase("", "a")]
+		public void StringsPreserveOrder(string smaller, string bigger)
+		{
+			var ascending = new KeyBuilder(new KeySchema(KeySchema.Ascending(KeyFieldType.String), KeySchema.Ascending(KeyFieldType.Int32)));
+			Assert.That(ByteHelpers.Compare(ascending.Reset().Append(smaller).Append(int.MaxValue).ToByteArray(),
+				ascending.Reset().Append(bigger).Append(int.MinValue).ToByteArray()), Is.LessThan(0));
+			var descending = new KeyBuilder(new KeySchema(KeySchema.Descending(KeyFieldType.String), KeySchema.Ascending(KeyFieldType.Int32)));
+			Assert.That(ByteHelpers.Compare(descending.Reset().Append(smaller).Append(int.MinValue).ToByteArray(),
+				descending.Reset().Append(bigger).Append(int.MaxValue).ToByteArray()), Is.GreaterThan(0));
+		}
+
+		[Test]
+		public void PrefixRangeContainsAllKeysWithPrefix()
+		{
+			var builder = new KeyBuilder(new KeySchema(KeySchema.Ascending(KeyFieldType.UInt32), KeySchema.Ascending(KeyFieldType.UInt32)));
+			var range = builder.Reset().Append(0x01FFFFFFu).ToPrefixRange();
+			Assert.That(range.Left.Value, Is.EqualTo(new byte[] { 1, 0xFF, 0xFF, 0xFF }));
+			Assert.That(range.Left.Inclusive);
+			Assert.That(range.Right.Value, Is.EqualTo(new byte[] { 2, 0, 0, 0 }));
+			Assert.That(range.Right.Inclusive, Is.False);
+		}
+
+		[Test]
+		public void FieldTypeIsChecked()
+		{
+			var builder = new KeyBuilder(new KeySchema(KeySchema.Ascending(KeyFieldType.Int32)));
+			var error = Assert.Throws<System.InvalidOperationException>(() => builder.Append("x"));
+			Assert.That(error.Message, Is.EqualTo("key field [0] has type [Int32], but [String] was written"));
+		}
+	}
+}
@@ -4,13 +4,20 @@ using JetBrains.Annotations;
 
 namespace SimpleBdb.Utils
 {
+	//positions are stored by column, column i occupies [i*RowsCount, (i+1)*RowsCount).
+	//table may be reused by fetches into caller table, its arrays are grown only when too small then
 	public class BytesTable
 	{
-		internal readonly byte[] store;
-		internal readonly SegmentPosition[] positions;
+		internal byte[] store;
+		internal SegmentPosition[] positions;
 		public uint RowsCount { get; private set; }
 		public uint ColumnsCount { get; private set; }
 
+		public BytesTable()
+			: this(null, new SegmentPosition[0], 0, 0)
+		{
+		}
+
 		public BytesTable(byte[] store, SegmentPosition[] positions, uint rowsCount, uint columnsCount)
 		{
 			this.store = store;
@@ -19,6 +26,89 @@ namespace SimpleBdb.Utils
 			ColumnsCount = columnsCount;
 		}
 
+		public int StoreCapacity
+		{
+			get { return store == null ? 0 : store.Length; }
+		}
+
+		//for fetches into this table, keeps first preservedLength bytes when store is grown
+		[NotNull]
+		public byte[] ReserveStore(int length, int preservedLength)
+		{
+			if (StoreCapacity >= length)
+				return store;
+			var newStore = new byte[length];
+			if (store != null && preservedLength > 0)
+				Buffer.BlockCopy(store, 0, newStore, 0, preservedLength);
+			store = newStore;
+			return store;
+		}
+
+		//for fetches into this table, content is not preserved
+		[NotNull]
+		public SegmentPosition[] ReservePositions(int length)
+		{
+			if (positions == null || positions.Length < length)
+				positions = new SegmentPosition[length];
+			return positions;
+		}
+
+		public void SetShape(uint rowsCount, uint columnsCount)
+		{
+			if ((ulong) rowsCount*columnsCount > (ulong) (positions == null ? 0 : positions.Length))
+			{
+				const string messageFormat = "invalid shape, rowsCount [{0}], columnsCount [{1}], positions length [{2}]";
+				throw new InvalidOperationException(string.Format(messageFormat, rowsCount, columnsCount, positions == null ? 0 : positions.Length));
+			}
+			RowsCount = rowsCount;
+			ColumnsCount = columnsCount;
+		}
+
+		//rows of tables one after another, up to maxRowsCount
+		[NotNull]
+		public static BytesTable Concat([NotNull] IList<BytesTable> tables, uint columnsCount, uint maxRowsCount)
+		{
+			return Concat(tables, columnsCount, maxRowsCount, new BytesTable());
+		}
+
+		[NotNull]
+		public static BytesTable Concat([NotNull] IList<BytesTable> tables, uint columnsCount, uint maxRowsCount, [NotNull] BytesTable target)
+		{
+			uint rowsCount = 0;
+			var storeLength = 0;
+			foreach (var table in tables)
+			{
+				if (rowsCount == maxRowsCount)
+					break;
+				rowsCount += Math.Min(table.RowsCount, maxRowsCount - rowsCount);
+				storeLength += table.store == null ? 0 : table.store.Length;
+			}
+			var store = target.ReserveStore(storeLength, 0);
+			var positions = target.ReservePositions((int) (rowsCount*columnsCount));
+			uint storeOffset = 0;
+			uint rowIndex = 0;
+			foreach (var table in tables)
+			{
+				if (rowIndex == rowsCount)
+					break;
+				var count = Math.Min(table.RowsCount, rowsCount - rowIndex);
+				for (uint c = 0; c < columnsCount; c++)
+					for (uint i = 0; i < count; i++)
+					{
+						var source = table.positions[c*table.RowsCount + i];
+						positions[c*rowsCount + rowIndex + i].start = source.start + storeOffset;
+						positions[c*rowsCount + rowIndex + i].length = source.length;
+					}
+				rowIndex += count;
+				if (table.store == null)
+					continue;
+				Buffer.BlockCopy(table.store, 0, store, (int) storeOffset, table.store.Length);
+				storeOffset += (uint) table.store.Length;
+			}
+			target.SetShape(rowsCount, columnsCount);
+			return target;
+		}
+
 		public BytesSegment GetSegment(uint row, uint column)
 		{
 			if (row >= RowsCount || column >= ColumnsCount)
@@ -26,10 +116,90 @@ namespace SimpleBdb.Utils
 				const string messageFormat = "invalid arguments, row [{0}], column [{1}], RowsCount [{2}], ColumnsCount [{3}]";
 				throw new InvalidOperationException(string.Format(messageFormat, row, column, RowsCount, ColumnsCount));
 			}
-			var position = positions[row*ColumnsCount + column];
+			var position = positions[column*RowsCount + row];
 			return new BytesSegment(store, (int) position.start, (int) position.length);
 		}
 
+		//decodes fixed width field at offset of every cell in one pass, without BytesSegment per cell
+		[NotNull]
+		public unsafe long[] GetInt64Column(uint column, uint offset, FieldEncoding encoding)
+		{
+			CheckField(column, offset, sizeof (long));
+			var result = new long[RowsCount];
+			if (RowsCount == 0)
+				return result;
+			fixed (byte* storePtr = store)
+			fixed (SegmentPosition* positionsPtr = &positions[column*RowsCount])
+				for (uint i = 0; i < RowsCount; i++)
+					result[i] = (long) ReadField(storePtr + positionsPtr[i].start + offset, sizeof (long), encoding);
+			return result;
+		}
+
+		[NotNull]
+		public unsafe int[] GetInt32Column(uint column, uint offset, FieldEncoding encoding)
+		{
+			CheckField(column, offset, sizeof (int));
+			var result = new int[RowsCount];
+			if (RowsCount == 0)
+				return result;
+			fixed (byte* storePtr = store)
+			fixed (SegmentPosition* positionsPtr = &positions[column*RowsCount])
+				for (uint i = 0; i < RowsCount; i++)
+					result[i] = (int) ReadField(storePtr + positionsPtr[i].start + offset, sizeof (int), encoding);
+			return result;
+		}
+
+		[NotNull]
+		public unsafe double[] GetDoubleColumn(uint column, uint offset, FieldEncoding encoding)
+		{
+			if (encoding == FieldEncoding.KeyOrdered)
+				throw new InvalidOperationException("key ordered encoding is not supported for double fields");
+			CheckField(column, offset, sizeof (double));
+			var result = new double[RowsCount];
+			if (RowsCount == 0)
+				return result;
+			fixed (byte* storePtr = store)
+			fixed (SegmentPosition* positionsPtr = &positions[column*RowsCount])
+				for (uint i = 0; i < RowsCount; i++)
+					result[i] = BitConverter.Int64BitsToDouble((long) ReadField(storePtr + positionsPtr[i].start + offset, sizeof (double), encoding));
+			return result;
+		}
+
+		private void CheckField(uint column, uint offset, uint width)
+		{
+			if (column >= ColumnsCount)
+			{
+				const string messageFormat = "invalid arguments, column [{0}], ColumnsCount [{1}]";
+				throw new InvalidOperationException(string.Format(messageFormat, column, ColumnsCount));
+			}
+			for (uint i = 0; i < RowsCount; i++)
+			{
+				var length = positions[column*RowsCount + i].length;
+				if (offset + width > length)
+				{
+					const string messageFormat = "field is out of cell, row [{0}], column [{1}], offset [{2}], width [{3}], length [{4}]";
+					throw new InvalidOperationException(string.Format(messageFormat, i, column, offset, width, length));
+				}
+			}
+		}
+
+		//width is 4 or 8, key ordered fields are big-endian with flipped sign bit as KeyBuilder writes them
+		private static unsafe ulong ReadField(byte* p, int width, FieldEncoding encoding)
+		{
+			if (encoding == FieldEncoding.LittleEndian && BitConverter.IsLittleEndian)
+				return width == sizeof (ulong) ? *(ulong*) p : *(uint*) p;
+			ulong result = 0;
+			if (encoding == FieldEncoding.LittleEndian)
+				for (var i = width - 1; i >= 0; i--)
+					result = (result << 8) | p[i];
+			else
+				for (var i = 0; i < width; i++)
+					result = (result << 8) | p[i];
+			if (encoding == FieldEncoding.KeyOrdered)
+				result ^= 1ul << (width*8 - 1);
+			return result;
+		}
+
 		[NotNull]
 		public List<BytesSegment> GetColumn(uint column)
 		{
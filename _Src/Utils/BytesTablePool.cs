@@ -0,0 +1,51 @@
+﻿using System;
+using System.Collections.Generic;
+using JetBrains.Annotations;
+
+namespace SimpleBdb.Utils
+{
+	//keeps up to maxCount returned tables for fetches into caller table, so paging loops don't allocate
+	//store and positions per page. tables with store longer than maxStoreLength are dropped on Return
+	public class BytesTablePool
+	{
+		private readonly Stack<BytesTable> tables = new Stack<BytesTable>();
+		private readonly int maxCount;
+		private readonly int maxStoreLength;
+
+		public BytesTablePool(int maxCount, int maxStoreLength)
+		{
+			if (maxCount <= 0)
+				throw new InvalidOperationException(string.Format("invalid maxCount [{0}]", maxCount));
+			this.maxCount = maxCount;
+			this.maxStoreLength = maxStoreLength;
+		}
+
+		public int Count
+		{
+			get
+			{
+				lock (tables)
+					return tables.Count;
+			}
+		}
+
+		[NotNull]
+		public BytesTable Rent()
+		{
+			lock (tables)
+				if (tables.Count > 0)
+					return tables.Pop();
+			return new BytesTable();
+		}
+
+		//table must not be used after Return
+		public void Return([NotNull] BytesTable table)
+		{
+			if (table.StoreCapacity > maxStoreLength)
+				return;
+			lock (tables)
+				if (tables.Count < maxCount)
+					tables.Push(table);
+		}
+	}
+}
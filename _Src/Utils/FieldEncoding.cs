@@ -0,0 +1,11 @@
+﻿namespace SimpleBdb.Utils
+{
+	//byte order of fixed width fields extracted from BytesTable columns
+	public enum FieldEncoding
+	{
+		LittleEndian = 0,
+		BigEndian = 1,
+		//big-endian with flipped sign bit, as KeyBuilder appends integers
+		KeyOrdered = 2
+	}
+}
@@ -0,0 +1,185 @@
+using System;
+using System.Text;
+using JetBrains.Annotations;
+
+namespace SimpleBdb.Utils
+{
+	//writes order preserving key encoding into reusable buffer:
+	//integers are big-endian with flipped sign bit, strings and bytes are escaped
+	//(0x00 -> 0x00 0xFF) and terminated by 0x00 0x01, descending fields are bitwise inverted
+	public class KeyBuilder
+	{
+		private const byte escape = 0x00;
+		private const byte escapedZero = 0xFF;
+		private const byte terminator = 0x01;
+
+		private readonly KeySchema schema;
+		private byte[] buffer;
+		private int length;
+		private int fieldIndex;
+
+		public KeyBuilder([NotNull] KeySchema schema, int capacity = 64)
+		{
+			this.schema = schema;
+			buffer = new byte[Math.Max(capacity, sizeof (long))];
+		}
+
+		[NotNull]
+		public KeySchema Schema
+		{
+			get { return schema; }
+		}
+
+		public int Length
+		{
+			get { return length; }
+		}
+
+		public int FieldsCount
+		{
+			get { return fieldIndex; }
+		}
+
+		[NotNull]
+		public KeyBuilder Reset()
+		{
+			length = 0;
+			fieldIndex = 0;
+			return this;
+		}
+
+		[NotNull]
+		public KeyBuilder Append(int value)
+		{
+			return AppendFixed(KeyFieldType.Int32, (uint) value ^ 0x80000000u, sizeof (int));
+		}
+
+		[NotNull]
+		public KeyBuilder Append(uint value)
+		{
+			return AppendFixed(KeyFieldType.UInt32, value, sizeof (uint));
+		}
+
+		[NotNull]
+		public KeyBuilder Append(long value)
+		{
+			return AppendFixed(KeyFieldType.Int64, (ulong) value ^ 0x8000000000000000ul, sizeof (long));
+		}
+
+		[NotNull]
+		public KeyBuilder Append(ulong value)
+		{
+			return AppendFixed(KeyFieldType.UInt64, value, sizeof (ulong));
+		}
+
+		[NotNull]
+		public KeyBuilder Append([NotNull] string value)
+		{
+			var field = NextField(KeyFieldType.String);
+			var start = length;
+			var maxLength = Encoding.UTF8.GetMaxByteCount(value.Length);
+			EnsureCapacity(length + maxLength*2 + 2);
+			var encodedLength = Encoding.UTF8.GetBytes(value, 0, value.Length, buffer, start);
+			EscapeInPlace(start, encodedLength);
+			return CompleteField(field, start);
+		}
+
+		[NotNull]
+		public KeyBuilder Append(BytesSegment value)
+		{
+			var field = NextField(KeyFieldType.Bytes);
+			var start = length;
+			EnsureCapacity(length + value.Length*2 + 2);
+			var bytes = value.DangerousGetBytes();
+			for (var i = 0; i < value.Length; i++)
+			{
+				var b = bytes[value.Offset + i];
+				buffer[length++] = b;
+				if (b == escape)
+					buffer[length++] = escapedZero;
+			}
+			buffer[length++] = escape;
+			buffer[length++] = terminator;
+			return CompleteField(field, start);
+		}
+
+		//valid until next Reset or Append
+		public BytesSegment ToSegment()
+		{
+			return new BytesSegment(buffer, 0, length);
+		}
+
+		[NotNull]
+		public byte[] ToByteArray()
+		{
+			return ToSegment().CopyToByteArray();
+		}
+
+		[NotNull]
+		public Range ToPrefixRange()
+		{
+			return Range.Prefix(ToSegment());
+		}
+
+		private KeyBuilder AppendFixed(KeyFieldType type, ulong value, int size)
+		{
+			var field = NextField(type);
+			var start = length;
+			EnsureCapacity(length + size);
+			for (var i = size - 1; i >= 0; i--)
+			{
+				buffer[start + i] = (byte) value;
+				value >>= 8;
+			}
+			length += size;
+			return CompleteField(field, start);
+		}
+
+		private void EscapeInPlace(int start, int encodedLength)
+		{
+			var zeros = 0;
+			for (var i = start; i < start + encodedLength; i++)
+				if (buffer[i] == escape)
+					zeros++;
+			var target = start + encodedLength + zeros + 2;
+			length = target;
+			buffer[--target] = terminator;
+			buffer[--target] = escape;
+			for (var i = start + encodedLength - 1; i >= start; i--)
+			{
+				if (buffer[i] == escape)
+					buffer[--target] = escapedZero;
+				buffer[--target] = buffer[i];
+			}
+		}
+
+		private KeyBuilder CompleteField(KeyField field, int start)
+		{
+			if (field.Descending)
+				for (var i = start; i < length; i++)
+					buffer[i] = (byte) ~buffer[i];
+			fieldIndex++;
+			return this;
+		}
+
+		private KeyField NextField(KeyFieldType type)
+		{
+			if (fieldIndex >= schema.Fields.Length)
+				throw new InvalidOperationException(string.Format("all [{0}] key fields are already written", schema.Fields.Length));
+			var result = schema.Fields[fieldIndex];
+			if (result.Type != type)
+				throw new InvalidOperationException(string.Format("key field [{0}] has type [{1}], but [{2}] was written",
+					fieldIndex, result.Type, type));
+			return result;
+		}
+
+		private void EnsureCapacity(int capacity)
+		{
+			if (capacity <= buffer.Length)
+				return;
+			var newBuffer = new byte[Math.Max(capacity, buffer.Length*2)];
+			Array.Copy(buffer, newBuffer, length);
+			buffer = newBuffer;
+		}
+	}
+}
@@ -0,0 +1,90 @@
+using System;
+using JetBrains.Annotations;
+
+namespace SimpleBdb.Utils
+{
+	public enum KeyFieldType
+	{
+		Int32 = 0,
+		UInt32 = 1,
+		Int64 = 2,
+		UInt64 = 3,
+		String = 4,
+		Bytes = 5
+	}
+
+	public class KeyField
+	{
+		public KeyFieldType Type { get; private set; }
+		public bool Descending { get; private set; }
+
+		public KeyField(KeyFieldType type, bool descending)
+		{
+			Type = type;
+			Descending = descending;
+		}
+
+		//0 for variable length fields
+		public int FixedLength
+		{
+			get
+			{
+				switch (Type)
+				{
+					case KeyFieldType.Int32:
+					case KeyFieldType.UInt32:
+						return sizeof (int);
+					case KeyFieldType.Int64:
+					case KeyFieldType.UInt64:
+						return sizeof (long);
+					default:
+						return 0;
+				}
+			}
+		}
+	}
+
+	public class KeySchema
+	{
+		[NotNull]
+		public KeyField[] Fields { get; private set; }
+
+		public KeySchema([NotNull] params KeyField[] fields)
+		{
+			Fields = fields;
+		}
+
+		[NotNull]
+		public static KeyField Ascending(KeyFieldType type)
+		{
+			return new KeyField(type, false);
+		}
+
+		[NotNull]
+		public static KeyField Descending(KeyFieldType type)
+		{
+			return new KeyField(type, true);
+		}
+
+		//byte offset of field, -1 if it depends on key content
+		public int GetFixedOffset(int fieldIndex)
+		{
+			CheckFieldIndex(fieldIndex);
+			var result = 0;
+			for (var i = 0; i < fieldIndex; i++)
+			{
+				var length = Fields[i].FixedLength;
+				if (length == 0)
+					return -1;
+				result += length;
+			}
+			return result;
+		}
+
+		internal void CheckFieldIndex(int fieldIndex)
+		{
+			if (fieldIndex < 0 || fieldIndex > Fields.Length)
+				throw new InvalidOperationException(string.Format("invalid field index [{0}], fields count [{1}]", fieldIndex, Fields.Length));
+		}
+	}
+}
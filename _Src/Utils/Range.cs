@@ -87,6 +87,14 @@ namespace SimpleBdb.Utils
 			return Prefix(prefix, prefix);
 		}
 
+		[NotNull]
+		public static Range Prefix(BytesSegment prefix)
+		{
+			var left = prefix.CopyToByteArray();
+			var right = prefix.CopyToByteArray();
+			return new Range(new Boundary(left, true), IncrementInPlace(right) ? new Boundary(right, false) : null);
+		}
+
 		[NotNull]
 		public static Range Prefix([NotNull] byte[] left, [NotNull] byte[] right)
 		{
@@ -99,15 +107,20 @@ namespace SimpleBdb.Utils
 		{
 			var result = new byte[source.Length];
 			Array.Copy(source, result, source.Length);
-			for (var i = result.Length - 1; i >= 0; i--)
-				if (result[i] == Byte.MaxValue)
-					result[i] = 0;
+			return IncrementInPlace(result) ? result : null;
+		}
+
+		private static bool IncrementInPlace([NotNull] byte[] bytes)
+		{
+			for (var i = bytes.Length - 1; i >= 0; i--)
+				if (bytes[i] == Byte.MaxValue)
+					bytes[i] = 0;
 				else
 				{
-					result[i]++;
-					return result;
+					bytes[i]++;
+					return true;
 				}
-			return null;
+			return false;
 		}
 	};
 }
\ No newline at end of file